@@ -241,12 +241,12 @@ typedef union HMM_Vec2
         float Width, Height;
     };
 
-    float Elements[2];
+    float elements[2];
 
 #ifdef __cplusplus
     inline float &operator[](int Index)
     {
-        return Elements[Index];
+        return elements[Index];
     }
 #endif
 } HMM_Vec2;
@@ -292,12 +292,12 @@ typedef union HMM_Vec3
         HMM_Vec2 VW;
     };
 
-    float Elements[3];
+    float elements[3];
 
 #ifdef __cplusplus
     inline float &operator[](int Index)
     {
-        return Elements[Index];
+        return elements[Index];
     }
 #endif
 } HMM_Vec3;
@@ -352,7 +352,7 @@ typedef union HMM_Vec4
         HMM_Vec2 ZW;
     };
 
-    float Elements[4];
+    float elements[4];
 
 #ifdef HANDMADE_MATH__USE_SSE
     __m128 SSE;
@@ -361,14 +361,14 @@ typedef union HMM_Vec4
 #ifdef __cplusplus
     inline float &operator[](int Index)
     {
-        return Elements[Index];
+        return elements[Index];
     }
 #endif
 } HMM_Vec4;
 
 typedef union HMM_Mat2
 {
-    float Elements[2][2];
+    float elements[2][2];
     HMM_Vec2 Columns[2];
 
 #ifdef __cplusplus
@@ -381,7 +381,7 @@ typedef union HMM_Mat2
     
 typedef union HMM_Mat3
 {
-    float Elements[3][3];
+    float elements[3][3];
     HMM_Vec3 Columns[3];
 
 #ifdef __cplusplus
@@ -394,7 +394,7 @@ typedef union HMM_Mat3
 
 typedef union HMM_Mat4
 {
-    float Elements[4][4];
+    float elements[4][4];
     HMM_Vec4 Columns[4];
 
 #ifdef __cplusplus
@@ -421,7 +421,7 @@ typedef union HMM_Quat
         float W;
     };
 
-    float Elements[4];
+    float elements[4];
 
 #ifdef HANDMADE_MATH__USE_SSE
     __m128 SSE;
@@ -0,0 +1,397 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "atlas.h"
+
+// @Skyline =================================================================================
+
+Skyline skyline_create(i32 width, i32 height)
+{
+  Skyline skyline = {0};
+  skyline.width = width;
+  skyline.height = height;
+  skyline.nodes = malloc(sizeof (SkylineNode) * (width + 1));
+  skyline_reset(&skyline);
+
+  return skyline;
+}
+
+void skyline_destroy(Skyline *skyline)
+{
+  free(skyline->nodes);
+  *skyline = (Skyline) {0};
+}
+
+void skyline_reset(Skyline *skyline)
+{
+  skyline->node_count = 1;
+  skyline->nodes[0] = (SkylineNode) {0, 0, skyline->width};
+}
+
+// Returns the y a rect of width w would rest at when placed on node i, or -1.
+static
+i32 skyline_fit(Skyline *skyline, i32 i, i32 w, i32 h)
+{
+  i32 x = skyline->nodes[i].x;
+  if (x + w > skyline->width) return -1;
+
+  i32 y = 0;
+  i32 remaining = w;
+  for (; remaining > 0; i++)
+  {
+    if (skyline->nodes[i].y > y) y = skyline->nodes[i].y;
+    remaining -= skyline->nodes[i].w;
+  }
+
+  if (y + h > skyline->height) return -1;
+
+  return y;
+}
+
+bool skyline_insert(Skyline *skyline, i32 w, i32 h, AtlasRect *out)
+{
+  i32 best = -1;
+  i32 best_y = skyline->height + 1;
+  i32 best_w = skyline->width;
+
+  for (i32 i = 0; i < skyline->node_count; i++)
+  {
+    i32 y = skyline_fit(skyline, i, w, h);
+    if (y < 0) continue;
+
+    if (y + h < best_y || (y + h == best_y && skyline->nodes[i].w < best_w))
+    {
+      best = i;
+      best_y = y + h;
+      best_w = skyline->nodes[i].w;
+    }
+  }
+
+  if (best < 0) return FALSE;
+
+  SkylineNode node = {skyline->nodes[best].x, best_y, w};
+  *out = (AtlasRect) {node.x, best_y - h, w, h};
+
+  memmove(&skyline->nodes[best + 1],
+          &skyline->nodes[best],
+          sizeof (SkylineNode) * (skyline->node_count - best));
+  skyline->nodes[best] = node;
+  skyline->node_count++;
+
+  // Shrink or drop the nodes now covered by the new one
+  for (i32 i = best + 1; i < skyline->node_count; i++)
+  {
+    SkylineNode *prev = &skyline->nodes[i - 1];
+    SkylineNode *curr = &skyline->nodes[i];
+    if (curr->x >= prev->x + prev->w) break;
+
+    i32 shrink = prev->x + prev->w - curr->x;
+    curr->x += shrink;
+    curr->w -= shrink;
+    if (curr->w > 0) break;
+
+    memmove(curr, curr + 1, sizeof (SkylineNode) * (skyline->node_count - i - 1));
+    skyline->node_count--;
+    i--;
+  }
+
+  // Merge neighbours at the same height
+  for (i32 i = 0; i < skyline->node_count - 1; i++)
+  {
+    if (skyline->nodes[i].y == skyline->nodes[i + 1].y)
+    {
+      skyline->nodes[i].w += skyline->nodes[i + 1].w;
+      memmove(&skyline->nodes[i + 1],
+              &skyline->nodes[i + 2],
+              sizeof (SkylineNode) * (skyline->node_count - i - 2));
+      skyline->node_count--;
+      i--;
+    }
+  }
+
+  return TRUE;
+}
+
+f32 skyline_occupancy(Skyline *skyline, i64 used_area)
+{
+  return (f32) used_area / ((f32) skyline->width * skyline->height);
+}
+
+// @ShelfAtlas ==============================================================================
+
+ShelfAtlas shelf_atlas_create(i32 width, i32 height, u32 max_entries)
+{
+  ShelfAtlas atlas = {0};
+  atlas.width = width;
+  atlas.height = height;
+  atlas.shelf_cap = height;
+  atlas.shelves = malloc(sizeof (AtlasShelf) * atlas.shelf_cap);
+  atlas.entry_cap = max_entries;
+  atlas.entries = calloc(max_entries, sizeof (AtlasEntry));
+  atlas.free_entries = malloc(sizeof (u32) * max_entries);
+
+  for (u32 i = 0; i < max_entries; i++)
+  {
+    atlas.free_entries[i] = max_entries - i - 1;
+  }
+
+  atlas.free_count = max_entries;
+
+  return atlas;
+}
+
+void shelf_atlas_destroy(ShelfAtlas *atlas)
+{
+  free(atlas->shelves);
+  free(atlas->entries);
+  free(atlas->free_entries);
+  *atlas = (ShelfAtlas) {0};
+}
+
+static
+u32 shelf_atlas_find_shelf(ShelfAtlas *atlas, i32 y)
+{
+  u32 lo = 0;
+  u32 hi = atlas->shelf_count;
+
+  while (lo < hi)
+  {
+    u32 mid = lo + (hi - lo) / 2;
+    if (atlas->shelves[mid].y < y) lo = mid + 1;
+    else hi = mid;
+  }
+
+  ASSERT(lo < atlas->shelf_count && atlas->shelves[lo].y == y);
+
+  return lo;
+}
+
+static
+void shelf_atlas_remove_shelf(ShelfAtlas *atlas, u32 i)
+{
+  memmove(&atlas->shelves[i],
+          &atlas->shelves[i + 1],
+          sizeof (AtlasShelf) * (atlas->shelf_count - i - 1));
+  atlas->shelf_count--;
+}
+
+// Merges runs of empty shelves and hands a trailing empty run back to the free
+// space above shelf_top, so it can be cut again at any height.
+static
+void shelf_atlas_compact(ShelfAtlas *atlas)
+{
+  for (u32 i = 0; i + 1 < atlas->shelf_count;)
+  {
+    AtlasShelf *curr = &atlas->shelves[i];
+    AtlasShelf *next = &atlas->shelves[i + 1];
+
+    if (curr->live_count == 0 && next->live_count == 0)
+    {
+      curr->height += next->height;
+      shelf_atlas_remove_shelf(atlas, i + 1);
+    }
+    else
+    {
+      i++;
+    }
+  }
+
+  if (atlas->shelf_count > 0 && atlas->shelves[atlas->shelf_count - 1].live_count == 0)
+  {
+    atlas->shelf_top = atlas->shelves[atlas->shelf_count - 1].y;
+    atlas->shelf_count--;
+  }
+}
+
+static
+void shelf_atlas_evict_shelf(ShelfAtlas *atlas, u32 shelf)
+{
+  i32 y = atlas->shelves[shelf].y;
+
+  for (u32 i = 0; i < atlas->entry_cap; i++)
+  {
+    AtlasEntry *entry = &atlas->entries[i];
+    if (!entry->live || entry->rect.y != y) continue;
+
+    entry->live = FALSE;
+    entry->generation++;
+    atlas->used_area -= (i64) entry->rect.w * entry->rect.h;
+    atlas->free_entries[atlas->free_count++] = i;
+    atlas->evictions++;
+  }
+
+  atlas->shelves[shelf].live_count = 0;
+  atlas->shelves[shelf].used_width = 0;
+}
+
+// Picks the shelf that wastes the least height, or cuts a new one.
+static
+i32 shelf_atlas_place(ShelfAtlas *atlas, i32 w, i32 h)
+{
+  i32 best = -1;
+  i32 best_waste = atlas->height;
+  i32 max_waste = h / 4 + 1;
+
+  for (u32 i = 0; i < atlas->shelf_count; i++)
+  {
+    AtlasShelf *shelf = &atlas->shelves[i];
+    if (shelf->height < h || shelf->used_width + w > atlas->width) continue;
+
+    i32 waste = shelf->height - h;
+    if (shelf->live_count > 0 && waste > max_waste) continue;
+
+    if (waste < best_waste)
+    {
+      best = i;
+      best_waste = waste;
+    }
+  }
+
+  if (best >= 0)
+  {
+    AtlasShelf *shelf = &atlas->shelves[best];
+
+    // Split an empty shelf that is much taller than needed
+    if (shelf->live_count == 0 && best_waste > max_waste)
+    {
+      memmove(&atlas->shelves[best + 1],
+              &atlas->shelves[best],
+              sizeof (AtlasShelf) * (atlas->shelf_count - best));
+      atlas->shelf_count++;
+      atlas->shelves[best].height = h;
+      atlas->shelves[best + 1].y += h;
+      atlas->shelves[best + 1].height -= h;
+    }
+
+    return best;
+  }
+
+  if (atlas->shelf_top + h <= atlas->height)
+  {
+    atlas->shelves[atlas->shelf_count] = (AtlasShelf) {.y = atlas->shelf_top, .height = h};
+    atlas->shelf_top += h;
+
+    return atlas->shelf_count++;
+  }
+
+  return -1;
+}
+
+bool shelf_atlas_alloc(ShelfAtlas *atlas, i32 w, i32 h, AtlasHandle *handle, AtlasRect *rect)
+{
+  if (w > atlas->width || h > atlas->height) return FALSE;
+
+  i32 shelf = atlas->free_count ? shelf_atlas_place(atlas, w, h) : -1;
+
+  while (shelf < 0)
+  {
+    // Evict the least recently used shelf that was not touched this frame
+    i32 victim = -1;
+    for (u32 i = 0; i < atlas->shelf_count; i++)
+    {
+      AtlasShelf *s = &atlas->shelves[i];
+      if (s->live_count == 0 || s->last_used >= atlas->frame) continue;
+      if (victim < 0 || s->last_used < atlas->shelves[victim].last_used) victim = i;
+    }
+
+    if (victim < 0) return FALSE;
+
+    shelf_atlas_evict_shelf(atlas, victim);
+    shelf_atlas_compact(atlas);
+    shelf = atlas->free_count ? shelf_atlas_place(atlas, w, h) : -1;
+  }
+
+  AtlasShelf *s = &atlas->shelves[shelf];
+  u32 index = atlas->free_entries[--atlas->free_count];
+  AtlasEntry *entry = &atlas->entries[index];
+
+  entry->rect = (AtlasRect) {s->used_width, s->y, w, h};
+  entry->last_used = atlas->frame;
+  entry->live = TRUE;
+
+  s->used_width += w;
+  s->live_count++;
+  s->last_used = atlas->frame;
+  atlas->used_area += (i64) w * h;
+
+  *handle = (AtlasHandle) {index, entry->generation};
+  *rect = entry->rect;
+
+  return TRUE;
+}
+
+bool shelf_atlas_touch(ShelfAtlas *atlas, AtlasHandle handle, AtlasRect *rect)
+{
+  AtlasEntry *entry = &atlas->entries[handle.index];
+  if (!entry->live || entry->generation != handle.generation) return FALSE;
+
+  entry->last_used = atlas->frame;
+  atlas->shelves[shelf_atlas_find_shelf(atlas, entry->rect.y)].last_used = atlas->frame;
+  if (rect) *rect = entry->rect;
+
+  return TRUE;
+}
+
+void shelf_atlas_free(ShelfAtlas *atlas, AtlasHandle handle)
+{
+  AtlasEntry *entry = &atlas->entries[handle.index];
+  if (!entry->live || entry->generation != handle.generation) return;
+
+  AtlasShelf *shelf = &atlas->shelves[shelf_atlas_find_shelf(atlas, entry->rect.y)];
+  shelf->live_count--;
+  if (shelf->live_count == 0) shelf->used_width = 0;
+
+  entry->live = FALSE;
+  entry->generation++;
+  atlas->used_area -= (i64) entry->rect.w * entry->rect.h;
+  atlas->free_entries[atlas->free_count++] = handle.index;
+
+  if (shelf->live_count == 0) shelf_atlas_compact(atlas);
+}
+
+void shelf_atlas_next_frame(ShelfAtlas *atlas)
+{
+  atlas->frame++;
+}
+
+f32 shelf_atlas_occupancy(ShelfAtlas *atlas)
+{
+  return (f32) atlas->used_area / ((f32) atlas->width * atlas->height);
+}
+
+// @AtlasSprite =============================================================================
+
+// FNV-1a
+u32 atlas_hash(const i8 *name)
+{
+  u32 hash = 2166136261u;
+  for (; *name; name++)
+  {
+    hash ^= (u8) *name;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+const AtlasSprite *atlas_find(const AtlasSprite *sprites, u32 count, const i8 *name)
+{
+  u32 hash = atlas_hash(name);
+  u32 lo = 0;
+  u32 hi = count;
+
+  while (lo < hi)
+  {
+    u32 mid = lo + (hi - lo) / 2;
+    if (sprites[mid].hash < hash) lo = mid + 1;
+    else hi = mid;
+  }
+
+  for (; lo < count && sprites[lo].hash == hash; lo++)
+  {
+    if (strcmp(sprites[lo].name, name) == 0) return &sprites[lo];
+  }
+
+  return NULL;
+}
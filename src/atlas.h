@@ -0,0 +1,117 @@
+#pragma once
+
+#include "base_common.h"
+
+typedef struct AtlasRect AtlasRect;
+struct AtlasRect
+{
+  i32 x;
+  i32 y;
+  i32 w;
+  i32 h;
+};
+
+// @Skyline =================================================================================
+
+typedef struct SkylineNode SkylineNode;
+struct SkylineNode
+{
+  i32 x;
+  i32 y;
+  i32 w;
+};
+
+// Bottom-left skyline packer. Never frees individual rects, only resets.
+typedef struct Skyline Skyline;
+struct Skyline
+{
+  i32 width;
+  i32 height;
+  i32 node_count;
+  SkylineNode *nodes;
+};
+
+Skyline skyline_create(i32 width, i32 height);
+void skyline_destroy(Skyline *skyline);
+void skyline_reset(Skyline *skyline);
+bool skyline_insert(Skyline *skyline, i32 w, i32 h, AtlasRect *out);
+f32 skyline_occupancy(Skyline *skyline, i64 used_area);
+
+// @ShelfAtlas ==============================================================================
+
+// Handles go stale when their entry is evicted; generation tells them apart.
+typedef struct AtlasHandle AtlasHandle;
+struct AtlasHandle
+{
+  u32 index;
+  u32 generation;
+};
+
+typedef struct AtlasShelf AtlasShelf;
+struct AtlasShelf
+{
+  i32 y;
+  i32 height;
+  i32 used_width;
+  u32 live_count;
+  u64 last_used;
+};
+
+typedef struct AtlasEntry AtlasEntry;
+struct AtlasEntry
+{
+  AtlasRect rect;
+  u32 generation;
+  u64 last_used;
+  bool live;
+};
+
+// Shelf allocator for atlases filled at runtime. Space is reclaimed a whole
+// shelf at a time, least recently used first.
+typedef struct ShelfAtlas ShelfAtlas;
+struct ShelfAtlas
+{
+  i32 width;
+  i32 height;
+  i32 shelf_top;
+
+  AtlasShelf *shelves;
+  u32 shelf_count;
+  u32 shelf_cap;
+
+  AtlasEntry *entries;
+  u32 *free_entries;
+  u32 entry_cap;
+  u32 free_count;
+
+  u64 frame;
+  i64 used_area;
+  u32 evictions;
+};
+
+ShelfAtlas shelf_atlas_create(i32 width, i32 height, u32 max_entries);
+void shelf_atlas_destroy(ShelfAtlas *atlas);
+bool shelf_atlas_alloc(ShelfAtlas *atlas, i32 w, i32 h, AtlasHandle *handle, AtlasRect *rect);
+bool shelf_atlas_touch(ShelfAtlas *atlas, AtlasHandle handle, AtlasRect *rect);
+void shelf_atlas_free(ShelfAtlas *atlas, AtlasHandle handle);
+void shelf_atlas_next_frame(ShelfAtlas *atlas);
+f32 shelf_atlas_occupancy(ShelfAtlas *atlas);
+
+// @AtlasSprite =============================================================================
+
+// Entries are emitted sorted by hash so lookup is a binary search.
+typedef struct AtlasSprite AtlasSprite;
+struct AtlasSprite
+{
+  u32 hash;
+  u16 page;
+  u16 x;
+  u16 y;
+  u16 w;
+  u16 h;
+  f32 uv[4]; // u0, v0, u1, v1
+  const i8 *name;
+};
+
+u32 atlas_hash(const i8 *name);
+const AtlasSprite *atlas_find(const AtlasSprite *sprites, u32 count, const i8 *name);
@@ -23,6 +23,8 @@ typedef double f64;
 
 #define ASSERT(exp) assert(exp)
 #define ARR_LEN(arr) (sizeof (arr) / sizeof (arr[0]))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
 
 #ifndef NULL
 #define NULL (void *) 0
@@ -32,8 +34,28 @@ typedef double f64;
 #define typeof(type) __typeof__(type)
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64)
+#define SIMD_SSE
+#include <emmintrin.h>
+#endif
+
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined(__F16C__)
+#define SIMD_F16C
+#include <immintrin.h>
+#endif
+
 // @Local ===================================================================================
 
+// On unless the build passes -DNDEBUG: GL error checks, shader logs and debug drawing
+#ifndef NDEBUG
+#define DEBUG
+#endif
+
 #define VSYNC_AUTO -1
 #define VSYNC_OFF 0
 #define VSYNC_ON 1
@@ -1,47 +1,257 @@
+// Compiled on its own for the out-of-line build, or included by base_math.h
+// when BASE_MATH_HEADER_ONLY is defined.
+#ifndef BASE_MATH_C
+#define BASE_MATH_C
+
 #include <math.h>
 
 #include "base_common.h"
 #include "base_math.h"
 
+// @Trig ====================================================================================
+
+// Arguments are reduced to r in [-pi/4, pi/4] around the nearest multiple q of
+// pi/2, then sin and cos of r are swapped and negated by the quadrant bits of q.
+// The precise tier subtracts pi/2 in three parts (Cody-Waite) so the reduction
+// stays exact for large q; the minimax coefficients are from Cephes.
+
+#define TRIG_2_OVER_PI 0.636619772367581f
+#define TRIG_PI_2 1.57079632679490f
+#define TRIG_PI_2_A 1.5703125f
+#define TRIG_PI_2_B 4.837512969970703125e-4f
+#define TRIG_PI_2_C 7.54978995489188216e-8f
+
+#define TRIG_SIN_1 -1.6666654611e-1f
+#define TRIG_SIN_2 8.3321608736e-3f
+#define TRIG_SIN_3 -1.9515295891e-4f
+#define TRIG_COS_1 4.166664568298827e-2f
+#define TRIG_COS_2 -1.388731625493765e-3f
+#define TRIG_COS_3 2.443315711809948e-5f
+
+#define TRIG_FAST_SIN_1 -0.16226f
+#define TRIG_FAST_COS_1 -0.49976f
+#define TRIG_FAST_COS_2 0.04046f
+
+MATH_API
+void sincos_f32(f32 x, TrigPrecision precision, f32 *s, f32 *c)
+{
+  // Round to nearest without floorf, which is a libm call below SSE4.1
+  f32 k = x * TRIG_2_OVER_PI;
+  #ifdef SIMD_SSE
+  i32 q = _mm_cvtss_si32(_mm_set_ss(k));
+  #else
+  i32 q = (i32) (k + (k < 0.0f ? -0.5f : 0.5f));
+  #endif
+  f32 qf = (f32) q;
+  f32 ps, pc;
+
+  if (precision == TRIG_FAST)
+  {
+    f32 r = x - qf * TRIG_PI_2;
+    f32 r2 = r * r;
+    ps = r + r * r2 * TRIG_FAST_SIN_1;
+    pc = 1.0f + r2 * (TRIG_FAST_COS_1 + r2 * TRIG_FAST_COS_2);
+  }
+  else
+  {
+    f32 r = ((x - qf * TRIG_PI_2_A) - qf * TRIG_PI_2_B) - qf * TRIG_PI_2_C;
+    f32 r2 = r * r;
+    ps = r + r * r2 * (TRIG_SIN_1 + r2 * (TRIG_SIN_2 + r2 * TRIG_SIN_3));
+    pc = 1.0f - 0.5f * r2 + r2 * r2 * (TRIG_COS_1 + r2 * (TRIG_COS_2 + r2 * TRIG_COS_3));
+  }
+
+  // Branch-free quadrant fix-up; random angles mispredict every branch
+  union { f32 f; u32 u; } bs = {ps}, bc = {pc}, rs, rc;
+  u32 swap = 0u - (u32) (q & 1);
+  rs.u = (bc.u & swap) | (bs.u & ~swap);
+  rc.u = (bs.u & swap) | (bc.u & ~swap);
+  rs.u ^= (u32) (q & 2) << 30;
+  rc.u ^= (u32) ((q + 1) & 2) << 30;
+  *s = rs.f;
+  *c = rc.f;
+}
+
+#ifdef SIMD_SSE
+static inline
+void sincos_ps(__m128 x, TrigPrecision precision, __m128 *s, __m128 *c)
+{
+  const __m128i one = _mm_set1_epi32(1);
+  const __m128i two = _mm_set1_epi32(2);
+
+  __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TRIG_2_OVER_PI)));
+  __m128 qf = _mm_cvtepi32_ps(q);
+  __m128 ps, pc;
+
+  if (precision == TRIG_FAST)
+  {
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(TRIG_PI_2)));
+    __m128 r2 = _mm_mul_ps(r, r);
+    ps = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), _mm_set1_ps(TRIG_FAST_SIN_1)));
+    pc = _mm_add_ps(_mm_set1_ps(TRIG_FAST_COS_1), _mm_mul_ps(r2, _mm_set1_ps(TRIG_FAST_COS_2)));
+    pc = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, pc));
+  }
+  else
+  {
+    __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(TRIG_PI_2_A)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(TRIG_PI_2_B)));
+    r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(TRIG_PI_2_C)));
+    __m128 r2 = _mm_mul_ps(r, r);
+
+    ps = _mm_add_ps(_mm_set1_ps(TRIG_SIN_2), _mm_mul_ps(r2, _mm_set1_ps(TRIG_SIN_3)));
+    ps = _mm_add_ps(_mm_set1_ps(TRIG_SIN_1), _mm_mul_ps(r2, ps));
+    ps = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), ps));
+
+    pc = _mm_add_ps(_mm_set1_ps(TRIG_COS_2), _mm_mul_ps(r2, _mm_set1_ps(TRIG_COS_3)));
+    pc = _mm_add_ps(_mm_set1_ps(TRIG_COS_1), _mm_mul_ps(r2, pc));
+    pc = _mm_mul_ps(_mm_mul_ps(r2, r2), pc);
+    pc = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, _mm_set1_ps(0.5f))), pc);
+  }
+
+  __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+  __m128 sin_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30));
+  __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30));
+
+  __m128 rs = _mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps));
+  __m128 rc = _mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc));
+  *s = _mm_xor_ps(rs, sin_sign);
+  *c = _mm_xor_ps(rc, cos_sign);
+}
+#endif
+
+#ifdef SIMD_AVX2
+static inline
+void sincos_ps256(__m256 x, TrigPrecision precision, __m256 *s, __m256 *c)
+{
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i two = _mm256_set1_epi32(2);
+
+  __m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(TRIG_2_OVER_PI)));
+  __m256 qf = _mm256_cvtepi32_ps(q);
+  __m256 ps, pc;
+
+  if (precision == TRIG_FAST)
+  {
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(qf, _mm256_set1_ps(TRIG_PI_2)));
+    __m256 r2 = _mm256_mul_ps(r, r);
+    ps = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), _mm256_set1_ps(TRIG_FAST_SIN_1)));
+    pc = _mm256_add_ps(_mm256_set1_ps(TRIG_FAST_COS_1), 
+                       _mm256_mul_ps(r2, _mm256_set1_ps(TRIG_FAST_COS_2)));
+    pc = _mm256_add_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(r2, pc));
+  }
+  else
+  {
+    __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(qf, _mm256_set1_ps(TRIG_PI_2_A)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(TRIG_PI_2_B)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(TRIG_PI_2_C)));
+    __m256 r2 = _mm256_mul_ps(r, r);
+
+    ps = _mm256_add_ps(_mm256_set1_ps(TRIG_SIN_2), _mm256_mul_ps(r2, _mm256_set1_ps(TRIG_SIN_3)));
+    ps = _mm256_add_ps(_mm256_set1_ps(TRIG_SIN_1), _mm256_mul_ps(r2, ps));
+    ps = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), ps));
+
+    pc = _mm256_add_ps(_mm256_set1_ps(TRIG_COS_2), _mm256_mul_ps(r2, _mm256_set1_ps(TRIG_COS_3)));
+    pc = _mm256_add_ps(_mm256_set1_ps(TRIG_COS_1), _mm256_mul_ps(r2, pc));
+    pc = _mm256_mul_ps(_mm256_mul_ps(r2, r2), pc);
+    pc = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), 
+                                     _mm256_mul_ps(r2, _mm256_set1_ps(0.5f))), pc);
+  }
+
+  __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+  __m256 sin_sign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30));
+  __m256 cos_sign = _mm256_castsi256_ps(
+    _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30));
+
+  *s = _mm256_xor_ps(_mm256_blendv_ps(ps, pc, swap), sin_sign);
+  *c = _mm256_xor_ps(_mm256_blendv_ps(pc, ps, swap), cos_sign);
+}
+#endif
+
+MATH_API
+void sincos_4f32(const f32 *x, TrigPrecision precision, f32 *s, f32 *c)
+{
+  #ifdef SIMD_SSE
+  __m128 vs, vc;
+  sincos_ps(_mm_loadu_ps(x), precision, &vs, &vc);
+  _mm_storeu_ps(s, vs);
+  _mm_storeu_ps(c, vc);
+  #else
+  for (u32 i = 0; i < 4; i++) sincos_f32(x[i], precision, &s[i], &c[i]);
+  #endif
+}
+
+MATH_API
+void sincos_8f32(const f32 *x, TrigPrecision precision, f32 *s, f32 *c)
+{
+  #if defined(SIMD_AVX2)
+  __m256 vs, vc;
+  sincos_ps256(_mm256_loadu_ps(x), precision, &vs, &vc);
+  _mm256_storeu_ps(s, vs);
+  _mm256_storeu_ps(c, vc);
+  #else
+  sincos_4f32(x, precision, s, c);
+  sincos_4f32(x + 4, precision, s + 4, c + 4);
+  #endif
+}
+
+// @SIMD ====================================================================================
+
+#ifdef SIMD_SSE
+static inline
+__m128 cross_ps(__m128 a, __m128 b)
+{
+  __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+
+  return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+}
+
+static inline
+__m128 splat_w_ps(__m128 a)
+{
+  return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+}
+#endif
+
 // @Vec2F ===================================================================================
 
-inline
+MATH_API
 Vec2F v2f(f32 x, f32 y)
 {
   return (Vec2F) {x, y};
 }
 
-inline
+MATH_API
 Vec2F add_2f(Vec2F a, Vec2F b)
 {
   return (Vec2F) {a.x + b.x, a.y + b.y};
 }
 
-inline
+MATH_API
 Vec2F sub_2f(Vec2F a, Vec2F b)
 {
   return (Vec2F) {a.x - b.x, a.y - b.y};
 }
 
-inline
+MATH_API
 Vec2F mul_2f(Vec2F a, Vec2F b)
 {
   return (Vec2F) {a.x * b.x, a.y * b.y};
 }
 
-inline
+MATH_API
 Vec2F div_2f(Vec2F a, Vec2F b)
 {
   return (Vec2F) {a.x / b.x, a.y / b.y};
 }
 
-inline
+MATH_API
 f32 dot_2f(Vec2F a, Vec2F b)
 {
   return (a.x * b.x) + (a.y * b.y);
 }
 
-inline
+MATH_API
 f32 cross_2f(Vec2F a, Vec2F b)
 {
   f32 result;
@@ -50,89 +260,102 @@ f32 cross_2f(Vec2F a, Vec2F b)
   return result;
 }
 
-inline
+MATH_API
 Vec2F scale_2f(Vec2F v, f32 scale)
 {
   return (Vec2F) {v.x * scale, v.y * scale};
 }
 
-inline
+MATH_API
 f32 magnitude_2f(Vec2F v)
 {
-  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f));
+  return sqrtf(dot_2f(v, v));
 }
 
-inline
+MATH_API
 f32 magnitude_squared_2f(Vec2F v)
 {
-  return powf(v.x, 2.0f) + powf(v.y, 2.0f);
+  return dot_2f(v, v);
 }
 
-inline
+MATH_API
 f32 distance_2f(Vec2F a, Vec2F b)
 {
-  Vec2F v = sub_2f(b, a);
-  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f));
+  return magnitude_2f(sub_2f(b, a));
 }
 
-inline
+MATH_API
 f32 distance_squared_2f(Vec2F a, Vec2F b)
 {
-  Vec2F v = sub_2f(b, a);
-  return powf(v.x, 2.0f) + powf(v.y, 2.0f);
+  return magnitude_squared_2f(sub_2f(b, a));
 }
 
-inline
+MATH_API
 Vec2F normalize_2f(Vec2F v)
 {
   return scale_2f(v, 1.0f / magnitude_2f(v));
 }
 
-inline
+MATH_API
+Vec2F normalize_fast_2f(Vec2F v)
+{
+  return scale_2f(v, rsqrt_f32(dot_2f(v, v)));
+}
+
+MATH_API
+Vec2F normalize_safe_2f(Vec2F v)
+{
+  f32 len_sq = dot_2f(v, v);
+  if (!(len_sq > NORMALIZE_MIN_SQUARED)) return V2F_ZERO;
+
+  return scale_2f(v, 1.0f / sqrtf(len_sq));
+}
+
+MATH_API
 Vec2F lerp_2f(Vec2F curr, Vec2F target, f32 rate)
 {
-  return scale_2f(sub_2f(target, curr), rate);
+  return add_2f(curr, scale_2f(sub_2f(target, curr), rate));
 }
 
 // @Vec3F ===================================================================================
 
-inline
+MATH_API
 Vec3F v3f(f32 x, f32 y, f32 z)
 {
   return (Vec3F) {x, y, z};
 }
 
-inline
+MATH_API
 Vec3F add_3f(Vec3F a, Vec3F b)
 {
   return (Vec3F) {a.x + b.x, a.y + b.y, a.z + b.z};
 }
 
-inline
+MATH_API
 Vec3F sub_3f(Vec3F a, Vec3F b)
 {
   return (Vec3F) {a.x - b.x, a.y - b.y, a.z - b.z};
 }
 
-inline
+MATH_API
 Vec3F mul_3f(Vec3F a, Vec3F b)
 {
   return (Vec3F) {a.x * b.x, a.y * b.y, a.z * b.z};
 }
 
-inline
+MATH_API
 Vec3F div_3f(Vec3F a, Vec3F b)
 {
   return (Vec3F) {a.x / b.x, a.y / b.y, a.z / b.z};
 }
 
-inline
+MATH_API
 f32 dot_3f(Vec3F a, Vec3F b)
 {
   return (a.x * b.x) + (a.y * b.y) + (a.z * b.z);
 }
 
-inline
+MATH_API
 Vec3F cross_3f(Vec3F a, Vec3F b)
 {
   Vec3F result;
@@ -143,12 +366,13 @@ Vec3F cross_3f(Vec3F a, Vec3F b)
   return result;
 }
 
-inline
+MATH_API
 Vec3F scale_3f(Vec3F v, f32 scale)
 {
   return (Vec3F) {v.x * scale, v.y * scale, v.z * scale};
 }
 
+MATH_API
 Vec3F transform_3f(Vec3F v, Mat3x3F m)
 {
   Vec3F result = {0};
@@ -162,138 +386,60 @@ Vec3F transform_3f(Vec3F v, Mat3x3F m)
   return result;
 }
 
-inline
+MATH_API
 f32 magnitude_3f(Vec3F v)
 {
-  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f));
+  return sqrtf(dot_3f(v, v));
 }
 
-inline
+MATH_API
 f32 magnitude_squared_3f(Vec3F v)
 {
-  return powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f);
+  return dot_3f(v, v);
 }
 
-inline
+MATH_API
 f32 distance_3f(Vec3F a, Vec3F b)
 {
-  Vec3F v = sub_3f(b, a);
-  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f));
+  return magnitude_3f(sub_3f(b, a));
 }
 
-inline
+MATH_API
 f32 distance_squared_3f(Vec3F a, Vec3F b)
 {
-  Vec3F v = sub_3f(b, a);
-  return powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f);
+  return magnitude_squared_3f(sub_3f(b, a));
 }
 
-inline
+MATH_API
 Vec3F normalize_3f(Vec3F v)
 {
   return scale_3f(v, 1.0f / magnitude_3f(v));
 }
 
-inline
-Vec3F lerp_3f(Vec3F curr, Vec3F target, f32 rate)
-{
-  return scale_3f(sub_3f(target, curr), rate);
-}
-
-// @Vec4F ===================================================================================
-
-inline
-Vec4F v4f(f32 x, f32 y, f32 z, f32 w)
-{
-  return (Vec4F) {x, y, z, w};
-}
-
-inline
-Vec4F add_4f(Vec4F a, Vec4F b)
+MATH_API
+Vec3F normalize_fast_3f(Vec3F v)
 {
-  return (Vec4F) {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+  return scale_3f(v, rsqrt_f32(dot_3f(v, v)));
 }
 
-inline
-Vec4F sub_4f(Vec4F a, Vec4F b)
+MATH_API
+Vec3F normalize_safe_3f(Vec3F v)
 {
-  return (Vec4F) {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
-}
+  f32 len_sq = dot_3f(v, v);
+  if (!(len_sq > NORMALIZE_MIN_SQUARED)) return V3F_ZERO;
 
-inline
-Vec4F mul_4f(Vec4F a, Vec4F b)
-{
-  return (Vec4F) {a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w};
+  return scale_3f(v, 1.0f / sqrtf(len_sq));
 }
 
-inline
-Vec4F div_4f(Vec4F a, Vec4F b)
-{
-  return (Vec4F) {a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w};
-}
-
-inline
-f32 dot_4f(Vec4F a, Vec4F b)
-{
-  return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
-}
-
-inline
-Vec4F scale_4f(Vec4F v, f32 scale)
-{
-  return (Vec4F) {v.x * scale, v.y * scale, v.z * scale, v.w * scale};
-}
-
-Vec4F transform_4f(Vec4F v, Mat4x4F m)
-{
-  Vec4F result = {0};
-
-  for (u8 c = 0; c < 4; c++)
-  {
-    result.x += m.elements[0][c] * v.elements[c];
-    result.y += m.elements[1][c] * v.elements[c];
-    result.z += m.elements[2][c] * v.elements[c];
-    result.w += m.elements[3][c] * v.elements[c];
-  }
-
-  return result;
-}
-
-inline
-f32 magnitude_4f(Vec4F v)
-{
-  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f) + powf(v.z, 2.0f));
-}
-
-inline
-f32 magnitude_squared_4f(Vec4F v)
-{
-  return powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f) + powf(v.z, 2.0f);
-}
-
-inline
-f32 distance_4f(Vec4F a, Vec4F b)
-{
-  Vec4F v = sub_4f(b, a);
-  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f) + powf(v.w, 2.0f));
-}
-
-inline
-f32 distance_squared_4f(Vec4F a, Vec4F b)
-{
-  Vec4F v = sub_4f(b, a);
-  return powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f) + powf(v.w, 2.0f);
-}
-
-inline
-Vec4F normalize_4f(Vec4F v)
+MATH_API
+Vec3F lerp_3f(Vec3F curr, Vec3F target, f32 rate)
 {
-  return scale_4f(v, 1.0f / magnitude_4f(v));
+  return add_3f(curr, scale_3f(sub_3f(target, curr), rate));
 }
 
 // @Mat3x3F =================================================================================
 
-inline
+MATH_API
 Mat3x3F m3x3f(f32 k)
 {
   return (Mat3x3F)
@@ -306,7 +452,7 @@ Mat3x3F m3x3f(f32 k)
   };
 }
 
-inline
+MATH_API
 Mat3x3F rows_3x3f(Vec3F v1, Vec3F v2, Vec3F v3)
 {
   return (Mat3x3F)
@@ -319,7 +465,7 @@ Mat3x3F rows_3x3f(Vec3F v1, Vec3F v2, Vec3F v3)
   };
 }
 
-inline
+MATH_API
 Mat3x3F cols_3x3f(Vec3F v1, Vec3F v2, Vec3F v3)
 {
   return (Mat3x3F)
@@ -332,6 +478,7 @@ Mat3x3F cols_3x3f(Vec3F v1, Vec3F v2, Vec3F v3)
   };
 }
 
+MATH_API
 Mat3x3F mul_3x3f(Mat3x3F a, Mat3x3F b)
 {
   Mat3x3F result = {0};
@@ -349,6 +496,7 @@ Mat3x3F mul_3x3f(Mat3x3F a, Mat3x3F b)
   return result;
 }
 
+MATH_API
 Mat3x3F transpose_3x3f(Mat3x3F m)
 {
   Mat3x3F result = m;
@@ -362,6 +510,7 @@ Mat3x3F transpose_3x3f(Mat3x3F m)
   return result;
 }
 
+MATH_API
 Mat3x3F translate_3x3f(f32 x_shift, f32 y_shift)
 {
   Mat3x3F result = m3x3f(1.0f);
@@ -371,17 +520,22 @@ Mat3x3F translate_3x3f(f32 x_shift, f32 y_shift)
   return result;
 }
 
+MATH_API
 Mat3x3F rotate_3x3f(f32 angle)
 {
+  f32 s, c;
+  sincos_f32(angle * (f32) (PI / 180.0), TRIG_PRECISE, &s, &c);
+
   Mat3x3F result = m3x3f(1.0f);
-  result.elements[0][0] = cos(angle * (PI / 180.0f));
-  result.elements[0][1] = -sin(angle * (PI / 180.0f));
-  result.elements[1][0] = sin(angle * (PI / 180.0f));
-  result.elements[1][1] = cos(angle * (PI / 180.0f));
+  result.elements[0][0] = c;
+  result.elements[0][1] = -s;
+  result.elements[1][0] = s;
+  result.elements[1][1] = c;
 
   return result;
 }
 
+MATH_API
 Mat3x3F scale_3x3f(f32 x_scale, f32 y_scale)
 {
   Mat3x3F result = m3x3f(1.0f);
@@ -391,6 +545,7 @@ Mat3x3F scale_3x3f(f32 x_scale, f32 y_scale)
   return result;
 }
 
+MATH_API
 Mat3x3F shear_3x3f(f32 x_shear, f32 y_shear)
 {
   Mat3x3F result = m3x3f(1.0f);
@@ -400,6 +555,7 @@ Mat3x3F shear_3x3f(f32 x_shear, f32 y_shear)
   return result;
 }
 
+MATH_API
 Mat3x3F orthographic_3x3f(f32 left, f32 right, f32 bot, f32 top)
 {
   Mat3x3F result = m3x3f(0.0f);
@@ -412,9 +568,106 @@ Mat3x3F orthographic_3x3f(f32 left, f32 right, f32 bot, f32 top)
   return result;
 }
 
+// @Affine2F ================================================================================
+
+MATH_API
+Affine2F a2f(Vec2F pos, f32 angle, Vec2F scale)
+{
+  f32 s, c;
+  sincos_f32(angle * (f32) (PI / 180.0), TRIG_PRECISE, &s, &c);
+
+  return (Affine2F)
+  {
+    {
+      {c * scale.x, -s * scale.y, pos.x},
+      {s * scale.x, c * scale.y, pos.y}
+    }
+  };
+}
+
+// a * b, like mul_3x3f: b is applied first.
+MATH_API
+Affine2F mul_a2f(Affine2F a, Affine2F b)
+{
+  Affine2F result;
+
+  for (u8 r = 0; r < 2; r++)
+  {
+    const f32 *row = a.elements[r];
+    result.elements[r][0] = row[0] * b.elements[0][0] + row[1] * b.elements[1][0];
+    result.elements[r][1] = row[0] * b.elements[0][1] + row[1] * b.elements[1][1];
+    result.elements[r][2] = row[0] * b.elements[0][2] + row[1] * b.elements[1][2] + row[2];
+  }
+
+  return result;
+}
+
+MATH_API
+Affine2F invert_a2f(Affine2F m)
+{
+  f32 a = m.elements[0][0], b = m.elements[0][1], tx = m.elements[0][2];
+  f32 c = m.elements[1][0], d = m.elements[1][1], ty = m.elements[1][2];
+  f32 inv_det = 1.0f / (a * d - b * c);
+
+  Affine2F result;
+  result.elements[0][0] = d * inv_det;
+  result.elements[0][1] = -b * inv_det;
+  result.elements[1][0] = -c * inv_det;
+  result.elements[1][1] = a * inv_det;
+  result.elements[0][2] = -(result.elements[0][0] * tx + result.elements[0][1] * ty);
+  result.elements[1][2] = -(result.elements[1][0] * tx + result.elements[1][1] * ty);
+
+  return result;
+}
+
+MATH_API
+Vec2F transform_a2f(Vec2F p, Affine2F m)
+{
+  return (Vec2F)
+  {
+    m.elements[0][0] * p.x + m.elements[0][1] * p.y + m.elements[0][2],
+    m.elements[1][0] * p.x + m.elements[1][1] * p.y + m.elements[1][2],
+  };
+}
+
+MATH_API
+Affine2F translate_a2f(f32 x_shift, f32 y_shift)
+{
+  Affine2F result = A2F_IDENTITY;
+  result.elements[0][2] = x_shift;
+  result.elements[1][2] = y_shift;
+
+  return result;
+}
+
+MATH_API
+Affine2F orthographic_a2f(f32 left, f32 right, f32 bot, f32 top)
+{
+  Affine2F result = {0};
+  result.elements[0][0] = 2.0f / (right - left);
+  result.elements[1][1] = 2.0f / (top - bot);
+  result.elements[0][2] = -(right + left) / (right - left);
+  result.elements[1][2] = -(top + bot) / (top - bot);
+
+  return result;
+}
+
+MATH_API
+Mat3x3F m3x3f_from_a2f(Affine2F m)
+{
+  return (Mat3x3F)
+  {
+    {
+      {m.elements[0][0], m.elements[0][1], m.elements[0][2]},
+      {m.elements[1][0], m.elements[1][1], m.elements[1][2]},
+      {0.0f, 0.0f, 1.0f}
+    }
+  };
+}
+
 // @Mat4x4F =================================================================================
 
-inline
+MATH_API
 Mat4x4F m4x4f(f32 k)
 {
   return (Mat4x4F)
@@ -428,7 +681,7 @@ Mat4x4F m4x4f(f32 k)
   };
 }
 
-inline
+MATH_API
 Mat4x4F rows_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4)
 {
   return (Mat4x4F)
@@ -442,7 +695,7 @@ Mat4x4F rows_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4)
   };
 }
 
-inline
+MATH_API
 Mat4x4F cols_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4)
 {
   return (Mat4x4F)
@@ -456,6 +709,7 @@ Mat4x4F cols_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4)
   };
 }
 
+MATH_API
 Mat4x4F mul_4x4f(Mat4x4F a, Mat4x4F b)
 {
   Mat4x4F result = {0};
@@ -474,6 +728,7 @@ Mat4x4F mul_4x4f(Mat4x4F a, Mat4x4F b)
   return result;
 }
 
+MATH_API
 Mat4x4F transpose_4x4f(Mat4x4F m)
 {
   Mat4x4F result = m;
@@ -493,6 +748,179 @@ Mat4x4F transpose_4x4f(Mat4x4F m)
   return result;
 }
 
+// The SSE path splits m into 2x2 blocks [A B; C D] and inverts blockwise with
+// 2x2 adjugates, about 40 vector ops. The scalar path gets the cofactors from
+// four 3D cross products, treating rows as the columns of the transpose.
+MATH_API
+Mat4x4F inverse_4x4f(Mat4x4F m)
+{
+  Mat4x4F result;
+
+  #ifdef SIMD_SSE
+  #define SHUF(a, b, x, y, z, w) _mm_shuffle_ps(a, b, (x) | (y) << 2 | (z) << 4 | (w) << 6)
+  #define SWIZ(a, x, y, z, w) SHUF(a, a, x, y, z, w)
+
+  // 2x2 blocks stored row-major in one register: A*B, adj(A)*B and A*adj(B)
+  #define MAT2_MUL(a, b) \
+    _mm_add_ps(_mm_mul_ps(a, SWIZ(b, 0, 3, 0, 3)), _mm_mul_ps(SWIZ(a, 1, 0, 3, 2), SWIZ(b, 2, 1, 2, 1)))
+  #define MAT2_ADJ_MUL(a, b) \
+    _mm_sub_ps(_mm_mul_ps(SWIZ(a, 3, 3, 0, 0), b), _mm_mul_ps(SWIZ(a, 1, 1, 2, 2), SWIZ(b, 2, 3, 0, 1)))
+  #define MAT2_MUL_ADJ(a, b) \
+    _mm_sub_ps(_mm_mul_ps(a, SWIZ(b, 3, 0, 3, 0)), _mm_mul_ps(SWIZ(a, 1, 0, 3, 2), SWIZ(b, 2, 1, 2, 1)))
+
+  __m128 r0 = _mm_loadu_ps(m.elements[0]);
+  __m128 r1 = _mm_loadu_ps(m.elements[1]);
+  __m128 r2 = _mm_loadu_ps(m.elements[2]);
+  __m128 r3 = _mm_loadu_ps(m.elements[3]);
+
+  __m128 a = _mm_movelh_ps(r0, r1);
+  __m128 b = _mm_movehl_ps(r1, r0);
+  __m128 c = _mm_movelh_ps(r2, r3);
+  __m128 d = _mm_movehl_ps(r3, r2);
+
+  // |A| |B| |C| |D|
+  __m128 det_sub = _mm_sub_ps(_mm_mul_ps(SHUF(r0, r2, 0, 2, 0, 2), SHUF(r1, r3, 1, 3, 1, 3)),
+                              _mm_mul_ps(SHUF(r0, r2, 1, 3, 1, 3), SHUF(r1, r3, 0, 2, 0, 2)));
+  __m128 det_a = SWIZ(det_sub, 0, 0, 0, 0);
+  __m128 det_b = SWIZ(det_sub, 1, 1, 1, 1);
+  __m128 det_c = SWIZ(det_sub, 2, 2, 2, 2);
+  __m128 det_d = SWIZ(det_sub, 3, 3, 3, 3);
+
+  __m128 d_c = MAT2_ADJ_MUL(d, c);
+  __m128 a_b = MAT2_ADJ_MUL(a, b);
+  __m128 x = _mm_sub_ps(_mm_mul_ps(det_d, a), MAT2_MUL(b, d_c));
+  __m128 w = _mm_sub_ps(_mm_mul_ps(det_a, d), MAT2_MUL(c, a_b));
+  __m128 y = _mm_sub_ps(_mm_mul_ps(det_b, c), MAT2_MUL_ADJ(d, a_b));
+  __m128 z = _mm_sub_ps(_mm_mul_ps(det_c, b), MAT2_MUL_ADJ(a, d_c));
+
+  // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+  __m128 tr = _mm_mul_ps(a_b, SWIZ(d_c, 0, 2, 1, 3));
+  tr = _mm_add_ps(tr, SWIZ(tr, 2, 3, 0, 1));
+  tr = _mm_add_ps(tr, SWIZ(tr, 1, 0, 3, 2));
+  __m128 det = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(det_a, det_d), _mm_mul_ps(det_b, det_c)), tr);
+
+  __m128 inv_det = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+  x = _mm_mul_ps(x, inv_det);
+  y = _mm_mul_ps(y, inv_det);
+  z = _mm_mul_ps(z, inv_det);
+  w = _mm_mul_ps(w, inv_det);
+
+  _mm_storeu_ps(result.elements[0], SHUF(x, y, 3, 1, 3, 1));
+  _mm_storeu_ps(result.elements[1], SHUF(x, y, 2, 0, 2, 0));
+  _mm_storeu_ps(result.elements[2], SHUF(z, w, 3, 1, 3, 1));
+  _mm_storeu_ps(result.elements[3], SHUF(z, w, 2, 0, 2, 0));
+
+  #undef MAT2_MUL_ADJ
+  #undef MAT2_ADJ_MUL
+  #undef MAT2_MUL
+  #undef SWIZ
+  #undef SHUF
+  #else
+  Vec3F r[4];
+  f32 rw[4];
+  for (u8 i = 0; i < 4; i++)
+  {
+    r[i] = (Vec3F) {m.elements[i][0], m.elements[i][1], m.elements[i][2]};
+    rw[i] = m.elements[i][3];
+  }
+
+  Vec3F c01 = cross_3f(r[0], r[1]);
+  Vec3F c23 = cross_3f(r[2], r[3]);
+  Vec3F b10 = sub_3f(scale_3f(r[0], rw[1]), scale_3f(r[1], rw[0]));
+  Vec3F b32 = sub_3f(scale_3f(r[2], rw[3]), scale_3f(r[3], rw[2]));
+
+  f32 inv_det = 1.0f / (dot_3f(c01, b32) + dot_3f(c23, b10));
+  c01 = scale_3f(c01, inv_det);
+  c23 = scale_3f(c23, inv_det);
+  b10 = scale_3f(b10, inv_det);
+  b32 = scale_3f(b32, inv_det);
+
+  Vec4F v[4];
+  Vec3F v0 = add_3f(cross_3f(r[1], b32), scale_3f(c23, rw[1]));
+  Vec3F v1 = sub_3f(cross_3f(b32, r[0]), scale_3f(c23, rw[0]));
+  Vec3F v2 = add_3f(cross_3f(r[3], b10), scale_3f(c01, rw[3]));
+  Vec3F v3 = sub_3f(cross_3f(b10, r[2]), scale_3f(c01, rw[2]));
+  v[0] = (Vec4F) {v0.x, v0.y, v0.z, -dot_3f(r[1], c23)};
+  v[1] = (Vec4F) {v1.x, v1.y, v1.z, dot_3f(r[0], c23)};
+  v[2] = (Vec4F) {v2.x, v2.y, v2.z, -dot_3f(r[3], c01)};
+  v[3] = (Vec4F) {v3.x, v3.y, v3.z, dot_3f(r[2], c01)};
+
+  for (u8 i = 0; i < 4; i++)
+  {
+    for (u8 j = 0; j < 4; j++) result.elements[j][i] = v[i].elements[j];
+  }
+  #endif
+
+  return result;
+}
+
+// The inverse of [A t; 0 1] is [A^-1, -A^-1 t; 0 1], and the columns of A^-1
+// are the pairwise cross products of A's rows over det(A).
+MATH_API
+Mat4x4F inverse_affine_4x4f(Mat4x4F m)
+{
+  Mat4x4F result;
+
+  #ifdef SIMD_SSE
+  const __m128 xyz = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+  __m128 r0 = _mm_loadu_ps(m.elements[0]);
+  __m128 r1 = _mm_loadu_ps(m.elements[1]);
+  __m128 r2 = _mm_loadu_ps(m.elements[2]);
+  __m128 t = _mm_setr_ps(m.elements[0][3], m.elements[1][3], m.elements[2][3], 0.0f);
+  r0 = _mm_and_ps(r0, xyz);
+  r1 = _mm_and_ps(r1, xyz);
+  r2 = _mm_and_ps(r2, xyz);
+
+  __m128 c0 = cross_ps(r1, r2);
+  __m128 c1 = cross_ps(r2, r0);
+  __m128 c2 = cross_ps(r0, r1);
+  __m128 inv_det = _mm_div_ps(_mm_set1_ps(1.0f), dot_ps(r0, c0));
+  c0 = _mm_mul_ps(c0, inv_det);
+  c1 = _mm_mul_ps(c1, inv_det);
+  c2 = _mm_mul_ps(c2, inv_det);
+
+  __m128 tx = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 0, 0, 0));
+  __m128 ty = _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1));
+  __m128 tz = _mm_shuffle_ps(t, t, _MM_SHUFFLE(2, 2, 2, 2));
+  __m128 it = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, tx), _mm_mul_ps(c1, ty)), _mm_mul_ps(c2, tz));
+  it = _mm_sub_ps(_mm_setzero_ps(), it);
+
+  // Columns c0 c1 c2 and the new translation transpose straight into rows
+  _MM_TRANSPOSE4_PS(c0, c1, c2, it);
+  _mm_storeu_ps(result.elements[0], c0);
+  _mm_storeu_ps(result.elements[1], c1);
+  _mm_storeu_ps(result.elements[2], c2);
+  _mm_storeu_ps(result.elements[3], _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+  #else
+  Vec3F a0 = {m.elements[0][0], m.elements[0][1], m.elements[0][2]};
+  Vec3F a1 = {m.elements[1][0], m.elements[1][1], m.elements[1][2]};
+  Vec3F a2 = {m.elements[2][0], m.elements[2][1], m.elements[2][2]};
+  Vec3F t = {m.elements[0][3], m.elements[1][3], m.elements[2][3]};
+
+  Vec3F c0 = cross_3f(a1, a2);
+  f32 inv_det = 1.0f / dot_3f(a0, c0);
+  c0 = scale_3f(c0, inv_det);
+  Vec3F c1 = scale_3f(cross_3f(a2, a0), inv_det);
+  Vec3F c2 = scale_3f(cross_3f(a0, a1), inv_det);
+  Vec3F it = scale_3f(add_3f(add_3f(scale_3f(c0, t.x), scale_3f(c1, t.y)), scale_3f(c2, t.z)), 
+                      -1.0f);
+
+  result = (Mat4x4F)
+  {
+    {
+      {c0.x, c1.x, c2.x, it.x},
+      {c0.y, c1.y, c2.y, it.y},
+      {c0.z, c1.z, c2.z, it.z},
+      {0.0f, 0.0f, 0.0f, 1.0f}
+    }
+  };
+  #endif
+
+  return result;
+}
+
+MATH_API
 Mat4x4F translate_4x4f(f32 x_shift, f32 y_shift, f32 z_shift)
 {
   Mat4x4F result = m4x4f(1.0f);
@@ -503,6 +931,33 @@ Mat4x4F translate_4x4f(f32 x_shift, f32 y_shift, f32 z_shift)
   return result;
 }
 
+// Rodrigues' formula; `axis` must be normalized.
+MATH_API
+Mat4x4F rotate_4x4f(f32 angle, Vec3F axis)
+{
+  f32 s, c;
+  sincos_f32(angle * (f32) (PI / 180.0), TRIG_PRECISE, &s, &c);
+
+  f32 t = 1.0f - c;
+  f32 x = axis.x;
+  f32 y = axis.y;
+  f32 z = axis.z;
+
+  Mat4x4F result = m4x4f(1.0f);
+  result.elements[0][0] = c + x * x * t;
+  result.elements[0][1] = x * y * t - z * s;
+  result.elements[0][2] = x * z * t + y * s;
+  result.elements[1][0] = y * x * t + z * s;
+  result.elements[1][1] = c + y * y * t;
+  result.elements[1][2] = y * z * t - x * s;
+  result.elements[2][0] = z * x * t - y * s;
+  result.elements[2][1] = z * y * t + x * s;
+  result.elements[2][2] = c + z * z * t;
+
+  return result;
+}
+
+MATH_API
 Mat4x4F scale_4x4f(f32 x_scale, f32 y_scale, f32 z_scale)
 {
   Mat4x4F result = m4x4f(1.0f);
@@ -513,6 +968,19 @@ Mat4x4F scale_4x4f(f32 x_scale, f32 y_scale, f32 z_scale)
   return result;
 }
 
+// x moves along y as in shear_3x3f, then cyclically y along z and z along x.
+MATH_API
+Mat4x4F shear_4x4f(f32 x_shear, f32 y_shear, f32 z_shear)
+{
+  Mat4x4F result = m4x4f(1.0f);
+  result.elements[0][1] = x_shear;
+  result.elements[1][2] = y_shear;
+  result.elements[2][0] = z_shear;
+
+  return result;
+}
+
+MATH_API
 Mat4x4F orthographic_4x4f(f32 left, f32 right, f32 bot, f32 top)
 {
   const f32 near = -1.0f;
@@ -530,63 +998,759 @@ Mat4x4F orthographic_4x4f(f32 left, f32 right, f32 bot, f32 top)
   return result;
 }
 
+// Z maps [-near, -far] to [-1, 1], matching GL's default clip space.
+MATH_API
+Mat4x4F perspective_4x4f(f32 fov, f32 aspect, f32 near, f32 far)
+{
+  f32 s, c;
+  sincos_f32(fov * (f32) (PI / 360.0), TRIG_PRECISE, &s, &c);
+  f32 cot = c / s;
+
+  Mat4x4F result = {0};
+  result.elements[0][0] = cot / aspect;
+  result.elements[1][1] = cot;
+  result.elements[2][2] = (near + far) / (near - far);
+  result.elements[2][3] = (2.0f * near * far) / (near - far);
+  result.elements[3][2] = -1.0f;
+
+  return result;
+}
+
+// Reversed-Z with an infinite far plane: near maps to 1 and infinity to 0.
+// Float depth is densest near 0, which this spends on distant geometry, so
+// precision is nearly uniform in view space. Needs a [0, 1] depth range
+// (glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE)), a float depth buffer cleared
+// to 0 and GL_GREATER.
+MATH_API
+Mat4x4F perspective_reversed_4x4f(f32 fov, f32 aspect, f32 near)
+{
+  f32 s, c;
+  sincos_f32(fov * (f32) (PI / 360.0), TRIG_PRECISE, &s, &c);
+  f32 cot = c / s;
+
+  Mat4x4F result = {0};
+  result.elements[0][0] = cot / aspect;
+  result.elements[1][1] = cot;
+  result.elements[2][3] = near;
+  result.elements[3][2] = -1.0f;
+
+  return result;
+}
+
+MATH_API
+Mat4x4F look_at_4x4f(Vec3F eye, Vec3F center, Vec3F up)
+{
+  Vec3F f = normalize_3f(sub_3f(center, eye));
+  Vec3F s = normalize_3f(cross_3f(f, up));
+  Vec3F u = cross_3f(s, f);
+
+  return (Mat4x4F)
+  {
+    {
+      {s.x, s.y, s.z, -dot_3f(s, eye)},
+      {u.x, u.y, u.z, -dot_3f(u, eye)},
+      {-f.x, -f.y, -f.z, dot_3f(f, eye)},
+      {0.0f, 0.0f, 0.0f, 1.0f}
+    }
+  };
+}
+
+// `screen` is in pixels from the top left, as SDL reports the mouse. `depth` is
+// NDC z: -1 and 1 give the near and far points of a picking ray (reversed for
+// perspective_reversed_4x4f, which only takes (0, 1]).
+MATH_API
+Vec3F unproject_4x4f(Vec2F screen, f32 depth, Vec2F viewport, Mat4x4F inv_view_proj)
+{
+  Vec4F ndc =
+  {
+    2.0f * screen.x / viewport.x - 1.0f,
+    1.0f - 2.0f * screen.y / viewport.y,
+    depth,
+    1.0f,
+  };
+
+  Vec4F world = transform_4f(ndc, inv_view_proj);
+
+  return scale_3f((Vec3F) {world.x, world.y, world.z}, 1.0f / world.w);
+}
+
+// @QuatF ===================================================================================
+
+MATH_API
+QuatF qf(f32 x, f32 y, f32 z, f32 w)
+{
+  return (QuatF) {x, y, z, w};
+}
+
+// `axis` must be normalized; `angle` is in degrees like the matrix builders.
+MATH_API
+QuatF axis_angle_qf(Vec3F axis, f32 angle)
+{
+  f32 s, c;
+  sincos_f32(angle * (f32) (PI / 360.0), TRIG_PRECISE, &s, &c);
+
+  return (QuatF) {axis.x * s, axis.y * s, axis.z * s, c};
+}
+
+// Applies b first, then a.
+MATH_API
+QuatF mul_qf(QuatF a, QuatF b)
+{
+  QuatF result;
+
+  #ifdef SIMD_SSE
+  const __m128 sign_b = _mm_setr_ps(1.0f, -1.0f, 1.0f, -1.0f);
+  const __m128 sign_c = _mm_setr_ps(1.0f, 1.0f, -1.0f, -1.0f);
+  const __m128 sign_d = _mm_setr_ps(-1.0f, 1.0f, 1.0f, -1.0f);
+
+  __m128 q = _mm_loadu_ps(b.elements);
+  __m128 r = _mm_mul_ps(_mm_set1_ps(a.w), q);
+  r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(a.x), sign_b), 
+                               _mm_shuffle_ps(q, q, _MM_SHUFFLE(0, 1, 2, 3))));
+  r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(a.y), sign_c), 
+                               _mm_shuffle_ps(q, q, _MM_SHUFFLE(1, 0, 3, 2))));
+  r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(a.z), sign_d), 
+                               _mm_shuffle_ps(q, q, _MM_SHUFFLE(2, 3, 0, 1))));
+  _mm_storeu_ps(result.elements, r);
+  #else
+  result.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+  result.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+  result.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+  result.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+  #endif
+
+  return result;
+}
+
+MATH_API
+f32 dot_qf(QuatF a, QuatF b)
+{
+  return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
+}
+
+MATH_API
+QuatF conjugate_qf(QuatF q)
+{
+  return (QuatF) {-q.x, -q.y, -q.z, q.w};
+}
+
+MATH_API
+QuatF normalize_qf(QuatF q)
+{
+  QuatF result;
+
+  #ifdef SIMD_SSE
+  __m128 v = _mm_loadu_ps(q.elements);
+  __m128 d = _mm_mul_ps(v, v);
+  d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+  d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+  _mm_storeu_ps(result.elements, _mm_div_ps(v, _mm_sqrt_ps(d)));
+  #else
+  f32 inv = 1.0f / sqrtf(dot_qf(q, q));
+  result = (QuatF) {q.x * inv, q.y * inv, q.z * inv, q.w * inv};
+  #endif
+
+  return result;
+}
+
+// v + 2w(u x v) + 2u x (u x v), with u the vector part of a unit quaternion
+MATH_API
+Vec3F rotate_qf(QuatF q, Vec3F v)
+{
+  Vec3F u = {q.x, q.y, q.z};
+  Vec3F t = scale_3f(cross_3f(u, v), 2.0f);
+
+  return add_3f(add_3f(v, scale_3f(t, q.w)), cross_3f(u, t));
+}
+
+// Takes the short way round and renormalizes. Cheaper than slerp and close
+// enough for small steps such as per-frame animation blending.
+MATH_API
+QuatF nlerp_qf(QuatF a, QuatF b, f32 t)
+{
+  f32 sign = dot_qf(a, b) < 0.0f ? -1.0f : 1.0f;
+  f32 ta = 1.0f - t;
+  f32 tb = t * sign;
+
+  return normalize_qf((QuatF) 
+  {
+    a.x * ta + b.x * tb,
+    a.y * ta + b.y * tb,
+    a.z * ta + b.z * tb,
+    a.w * ta + b.w * tb,
+  });
+}
+
+MATH_API
+QuatF slerp_qf(QuatF a, QuatF b, f32 t)
+{
+  f32 cos_theta = dot_qf(a, b);
+  if (cos_theta < 0.0f)
+  {
+    b = (QuatF) {-b.x, -b.y, -b.z, -b.w};
+    cos_theta = -cos_theta;
+  }
+
+  // Nearly parallel, sin(theta) would vanish
+  if (cos_theta > 0.9995f) return nlerp_qf(a, b, t);
+
+  f32 theta = acosf(cos_theta);
+  f32 sin_theta, sin_a, sin_b, unused;
+  sincos_f32(theta, TRIG_PRECISE, &sin_theta, &unused);
+  sincos_f32(theta * (1.0f - t), TRIG_PRECISE, &sin_a, &unused);
+  sincos_f32(theta * t, TRIG_PRECISE, &sin_b, &unused);
+
+  f32 ta = sin_a / sin_theta;
+  f32 tb = sin_b / sin_theta;
+
+  return (QuatF) 
+  {
+    a.x * ta + b.x * tb,
+    a.y * ta + b.y * tb,
+    a.z * ta + b.z * tb,
+    a.w * ta + b.w * tb,
+  };
+}
+
+MATH_API
+Mat4x4F m4x4f_from_qf(QuatF q)
+{
+  return trs_4x4f(V3F_ZERO, q, (Vec3F) {1.0f, 1.0f, 1.0f});
+}
+
+// Expects a pure rotation in the upper 3x3. Picks the largest of w, x, y, z
+// to divide by so the result stays accurate near 180 degrees.
+MATH_API
+QuatF qf_from_4x4f(Mat4x4F m)
+{
+  f32 (*e)[4] = m.elements;
+  f32 trace = e[0][0] + e[1][1] + e[2][2];
+  QuatF result;
+
+  if (trace > 0.0f)
+  {
+    f32 s = 0.5f / sqrtf(trace + 1.0f);
+    result.w = 0.25f / s;
+    result.x = (e[2][1] - e[1][2]) * s;
+    result.y = (e[0][2] - e[2][0]) * s;
+    result.z = (e[1][0] - e[0][1]) * s;
+  }
+  else if (e[0][0] > e[1][1] && e[0][0] > e[2][2])
+  {
+    f32 s = 2.0f * sqrtf(1.0f + e[0][0] - e[1][1] - e[2][2]);
+    result.w = (e[2][1] - e[1][2]) / s;
+    result.x = 0.25f * s;
+    result.y = (e[0][1] + e[1][0]) / s;
+    result.z = (e[0][2] + e[2][0]) / s;
+  }
+  else if (e[1][1] > e[2][2])
+  {
+    f32 s = 2.0f * sqrtf(1.0f + e[1][1] - e[0][0] - e[2][2]);
+    result.w = (e[0][2] - e[2][0]) / s;
+    result.x = (e[0][1] + e[1][0]) / s;
+    result.y = 0.25f * s;
+    result.z = (e[1][2] + e[2][1]) / s;
+  }
+  else
+  {
+    f32 s = 2.0f * sqrtf(1.0f + e[2][2] - e[0][0] - e[1][1]);
+    result.w = (e[1][0] - e[0][1]) / s;
+    result.x = (e[0][2] + e[2][0]) / s;
+    result.y = (e[1][2] + e[2][1]) / s;
+    result.z = 0.25f * s;
+  }
+
+  return result;
+}
+
+MATH_API
+Mat4x4F trs_4x4f(Vec3F t, QuatF r, Vec3F s)
+{
+  f32 xx = r.x * r.x, yy = r.y * r.y, zz = r.z * r.z;
+  f32 xy = r.x * r.y, xz = r.x * r.z, yz = r.y * r.z;
+  f32 wx = r.w * r.x, wy = r.w * r.y, wz = r.w * r.z;
+
+  return (Mat4x4F)
+  {
+    {
+      {(1.0f - 2.0f * (yy + zz)) * s.x, 2.0f * (xy - wz) * s.y, 2.0f * (xz + wy) * s.z, t.x},
+      {2.0f * (xy + wz) * s.x, (1.0f - 2.0f * (xx + zz)) * s.y, 2.0f * (yz - wx) * s.z, t.y},
+      {2.0f * (xz - wy) * s.x, 2.0f * (yz + wx) * s.y, (1.0f - 2.0f * (xx + yy)) * s.z, t.z},
+      {0.0f, 0.0f, 0.0f, 1.0f}
+    }
+  };
+}
+
+// Four transforms per iteration, one per SIMD lane, so the formula above runs
+// unchanged on vectors. Each output row is then a 4x4 transpose away.
+MATH_API
+void trs_batch_4x4f(const Vec3F *t, const QuatF *r, const Vec3F *s, Mat4x4F *out, u32 count)
+{
+  u32 i = 0;
+
+  #ifdef SIMD_SSE
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 two = _mm_set1_ps(2.0f);
+  const __m128 last = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 qx = _mm_loadu_ps(r[i + 0].elements);
+    __m128 qy = _mm_loadu_ps(r[i + 1].elements);
+    __m128 qz = _mm_loadu_ps(r[i + 2].elements);
+    __m128 qw = _mm_loadu_ps(r[i + 3].elements);
+    _MM_TRANSPOSE4_PS(qx, qy, qz, qw);
+
+    __m128 sx = _mm_setr_ps(s[i].x, s[i + 1].x, s[i + 2].x, s[i + 3].x);
+    __m128 sy = _mm_setr_ps(s[i].y, s[i + 1].y, s[i + 2].y, s[i + 3].y);
+    __m128 sz = _mm_setr_ps(s[i].z, s[i + 1].z, s[i + 2].z, s[i + 3].z);
+    __m128 tx = _mm_setr_ps(t[i].x, t[i + 1].x, t[i + 2].x, t[i + 3].x);
+    __m128 ty = _mm_setr_ps(t[i].y, t[i + 1].y, t[i + 2].y, t[i + 3].y);
+    __m128 tz = _mm_setr_ps(t[i].z, t[i + 1].z, t[i + 2].z, t[i + 3].z);
+
+    __m128 x2 = _mm_mul_ps(qx, two);
+    __m128 y2 = _mm_mul_ps(qy, two);
+    __m128 z2 = _mm_mul_ps(qz, two);
+    __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+    __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+    __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+
+    __m128 row[3][4] =
+    {
+      {
+        _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx),
+        _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+        _mm_mul_ps(_mm_add_ps(xz, wy), sz),
+        tx,
+      },
+      {
+        _mm_mul_ps(_mm_add_ps(xy, wz), sx),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+        _mm_mul_ps(_mm_sub_ps(yz, wx), sz),
+        ty,
+      },
+      {
+        _mm_mul_ps(_mm_sub_ps(xz, wy), sx),
+        _mm_mul_ps(_mm_add_ps(yz, wx), sy),
+        _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz),
+        tz,
+      },
+    };
+
+    for (u32 j = 0; j < 3; j++)
+    {
+      _MM_TRANSPOSE4_PS(row[j][0], row[j][1], row[j][2], row[j][3]);
+      for (u32 k = 0; k < 4; k++) _mm_storeu_ps(out[i + k].elements[j], row[j][k]);
+    }
+
+    for (u32 k = 0; k < 4; k++) _mm_storeu_ps(out[i + k].elements[3], last);
+  }
+  #endif
+
+  for (; i < count; i++) out[i] = trs_4x4f(t[i], r[i], s[i]);
+}
+
+// @Bounds ==================================================================================
+
+MATH_API
+bool overlap_aabb2f(AABB2F a, AABB2F b)
+{
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y;
+}
+
+MATH_API
+bool overlap_circle_aabb2f(CircleF c, AABB2F box)
+{
+  f32 dx = fmaxf(fmaxf(box.min.x - c.center.x, c.center.x - box.max.x), 0.0f);
+  f32 dy = fmaxf(fmaxf(box.min.y - c.center.y, c.center.y - box.max.y), 0.0f);
+
+  return dx * dx + dy * dy <= c.radius * c.radius;
+}
+
+// Transforms the center and grows the extent by the absolute linear part,
+// which gives the tightest box around the transformed box (Arvo).
+MATH_API
+AABB2F transform_aabb2f(AABB2F box, Affine2F m)
+{
+  Vec2F center = scale_2f(add_2f(box.min, box.max), 0.5f);
+  Vec2F extent = scale_2f(sub_2f(box.max, box.min), 0.5f);
+  center = transform_a2f(center, m);
+
+  Vec2F e =
+  {
+    fabsf(m.elements[0][0]) * extent.x + fabsf(m.elements[0][1]) * extent.y,
+    fabsf(m.elements[1][0]) * extent.x + fabsf(m.elements[1][1]) * extent.y,
+  };
+
+  return (AABB2F) {sub_2f(center, e), add_2f(center, e)};
+}
+
+// `m` must be affine.
+MATH_API
+AABB3F transform_aabb3f(AABB3F box, Mat4x4F m)
+{
+  Vec3F center = scale_3f(add_3f(box.min, box.max), 0.5f);
+  Vec3F extent = scale_3f(sub_3f(box.max, box.min), 0.5f);
+
+  Vec3F c, e;
+  for (u8 r = 0; r < 3; r++)
+  {
+    f32 *row = m.elements[r];
+    c.elements[r] = row[0] * center.x + row[1] * center.y + row[2] * center.z + row[3];
+    e.elements[r] = fabsf(row[0]) * extent.x + fabsf(row[1]) * extent.y + fabsf(row[2]) * extent.z;
+  }
+
+  return (AABB3F) {sub_3f(c, e), add_3f(c, e)};
+}
+
+MATH_API
+bool overlap_aabb3f(AABB3F a, AABB3F b)
+{
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && 
+         a.min.y <= b.max.y && a.max.y >= b.min.y && 
+         a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+MATH_API
+bool contains_aabb3f(AABB3F outer, AABB3F inner)
+{
+  return outer.min.x <= inner.min.x && outer.max.x >= inner.max.x && 
+         outer.min.y <= inner.min.y && outer.max.y >= inner.max.y && 
+         outer.min.z <= inner.min.z && outer.max.z >= inner.max.z;
+}
+
+MATH_API
+AABB3F union_aabb3f(AABB3F a, AABB3F b)
+{
+  return (AABB3F)
+  {
+    {MIN(a.min.x, b.min.x), MIN(a.min.y, b.min.y), MIN(a.min.z, b.min.z)},
+    {MAX(a.max.x, b.max.x), MAX(a.max.y, b.max.y), MAX(a.max.z, b.max.z)},
+  };
+}
+
+// @Culling =================================================================================
+
+// Gribb-Hartmann: each clip plane is the last row plus or minus another row.
+MATH_API
+FrustumF frustum_from_4x4f(Mat4x4F view_proj)
+{
+  f32 (*e)[4] = view_proj.elements;
+  FrustumF result;
+
+  for (u8 i = 0; i < 3; i++)
+  {
+    for (u8 c = 0; c < 4; c++)
+    {
+      result.planes[i * 2 + 0].elements[c] = e[3][c] + e[i][c];
+      result.planes[i * 2 + 1].elements[c] = e[3][c] - e[i][c];
+    }
+  }
+
+  for (u8 i = 0; i < 6; i++)
+  {
+    Vec4F *p = &result.planes[i];
+    *p = scale_4f(*p, 1.0f / sqrtf(p->x * p->x + p->y * p->y + p->z * p->z));
+  }
+
+  return result;
+}
+
+MATH_API
+bool sphere_in_frustum(const FrustumF *frustum, SphereF sphere)
+{
+  for (u8 i = 0; i < 6; i++)
+  {
+    const Vec4F *p = &frustum->planes[i];
+    f32 d = p->x * sphere.center.x + p->y * sphere.center.y + p->z * sphere.center.z + p->w;
+    if (d < -sphere.radius) return FALSE;
+  }
+
+  return TRUE;
+}
+
+MATH_API
+bool aabb_in_frustum(const FrustumF *frustum, AABB3F box)
+{
+  Vec3F c = scale_3f(add_3f(box.min, box.max), 0.5f);
+  Vec3F e = scale_3f(sub_3f(box.max, box.min), 0.5f);
+
+  for (u8 i = 0; i < 6; i++)
+  {
+    const Vec4F *p = &frustum->planes[i];
+    f32 d = p->x * c.x + p->y * c.y + p->z * c.z + p->w;
+    f32 r = fabsf(p->x) * e.x + fabsf(p->y) * e.y + fabsf(p->z) * e.z;
+    if (d + r < 0.0f) return FALSE;
+  }
+
+  return TRUE;
+}
+
+#ifdef SIMD_SSE
+// Appends i..i+3 for the set bits of `mask` without branching. Every store
+// lands below i + 4 because n <= i on entry, so `visible` needs no slack.
+static inline
+u32 cull_emit4(u32 *visible, u32 n, u32 i, i32 mask)
+{
+  visible[n] = i + 0;
+  n += mask & 1;
+  visible[n] = i + 1;
+  n += (mask >> 1) & 1;
+  visible[n] = i + 2;
+  n += (mask >> 2) & 1;
+  visible[n] = i + 3;
+  n += (mask >> 3) & 1;
+
+  return n;
+}
+#endif
+
+MATH_API
+u32 cull_spheres(const FrustumF *frustum, const SphereF *spheres, u32 count, u32 *visible)
+{
+  u32 n = 0;
+  u32 i = 0;
+
+  #ifdef SIMD_SSE
+  __m128 planes[6][4];
+  for (u8 p = 0; p < 6; p++)
+  {
+    for (u8 c = 0; c < 4; c++) planes[p][c] = _mm_set1_ps(frustum->planes[p].elements[c]);
+  }
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 x = _mm_loadu_ps(&spheres[i + 0].center.x);
+    __m128 y = _mm_loadu_ps(&spheres[i + 1].center.x);
+    __m128 z = _mm_loadu_ps(&spheres[i + 2].center.x);
+    __m128 r = _mm_loadu_ps(&spheres[i + 3].center.x);
+    _MM_TRANSPOSE4_PS(x, y, z, r);
+    __m128 neg_r = _mm_sub_ps(_mm_setzero_ps(), r);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (u8 p = 0; p < 6; p++)
+    {
+      __m128 d = _mm_add_ps(_mm_mul_ps(planes[p][0], x), _mm_mul_ps(planes[p][1], y));
+      d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(planes[p][2], z), planes[p][3]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(d, neg_r));
+    }
+
+    n = cull_emit4(visible, n, i, _mm_movemask_ps(inside));
+  }
+  #endif
+
+  for (; i < count; i++)
+  {
+    if (sphere_in_frustum(frustum, spheres[i])) visible[n++] = i;
+  }
+
+  return n;
+}
+
+MATH_API
+u32 cull_aabbs(const FrustumF *frustum, const AABB3F *boxes, u32 count, u32 *visible)
+{
+  u32 n = 0;
+  u32 i = 0;
+
+  #ifdef SIMD_SSE
+  const __m128 half = _mm_set1_ps(0.5f);
+  __m128 planes[6][4];
+  __m128 abs_planes[6][3];
+  for (u8 p = 0; p < 6; p++)
+  {
+    for (u8 c = 0; c < 4; c++) planes[p][c] = _mm_set1_ps(frustum->planes[p].elements[c]);
+    for (u8 c = 0; c < 3; c++) abs_planes[p][c] = _mm_set1_ps(fabsf(frustum->planes[p].elements[c]));
+  }
+
+  for (; i + 4 <= count; i += 4)
+  {
+    const AABB3F *b = &boxes[i];
+    __m128 min_x = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+    __m128 min_y = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+    __m128 min_z = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+    __m128 max_x = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+    __m128 max_y = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+    __m128 max_z = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+
+    __m128 cx = _mm_mul_ps(_mm_add_ps(min_x, max_x), half);
+    __m128 cy = _mm_mul_ps(_mm_add_ps(min_y, max_y), half);
+    __m128 cz = _mm_mul_ps(_mm_add_ps(min_z, max_z), half);
+    __m128 ex = _mm_mul_ps(_mm_sub_ps(max_x, min_x), half);
+    __m128 ey = _mm_mul_ps(_mm_sub_ps(max_y, min_y), half);
+    __m128 ez = _mm_mul_ps(_mm_sub_ps(max_z, min_z), half);
+
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (u8 p = 0; p < 6; p++)
+    {
+      __m128 d = _mm_add_ps(_mm_mul_ps(planes[p][0], cx), _mm_mul_ps(planes[p][1], cy));
+      d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(planes[p][2], cz), planes[p][3]));
+      __m128 r = _mm_add_ps(_mm_mul_ps(abs_planes[p][0], ex), _mm_mul_ps(abs_planes[p][1], ey));
+      r = _mm_add_ps(r, _mm_mul_ps(abs_planes[p][2], ez));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+    }
+
+    n = cull_emit4(visible, n, i, _mm_movemask_ps(inside));
+  }
+  #endif
+
+  for (; i < count; i++)
+  {
+    if (aabb_in_frustum(frustum, boxes[i])) visible[n++] = i;
+  }
+
+  return n;
+}
+
+MATH_API
+u32 cull_circles_2d(AABB2F view, const CircleF *circles, u32 count, u32 *visible)
+{
+  u32 n = 0;
+  u32 i = 0;
+
+  #ifdef SIMD_SSE
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 min_x = _mm_set1_ps(view.min.x);
+  const __m128 min_y = _mm_set1_ps(view.min.y);
+  const __m128 max_x = _mm_set1_ps(view.max.x);
+  const __m128 max_y = _mm_set1_ps(view.max.y);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    const CircleF *c = &circles[i];
+    __m128 x = _mm_setr_ps(c[0].center.x, c[1].center.x, c[2].center.x, c[3].center.x);
+    __m128 y = _mm_setr_ps(c[0].center.y, c[1].center.y, c[2].center.y, c[3].center.y);
+    __m128 r = _mm_setr_ps(c[0].radius, c[1].radius, c[2].radius, c[3].radius);
+
+    __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_x, x), _mm_sub_ps(x, max_x)), zero);
+    __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(min_y, y), _mm_sub_ps(y, max_y)), zero);
+    __m128 d2 = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+    __m128 inside = _mm_cmple_ps(d2, _mm_mul_ps(r, r));
+
+    n = cull_emit4(visible, n, i, _mm_movemask_ps(inside));
+  }
+  #endif
+
+  for (; i < count; i++)
+  {
+    if (overlap_circle_aabb2f(circles[i], view)) visible[n++] = i;
+  }
+
+  return n;
+}
+
+MATH_API
+u32 cull_aabbs_2d(AABB2F view, const AABB2F *boxes, u32 count, u32 *visible)
+{
+  u32 n = 0;
+  u32 i = 0;
+
+  #ifdef SIMD_SSE
+  const __m128 view_min_x = _mm_set1_ps(view.min.x);
+  const __m128 view_min_y = _mm_set1_ps(view.min.y);
+  const __m128 view_max_x = _mm_set1_ps(view.max.x);
+  const __m128 view_max_y = _mm_set1_ps(view.max.y);
+
+  for (; i + 4 <= count; i += 4)
+  {
+    __m128 min_x = _mm_loadu_ps(&boxes[i + 0].min.x);
+    __m128 min_y = _mm_loadu_ps(&boxes[i + 1].min.x);
+    __m128 max_x = _mm_loadu_ps(&boxes[i + 2].min.x);
+    __m128 max_y = _mm_loadu_ps(&boxes[i + 3].min.x);
+    _MM_TRANSPOSE4_PS(min_x, min_y, max_x, max_y);
+
+    __m128 inside = _mm_and_ps(_mm_cmple_ps(min_x, view_max_x), _mm_cmpge_ps(max_x, view_min_x));
+    inside = _mm_and_ps(inside, _mm_cmple_ps(min_y, view_max_y));
+    inside = _mm_and_ps(inside, _mm_cmpge_ps(max_y, view_min_y));
+
+    n = cull_emit4(visible, n, i, _mm_movemask_ps(inside));
+  }
+  #endif
+
+  for (; i < count; i++)
+  {
+    if (overlap_aabb2f(boxes[i], view)) visible[n++] = i;
+  }
+
+  return n;
+}
+
 #ifdef __cplusplus
 
 // @Overloading =============================================================================
 
+MATH_API
 Vec2F operator+(Vec2F a, Vec2F b)
 {
   return add_2f(a, b);
 }
 
+MATH_API
 Vec3F operator+(Vec3F a, Vec3F b)
 {
   return add_3f(a, b);
 }
 
+MATH_API
 Vec4F operator+(Vec4F a, Vec4F b)
 {
   return add_4f(a, b);
 }
 
+MATH_API
 Vec2F operator-(Vec2F a, Vec2F b)
 {
   return sub_2f(a, b);
 }
 
+MATH_API
 Vec3F operator-(Vec3F a, Vec3F b)
 {
   return sub_3f(a, b);
 }
 
+MATH_API
 Vec4F operator-(Vec4F a, Vec4F b)
 {
   return sub_4f(a, b);
 }
 
+MATH_API
 f32 operator*(Vec2F a, Vec2F b)
 {
   return dot_2f(a, b);
 }
 
+MATH_API
 f32 operator*(Vec3F a, Vec3F b)
 {
   return dot_3f(a, b);
 }
 
+MATH_API
 f32 operator*(Vec4F a, Vec4F b)
 {
   return dot_4f(a, b);
 }
 
+MATH_API
 Mat3x3F operator*(Mat3x3F a, Mat3x3F b)
 {
   return mul_3x3f(a, b);
 }
 
+MATH_API
 Mat4x4F operator*(Mat4x4F a, Mat4x4F b)
 {
   return mul_4x4f(a, b);
 }
 
+MATH_API
+QuatF operator*(QuatF a, QuatF b)
+{
+  return mul_qf(a, b);
+}
+
 #endif
+
+#endif // BASE_MATH_C
@@ -1,9 +1,39 @@
 #pragma once
 
+#include <math.h>
+
 #include "base_common.h"
 
 #define PI 3.14159265359
 
+// Defining BASE_MATH_HEADER_ONLY turns every function into a static inline
+// pulled in from base_math.c, so calls from other translation units can be
+// inlined. Without it base_math.c is compiled once and linked as usual.
+// BASE_MATH_FORCE_INLINE additionally marks them always_inline.
+#ifdef BASE_MATH_HEADER_ONLY
+#if defined(BASE_MATH_FORCE_INLINE) && defined(__GNUC__)
+#define MATH_API static inline __attribute__((always_inline))
+#else
+#define MATH_API static inline
+#endif
+#else
+#define MATH_API
+#endif
+
+// The Vec4F kernels are static inline in both builds. Vec4F crosses a call as
+// two 8-byte halves and Mat4x4F on the stack, which costs several times what
+// the kernels do, and inlined they can use SSE on whole registers.
+// BASE_MATH_SCALAR_VEC4 keeps them scalar, to test the fallback on x86.
+#if defined(BASE_MATH_FORCE_INLINE) && defined(__GNUC__)
+#define MATH_INLINE static inline __attribute__((always_inline))
+#else
+#define MATH_INLINE static inline
+#endif
+
+#if defined(SIMD_SSE) && !defined(BASE_MATH_SCALAR_VEC4)
+#define SIMD_SSE_VEC4
+#endif
+
 typedef union Vec2F Vec2F;
 union Vec2F
 {
@@ -43,132 +73,512 @@ union Vec4F
   f32 elements[4];
 };
 
+typedef union QuatF QuatF;
+union QuatF
+{
+  struct
+  {
+    f32 x;
+    f32 y;
+    f32 z;
+    f32 w;
+  };
+
+  f32 elements[4];
+};
+
 typedef struct Mat3x3F Mat3x3F;
 struct Mat3x3F
 {
   f32 elements[3][3];
 };
 
+// 2D affine transform. Stores the top two rows of a Mat3x3F; the third is
+// always 0 0 1 and is never multiplied.
+typedef struct Affine2F Affine2F;
+struct Affine2F
+{
+  f32 elements[2][3];
+};
+
 typedef struct Mat4x4F Mat4x4F;
 struct Mat4x4F
 {
   f32 elements[4][4];
 };
 
-// @Vec2F ===================================================================================
+typedef struct AABB2F AABB2F;
+struct AABB2F
+{
+  Vec2F min;
+  Vec2F max;
+};
 
-#define V2F_ZERO ((Vec2F) {0.0f, 0.0f})
+typedef struct AABB3F AABB3F;
+struct AABB3F
+{
+  Vec3F min;
+  Vec3F max;
+};
 
-Vec2F v2f(f32 x, f32 y);
+typedef struct CircleF CircleF;
+struct CircleF
+{
+  Vec2F center;
+  f32 radius;
+};
 
-Vec2F add_2f(Vec2F a, Vec2F b);
-Vec2F sub_2f(Vec2F a, Vec2F b);
-Vec2F mul_2f(Vec2F a, Vec2F b);
-Vec2F div_2f(Vec2F a, Vec2F b);
-f32 dot_2f(Vec2F a, Vec2F b);
-f32 cross_2f(Vec2F a, Vec2F b);
-Vec2F scale_2f(Vec2F v, f32 scale);
+typedef struct SphereF SphereF;
+struct SphereF
+{
+  Vec3F center;
+  f32 radius;
+};
 
-f32 magnitude_2f(Vec2F a);
-f32 magnitude_squared_2f(Vec2F a);
-f32 distance_2f(Vec2F a, Vec2F b);
-f32 distance_squared_2f(Vec2F a, Vec2F b);
-Vec2F normalize_2f(Vec2F a);
+// Normalized planes (a, b, c, d); a point is inside when a*x + b*y + c*z + d >= 0.
+// Ordered left, right, bottom, top, near, far.
+typedef struct FrustumF FrustumF;
+struct FrustumF
+{
+  Vec4F planes[6];
+};
+
+// @Trig ====================================================================================
+
+// Max absolute error against libm for |x| < 1000.
+typedef enum TrigPrecision
+{
+  TRIG_PRECISE, // ~1e-6
+  TRIG_FAST,    // ~1e-3, shorter polynomials and a one-step range reduction
+} TrigPrecision;
+
+MATH_API void sincos_f32(f32 x, TrigPrecision precision, f32 *s, f32 *c);
+MATH_API void sincos_4f32(const f32 *x, TrigPrecision precision, f32 *s, f32 *c);
+MATH_API void sincos_8f32(const f32 *x, TrigPrecision precision, f32 *s, f32 *c);
 
-Vec2F lerp_2f(Vec2F curr, Vec2F target, f32 rate);
+// @Vec2F ===================================================================================
+
+#define V2F_ZERO ((Vec2F) {0.0f, 0.0f})
+
+MATH_API Vec2F v2f(f32 x, f32 y);
+
+MATH_API Vec2F add_2f(Vec2F a, Vec2F b);
+MATH_API Vec2F sub_2f(Vec2F a, Vec2F b);
+MATH_API Vec2F mul_2f(Vec2F a, Vec2F b);
+MATH_API Vec2F div_2f(Vec2F a, Vec2F b);
+MATH_API f32 dot_2f(Vec2F a, Vec2F b);
+MATH_API f32 cross_2f(Vec2F a, Vec2F b);
+MATH_API Vec2F scale_2f(Vec2F v, f32 scale);
+
+MATH_API f32 magnitude_2f(Vec2F a);
+MATH_API f32 magnitude_squared_2f(Vec2F a);
+MATH_API f32 distance_2f(Vec2F a, Vec2F b);
+MATH_API f32 distance_squared_2f(Vec2F a, Vec2F b);
+// The fast variants refine the hardware reciprocal square root estimate with
+// one Newton step, good to about 2^-22. The safe ones return zero for vectors
+// too short to normalize instead of infinities and NaNs.
+MATH_API Vec2F normalize_2f(Vec2F a);
+MATH_API Vec2F normalize_fast_2f(Vec2F a);
+MATH_API Vec2F normalize_safe_2f(Vec2F a);
+
+MATH_API Vec2F lerp_2f(Vec2F curr, Vec2F target, f32 rate);
 
 // @Vec3F ===================================================================================
 
 #define V3F_ZERO ((Vec3F) {0.0f, 0.0f, 0.0f})
 
-Vec3F v3f(f32 x, f32 y, f32 z);
+MATH_API Vec3F v3f(f32 x, f32 y, f32 z);
 
-Vec3F add_3f(Vec3F a, Vec3F b);
-Vec3F sub_3f(Vec3F a, Vec3F b);
-Vec3F mul_3f(Vec3F a, Vec3F b);
-Vec3F div_3f(Vec3F a, Vec3F b);
-f32 dot_3f(Vec3F a, Vec3F b);
-Vec3F cross_3f(Vec3F a, Vec3F b);
-Vec3F scale_3f(Vec3F v, f32 scale);
-Vec3F transform_3f(Vec3F v, Mat3x3F m);
+MATH_API Vec3F add_3f(Vec3F a, Vec3F b);
+MATH_API Vec3F sub_3f(Vec3F a, Vec3F b);
+MATH_API Vec3F mul_3f(Vec3F a, Vec3F b);
+MATH_API Vec3F div_3f(Vec3F a, Vec3F b);
+MATH_API f32 dot_3f(Vec3F a, Vec3F b);
+MATH_API Vec3F cross_3f(Vec3F a, Vec3F b);
+MATH_API Vec3F scale_3f(Vec3F v, f32 scale);
+MATH_API Vec3F transform_3f(Vec3F v, Mat3x3F m);
 
-f32 magnitude_3f(Vec3F v);
-f32 magnitude_squared_3f(Vec3F v);
-f32 distance_3f(Vec3F a, Vec3F b);
-f32 distance_squared_3f(Vec3F a, Vec3F b);
-Vec3F normalize_3f(Vec3F v);
+MATH_API f32 magnitude_3f(Vec3F v);
+MATH_API f32 magnitude_squared_3f(Vec3F v);
+MATH_API f32 distance_3f(Vec3F a, Vec3F b);
+MATH_API f32 distance_squared_3f(Vec3F a, Vec3F b);
+MATH_API Vec3F normalize_3f(Vec3F v);
+MATH_API Vec3F normalize_fast_3f(Vec3F v);
+MATH_API Vec3F normalize_safe_3f(Vec3F v);
 
-Vec3F lerp_3f(Vec3F curr, Vec3F target, f32 rate);
+MATH_API Vec3F lerp_3f(Vec3F curr, Vec3F target, f32 rate);
 
 // @Vec4F ===================================================================================
 
 #define V4F_ZERO ((Vec4F) {0.0f, 0.0f, 0.0f, 0.0f})
 
-Vec4F v4f(f32 x, f32 y, f32 z, f32 w);
+MATH_INLINE Vec4F v4f(f32 x, f32 y, f32 z, f32 w);
 
-Vec4F add_4f(Vec4F a, Vec4F b);
-Vec4F sub_4f(Vec4F a, Vec4F b);
-Vec4F mul_4f(Vec4F a, Vec4F b);
-Vec4F div_4f(Vec4F a, Vec4F b);
-f32 dot_4f(Vec4F a, Vec4F b);
-Vec4F scale_4f(Vec4F v, f32 scale);
-Vec4F transform_4f(Vec4F v, Mat4x4F m);
+MATH_INLINE Vec4F add_4f(Vec4F a, Vec4F b);
+MATH_INLINE Vec4F sub_4f(Vec4F a, Vec4F b);
+MATH_INLINE Vec4F mul_4f(Vec4F a, Vec4F b);
+MATH_INLINE Vec4F div_4f(Vec4F a, Vec4F b);
+MATH_INLINE f32 dot_4f(Vec4F a, Vec4F b);
+MATH_INLINE Vec4F scale_4f(Vec4F v, f32 scale);
+MATH_INLINE Vec4F transform_4f(Vec4F v, Mat4x4F m);
 
-f32 magnitude_4f(Vec4F v);
-f32 magnitude_squared_4f(Vec4F v);
-f32 distance_4f(Vec4F a, Vec4F b);
-f32 distance_squared_4f(Vec4F a, Vec4F b);
-Vec4F normalize_4f(Vec4F v);
+MATH_INLINE f32 magnitude_4f(Vec4F v);
+MATH_INLINE f32 magnitude_squared_4f(Vec4F v);
+MATH_INLINE f32 distance_4f(Vec4F a, Vec4F b);
+MATH_INLINE f32 distance_squared_4f(Vec4F a, Vec4F b);
+MATH_INLINE Vec4F normalize_4f(Vec4F v);
+MATH_INLINE Vec4F normalize_fast_4f(Vec4F v);
+MATH_INLINE Vec4F normalize_safe_4f(Vec4F v);
+
+MATH_INLINE Vec4F lerp_4f(Vec4F curr, Vec4F target, f32 rate);
 
 // @Mat3x3F =================================================================================
 
-Mat3x3F m3x3f(f32 k);
+MATH_API Mat3x3F m3x3f(f32 k);
+
+MATH_API Mat3x3F rows_3x3f(Vec3F v1, Vec3F v2, Vec3F v3);
+MATH_API Mat3x3F cols_3x3f(Vec3F v1, Vec3F v2, Vec3F v3);
+
+MATH_API Mat3x3F mul_3x3f(Mat3x3F a, Mat3x3F b);
+MATH_API Mat3x3F transpose_3x3f(Mat3x3F m);
 
-Mat3x3F rows_3x3f(Vec3F v1, Vec3F v2, Vec3F v3);
-Mat3x3F cols_3x3f(Vec3F v1, Vec3F v2, Vec3F v3);
+MATH_API Mat3x3F translate_3x3f(f32 x_shift, f32 y_shift);
+MATH_API Mat3x3F rotate_3x3f(f32 angle);
+MATH_API Mat3x3F scale_3x3f(f32 x_scale, f32 y_scale);
+MATH_API Mat3x3F shear_3x3f(f32 x_shear, f32 y_shear);
 
-Mat3x3F mul_3x3f(Mat3x3F a, Mat3x3F b);
-Mat3x3F transpose_3x3f(Mat3x3F m);
+MATH_API Mat3x3F orthographic_3x3f(f32 left, f32 right, f32 bot, f32 top);
 
-Mat3x3F translate_3x3f(f32 x_shift, f32 y_shift);
-Mat3x3F rotate_3x3f(f32 angle);
-Mat3x3F scale_3x3f(f32 x_scale, f32 y_scale);
-Mat3x3F shear_3x3f(f32 x_shear, f32 y_shear);
+// @Affine2F ================================================================================
 
-Mat3x3F orthographic_3x3f(f32 left, f32 right, f32 bot, f32 top);
+#define A2F_IDENTITY ((Affine2F) {{{1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}}})
+
+// Translation * rotation * scale, with `angle` in degrees
+MATH_API Affine2F a2f(Vec2F pos, f32 angle, Vec2F scale);
+
+MATH_API Affine2F mul_a2f(Affine2F a, Affine2F b);
+MATH_API Affine2F invert_a2f(Affine2F m);
+MATH_API Vec2F transform_a2f(Vec2F p, Affine2F m);
+
+MATH_API Affine2F translate_a2f(f32 x_shift, f32 y_shift);
+MATH_API Affine2F orthographic_a2f(f32 left, f32 right, f32 bot, f32 top);
+
+MATH_API Mat3x3F m3x3f_from_a2f(Affine2F m);
 
 // @Mat4x4F =================================================================================
 
-Mat4x4F m4x4f(f32 k);
+MATH_API Mat4x4F m4x4f(f32 k);
+
+MATH_API Mat4x4F rows_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4);
+MATH_API Mat4x4F cols_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4);
+
+MATH_API Mat4x4F mul_4x4f(Mat4x4F a, Mat4x4F b);
+MATH_API Mat4x4F transpose_4x4f(Mat4x4F m);
+MATH_API Mat4x4F inverse_4x4f(Mat4x4F m);
+MATH_API Mat4x4F inverse_affine_4x4f(Mat4x4F m); // Bottom row must be 0 0 0 1
 
-Mat4x4F rows_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4);
-Mat4x4F cols_4x4f(Vec4F v1, Vec4F v2, Vec4F v3, Vec4F v4);
-Mat4x4F m4x4f(f32 k);
+MATH_API Mat4x4F translate_4x4f(f32 x_shift, f32 y_shift, f32 z_shift);
+MATH_API Mat4x4F rotate_4x4f(f32 angle, Vec3F axis);
+MATH_API Mat4x4F scale_4x4f(f32 x_scale, f32 y_scale, f32 z_scale);
+MATH_API Mat4x4F shear_4x4f(f32 x_shear, f32 y_shear, f32 z_shear);
 
-Mat4x4F mul_4x4f(Mat4x4F a, Mat4x4F b);
-Mat4x4F transpose_4x4f(Mat4x4F m);
+MATH_API Mat4x4F orthographic_4x4f(f32 left, f32 right, f32 bot, f32 top);
 
-Mat4x4F translate_4x4f(f32 x_shift, f32 y_shift, f32 z_shift);
-Mat4x4F rotate_4x4f(f32 angle, Vec3F axis); // Should use quaternion
-Mat4x4F scale_4x4f(f32 x_scale, f32 y_scale, f32 z_scale);
-Mat4x4F shear_4x4f(f32 x_shear, f32 y_shear, f32 z_shear);
+// Right-handed, looking down -z. `fov` is vertical, in degrees.
+MATH_API Mat4x4F perspective_4x4f(f32 fov, f32 aspect, f32 near, f32 far);
+MATH_API Mat4x4F perspective_reversed_4x4f(f32 fov, f32 aspect, f32 near);
+MATH_API Mat4x4F look_at_4x4f(Vec3F eye, Vec3F center, Vec3F up);
 
-Mat4x4F orthographic_4x4f(f32 left, f32 right, f32 bot, f32 top);
+MATH_API Vec3F unproject_4x4f(Vec2F screen, f32 depth, Vec2F viewport, Mat4x4F inv_view_proj);
+
+// @QuatF ===================================================================================
+
+#define QF_IDENTITY ((QuatF) {0.0f, 0.0f, 0.0f, 1.0f})
+
+MATH_API QuatF qf(f32 x, f32 y, f32 z, f32 w);
+MATH_API QuatF axis_angle_qf(Vec3F axis, f32 angle);
+
+MATH_API QuatF mul_qf(QuatF a, QuatF b);
+MATH_API f32 dot_qf(QuatF a, QuatF b);
+MATH_API QuatF conjugate_qf(QuatF q);
+MATH_API QuatF normalize_qf(QuatF q);
+MATH_API Vec3F rotate_qf(QuatF q, Vec3F v);
+
+MATH_API QuatF nlerp_qf(QuatF a, QuatF b, f32 t);
+MATH_API QuatF slerp_qf(QuatF a, QuatF b, f32 t);
+
+MATH_API Mat4x4F m4x4f_from_qf(QuatF q);
+MATH_API QuatF qf_from_4x4f(Mat4x4F m);
+
+// Translation * rotation * scale, built directly rather than by multiplying.
+MATH_API Mat4x4F trs_4x4f(Vec3F t, QuatF r, Vec3F s);
+MATH_API void trs_batch_4x4f(const Vec3F *t, const QuatF *r, const Vec3F *s, 
+                             Mat4x4F *out, u32 count);
+
+// @Bounds ==================================================================================
+
+MATH_API bool overlap_aabb2f(AABB2F a, AABB2F b);
+MATH_API bool overlap_circle_aabb2f(CircleF c, AABB2F box);
+MATH_API AABB2F transform_aabb2f(AABB2F box, Affine2F m);
+MATH_API AABB3F transform_aabb3f(AABB3F box, Mat4x4F m);
+MATH_API bool overlap_aabb3f(AABB3F a, AABB3F b);
+MATH_API bool contains_aabb3f(AABB3F outer, AABB3F inner);
+MATH_API AABB3F union_aabb3f(AABB3F a, AABB3F b);
+
+// @Culling =================================================================================
+
+// Planes of the clip volume -w <= x, y, z <= w, i.e. GL's default depth range.
+MATH_API FrustumF frustum_from_4x4f(Mat4x4F view_proj);
+MATH_API bool sphere_in_frustum(const FrustumF *frustum, SphereF sphere);
+MATH_API bool aabb_in_frustum(const FrustumF *frustum, AABB3F box);
+
+// Batch kernels test four bounds per step and write the indices of the visible
+// ones to `visible`, which must hold `count` entries. Return the visible count.
+// Tests are conservative: a box straddling two planes outside a corner passes.
+MATH_API u32 cull_spheres(const FrustumF *frustum, const SphereF *spheres, u32 count, 
+                          u32 *visible);
+MATH_API u32 cull_aabbs(const FrustumF *frustum, const AABB3F *boxes, u32 count, u32 *visible);
+MATH_API u32 cull_circles_2d(AABB2F view, const CircleF *circles, u32 count, u32 *visible);
+MATH_API u32 cull_aabbs_2d(AABB2F view, const AABB2F *boxes, u32 count, u32 *visible);
 
 #ifdef __cplusplus
 
 // @Overloading =============================================================================
 
-Vec2F operator+(Vec2F a, Vec2F b);
-Vec3F operator+(Vec3F a, Vec3F b);
-Vec4F operator+(Vec4F a, Vec4F b);
-Vec2F operator-(Vec2F a, Vec2F b);
-Vec3F operator-(Vec3F a, Vec3F b);
-Vec4F operator-(Vec4F a, Vec4F b);
-f32 operator*(Vec2F a, Vec2F b);
-f32 operator*(Vec3F a, Vec3F b);
-f32 operator*(Vec4F a, Vec4F b);
-Mat3x3F operator*(Mat3x3F a, Mat3x3F b);
-Mat4x4F operator*(Mat4x4F a, Mat4x4F b);
+MATH_API Vec2F operator+(Vec2F a, Vec2F b);
+MATH_API Vec3F operator+(Vec3F a, Vec3F b);
+MATH_API Vec4F operator+(Vec4F a, Vec4F b);
+MATH_API Vec2F operator-(Vec2F a, Vec2F b);
+MATH_API Vec3F operator-(Vec3F a, Vec3F b);
+MATH_API Vec4F operator-(Vec4F a, Vec4F b);
+MATH_API f32 operator*(Vec2F a, Vec2F b);
+MATH_API f32 operator*(Vec3F a, Vec3F b);
+MATH_API f32 operator*(Vec4F a, Vec4F b);
+MATH_API Mat3x3F operator*(Mat3x3F a, Mat3x3F b);
+MATH_API Mat4x4F operator*(Mat4x4F a, Mat4x4F b);
+MATH_API QuatF operator*(QuatF a, QuatF b);
+
+#endif
+
+// @Inline ==================================================================================
+
+// With SIMD_SSE_VEC4 every Vec4F op is one or two instructions on __m128 values
+// from load_4f; the horizontal sums in dot and transform use shuffles since
+// SSE2 has no dpps.
+
+#ifdef SIMD_SSE
+static inline
+__m128 dot_ps(__m128 a, __m128 b)
+{
+  __m128 d = _mm_mul_ps(a, b);
+  d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(2, 3, 0, 1)));
+  d = _mm_add_ps(d, _mm_shuffle_ps(d, d, _MM_SHUFFLE(1, 0, 3, 2)));
+
+  return d;
+}
+
+static inline
+__m128 load_4f(Vec4F v)
+{
+  return _mm_setr_ps(v.x, v.y, v.z, v.w);
+}
+
+static inline
+Vec4F store_4f(__m128 m)
+{
+  Vec4F result;
+  _mm_storeu_ps(result.elements, m);
+
+  return result;
+}
+
+// The estimate is good to 12 bits; one Newton step y * (1.5 - 0.5 * x * y^2)
+// brings it to about 22.
+static inline
+__m128 rsqrt_ps(__m128 x)
+{
+  __m128 y = _mm_rsqrt_ps(x);
+  __m128 xyy = _mm_mul_ps(_mm_mul_ps(x, y), y);
+  return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), xyy));
+}
+#endif
+
+static inline
+f32 rsqrt_f32(f32 x)
+{
+  #ifdef SIMD_SSE
+  return _mm_cvtss_f32(rsqrt_ps(_mm_set_ss(x)));
+  #else
+  return 1.0f / sqrtf(x);
+  #endif
+}
+
+// Below this squared length 1 / |v| overflows or loses all precision
+#define NORMALIZE_MIN_SQUARED 1e-30f
+
+MATH_INLINE
+Vec4F v4f(f32 x, f32 y, f32 z, f32 w)
+{
+  return (Vec4F) {x, y, z, w};
+}
+
+MATH_INLINE
+Vec4F add_4f(Vec4F a, Vec4F b)
+{
+  #ifdef SIMD_SSE_VEC4
+  return store_4f(_mm_add_ps(load_4f(a), load_4f(b)));
+  #else
+  return (Vec4F) {a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w};
+  #endif
+}
+
+MATH_INLINE
+Vec4F sub_4f(Vec4F a, Vec4F b)
+{
+  #ifdef SIMD_SSE_VEC4
+  return store_4f(_mm_sub_ps(load_4f(a), load_4f(b)));
+  #else
+  return (Vec4F) {a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w};
+  #endif
+}
+
+MATH_INLINE
+Vec4F mul_4f(Vec4F a, Vec4F b)
+{
+  #ifdef SIMD_SSE_VEC4
+  return store_4f(_mm_mul_ps(load_4f(a), load_4f(b)));
+  #else
+  return (Vec4F) {a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w};
+  #endif
+}
+
+MATH_INLINE
+Vec4F div_4f(Vec4F a, Vec4F b)
+{
+  #ifdef SIMD_SSE_VEC4
+  return store_4f(_mm_div_ps(load_4f(a), load_4f(b)));
+  #else
+  return (Vec4F) {a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w};
+  #endif
+}
+
+MATH_INLINE
+f32 dot_4f(Vec4F a, Vec4F b)
+{
+  #ifdef SIMD_SSE_VEC4
+  return _mm_cvtss_f32(dot_ps(load_4f(a), load_4f(b)));
+  #else
+  return (a.x * b.x) + (a.y * b.y) + (a.z * b.z) + (a.w * b.w);
+  #endif
+}
+
+MATH_INLINE
+Vec4F scale_4f(Vec4F v, f32 scale)
+{
+  #ifdef SIMD_SSE_VEC4
+  return store_4f(_mm_mul_ps(load_4f(v), _mm_set1_ps(scale)));
+  #else
+  return (Vec4F) {v.x * scale, v.y * scale, v.z * scale, v.w * scale};
+  #endif
+}
+
+MATH_INLINE
+Vec4F transform_4f(Vec4F v, Mat4x4F m)
+{
+  #ifdef SIMD_SSE_VEC4
+  __m128 x = load_4f(v);
+  __m128 r0 = _mm_mul_ps(_mm_loadu_ps(m.elements[0]), x);
+  __m128 r1 = _mm_mul_ps(_mm_loadu_ps(m.elements[1]), x);
+  __m128 r2 = _mm_mul_ps(_mm_loadu_ps(m.elements[2]), x);
+  __m128 r3 = _mm_mul_ps(_mm_loadu_ps(m.elements[3]), x);
+  _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+  return store_4f(_mm_add_ps(_mm_add_ps(r0, r1), _mm_add_ps(r2, r3)));
+  #else
+  Vec4F result = {0};
+
+  for (u8 c = 0; c < 4; c++)
+  {
+    result.x += m.elements[0][c] * v.elements[c];
+    result.y += m.elements[1][c] * v.elements[c];
+    result.z += m.elements[2][c] * v.elements[c];
+    result.w += m.elements[3][c] * v.elements[c];
+  }
+
+  return result;
+  #endif
+}
+
+MATH_INLINE
+f32 magnitude_4f(Vec4F v)
+{
+  return sqrtf(dot_4f(v, v));
+}
+
+MATH_INLINE
+f32 magnitude_squared_4f(Vec4F v)
+{
+  return dot_4f(v, v);
+}
+
+MATH_INLINE
+f32 distance_4f(Vec4F a, Vec4F b)
+{
+  return magnitude_4f(sub_4f(b, a));
+}
+
+MATH_INLINE
+f32 distance_squared_4f(Vec4F a, Vec4F b)
+{
+  return magnitude_squared_4f(sub_4f(b, a));
+}
+
+MATH_INLINE
+Vec4F normalize_4f(Vec4F v)
+{
+  #ifdef SIMD_SSE_VEC4
+  __m128 x = load_4f(v);
+  return store_4f(_mm_div_ps(x, _mm_sqrt_ps(dot_ps(x, x))));
+  #else
+  return scale_4f(v, 1.0f / magnitude_4f(v));
+  #endif
+}
+
+MATH_INLINE
+Vec4F normalize_fast_4f(Vec4F v)
+{
+  #ifdef SIMD_SSE_VEC4
+  __m128 x = load_4f(v);
+  return store_4f(_mm_mul_ps(x, rsqrt_ps(dot_ps(x, x))));
+  #else
+  return scale_4f(v, rsqrt_f32(dot_4f(v, v)));
+  #endif
+}
+
+MATH_INLINE
+Vec4F normalize_safe_4f(Vec4F v)
+{
+  #ifdef SIMD_SSE_VEC4
+  // Branch-free: lanes are masked to zero when the length is too small
+  __m128 x = load_4f(v);
+  __m128 len_sq = dot_ps(x, x);
+  __m128 ok = _mm_cmpgt_ps(len_sq, _mm_set1_ps(NORMALIZE_MIN_SQUARED));
+  __m128 n = _mm_div_ps(x, _mm_sqrt_ps(len_sq));
+  return store_4f(_mm_and_ps(n, ok));
+  #else
+  f32 len_sq = dot_4f(v, v);
+  if (!(len_sq > NORMALIZE_MIN_SQUARED)) return V4F_ZERO;
+
+  return scale_4f(v, 1.0f / sqrtf(len_sq));
+  #endif
+}
+
+MATH_INLINE
+Vec4F lerp_4f(Vec4F curr, Vec4F target, f32 rate)
+{
+  return add_4f(curr, scale_4f(sub_4f(target, curr), rate));
+}
 
+#ifdef BASE_MATH_HEADER_ONLY
+#include "base_math.c"
 #endif
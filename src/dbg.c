@@ -0,0 +1,237 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "base_math.h"
+#include "vertex.h"
+#include "dbg.h"
+
+#ifdef DEBUG
+
+DbgFrame dbg_frame;
+
+// One glyph per printable ASCII character from ' ', one octal digit per row
+// from the top, 4 is the left pixel.
+static const u16 dbg_font[95] =
+{
+  000000, 022202, 055000, 057575, 036236, 051245, 025253, 022000,
+  012221, 042224, 005250, 002720, 000024, 000700, 000002, 011244,
+  075557, 026227, 071747, 071317, 055711, 074717, 074757, 071111,
+  075757, 075717, 002020, 002024, 012421, 007070, 042124, 071302,
+  075747, 025755, 065656, 034443, 065556, 074647, 074644, 034553,
+  055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552,
+  065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775,
+  055255, 055222, 071247, 064446, 044211, 031113, 025000, 000007,
+  042000, 025755, 065656, 034443, 065556, 074647, 074644, 034553,
+  055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552,
+  065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775,
+  055255, 055222, 071247, 032623, 022222, 062326, 000360,
+};
+
+static
+DbgVertex *dbg_reserve(DbgBatch *batch, u32 count)
+{
+  if (batch->count + count > batch->cap)
+  {
+    batch->cap = MAX(MAX(batch->cap * 2, batch->count + count), 4096);
+    batch->vertices = realloc(batch->vertices, sizeof (DbgVertex) * batch->cap);
+  }
+
+  DbgVertex *vertices = batch->vertices + batch->count;
+  batch->count += count;
+
+  return vertices;
+}
+
+u32 dbg_color(Vec4F color)
+{
+  u8 bytes[4] = 
+  {
+    unorm8_from_f32(color.x), 
+    unorm8_from_f32(color.y), 
+    unorm8_from_f32(color.z), 
+    unorm8_from_f32(color.w),
+  };
+
+  u32 packed;
+  memcpy(&packed, bytes, sizeof (packed));
+
+  return packed;
+}
+
+// Calls mostly repeat the last color, so the conversion is skipped for it.
+// Compared bitwise in halves, the way Vec4F arrives in registers.
+static
+u32 dbg_pack(Vec4F color)
+{
+  static u64 last_color[2] = {0};
+  static u32 last_packed = 0;
+
+  u64 bits[2];
+  memcpy(bits, &color, sizeof (bits));
+  if (bits[0] != last_color[0] || bits[1] != last_color[1])
+  {
+    memcpy(last_color, bits, sizeof (bits));
+    last_packed = dbg_color(color);
+  }
+
+  return last_packed;
+}
+
+// @Lines ===================================================================================
+
+void dbg_line(Vec3F a, Vec3F b, Vec4F color, DbgMode mode)
+{
+  u32 packed = dbg_pack(color);
+  DbgVertex *v = dbg_reserve(&dbg_frame.lines[mode], 2);
+  v[0] = (DbgVertex) {a, packed};
+  v[1] = (DbgVertex) {b, packed};
+}
+
+void dbg_lines(const Vec3F *points, u32 count, Vec4F color, DbgMode mode)
+{
+  count &= ~1u;
+  u32 packed = dbg_pack(color);
+  DbgVertex *v = dbg_reserve(&dbg_frame.lines[mode], count);
+  for (u32 i = 0; i < count; i++) v[i] = (DbgVertex) {points[i], packed};
+}
+
+void dbg_rect(AABB2F rect, f32 z, Vec4F color, DbgMode mode)
+{
+  Vec3F corners[4] = 
+  {
+    {rect.min.x, rect.min.y, z},
+    {rect.max.x, rect.min.y, z},
+    {rect.max.x, rect.max.y, z},
+    {rect.min.x, rect.max.y, z},
+  };
+
+  u32 packed = dbg_pack(color);
+  DbgVertex *v = dbg_reserve(&dbg_frame.lines[mode], 8);
+  for (u32 i = 0; i < 4; i++)
+  {
+    v[i * 2 + 0] = (DbgVertex) {corners[i], packed};
+    v[i * 2 + 1] = (DbgVertex) {corners[(i + 1) % 4], packed};
+  }
+}
+
+void dbg_box(AABB3F box, Vec4F color, DbgMode mode)
+{
+  Vec3F c[8];
+  for (u32 i = 0; i < 8; i++)
+  {
+    c[i] = v3f(i & 1 ? box.max.x : box.min.x, 
+               i & 2 ? box.max.y : box.min.y, 
+               i & 4 ? box.max.z : box.min.z);
+  }
+
+  // Corner pairs differing in one bit
+  static const u8 edges[12][2] = 
+  {
+    {0, 1}, {2, 3}, {4, 5}, {6, 7},
+    {0, 2}, {1, 3}, {4, 6}, {5, 7},
+    {0, 4}, {1, 5}, {2, 6}, {3, 7},
+  };
+
+  u32 packed = dbg_pack(color);
+  DbgVertex *v = dbg_reserve(&dbg_frame.lines[mode], 24);
+  for (u32 i = 0; i < 12; i++)
+  {
+    v[i * 2 + 0] = (DbgVertex) {c[edges[i][0]], packed};
+    v[i * 2 + 1] = (DbgVertex) {c[edges[i][1]], packed};
+  }
+}
+
+void dbg_circle(Vec3F center, f32 radius, Vec4F color, DbgMode mode)
+{
+  static Vec2F unit[DBG_CIRCLE_SEGMENTS + 1];
+  static bool unit_ready = FALSE;
+  if (!unit_ready)
+  {
+    for (u32 i = 0; i <= DBG_CIRCLE_SEGMENTS; i++)
+    {
+      sincos_f32(6.28318531f * i / DBG_CIRCLE_SEGMENTS, TRIG_PRECISE, &unit[i].y, &unit[i].x);
+    }
+    unit_ready = TRUE;
+  }
+
+  u32 packed = dbg_pack(color);
+  DbgVertex *v = dbg_reserve(&dbg_frame.lines[mode], DBG_CIRCLE_SEGMENTS * 2);
+  for (u32 i = 0; i < DBG_CIRCLE_SEGMENTS; i++)
+  {
+    Vec3F a = v3f(center.x + unit[i].x * radius, center.y + unit[i].y * radius, center.z);
+    Vec3F b = v3f(center.x + unit[i + 1].x * radius, center.y + unit[i + 1].y * radius, center.z);
+    v[i * 2 + 0] = (DbgVertex) {a, packed};
+    v[i * 2 + 1] = (DbgVertex) {b, packed};
+  }
+}
+
+// @Text ====================================================================================
+
+void dbg_text(Vec2F position, f32 size, Vec4F color, const i8 *text)
+{
+  u32 packed = dbg_pack(color);
+  f32 x = position.x;
+  f32 y = position.y;
+
+  for (const i8 *c = text; *c; c++)
+  {
+    if (*c == '\n')
+    {
+      x = position.x;
+      y += (DBG_FONT_HEIGHT + 1) * size;
+      continue;
+    }
+
+    u32 index = (u8) *c - ' ';
+    u16 glyph = index < ARR_LEN(dbg_font) ? dbg_font[index] : dbg_font['?' - ' '];
+
+    // One quad per run of lit pixels in a row
+    for (u32 row = 0; row < DBG_FONT_HEIGHT; row++)
+    {
+      u32 bits = (glyph >> ((DBG_FONT_HEIGHT - 1 - row) * 3)) & 7;
+      u32 col = 0;
+      while (col < DBG_FONT_WIDTH)
+      {
+        if (!(bits & (4 >> col)))
+        {
+          col++;
+          continue;
+        }
+
+        u32 start = col;
+        while (col < DBG_FONT_WIDTH && (bits & (4 >> col))) col++;
+
+        f32 x0 = x + start * size;
+        f32 x1 = x + col * size;
+        f32 y0 = y + row * size;
+        f32 y1 = y0 + size;
+
+        DbgVertex *v = dbg_reserve(&dbg_frame.text, 6);
+        v[0] = (DbgVertex) {{x0, y0, 0.0f}, packed};
+        v[1] = (DbgVertex) {{x0, y1, 0.0f}, packed};
+        v[2] = (DbgVertex) {{x1, y0, 0.0f}, packed};
+        v[3] = (DbgVertex) {{x1, y0, 0.0f}, packed};
+        v[4] = (DbgVertex) {{x0, y1, 0.0f}, packed};
+        v[5] = (DbgVertex) {{x1, y1, 0.0f}, packed};
+      }
+    }
+
+    x += (DBG_FONT_WIDTH + 1) * size;
+  }
+}
+
+void dbg_clear(void)
+{
+  for (u32 i = 0; i < DBG_MODE_COUNT; i++) dbg_frame.lines[i].count = 0;
+  dbg_frame.text.count = 0;
+}
+
+void dbg_shutdown(void)
+{
+  for (u32 i = 0; i < DBG_MODE_COUNT; i++) free(dbg_frame.lines[i].vertices);
+  free(dbg_frame.text.vertices);
+  dbg_frame = (DbgFrame) {0};
+}
+
+#endif
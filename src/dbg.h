@@ -0,0 +1,85 @@
+#pragma once
+
+#include "base_common.h"
+#include "base_math.h"
+
+// Immediate mode debug drawing. Calls append vertices to per-frame batches
+// and r_flush_debug draws them all at once, lines in two draws (depth tested
+// and on top) and text in a third. Without DEBUG every call compiles to
+// nothing, arguments included.
+
+#define DBG_FONT_WIDTH 3
+#define DBG_FONT_HEIGHT 5
+#define DBG_CIRCLE_SEGMENTS 32
+
+typedef enum DbgMode
+{
+  DBG_DEPTH,   // Hidden behind scene geometry
+  DBG_OVERLAY, // Always on top
+  DBG_MODE_COUNT,
+} DbgMode;
+
+// 16 bytes; color is RGBA8 in memory order, read as normalized bytes
+typedef struct DbgVertex DbgVertex;
+struct DbgVertex
+{
+  Vec3F position;
+  u32 color;
+};
+
+typedef struct DbgBatch DbgBatch;
+struct DbgBatch
+{
+  DbgVertex *vertices;
+  u32 count;
+  u32 cap;
+};
+
+// Lines are in world space. Text is triangles in pixels from the top left of
+// the viewport and always on top.
+typedef struct DbgFrame DbgFrame;
+struct DbgFrame
+{
+  DbgBatch lines[DBG_MODE_COUNT];
+  DbgBatch text;
+};
+
+#ifdef DEBUG
+
+extern DbgFrame dbg_frame;
+
+u32 dbg_color(Vec4F color);
+
+void dbg_line(Vec3F a, Vec3F b, Vec4F color, DbgMode mode);
+
+// `points` holds `count` / 2 segments, for drawing lots of lines at once
+void dbg_lines(const Vec3F *points, u32 count, Vec4F color, DbgMode mode);
+
+// A rect in the plane z, a box, and a circle around z
+void dbg_rect(AABB2F rect, f32 z, Vec4F color, DbgMode mode);
+void dbg_box(AABB3F box, Vec4F color, DbgMode mode);
+void dbg_circle(Vec3F center, f32 radius, Vec4F color, DbgMode mode);
+
+// 3x5 pixel font scaled by `size`, ASCII only with lowercase drawn as
+// uppercase. '\n' starts a new line at position.x.
+void dbg_text(Vec2F position, f32 size, Vec4F color, const i8 *text);
+
+// Empties the batches and keeps their memory, called by r_flush_debug
+void dbg_clear(void);
+
+// Frees the batches
+void dbg_shutdown(void);
+
+#else
+
+#define dbg_color(...) 0
+#define dbg_line(...) ((void) 0)
+#define dbg_lines(...) ((void) 0)
+#define dbg_rect(...) ((void) 0)
+#define dbg_box(...) ((void) 0)
+#define dbg_circle(...) ((void) 0)
+#define dbg_text(...) ((void) 0)
+#define dbg_clear() ((void) 0)
+#define dbg_shutdown() ((void) 0)
+
+#endif
@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "draw.h"
+
+// @DrawPack ================================================================================
+
+DrawPack draw_pack_create(u32 vertex_cap, u32 index_cap)
+{
+  DrawPack pack = {0};
+  pack.vertex_cap = MAX(vertex_cap, 1);
+  pack.index_cap = MAX(index_cap, 1);
+  pack.mesh_cap = 16;
+  pack.vertices = malloc(sizeof (MeshVertex) * pack.vertex_cap);
+  pack.indices = malloc(sizeof (u32) * pack.index_cap);
+  pack.meshes = malloc(sizeof (DrawPackMesh) * pack.mesh_cap);
+
+  return pack;
+}
+
+void draw_pack_destroy(DrawPack *pack)
+{
+  free(pack->vertices);
+  free(pack->indices);
+  free(pack->meshes);
+  *pack = (DrawPack) {0};
+}
+
+u32 draw_pack_add(DrawPack *pack, const Mesh *mesh)
+{
+  while (pack->vertex_count + mesh->vertex_count > pack->vertex_cap) pack->vertex_cap *= 2;
+  while (pack->index_count + mesh->index_count > pack->index_cap) pack->index_cap *= 2;
+  if (pack->mesh_count == pack->mesh_cap) pack->mesh_cap *= 2;
+  pack->vertices = realloc(pack->vertices, sizeof (MeshVertex) * pack->vertex_cap);
+  pack->indices = realloc(pack->indices, sizeof (u32) * pack->index_cap);
+  pack->meshes = realloc(pack->meshes, sizeof (DrawPackMesh) * pack->mesh_cap);
+
+  DrawPackMesh *entry = &pack->meshes[pack->mesh_count];
+  entry->base_vertex = pack->vertex_count;
+  entry->first_index = pack->index_count;
+  entry->vertex_count = mesh->vertex_count;
+
+  if (mesh->lod_count)
+  {
+    memcpy(entry->lods, mesh->lods, sizeof (MeshLod) * mesh->lod_count);
+    entry->lod_count = mesh->lod_count;
+  }
+  else
+  {
+    entry->lods[0] = (MeshLod) {0, mesh->index_count, 0.0f};
+    entry->lod_count = 1;
+  }
+
+  memcpy(pack->vertices + pack->vertex_count, mesh->vertices,
+         sizeof (MeshVertex) * mesh->vertex_count);
+  memcpy(pack->indices + pack->index_count, mesh->indices, sizeof (u32) * mesh->index_count);
+  pack->vertex_count += mesh->vertex_count;
+  pack->index_count += mesh->index_count;
+
+  return pack->mesh_count++;
+}
+
+u32 draw_pack_index_size(const DrawPack *pack)
+{
+  u32 max_vertices = 0;
+  for (u32 i = 0; i < pack->mesh_count; i++)
+  {
+    max_vertices = MAX(max_vertices, pack->meshes[i].vertex_count);
+  }
+
+  return mesh_index_size(max_vertices);
+}
+
+// @DrawList ================================================================================
+
+DrawList draw_list_create(u32 capacity)
+{
+  DrawList list = {0};
+  list.cap = MAX(capacity, 1);
+  list.commands = malloc(sizeof (DrawCommand) * list.cap);
+
+  return list;
+}
+
+void draw_list_destroy(DrawList *list)
+{
+  free(list->commands);
+  *list = (DrawList) {0};
+}
+
+void draw_list_clear(DrawList *list)
+{
+  list->count = 0;
+  list->instance_count = 0;
+}
+
+u32 draw_list_add(DrawList *list, const DrawPack *pack, u32 mesh, u32 lod, u32 instance_count)
+{
+  ASSERT(mesh < pack->mesh_count);
+  const DrawPackMesh *entry = &pack->meshes[mesh];
+  ASSERT(lod < entry->lod_count);
+
+  if (list->count == list->cap)
+  {
+    list->cap *= 2;
+    list->commands = realloc(list->commands, sizeof (DrawCommand) * list->cap);
+  }
+
+  u32 base_instance = list->instance_count;
+  list->commands[list->count++] = (DrawCommand)
+  {
+    .index_count = entry->lods[lod].index_count,
+    .instance_count = instance_count,
+    .first_index = entry->first_index + entry->lods[lod].index_offset,
+    .base_vertex = (i32) entry->base_vertex,
+    .base_instance = base_instance,
+  };
+  list->instance_count += instance_count;
+
+  return base_instance;
+}
+
+// @Submit ==================================================================================
+
+void draw_list_submit(const DrawList *list, DrawPath path, const DrawBackend *backend)
+{
+  if (list->count == 0) return;
+
+  switch (path)
+  {
+    case DRAW_PATH_LOOP:
+    {
+      for (u32 i = 0; i < list->count; i++)
+      {
+        backend->set_base_instance(backend->user, list->commands[i].base_instance);
+        backend->draw(backend->user, &list->commands[i]);
+      }
+    } break;
+
+    case DRAW_PATH_MULTI:
+    {
+      backend->multi_draw(backend->user, list->commands, list->count);
+    } break;
+
+    case DRAW_PATH_INDIRECT:
+    {
+      backend->multi_draw_indirect(backend->user, list->commands, list->count);
+    } break;
+  }
+}
+
+static
+void recorder_set_base_instance(void *user, u32 base_instance)
+{
+  (void) base_instance;
+  DrawRecorder *recorder = user;
+  recorder->api_calls++;
+}
+
+static
+void recorder_draw(void *user, const DrawCommand *command)
+{
+  DrawRecorder *recorder = user;
+  recorder->api_calls++;
+  recorder->draws++;
+  recorder->indices += (u64) command->index_count * command->instance_count;
+}
+
+static
+void recorder_multi_draw(void *user, const DrawCommand *commands, u32 count)
+{
+  DrawRecorder *recorder = user;
+  recorder->api_calls++;
+  recorder->draws += count;
+  for (u32 i = 0; i < count; i++) recorder->indices += commands[i].index_count;
+}
+
+static
+void recorder_multi_draw_indirect(void *user, const DrawCommand *commands, u32 count)
+{
+  DrawRecorder *recorder = user;
+  recorder->api_calls += 2;
+  recorder->draws += count;
+  recorder->upload_bytes += sizeof (DrawCommand) * count;
+  for (u32 i = 0; i < count; i++)
+  {
+    recorder->indices += (u64) commands[i].index_count * commands[i].instance_count;
+  }
+}
+
+DrawBackend draw_recorder_backend(DrawRecorder *recorder)
+{
+  return (DrawBackend)
+  {
+    .user = recorder,
+    .set_base_instance = recorder_set_base_instance,
+    .draw = recorder_draw,
+    .multi_draw = recorder_multi_draw,
+    .multi_draw_indirect = recorder_multi_draw_indirect,
+  };
+}
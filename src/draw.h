@@ -0,0 +1,119 @@
+#pragma once
+
+#include "base_common.h"
+#include "mesh.h"
+
+// Same layout as GL's DrawElementsIndirectCommand, so a list of them can be
+// uploaded as is for glMultiDrawElementsIndirect.
+typedef struct DrawCommand DrawCommand;
+struct DrawCommand
+{
+  u32 index_count;
+  u32 instance_count;
+  u32 first_index;
+  i32 base_vertex;
+  u32 base_instance;
+};
+
+// @DrawPack ================================================================================
+
+typedef struct DrawPackMesh DrawPackMesh;
+struct DrawPackMesh
+{
+  u32 base_vertex;
+  u32 first_index;
+  u32 vertex_count;
+  MeshLod lods[MESH_MAX_LODS]; // Offsets relative to first_index
+  u32 lod_count;
+};
+
+// Static meshes appended into one vertex and one index array, to be uploaded
+// once and drawn with one vertex array bound. Indices stay relative to their
+// mesh and get base_vertex added at draw time, so 16-bit indices still work
+// when the pack holds more than 65536 vertices.
+typedef struct DrawPack DrawPack;
+struct DrawPack
+{
+  MeshVertex *vertices;
+  u32 vertex_count;
+  u32 vertex_cap;
+  u32 *indices;
+  u32 index_count;
+  u32 index_cap;
+  DrawPackMesh *meshes;
+  u32 mesh_count;
+  u32 mesh_cap;
+};
+
+DrawPack draw_pack_create(u32 vertex_cap, u32 index_cap);
+void draw_pack_destroy(DrawPack *pack);
+
+// Returns the mesh's id in the pack
+u32 draw_pack_add(DrawPack *pack, const Mesh *mesh);
+
+// Index size that fits the largest mesh, 2 or 4
+u32 draw_pack_index_size(const DrawPack *pack);
+
+// @DrawList ================================================================================
+
+// Commands for one frame. Each draw's instances take consecutive slots from
+// base_instance on, and the vertex shader finds its per-draw data through an
+// instanced attribute read at that slot, which stands in for gl_DrawID.
+typedef struct DrawList DrawList;
+struct DrawList
+{
+  DrawCommand *commands;
+  u32 count;
+  u32 cap;
+  u32 instance_count;
+};
+
+DrawList draw_list_create(u32 capacity);
+void draw_list_destroy(DrawList *list);
+void draw_list_clear(DrawList *list);
+
+// Returns the first instance slot of the draw
+u32 draw_list_add(DrawList *list, const DrawPack *pack, u32 mesh, u32 lod, u32 instance_count);
+
+// @Submit ==================================================================================
+
+typedef enum DrawPath
+{
+  // One draw per command, each preceded by moving the instance stream to its
+  // base_instance. Two calls per draw, works on 4.1.
+  DRAW_PATH_LOOP,
+
+  // glMultiDrawElementsBaseVertex, one call on 4.1. It has no instancing, so
+  // every draw reads instance slot 0: only for geometry that needs no
+  // per-draw data, e.g. static meshes pre-transformed into world space.
+  DRAW_PATH_MULTI,
+
+  // Command upload plus glMultiDrawElementsIndirect, needs 4.3.
+  DRAW_PATH_INDIRECT,
+} DrawPath;
+
+// What a submission turns into. render.c implements it with GL; the recorder
+// below counts calls instead, so submission costs can be measured without a
+// context.
+typedef struct DrawBackend DrawBackend;
+struct DrawBackend
+{
+  void *user;
+  void (*set_base_instance)(void *user, u32 base_instance);
+  void (*draw)(void *user, const DrawCommand *command);
+  void (*multi_draw)(void *user, const DrawCommand *commands, u32 count);
+  void (*multi_draw_indirect)(void *user, const DrawCommand *commands, u32 count);
+};
+
+void draw_list_submit(const DrawList *list, DrawPath path, const DrawBackend *backend);
+
+typedef struct DrawRecorder DrawRecorder;
+struct DrawRecorder
+{
+  u32 api_calls;     // Driver calls, a command upload counts as one
+  u32 draws;         // Commands executed
+  u64 upload_bytes;  // Command data sent for indirect draws
+  u64 indices;       // Indices drawn, instances included
+};
+
+DrawBackend draw_recorder_backend(DrawRecorder *recorder);
@@ -0,0 +1,1164 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "font.h"
+#include "vertex.h"
+
+#define FONT_NONE 0xFFFFFFFF
+#define FONT_INF 1e20f
+
+// @Source ==================================================================================
+
+#define FONT_TTF_MAX_DEPTH 8   // Composite glyphs nest at most this deep
+#define FONT_TTF_TOLERANCE 0.1f // Curves are flattened to within this many pixels
+
+typedef struct FontTtf FontTtf;
+struct FontTtf
+{
+  const u8 *data;
+  u64 size;
+  u8 *owned;
+
+  u32 glyph_count;
+  u32 metric_count;
+  bool long_loca;
+  i16 ascent;
+  i16 descent;
+  i16 line_gap;
+
+  u32 cmap;
+  u32 cmap_format;
+  u32 loca;
+  u32 glyf;
+  u32 glyf_size;
+  u32 hmtx;
+  u32 kern;
+  u32 kern_pairs;
+};
+
+// Line segments in pixels, two points each
+typedef struct FontEdges FontEdges;
+struct FontEdges
+{
+  Vec2F *points;
+  u32 count;
+  u32 cap;
+};
+
+// Font units to pixels, x' = m[0] x + m[2] y + m[4] and y' = m[1] x + m[3] y + m[5]
+typedef struct FontTransform FontTransform;
+struct FontTransform
+{
+  f32 m[6];
+};
+
+// Reads past the end of the file come back as zero, so a truncated or
+// malformed table ends up as missing glyphs rather than a crash
+static
+u32 ttf_u8(const FontTtf *ttf, u64 offset)
+{
+  return offset < ttf->size ? ttf->data[offset] : 0;
+}
+
+static
+u32 ttf_u16(const FontTtf *ttf, u64 offset)
+{
+  if (offset + 2 > ttf->size) return 0;
+
+  const u8 *p = &ttf->data[offset];
+  return (u32) p[0] << 8 | p[1];
+}
+
+static
+i32 ttf_i16(const FontTtf *ttf, u64 offset)
+{
+  return (i16) ttf_u16(ttf, offset);
+}
+
+static
+u32 ttf_u32(const FontTtf *ttf, u64 offset)
+{
+  if (offset + 4 > ttf->size) return 0;
+
+  const u8 *p = &ttf->data[offset];
+  return (u32) p[0] << 24 | (u32) p[1] << 16 | (u32) p[2] << 8 | p[3];
+}
+
+static
+u32 ttf_table(const FontTtf *ttf, const i8 *tag, u32 *length)
+{
+  u32 count = ttf_u16(ttf, 4);
+  for (u32 i = 0; i < count; i++)
+  {
+    u32 record = 12 + 16 * i;
+    if (record + 16 > ttf->size) break;
+    if (memcmp(&ttf->data[record], tag, 4) == 0)
+    {
+      u32 offset = ttf_u32(ttf, record + 8);
+      if (length) *length = ttf_u32(ttf, record + 12);
+      return offset;
+    }
+  }
+
+  return 0;
+}
+
+static
+u32 ttf_cmap_lookup(const FontTtf *ttf, u32 codepoint)
+{
+  u32 cmap = ttf->cmap;
+
+  if (ttf->cmap_format == 12)
+  {
+    u32 lo = 0;
+    u32 hi = ttf_u32(ttf, cmap + 12);
+    while (lo < hi)
+    {
+      u32 mid = (lo + hi) / 2;
+      u64 group = cmap + 16 + 12 * (u64) mid;
+      u32 start = ttf_u32(ttf, group);
+      u32 end = ttf_u32(ttf, group + 4);
+      if (codepoint < start) hi = mid;
+      else if (codepoint > end) lo = mid + 1;
+      else return ttf_u32(ttf, group + 8) + codepoint - start;
+    }
+
+    return 0;
+  }
+
+  if (codepoint > 0xFFFF) return 0;
+
+  // First segment whose end is at or past the codepoint
+  u32 segments = ttf_u16(ttf, cmap + 6) / 2;
+  u32 ends = cmap + 14;
+  u32 lo = 0;
+  u32 hi = segments;
+  while (lo < hi)
+  {
+    u32 mid = (lo + hi) / 2;
+    if (ttf_u16(ttf, ends + 2 * mid) < codepoint) lo = mid + 1;
+    else hi = mid;
+  }
+  if (lo == segments) return 0;
+
+  u32 starts = ends + 2 * segments + 2;
+  u32 start = ttf_u16(ttf, starts + 2 * lo);
+  if (codepoint < start) return 0;
+
+  u32 delta = ttf_u16(ttf, starts + 2 * segments + 2 * lo);
+  u32 range = starts + 4 * segments + 2 * lo;
+  u32 range_offset = ttf_u16(ttf, range);
+  if (range_offset == 0) return (codepoint + delta) & 0xFFFF;
+
+  // The offset is from its own position into the glyph id array that follows
+  u32 glyph = ttf_u16(ttf, range + range_offset + 2 * (codepoint - start));
+  return glyph ? (glyph + delta) & 0xFFFF : 0;
+}
+
+// Byte range of a glyph in glyf, empty for blank glyphs
+static
+bool ttf_glyph_range(const FontTtf *ttf, u32 glyph, u32 *offset)
+{
+  if (glyph >= ttf->glyph_count) return FALSE;
+
+  u32 start, end;
+  if (ttf->long_loca)
+  {
+    start = ttf_u32(ttf, ttf->loca + 4 * glyph);
+    end = ttf_u32(ttf, ttf->loca + 4 * glyph + 4);
+  }
+  else
+  {
+    start = ttf_u16(ttf, ttf->loca + 2 * glyph) * 2;
+    end = ttf_u16(ttf, ttf->loca + 2 * glyph + 2) * 2;
+  }
+
+  if (start + 10 > end || end > ttf->glyf_size) return FALSE;
+
+  *offset = ttf->glyf + start;
+  return TRUE;
+}
+
+static
+Vec2F ttf_apply(const FontTransform *t, f32 x, f32 y)
+{
+  return v2f(t->m[0] * x + t->m[2] * y + t->m[4], t->m[1] * x + t->m[3] * y + t->m[5]);
+}
+
+static
+void ttf_edge(FontEdges *edges, Vec2F a, Vec2F b)
+{
+  if (edges->count + 2 > edges->cap)
+  {
+    edges->cap = MAX(edges->cap * 2, 256);
+    edges->points = realloc(edges->points, sizeof (Vec2F) * edges->cap);
+  }
+
+  edges->points[edges->count++] = a;
+  edges->points[edges->count++] = b;
+}
+
+// Flattened into as many lines as keep the midpoint within the tolerance
+static
+void ttf_curve(FontEdges *edges, Vec2F a, Vec2F control, Vec2F b)
+{
+  f32 dx = a.x - 2.0f * control.x + b.x;
+  f32 dy = a.y - 2.0f * control.y + b.y;
+  f32 deviation = 0.25f * sqrtf(dx * dx + dy * dy);
+  u32 steps = (u32) ceilf(sqrtf(deviation / FONT_TTF_TOLERANCE));
+  steps = MIN(MAX(steps, 1), 32);
+
+  Vec2F prev = a;
+  for (u32 i = 1; i <= steps; i++)
+  {
+    f32 t = (f32) i / steps;
+    f32 s = 1.0f - t;
+    Vec2F next = v2f(s * s * a.x + 2.0f * s * t * control.x + t * t * b.x,
+                     s * s * a.y + 2.0f * s * t * control.y + t * t * b.y);
+    ttf_edge(edges, prev, next);
+    prev = next;
+  }
+}
+
+static
+Vec2F ttf_mid(Vec2F a, Vec2F b)
+{
+  return v2f(0.5f * (a.x + b.x), 0.5f * (a.y + b.y));
+}
+
+// Contours are quadratic splines where two off curve points in a row imply
+// an on curve one halfway between them
+static
+void ttf_contour(FontEdges *edges, const Vec2F *points, const u8 *flags, u32 n)
+{
+  if (n < 2) return;
+
+  bool first_on = flags[0] & 1;
+  bool last_on = flags[n - 1] & 1;
+  Vec2F start = first_on ? points[0] : last_on ? points[n - 1] : ttf_mid(points[0], points[n - 1]);
+  u32 begin = first_on ? 1 : 0;
+  u32 end = first_on || !last_on ? n : n - 1;
+
+  Vec2F pen = start;
+  Vec2F control = start;
+  bool curve = FALSE;
+  for (u32 i = begin; i <= end; i++)
+  {
+    bool closing = i == end;
+    Vec2F p = closing ? start : points[i];
+    bool on = closing || (flags[i] & 1);
+
+    if (on)
+    {
+      if (curve) ttf_curve(edges, pen, control, p);
+      else ttf_edge(edges, pen, p);
+      pen = p;
+      curve = FALSE;
+    }
+    else
+    {
+      if (curve)
+      {
+        Vec2F mid = ttf_mid(control, p);
+        ttf_curve(edges, pen, control, mid);
+        pen = mid;
+      }
+      control = p;
+      curve = TRUE;
+    }
+  }
+}
+
+static
+void ttf_outline(const FontTtf *ttf, u32 glyph, FontTransform t, u32 depth, FontEdges *edges)
+{
+  u32 offset;
+  if (!ttf_glyph_range(ttf, glyph, &offset)) return;
+
+  i32 contours = ttf_i16(ttf, offset);
+  u64 p = offset + 10;
+
+  if (contours < 0)
+  {
+    if (depth == FONT_TTF_MAX_DEPTH) return;
+
+    u32 flags;
+    do
+    {
+      flags = ttf_u16(ttf, p);
+      u32 component = ttf_u16(ttf, p + 2);
+      p += 4;
+
+      // Point matching offsets (ARGS_ARE_XY_VALUES unset) are taken as zero
+      f32 dx, dy;
+      if (flags & 0x1)
+      {
+        dx = (f32) ttf_i16(ttf, p);
+        dy = (f32) ttf_i16(ttf, p + 2);
+        p += 4;
+      }
+      else
+      {
+        dx = (f32) (i8) ttf_u8(ttf, p);
+        dy = (f32) (i8) ttf_u8(ttf, p + 1);
+        p += 2;
+      }
+      if (!(flags & 0x2)) dx = dy = 0.0f;
+
+      // 2.14 fixed point: one scale, separate x and y, or a full 2x2
+      f32 a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f;
+      if (flags & 0x8)
+      {
+        a = d = ttf_i16(ttf, p) / 16384.0f;
+        p += 2;
+      }
+      else if (flags & 0x40)
+      {
+        a = ttf_i16(ttf, p) / 16384.0f;
+        d = ttf_i16(ttf, p + 2) / 16384.0f;
+        p += 4;
+      }
+      else if (flags & 0x80)
+      {
+        a = ttf_i16(ttf, p) / 16384.0f;
+        b = ttf_i16(ttf, p + 2) / 16384.0f;
+        c = ttf_i16(ttf, p + 4) / 16384.0f;
+        d = ttf_i16(ttf, p + 6) / 16384.0f;
+        p += 8;
+      }
+
+      const f32 *m = t.m;
+      FontTransform child =
+      {
+        {
+          m[0] * a + m[2] * b, m[1] * a + m[3] * b,
+          m[0] * c + m[2] * d, m[1] * c + m[3] * d,
+          m[0] * dx + m[2] * dy + m[4], m[1] * dx + m[3] * dy + m[5],
+        }
+      };
+      ttf_outline(ttf, component, child, depth + 1, edges);
+    }
+    while ((flags & 0x20) && p < ttf->size);
+
+    return;
+  }
+
+  u32 count = contours ? ttf_u16(ttf, p + 2 * (contours - 1)) + 1 : 0;
+  if (count == 0) return;
+
+  u64 instructions = p + 2 * contours;
+  p = instructions + 2 + ttf_u16(ttf, instructions);
+
+  u8 *flags = malloc(count);
+  Vec2F *points = malloc(sizeof (Vec2F) * count);
+  for (u32 i = 0; i < count; )
+  {
+    u8 flag = (u8) ttf_u8(ttf, p++);
+    u32 repeat = flag & 0x8 ? ttf_u8(ttf, p++) : 0;
+    for (u32 r = 0; r <= repeat && i < count; r++) flags[i++] = flag;
+  }
+
+  // Coordinates are deltas, a byte with a sign flag or an i16, or the same
+  // as the previous point
+  i32 x = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (flags[i] & 0x2)
+    {
+      i32 delta = (i32) ttf_u8(ttf, p++);
+      x += flags[i] & 0x10 ? delta : -delta;
+    }
+    else if (!(flags[i] & 0x10))
+    {
+      x += ttf_i16(ttf, p);
+      p += 2;
+    }
+    points[i].x = (f32) x;
+  }
+
+  i32 y = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (flags[i] & 0x4)
+    {
+      i32 delta = (i32) ttf_u8(ttf, p++);
+      y += flags[i] & 0x20 ? delta : -delta;
+    }
+    else if (!(flags[i] & 0x20))
+    {
+      y += ttf_i16(ttf, p);
+      p += 2;
+    }
+    points[i] = ttf_apply(&t, points[i].x, (f32) y);
+  }
+
+  u32 first = 0;
+  for (i32 i = 0; i < contours; i++)
+  {
+    u32 last = ttf_u16(ttf, offset + 10 + 2 * i);
+    if (last < first || last >= count) break;
+    ttf_contour(edges, &points[first], &flags[first], last - first + 1);
+    first = last + 1;
+  }
+
+  free(flags);
+  free(points);
+}
+
+// Exact area coverage: every edge adds its signed area to the cells it
+// crosses and each row's running sum is the coverage (Raph Levien's font-rs
+// accumulator). `accum` is w + 2 wide so edges on the right border fit.
+static
+void ttf_draw_edge(f32 *accum, i32 w, i32 h, Vec2F a, Vec2F b)
+{
+  if (a.y == b.y) return;
+
+  f32 dir = 1.0f;
+  if (a.y > b.y)
+  {
+    Vec2F swap = a;
+    a = b;
+    b = swap;
+    dir = -1.0f;
+  }
+
+  // x is worked out from a on every row rather than stepped, so rounding can't
+  // carry it past the edge's ends. Clamped to [0, w], every cell written is in
+  // [0, w + 1] and stays inside the row
+  f32 dxdy = (b.x - a.x) / (b.y - a.y);
+  f32 x_lo = MAX(MIN(a.x, b.x), 0.0f);
+  f32 x_hi = MIN(MAX(a.x, b.x), (f32) w);
+
+  i32 stride = w + 2;
+  i32 y_end = MIN(h, (i32) ceilf(b.y));
+  for (i32 y = MAX((i32) a.y, 0); y < y_end; y++)
+  {
+    f32 *row = &accum[y * stride];
+    f32 top = MAX((f32) y, a.y);
+    f32 bottom = MIN((f32) (y + 1), b.y);
+    f32 x = MIN(MAX(a.x + dxdy * (top - a.y), x_lo), x_hi);
+    f32 x_next = MIN(MAX(a.x + dxdy * (bottom - a.y), x_lo), x_hi);
+    f32 d = (bottom - top) * dir;
+    f32 x0 = MIN(x, x_next);
+    f32 x1 = MAX(x, x_next);
+    f32 x0_floor = floorf(x0);
+    f32 x1_ceil = ceilf(x1);
+    i32 x0i = (i32) x0_floor;
+    i32 x1i = (i32) x1_ceil;
+
+    if (x1i <= x0i + 1)
+    {
+      f32 mid = 0.5f * (x + x_next) - x0_floor;
+      row[x0i] += d - d * mid;
+      row[x0i + 1] += d * mid;
+    }
+    else
+    {
+      f32 s = 1.0f / (x1 - x0);
+      f32 x0f = x0 - x0_floor;
+      f32 a0 = 0.5f * s * (1.0f - x0f) * (1.0f - x0f);
+      f32 x1f = x1 - x1_ceil + 1.0f;
+      f32 am = 0.5f * s * x1f * x1f;
+      row[x0i] += d * a0;
+      if (x1i == x0i + 2)
+      {
+        row[x0i + 1] += d * (1.0f - a0 - am);
+      }
+      else
+      {
+        f32 a1 = s * (1.5f - x0f);
+        row[x0i + 1] += d * (a1 - a0);
+        for (i32 xi = x0i + 2; xi < x1i - 1; xi++) row[xi] += d * s;
+        f32 a2 = a1 + (x1i - x0i - 3) * s;
+        row[x1i - 1] += d * (1.0f - a2 - am);
+      }
+      row[x1i] += d * am;
+    }
+  }
+}
+
+static
+f32 ttf_scale_for_size(void *user, f32 pixel_height)
+{
+  FontTtf *ttf = user;
+  return pixel_height / (ttf->ascent - ttf->descent);
+}
+
+static
+void ttf_v_metrics(void *user, f32 scale, f32 *ascent, f32 *descent, f32 *line_gap)
+{
+  FontTtf *ttf = user;
+  *ascent = ttf->ascent * scale;
+  *descent = ttf->descent * scale;
+  *line_gap = ttf->line_gap * scale;
+}
+
+static
+u32 ttf_glyph_index(void *user, u32 codepoint)
+{
+  FontTtf *ttf = user;
+  u32 glyph = ttf_cmap_lookup(ttf, codepoint);
+  return glyph < ttf->glyph_count ? glyph : 0;
+}
+
+static
+void ttf_glyph_metrics(void *user, u32 glyph, f32 scale, f32 *advance, i32 box[4])
+{
+  FontTtf *ttf = user;
+  u32 metric = MIN(glyph, ttf->metric_count - 1);
+  *advance = ttf_u16(ttf, ttf->hmtx + 4 * metric) * scale;
+
+  box[0] = box[1] = box[2] = box[3] = 0;
+  u32 offset;
+  if (!ttf_glyph_range(ttf, glyph, &offset)) return;
+
+  // The header's bounds, y flipped. An inverted box is a broken glyph and is
+  // left empty rather than handing out a negative size
+  i32 x_min = ttf_i16(ttf, offset + 2);
+  i32 y_min = ttf_i16(ttf, offset + 4);
+  i32 x_max = ttf_i16(ttf, offset + 6);
+  i32 y_max = ttf_i16(ttf, offset + 8);
+  if (x_min > x_max || y_min > y_max) return;
+
+  box[0] = (i32) floorf(x_min * scale);
+  box[1] = (i32) floorf(-y_max * scale);
+  box[2] = (i32) ceilf(x_max * scale);
+  box[3] = (i32) ceilf(-y_min * scale);
+}
+
+static
+f32 ttf_kerning(void *user, u32 a, u32 b, f32 scale)
+{
+  FontTtf *ttf = user;
+  u32 key = a << 16 | b;
+  u32 lo = 0;
+  u32 hi = ttf->kern_pairs;
+  while (lo < hi)
+  {
+    u32 mid = (lo + hi) / 2;
+    u32 pair = ttf->kern + 6 * mid;
+    u32 probe = ttf_u32(ttf, pair);
+    if (probe < key) lo = mid + 1;
+    else if (probe > key) hi = mid;
+    else return ttf_i16(ttf, pair + 4) * scale;
+  }
+
+  return 0.0f;
+}
+
+static
+void ttf_rasterize(void *user, u32 glyph, f32 scale, u8 *out, i32 w, i32 h, i32 stride)
+{
+  if (w <= 0 || h <= 0) return;
+
+  FontTtf *ttf = user;
+  f32 advance;
+  i32 box[4];
+  ttf_glyph_metrics(user, glyph, scale, &advance, box);
+
+  // Into pixels from the box's top left, y down
+  FontTransform t = {{scale, 0.0f, 0.0f, -scale, (f32) -box[0], (f32) -box[1]}};
+  FontEdges edges = {0};
+  ttf_outline(ttf, glyph, t, 0, &edges);
+
+  f32 *accum = calloc((u64) (w + 2) * h, sizeof (f32));
+  for (u32 i = 0; i < edges.count; i += 2)
+  {
+    // Clamped to the box in case the header's bounds are off
+    Vec2F a = edges.points[i];
+    Vec2F b = edges.points[i + 1];
+    a.x = MIN(MAX(a.x, 0.0f), (f32) w);
+    b.x = MIN(MAX(b.x, 0.0f), (f32) w);
+    ttf_draw_edge(accum, w, h, a, b);
+  }
+
+  for (i32 y = 0; y < h; y++)
+  {
+    f32 sum = 0.0f;
+    for (i32 x = 0; x < w; x++)
+    {
+      sum += accum[y * (w + 2) + x];
+      f32 coverage = MIN(fabsf(sum), 1.0f);
+      out[y * stride + x] = (u8) (coverage * 255.0f + 0.5f);
+    }
+  }
+
+  free(accum);
+  free(edges.points);
+}
+
+bool font_source_ttf(const u8 *data, u64 size, FontSource *source)
+{
+  *source = (FontSource) {0};
+
+  FontTtf info = {.data = data, .size = size};
+  FontTtf *ttf = &info;
+
+  // TrueType outlines only, 'OTTO' fonts carry CFF
+  u32 version = ttf_u32(ttf, 0);
+  if (version != 0x00010000 && version != 0x74727565) return FALSE;
+
+  u32 head = ttf_table(ttf, "head", NULL);
+  u32 hhea = ttf_table(ttf, "hhea", NULL);
+  u32 maxp = ttf_table(ttf, "maxp", NULL);
+  u32 cmap = ttf_table(ttf, "cmap", NULL);
+  ttf->loca = ttf_table(ttf, "loca", NULL);
+  ttf->glyf = ttf_table(ttf, "glyf", &ttf->glyf_size);
+  ttf->hmtx = ttf_table(ttf, "hmtx", NULL);
+  if (!head || !hhea || !maxp || !cmap || !ttf->loca || !ttf->glyf || !ttf->hmtx) return FALSE;
+
+  ttf->long_loca = ttf_i16(ttf, head + 50) == 1;
+  ttf->ascent = (i16) ttf_i16(ttf, hhea + 4);
+  ttf->descent = (i16) ttf_i16(ttf, hhea + 6);
+  ttf->line_gap = (i16) ttf_i16(ttf, hhea + 8);
+  ttf->metric_count = ttf_u16(ttf, hhea + 34);
+  ttf->glyph_count = ttf_u16(ttf, maxp + 4);
+  if (ttf->ascent <= ttf->descent || ttf->metric_count == 0) return FALSE;
+
+  // Unicode subtables, full repertoire (format 12) over the BMP (format 4)
+  u32 tables = ttf_u16(ttf, cmap + 2);
+  for (u32 i = 0; i < tables; i++)
+  {
+    u32 record = cmap + 4 + 8 * i;
+    u32 platform = ttf_u16(ttf, record);
+    u32 encoding = ttf_u16(ttf, record + 2);
+    u32 subtable = cmap + ttf_u32(ttf, record + 4);
+    u32 format = ttf_u16(ttf, subtable);
+
+    bool unicode = platform == 0 || (platform == 3 && (encoding == 1 || encoding == 10));
+    if (!unicode || (format != 4 && format != 12) || ttf->cmap_format == 12) continue;
+
+    ttf->cmap = subtable;
+    ttf->cmap_format = format;
+  }
+  if (!ttf->cmap) return FALSE;
+
+  u32 kern = ttf_table(ttf, "kern", NULL);
+  if (kern && ttf_u16(ttf, kern) == 0)
+  {
+    u32 subtable = kern + 4;
+    u32 count = ttf_u16(ttf, kern + 2);
+    for (u32 i = 0; i < count; i++)
+    {
+      // Format in the high byte of coverage, bit 0 horizontal
+      u32 coverage = ttf_u16(ttf, subtable + 4);
+      if ((coverage >> 8) == 0 && (coverage & 0x1))
+      {
+        ttf->kern = subtable + 14;
+        ttf->kern_pairs = ttf_u16(ttf, subtable + 6);
+        break;
+      }
+      subtable += ttf_u16(ttf, subtable + 2);
+    }
+  }
+
+  *source = (FontSource)
+  {
+    .user = malloc(sizeof (FontTtf)),
+    .scale_for_size = ttf_scale_for_size,
+    .v_metrics = ttf_v_metrics,
+    .glyph_index = ttf_glyph_index,
+    .glyph_metrics = ttf_glyph_metrics,
+    .kerning = ttf->kern_pairs ? ttf_kerning : NULL,
+    .rasterize = ttf_rasterize,
+  };
+  memcpy(source->user, ttf, sizeof (FontTtf));
+
+  return TRUE;
+}
+
+bool font_load_ttf(const i8 *path, FontSource *source)
+{
+  *source = (FontSource) {0};
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return FALSE;
+
+  fseek(file, 0, SEEK_END);
+  i64 size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  u8 *data = malloc(MAX(size, 1));
+  bool ok = size >= 0 && fread(data, 1, size, file) == (u64) size;
+  fclose(file);
+
+  ok = ok && font_source_ttf(data, size, source);
+  if (!ok)
+  {
+    free(data);
+    return FALSE;
+  }
+
+  FontTtf *ttf = source->user;
+  ttf->owned = data;
+
+  return TRUE;
+}
+
+void font_source_ttf_free(FontSource *source)
+{
+  FontTtf *ttf = source->user;
+  if (ttf) free(ttf->owned);
+  free(ttf);
+  *source = (FontSource) {0};
+}
+
+// @Font ====================================================================================
+
+Font font_create(FontSource source, f32 size, FontMode mode)
+{
+  Font font = {0};
+  font.source = source;
+  font.mode = mode;
+  font.size = size;
+  font.scale = source.scale_for_size(source.user, size);
+
+  f32 line_gap;
+  source.v_metrics(source.user, font.scale, &font.ascent, &font.descent, &line_gap);
+  font.line_height = font.ascent - font.descent + line_gap;
+
+  font.glyph_cap = 128;
+  font.glyphs = malloc(sizeof (FontGlyph) * font.glyph_cap);
+  font.table_cap = 256;
+  font.table = calloc(font.table_cap, sizeof (u32));
+
+  if (source.kerning)
+  {
+    u32 indices[FONT_KERN_COUNT];
+    for (u32 i = 0; i < FONT_KERN_COUNT; i++)
+    {
+      indices[i] = source.glyph_index(source.user, FONT_KERN_FIRST + i);
+    }
+
+    font.kern = malloc(sizeof (f32) * FONT_KERN_COUNT * FONT_KERN_COUNT);
+    for (u32 a = 0; a < FONT_KERN_COUNT; a++)
+    {
+      for (u32 b = 0; b < FONT_KERN_COUNT; b++)
+      {
+        font.kern[a * FONT_KERN_COUNT + b] =
+          source.kerning(source.user, indices[a], indices[b], font.scale);
+      }
+    }
+  }
+
+  return font;
+}
+
+void font_destroy(Font *font)
+{
+  free(font->glyphs);
+  free(font->table);
+  free(font->kern);
+  *font = (Font) {0};
+}
+
+static
+u32 font_hash(u32 codepoint)
+{
+  return codepoint * 2654435761u;
+}
+
+static
+void font_table_insert(Font *font, u32 glyph)
+{
+  u32 mask = font->table_cap - 1;
+  u32 slot = font_hash(font->glyphs[glyph].codepoint) & mask;
+  while (font->table[slot]) slot = (slot + 1) & mask;
+  font->table[slot] = glyph + 1;
+}
+
+static
+u32 font_load_glyph(Font *font, u32 codepoint)
+{
+  if (font->glyph_count == font->glyph_cap)
+  {
+    font->glyph_cap *= 2;
+    font->glyphs = realloc(font->glyphs, sizeof (FontGlyph) * font->glyph_cap);
+  }
+
+  // Kept under half full
+  if (2 * (font->glyph_count + 1) > font->table_cap)
+  {
+    free(font->table);
+    font->table_cap *= 2;
+    font->table = calloc(font->table_cap, sizeof (u32));
+    for (u32 i = 0; i < font->glyph_count; i++)
+    {
+      if (font->glyphs[i].codepoint >= 128) font_table_insert(font, i);
+    }
+  }
+
+  FontSource *source = &font->source;
+  u32 index = source->glyph_index(source->user, codepoint);
+
+  FontGlyph glyph = {.codepoint = codepoint, .index = index};
+  i32 box[4];
+  source->glyph_metrics(source->user, index, font->scale, &glyph.advance, box);
+
+  if (box[2] > box[0] && box[3] > box[1])
+  {
+    if (font->mode == FONT_SDF)
+    {
+      // The box at the oversampled scale, shrunk back, can be a pixel wider
+      f32 scale = font->scale * FONT_SDF_OVERSAMPLE;
+      f32 advance;
+      source->glyph_metrics(source->user, index, scale, &advance, box);
+      glyph.x0 = (i32) floorf((f32) box[0] / FONT_SDF_OVERSAMPLE) - FONT_SDF_PADDING;
+      glyph.y0 = (i32) floorf((f32) box[1] / FONT_SDF_OVERSAMPLE) - FONT_SDF_PADDING;
+      glyph.x1 = (i32) ceilf((f32) box[2] / FONT_SDF_OVERSAMPLE) + FONT_SDF_PADDING;
+      glyph.y1 = (i32) ceilf((f32) box[3] / FONT_SDF_OVERSAMPLE) + FONT_SDF_PADDING;
+    }
+    else
+    {
+      glyph.x0 = box[0] - 1;
+      glyph.y0 = box[1] - 1;
+      glyph.x1 = box[2] + 1;
+      glyph.y1 = box[3] + 1;
+    }
+  }
+
+  u32 result = font->glyph_count++;
+  font->glyphs[result] = glyph;
+  if (codepoint < 128) font->ascii[codepoint] = result + 1;
+  else font_table_insert(font, result);
+
+  return result;
+}
+
+u32 font_glyph(Font *font, u32 codepoint)
+{
+  if (codepoint < 128)
+  {
+    if (font->ascii[codepoint]) return font->ascii[codepoint] - 1;
+  }
+  else
+  {
+    u32 mask = font->table_cap - 1;
+    for (u32 slot = font_hash(codepoint) & mask; font->table[slot]; slot = (slot + 1) & mask)
+    {
+      u32 glyph = font->table[slot] - 1;
+      if (font->glyphs[glyph].codepoint == codepoint) return glyph;
+    }
+  }
+
+  return font_load_glyph(font, codepoint);
+}
+
+void font_rasterize(const Font *font, u32 glyph, u8 *out)
+{
+  const FontGlyph *g = &font->glyphs[glyph];
+  const FontSource *source = &font->source;
+  i32 w = g->x1 - g->x0;
+  i32 h = g->y1 - g->y0;
+  if (w <= 0 || h <= 0) return;
+  memset(out, 0, (u64) w * h);
+
+  if (font->mode == FONT_SDF)
+  {
+    f32 scale = font->scale * FONT_SDF_OVERSAMPLE;
+    i32 cw = w * FONT_SDF_OVERSAMPLE;
+    i32 ch = h * FONT_SDF_OVERSAMPLE;
+    i32 box[4];
+    f32 advance;
+    source->glyph_metrics(source->user, g->index, scale, &advance, box);
+    if (box[2] <= box[0] || box[3] <= box[1]) return;
+
+    u8 *coverage = calloc((u64) cw * ch, 1);
+    i32 ox = box[0] - g->x0 * FONT_SDF_OVERSAMPLE;
+    i32 oy = box[1] - g->y0 * FONT_SDF_OVERSAMPLE;
+    source->rasterize(source->user, g->index, scale, &coverage[oy * cw + ox],
+                      box[2] - box[0], box[3] - box[1], cw);
+
+    font_sdf(coverage, cw, ch, FONT_SDF_OVERSAMPLE, FONT_SDF_PADDING, out);
+    free(coverage);
+  }
+  else
+  {
+    source->rasterize(source->user, g->index, font->scale, &out[w + 1], w - 2, h - 2, w);
+  }
+}
+
+// @SDF =====================================================================================
+
+// Felzenszwalb and Huttenlocher's 1D squared distance transform: the lower
+// envelope of the parabolas rooted at each sample. `v` and `z` hold n and
+// n + 1 entries.
+static
+void font_edt_1d(const f32 *f, f32 *d, i32 n, i32 *v, f32 *z)
+{
+  i32 k = 0;
+  v[0] = 0;
+  z[0] = -FONT_INF;
+  z[1] = FONT_INF;
+
+  for (i32 q = 1; q < n; q++)
+  {
+    f32 s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+    while (s <= z[k])
+    {
+      k--;
+      s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+    }
+
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = FONT_INF;
+  }
+
+  k = 0;
+  for (i32 q = 0; q < n; q++)
+  {
+    while (z[k + 1] < q) k++;
+    f32 dq = (f32) (q - v[k]);
+    d[q] = dq * dq + f[v[k]];
+  }
+}
+
+// Squared distance from every cell to the nearest zero cell, rows then columns
+static
+void font_edt(f32 *grid, i32 w, i32 h, f32 *f, f32 *d, i32 *v, f32 *z)
+{
+  for (i32 x = 0; x < w; x++)
+  {
+    for (i32 y = 0; y < h; y++) f[y] = grid[y * w + x];
+    font_edt_1d(f, d, h, v, z);
+    for (i32 y = 0; y < h; y++) grid[y * w + x] = d[y];
+  }
+
+  for (i32 y = 0; y < h; y++)
+  {
+    font_edt_1d(&grid[y * w], d, w, v, z);
+    memcpy(&grid[y * w], d, sizeof (f32) * w);
+  }
+}
+
+void font_sdf(const u8 *coverage, i32 w, i32 h, i32 downsample, f32 spread, u8 *out)
+{
+  i32 n = MAX(w, h);
+  u64 cells = (u64) w * h;
+  f32 *outside = malloc(sizeof (f32) * cells);
+  f32 *inside = malloc(sizeof (f32) * cells);
+  f32 *f = malloc(sizeof (f32) * n);
+  f32 *d = malloc(sizeof (f32) * n);
+  f32 *z = malloc(sizeof (f32) * (n + 1));
+  i32 *v = malloc(sizeof (i32) * n);
+
+  for (u64 i = 0; i < cells; i++)
+  {
+    bool in = coverage[i] >= 128;
+    outside[i] = in ? 0.0f : FONT_INF;
+    inside[i] = in ? FONT_INF : 0.0f;
+  }
+
+  font_edt(outside, w, h, f, d, v, z);
+  font_edt(inside, w, h, f, d, v, z);
+
+  // Distances are between cell centers, the edge sits half a cell closer.
+  // Each output texel averages its block, inside positive.
+  i32 ow = w / downsample;
+  i32 oh = h / downsample;
+  f32 to_texel = 1.0f / (downsample * downsample * downsample * spread);
+  for (i32 oy = 0; oy < oh; oy++)
+  {
+    for (i32 ox = 0; ox < ow; ox++)
+    {
+      f32 sum = 0.0f;
+      for (i32 y = oy * downsample; y < (oy + 1) * downsample; y++)
+      {
+        for (i32 x = ox * downsample; x < (ox + 1) * downsample; x++)
+        {
+          u64 i = (u64) y * w + x;
+          if (outside[i] > 0.0f) sum -= sqrtf(outside[i]) - 0.5f;
+          else sum += sqrtf(inside[i]) - 0.5f;
+        }
+      }
+
+      f32 value = 128.0f + 127.0f * sum * to_texel;
+      out[oy * ow + ox] = (u8) (MIN(MAX(value, 0.0f), 255.0f) + 0.5f);
+    }
+  }
+
+  free(outside);
+  free(inside);
+  free(f);
+  free(d);
+  free(z);
+  free(v);
+}
+
+// @Layout ==================================================================================
+
+// Malformed sequences decode to U+FFFD one byte at a time
+static
+u32 font_decode(const u8 **text)
+{
+  const u8 *p = *text;
+  u32 c = p[0];
+  u32 length = 1;
+  u32 min = 0;
+
+  if (c < 0x80)
+  {
+    *text = p + 1;
+    return c;
+  }
+
+  if ((c & 0xE0) == 0xC0)
+  {
+    length = 2;
+    c &= 0x1F;
+    min = 0x80;
+  }
+  else if ((c & 0xF0) == 0xE0)
+  {
+    length = 3;
+    c &= 0x0F;
+    min = 0x800;
+  }
+  else if ((c & 0xF8) == 0xF0)
+  {
+    length = 4;
+    c &= 0x07;
+    min = 0x10000;
+  }
+  else
+  {
+    length = 0;
+  }
+
+  *text = p + 1;
+  if (length == 0) return 0xFFFD;
+
+  for (u32 i = 1; i < length; i++)
+  {
+    if ((p[i] & 0xC0) != 0x80) return 0xFFFD;
+    c = (c << 6) | (p[i] & 0x3F);
+  }
+
+  *text = p + length;
+  if (c < min || c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF)) return 0xFFFD;
+
+  return c;
+}
+
+static
+f32 font_kerning(const Font *font, u32 a, u32 b)
+{
+  if (!font->kern) return 0.0f;
+
+  u32 ca = font->glyphs[a].codepoint - FONT_KERN_FIRST;
+  u32 cb = font->glyphs[b].codepoint - FONT_KERN_FIRST;
+  if (ca < FONT_KERN_COUNT && cb < FONT_KERN_COUNT) return font->kern[ca * FONT_KERN_COUNT + cb];
+
+  return font->source.kerning(font->source.user, font->glyphs[a].index,
+                              font->glyphs[b].index, font->scale);
+}
+
+u32 font_layout(Font *font, const i8 *text, Vec2F position, f32 size, FontQuad *quads)
+{
+  f32 k = size / font->size;
+  f32 x = position.x;
+  f32 baseline = position.y + font->ascent * k;
+  u32 prev = FONT_NONE;
+  u32 count = 0;
+
+  const u8 *p = (const u8 *) text;
+  while (*p)
+  {
+    u32 codepoint = font_decode(&p);
+    if (codepoint == '\n')
+    {
+      x = position.x;
+      baseline += font->line_height * k;
+      prev = FONT_NONE;
+      continue;
+    }
+
+    u32 glyph = font_glyph(font, codepoint);
+    if (prev != FONT_NONE) x += font_kerning(font, prev, glyph) * k;
+
+    // Bitmaps are only sharp on whole pixels
+    const FontGlyph *g = &font->glyphs[glyph];
+    if (g->x1 > g->x0)
+    {
+      f32 pen = font->mode == FONT_BITMAP ? floorf(x + 0.5f) : x;
+      quads[count++] = (FontQuad)
+      {
+        .x0 = pen + g->x0 * k,
+        .y0 = baseline + g->y0 * k,
+        .x1 = pen + g->x1 * k,
+        .y1 = baseline + g->y1 * k,
+        .glyph = glyph,
+      };
+    }
+
+    x += g->advance * k;
+    prev = glyph;
+  }
+
+  return count;
+}
+
+Vec2F font_measure(Font *font, const i8 *text, f32 size)
+{
+  f32 k = size / font->size;
+  f32 x = 0.0f;
+  f32 width = 0.0f;
+  u32 lines = 1;
+  u32 prev = FONT_NONE;
+
+  const u8 *p = (const u8 *) text;
+  while (*p)
+  {
+    u32 codepoint = font_decode(&p);
+    if (codepoint == '\n')
+    {
+      width = MAX(width, x);
+      x = 0.0f;
+      lines++;
+      prev = FONT_NONE;
+      continue;
+    }
+
+    u32 glyph = font_glyph(font, codepoint);
+    if (prev != FONT_NONE) x += font_kerning(font, prev, glyph) * k;
+    x += font->glyphs[glyph].advance * k;
+    prev = glyph;
+  }
+
+  width = MAX(width, x);
+  f32 height = (font->ascent - font->descent + font->line_height * (lines - 1)) * k;
+
+  return v2f(width, height);
+}
+
+void font_emit(const Font *font, const FontQuad *quads, u32 count, Vec4F color, FontVertex *out)
+{
+  u8 rgba[4] =
+  {
+    unorm8_from_f32(color.x),
+    unorm8_from_f32(color.y),
+    unorm8_from_f32(color.z),
+    unorm8_from_f32(color.w),
+  };
+
+  for (u32 i = 0; i < count; i++)
+  {
+    const FontQuad *q = &quads[i];
+    Vec4F uv = font->glyphs[q->glyph].uv;
+    u16 u0 = unorm16_from_f32(uv.x);
+    u16 v0 = unorm16_from_f32(uv.y);
+    u16 u1 = unorm16_from_f32(uv.z);
+    u16 v1 = unorm16_from_f32(uv.w);
+
+    FontVertex *v = &out[i * 4];
+    v[0] = (FontVertex) {{q->x0, q->y0}, {u0, v0}, {rgba[0], rgba[1], rgba[2], rgba[3]}};
+    v[1] = (FontVertex) {{q->x1, q->y0}, {u1, v0}, {rgba[0], rgba[1], rgba[2], rgba[3]}};
+    v[2] = (FontVertex) {{q->x0, q->y1}, {u0, v1}, {rgba[0], rgba[1], rgba[2], rgba[3]}};
+    v[3] = (FontVertex) {{q->x1, q->y1}, {u1, v1}, {rgba[0], rgba[1], rgba[2], rgba[3]}};
+  }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "base_common.h"
+#include "base_math.h"
+#include "atlas.h"
+
+#define FONT_SDF_PADDING 4    // Distance range on each side of the edge, in pixels at the font size
+#define FONT_SDF_OVERSAMPLE 4 // SDF glyphs are rasterized this much larger, then downsampled
+
+// @Source ==================================================================================
+
+// Where glyph shapes come from, mirroring stb_truetype's API. `glyph` is the
+// source's own glyph index, 0 for missing. Boxes are in pixels at `scale`,
+// relative to the pen on the baseline with y down. `kerning` may be NULL.
+typedef struct FontSource FontSource;
+struct FontSource
+{
+  void *user;
+  f32 (*scale_for_size)(void *user, f32 pixel_height);
+  void (*v_metrics)(void *user, f32 scale, f32 *ascent, f32 *descent, f32 *line_gap);
+  u32 (*glyph_index)(void *user, u32 codepoint);
+  void (*glyph_metrics)(void *user, u32 glyph, f32 scale, f32 *advance, i32 box[4]);
+  f32 (*kerning)(void *user, u32 a, u32 b, f32 scale);
+  void (*rasterize)(void *user, u32 glyph, f32 scale, u8 *out, i32 w, i32 h, i32 stride);
+};
+
+// TrueType fonts with glyf outlines (simple and composite), cmap formats 4
+// and 12 and kerning from the kern table's first horizontal format 0
+// subtable. Hinting, GPOS kerning and CFF outlines aren't read. `data` must
+// outlive the source.
+bool font_source_ttf(const u8 *data, u64 size, FontSource *source);
+// Reads the whole file, which the source then owns
+bool font_load_ttf(const i8 *path, FontSource *source);
+void font_source_ttf_free(FontSource *source);
+
+// @Font ====================================================================================
+
+typedef enum FontMode
+{
+  FONT_BITMAP, // Coverage, sharp at the font size only
+  FONT_SDF,    // Signed distance, 128 on the edge, scales up cleanly
+} FontMode;
+
+// Loaded on first use. The bitmap box includes padding (1 pixel for bitmaps
+// so filtering doesn't bleed, FONT_SDF_PADDING for distance fields). Whoever
+// caches the bitmap keeps its handle and UVs here, with `cached` set once the
+// handle is meaningful.
+typedef struct FontGlyph FontGlyph;
+struct FontGlyph
+{
+  u32 codepoint;
+  u32 index;
+  f32 advance;
+  i32 x0;
+  i32 y0;
+  i32 x1;
+  i32 y1;
+  AtlasHandle handle;
+  Vec4F uv;
+  bool cached;
+};
+
+#define FONT_KERN_FIRST 32
+#define FONT_KERN_COUNT 95
+
+typedef struct Font Font;
+struct Font
+{
+  FontSource source;
+  FontMode mode;
+  f32 size;
+  f32 scale;
+  f32 ascent;
+  f32 descent;
+  f32 line_height;
+
+  FontGlyph *glyphs;
+  u32 glyph_count;
+  u32 glyph_cap;
+
+  // Codepoint to glyph + 1, open addressing; ASCII skips the hash
+  u32 *table;
+  u32 table_cap;
+  u32 ascii[128];
+
+  // Printable ASCII pairs, looked up once at creation
+  f32 *kern;
+};
+
+Font font_create(FontSource source, f32 size, FontMode mode);
+void font_destroy(Font *font);
+
+// Index into font->glyphs
+u32 font_glyph(Font *font, u32 codepoint);
+
+// Writes the glyph's bitmap, (x1 - x0) * (y1 - y0) bytes
+void font_rasterize(const Font *font, u32 glyph, u8 *out);
+
+// Signed distance field of a coverage mask, `downsample` times smaller, with
+// `spread` output pixels of distance on each side of the 50% edge.
+void font_sdf(const u8 *coverage, i32 w, i32 h, i32 downsample, f32 spread, u8 *out);
+
+// @Layout ==================================================================================
+
+typedef struct FontQuad FontQuad;
+struct FontQuad
+{
+  f32 x0;
+  f32 y0;
+  f32 x1;
+  f32 y1;
+  u32 glyph;
+};
+
+// Decodes UTF-8 and places glyphs with kerning, `size` pixels tall.
+// `position` is the top left of the first line; '\n' starts the next one.
+// Blank glyphs take no quad. Returns the quad count, at most the byte
+// length of `text`.
+u32 font_layout(Font *font, const i8 *text, Vec2F position, f32 size, FontQuad *quads);
+Vec2F font_measure(Font *font, const i8 *text, f32 size);
+
+// 16 bytes; UVs are unorm16 and color RGBA8
+typedef struct FontVertex FontVertex;
+struct FontVertex
+{
+  Vec2F position;
+  u16 uv[2];
+  u8 color[4];
+};
+
+// Four vertices per quad, from the glyphs' cached UVs: top left, top right,
+// bottom left, bottom right.
+void font_emit(const Font *font, const FontQuad *quads, u32 count, Vec4F color, FontVertex *out);
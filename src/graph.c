@@ -0,0 +1,487 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "graph.h"
+
+void graph_reset(FrameGraph *graph)
+{
+  graph->pass_count = 0;
+  graph->resource_count = 0;
+  graph->order_count = 0;
+  graph->physical_count = 0;
+  graph->transient_bytes = 0;
+  graph->physical_bytes = 0;
+}
+
+static
+u32 graph_add_resource(FrameGraph *graph, const i8 *name, const TargetDesc *desc, bool imported)
+{
+  ASSERT(graph->resource_count < GRAPH_MAX_RESOURCES);
+
+  u32 resource = graph->resource_count++;
+  graph->resources[resource] = (GraphResource)
+  {
+    .name = name,
+    .desc = *desc,
+    .imported = imported,
+    .output = imported,
+    .physical = TARGET_NONE,
+  };
+
+  return resource;
+}
+
+u32 graph_create_target(FrameGraph *graph, const i8 *name, const TargetDesc *desc)
+{
+  return graph_add_resource(graph, name, desc, FALSE);
+}
+
+u32 graph_import_target(FrameGraph *graph, const i8 *name, const TargetDesc *desc)
+{
+  return graph_add_resource(graph, name, desc, TRUE);
+}
+
+void graph_export(FrameGraph *graph, u32 resource)
+{
+  graph->resources[resource].output = TRUE;
+}
+
+u32 graph_add_pass(FrameGraph *graph, const i8 *name, GraphExecute execute, void *user)
+{
+  ASSERT(graph->pass_count < GRAPH_MAX_PASSES);
+
+  u32 pass = graph->pass_count++;
+  graph->passes[pass] = (GraphPass) {.name = name, .execute = execute, .user = user};
+
+  return pass;
+}
+
+void graph_read(FrameGraph *graph, u32 pass, u32 resource)
+{
+  GraphPass *p = &graph->passes[pass];
+  ASSERT(p->read_count < GRAPH_MAX_PASS_RESOURCES && resource < graph->resource_count);
+  p->reads[p->read_count++] = resource;
+}
+
+void graph_write(FrameGraph *graph, u32 pass, u32 resource)
+{
+  GraphPass *p = &graph->passes[pass];
+  ASSERT(p->write_count < GRAPH_MAX_PASS_RESOURCES && resource < graph->resource_count);
+  p->writes[p->write_count++] = resource;
+}
+
+static
+bool graph_pass_reads(const GraphPass *pass, u32 resource)
+{
+  for (u32 i = 0; i < pass->read_count; i++)
+  {
+    if (pass->reads[i] == resource) return TRUE;
+  }
+
+  return FALSE;
+}
+
+static
+bool graph_pass_writes(const GraphPass *pass, u32 resource)
+{
+  for (u32 i = 0; i < pass->write_count; i++)
+  {
+    if (pass->writes[i] == resource) return TRUE;
+  }
+
+  return FALSE;
+}
+
+// @Compile =================================================================================
+
+// Reference counts from the outputs back: a pass lives while something reads
+// one of its writes, a target lives while a live pass reads it.
+static
+void graph_cull(FrameGraph *graph)
+{
+  u32 pass_refs[GRAPH_MAX_PASSES];
+  u32 resource_refs[GRAPH_MAX_RESOURCES] = {0};
+  u32 stack[GRAPH_MAX_RESOURCES];
+  u32 stack_count = 0;
+
+  for (u32 i = 0; i < graph->resource_count; i++)
+  {
+    resource_refs[i] = graph->resources[i].output;
+  }
+
+  for (u32 i = 0; i < graph->pass_count; i++)
+  {
+    GraphPass *pass = &graph->passes[i];
+    pass->culled = FALSE;
+    pass_refs[i] = pass->write_count;
+    for (u32 j = 0; j < pass->read_count; j++) resource_refs[pass->reads[j]]++;
+  }
+
+  for (u32 i = 0; i < graph->resource_count; i++)
+  {
+    if (resource_refs[i] == 0) stack[stack_count++] = i;
+  }
+
+  // Passes that write nothing have no reason to run
+  for (u32 i = 0; i < graph->pass_count; i++)
+  {
+    GraphPass *pass = &graph->passes[i];
+    if (pass_refs[i] > 0) continue;
+
+    pass->culled = TRUE;
+    for (u32 j = 0; j < pass->read_count; j++)
+    {
+      if (--resource_refs[pass->reads[j]] == 0) stack[stack_count++] = pass->reads[j];
+    }
+  }
+
+  while (stack_count > 0)
+  {
+    u32 resource = stack[--stack_count];
+    for (u32 i = 0; i < graph->pass_count; i++)
+    {
+      GraphPass *pass = &graph->passes[i];
+      if (pass->culled || !graph_pass_writes(pass, resource)) continue;
+      if (--pass_refs[i] > 0) continue;
+
+      pass->culled = TRUE;
+      for (u32 j = 0; j < pass->read_count; j++)
+      {
+        if (--resource_refs[pass->reads[j]] == 0) stack[stack_count++] = pass->reads[j];
+      }
+    }
+  }
+}
+
+// The pass whose write of `resource` a read by `reader` sees: the last writer
+// declared before the reader, or the first writer when the reader is declared
+// ahead of all of them. TARGET_NONE when nothing writes it.
+static
+u32 graph_producer(const FrameGraph *graph, u32 reader, u32 resource)
+{
+  u32 first = TARGET_NONE;
+  u32 last = TARGET_NONE;
+  for (u32 i = 0; i < graph->pass_count; i++)
+  {
+    if (!graph_pass_writes(&graph->passes[i], resource)) continue;
+
+    if (first == TARGET_NONE) first = i;
+    if (i < reader) last = i;
+  }
+
+  return last != TARGET_NONE ? last : first;
+}
+
+// Whether `a` has to run before `b` over one of the targets they share.
+// Writers run in declaration order, each write starting a new version. A
+// reader runs after the write it sees and before the write that replaces it.
+static
+bool graph_depends(const FrameGraph *graph, u32 a, u32 b)
+{
+  const GraphPass *pa = &graph->passes[a];
+  const GraphPass *pb = &graph->passes[b];
+
+  for (u32 i = 0; i < pa->write_count; i++)
+  {
+    u32 resource = pa->writes[i];
+    if (graph_pass_writes(pb, resource))
+    {
+      if (a < b) return TRUE;
+    }
+    else if (graph_pass_reads(pb, resource) && a <= graph_producer(graph, b, resource))
+    {
+      return TRUE;
+    }
+  }
+
+  for (u32 i = 0; i < pa->read_count; i++)
+  {
+    u32 resource = pa->reads[i];
+    if (graph_pass_writes(pa, resource) || !graph_pass_writes(pb, resource)) continue;
+
+    if (b > graph_producer(graph, a, resource)) return TRUE;
+  }
+
+  return FALSE;
+}
+
+// Kahn's algorithm, taking the earliest declared pass whenever several are
+// ready so a graph declared in order runs in order
+static
+bool graph_sort(FrameGraph *graph)
+{
+  u32 in_degree[GRAPH_MAX_PASSES] = {0};
+  bool done[GRAPH_MAX_PASSES] = {0};
+  u32 live = 0;
+
+  for (u32 b = 0; b < graph->pass_count; b++)
+  {
+    if (graph->passes[b].culled) continue;
+
+    live++;
+    for (u32 a = 0; a < graph->pass_count; a++)
+    {
+      if (a != b && !graph->passes[a].culled && graph_depends(graph, a, b)) in_degree[b]++;
+    }
+  }
+
+  graph->order_count = 0;
+  while (graph->order_count < live)
+  {
+    u32 next = TARGET_NONE;
+    for (u32 i = 0; i < graph->pass_count && next == TARGET_NONE; i++)
+    {
+      if (!graph->passes[i].culled && !done[i] && in_degree[i] == 0) next = i;
+    }
+
+    if (next == TARGET_NONE) return FALSE;
+
+    done[next] = TRUE;
+    graph->order[graph->order_count++] = next;
+    for (u32 b = 0; b < graph->pass_count; b++)
+    {
+      if (b != next && !graph->passes[b].culled && !done[b] && graph_depends(graph, next, b))
+      {
+        in_degree[b]--;
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+// Lifetimes are spans of the execution order. Targets take the first
+// physical target of their description that is free by their first use.
+static
+void graph_alias(FrameGraph *graph)
+{
+  u32 physical_last[GRAPH_MAX_RESOURCES];
+
+  for (u32 i = 0; i < graph->resource_count; i++)
+  {
+    GraphResource *resource = &graph->resources[i];
+    resource->first = TARGET_NONE;
+    resource->last = 0;
+    resource->physical = TARGET_NONE;
+  }
+
+  for (u32 i = 0; i < graph->order_count; i++)
+  {
+    GraphPass *pass = &graph->passes[graph->order[i]];
+    for (u32 j = 0; j < pass->read_count + pass->write_count; j++)
+    {
+      u32 r = j < pass->read_count ? pass->reads[j] : pass->writes[j - pass->read_count];
+      GraphResource *resource = &graph->resources[r];
+      if (resource->first == TARGET_NONE) resource->first = i;
+      resource->last = i;
+    }
+  }
+
+  // Outputs are still needed after the last pass
+  for (u32 i = 0; i < graph->resource_count; i++)
+  {
+    GraphResource *resource = &graph->resources[i];
+    if (resource->output && resource->first != TARGET_NONE) resource->last = graph->order_count;
+  }
+
+  graph->physical_count = 0;
+  graph->transient_bytes = 0;
+  graph->physical_bytes = 0;
+  for (u32 i = 0; i < graph->order_count; i++)
+  {
+    for (u32 r = 0; r < graph->resource_count; r++)
+    {
+      GraphResource *resource = &graph->resources[r];
+      if (resource->imported || resource->first != i) continue;
+
+      u32 physical = TARGET_NONE;
+      for (u32 p = 0; p < graph->physical_count && physical == TARGET_NONE; p++)
+      {
+        if (physical_last[p] < i && target_desc_equal(&graph->physicals[p], &resource->desc))
+        {
+          physical = p;
+        }
+      }
+
+      u64 bytes = target_desc_bytes(&resource->desc);
+      if (physical == TARGET_NONE)
+      {
+        physical = graph->physical_count++;
+        graph->physicals[physical] = resource->desc;
+        graph->physical_bytes += bytes;
+      }
+
+      physical_last[physical] = resource->last;
+      resource->physical = physical;
+      graph->transient_bytes += bytes;
+    }
+  }
+}
+
+// A write is kept when a later pass reads it or the frame outputs it
+static
+void graph_resolve_keep(FrameGraph *graph)
+{
+  for (u32 i = 0; i < graph->order_count; i++)
+  {
+    GraphPass *pass = &graph->passes[graph->order[i]];
+    pass->keep = 0;
+
+    for (u32 j = 0; j < pass->write_count; j++)
+    {
+      u32 resource = pass->writes[j];
+      bool keep = graph->resources[resource].output;
+      for (u32 k = i + 1; k < graph->order_count && !keep; k++)
+      {
+        keep = graph_pass_reads(&graph->passes[graph->order[k]], resource);
+      }
+
+      if (keep) pass->keep |= 1u << j;
+    }
+  }
+}
+
+bool graph_compile(FrameGraph *graph)
+{
+  graph_cull(graph);
+  if (!graph_sort(graph)) return FALSE;
+  graph_alias(graph);
+  graph_resolve_keep(graph);
+
+  return TRUE;
+}
+
+// @Execute =================================================================================
+
+bool graph_execute(FrameGraph *graph, TargetPool *pool, const TargetBackend *backend)
+{
+  for (u32 i = 0; i < graph->physical_count; i++)
+  {
+    graph->slots[i] = target_pool_acquire(pool, &graph->physicals[i], backend);
+    if (graph->slots[i] != TARGET_NONE) continue;
+
+    for (u32 j = 0; j < i; j++) target_pool_release(pool, graph->slots[j]);
+    return FALSE;
+  }
+
+  for (u32 i = 0; i < graph->order_count; i++)
+  {
+    GraphPass *pass = &graph->passes[graph->order[i]];
+    if (pass->execute) pass->execute(pass->user, graph, graph->order[i]);
+  }
+
+  for (u32 i = 0; i < graph->physical_count; i++) target_pool_release(pool, graph->slots[i]);
+
+  return TRUE;
+}
+
+u32 graph_target(const FrameGraph *graph, u32 resource)
+{
+  u32 physical = graph->resources[resource].physical;
+
+  return physical == TARGET_NONE ? TARGET_NONE : graph->slots[physical];
+}
+
+bool graph_keep(const FrameGraph *graph, u32 pass, u32 resource)
+{
+  const GraphPass *p = &graph->passes[pass];
+  for (u32 i = 0; i < p->write_count; i++)
+  {
+    if (p->writes[i] == resource) return (p->keep >> i) & 1;
+  }
+
+  return FALSE;
+}
+
+// @Dump ====================================================================================
+
+static const i8 *graph_format_names[TARGET_FORMAT_COUNT] =
+{
+  [TARGET_FORMAT_NONE]             = "none",
+  [TARGET_FORMAT_RGBA8]            = "rgba8",
+  [TARGET_FORMAT_SRGB8_A8]         = "srgb8_a8",
+  [TARGET_FORMAT_RGBA16F]          = "rgba16f",
+  [TARGET_FORMAT_R11G11B10F]       = "r11g11b10f",
+  [TARGET_FORMAT_R16F]             = "r16f",
+  [TARGET_FORMAT_DEPTH24]          = "d24",
+  [TARGET_FORMAT_DEPTH32F]         = "d32f",
+  [TARGET_FORMAT_DEPTH24_STENCIL8] = "d24s8",
+};
+
+static
+void graph_dump_desc(const TargetDesc *desc, FILE *out)
+{
+  i8 formats[64] = {0};
+  for (u32 i = 0; i < target_desc_color_count(desc); i++)
+  {
+    if (i) strcat(formats, "+");
+    strcat(formats, graph_format_names[desc->color[i]]);
+  }
+
+  if (desc->depth != TARGET_FORMAT_NONE)
+  {
+    if (formats[0]) strcat(formats, "+");
+    strcat(formats, graph_format_names[desc->depth]);
+  }
+
+  fprintf(out, "%5ix%-5i %-25s x%u", desc->width, desc->height, formats, MAX(desc->samples, 1));
+}
+
+void graph_dump(const FrameGraph *graph, FILE *out)
+{
+  fprintf(out, "passes, in order:\n");
+  for (u32 i = 0; i < graph->order_count; i++)
+  {
+    const GraphPass *pass = &graph->passes[graph->order[i]];
+    fprintf(out, "  %2u %-14s", i, pass->name);
+
+    for (u32 j = 0; j < pass->read_count; j++)
+    {
+      fprintf(out, " <%s", graph->resources[pass->reads[j]].name);
+    }
+
+    for (u32 j = 0; j < pass->write_count; j++)
+    {
+      const i8 *store = (pass->keep >> j) & 1 ? "" : " (discard)";
+      fprintf(out, " >%s%s", graph->resources[pass->writes[j]].name, store);
+    }
+
+    fprintf(out, "\n");
+  }
+
+  for (u32 i = 0; i < graph->pass_count; i++)
+  {
+    if (graph->passes[i].culled) fprintf(out, "  -- %-14s culled\n", graph->passes[i].name);
+  }
+
+  u32 transient_count = 0;
+  fprintf(out, "targets:\n");
+  for (u32 i = 0; i < graph->resource_count; i++)
+  {
+    const GraphResource *resource = &graph->resources[i];
+    fprintf(out, "  %-14s ", resource->name);
+    graph_dump_desc(&resource->desc, out);
+
+    if (resource->first == TARGET_NONE)
+    {
+      fprintf(out, "  unused\n");
+    }
+    else if (resource->imported)
+    {
+      fprintf(out, "  imported\n");
+    }
+    else
+    {
+      fprintf(out, "  passes %2u..%-2u physical %2u %7.2f MB\n", resource->first, resource->last,
+              resource->physical, target_desc_bytes(&resource->desc) / (1024.0 * 1024.0));
+      transient_count++;
+    }
+  }
+
+  f64 transient = graph->transient_bytes / (1024.0 * 1024.0);
+  f64 physical = graph->physical_bytes / (1024.0 * 1024.0);
+  fprintf(out, "%u transient targets on %u physical: %.2f MB instead of %.2f MB (%.0f%% saved)\n",
+          transient_count, graph->physical_count, physical,
+          transient, transient > 0.0 ? 100.0 * (1.0 - physical / transient) : 0.0);
+}
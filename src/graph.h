@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "base_common.h"
+#include "target.h"
+
+#define GRAPH_MAX_PASSES 64
+#define GRAPH_MAX_RESOURCES 64
+#define GRAPH_MAX_PASS_RESOURCES 8
+
+// Frame graph over render targets, rebuilt every frame. Passes declare the
+// targets they read and write, then graph_compile:
+// - culls passes whose results nothing reads, back from the outputs
+// - orders the rest so writers of a target keep their declaration order and
+//   each read sees the last write declared before it, or the first write
+//   when it is declared ahead of every writer; a later write waits for the
+//   reads of the one before it
+// - gives transient targets a lifetime and packs them onto as few physical
+//   targets as it can, sharing one between targets of the same description
+//   whose lifetimes don't overlap
+// graph_execute then takes the physical targets from a TargetPool for the
+// frame and runs the passes.
+
+typedef struct FrameGraph FrameGraph;
+
+typedef void (*GraphExecute)(void *user, FrameGraph *graph, u32 pass);
+
+typedef struct GraphResource GraphResource;
+struct GraphResource
+{
+  const i8 *name;
+  TargetDesc desc;
+  bool imported; // Owned outside the graph, like the backbuffer; always an output
+  bool output;
+
+  // Compiled; positions in graph->order
+  u32 first;
+  u32 last;
+  u32 physical; // TARGET_NONE when imported or unused
+};
+
+typedef struct GraphPass GraphPass;
+struct GraphPass
+{
+  const i8 *name;
+  GraphExecute execute;
+  void *user;
+  u32 reads[GRAPH_MAX_PASS_RESOURCES];
+  u32 read_count;
+  u32 writes[GRAPH_MAX_PASS_RESOURCES];
+  u32 write_count;
+
+  // Compiled
+  bool culled;
+  u32 keep; // Bit per write, set when a later pass or the frame still needs it
+};
+
+struct FrameGraph
+{
+  GraphPass passes[GRAPH_MAX_PASSES];
+  u32 pass_count;
+  GraphResource resources[GRAPH_MAX_RESOURCES];
+  u32 resource_count;
+
+  // Compiled
+  u32 order[GRAPH_MAX_PASSES];
+  u32 order_count;
+  TargetDesc physicals[GRAPH_MAX_RESOURCES];
+  u32 physical_count;
+  u64 transient_bytes;
+  u64 physical_bytes;
+
+  // Pool slots of the physical targets while executing
+  u32 slots[GRAPH_MAX_RESOURCES];
+};
+
+void graph_reset(FrameGraph *graph);
+
+u32 graph_create_target(FrameGraph *graph, const i8 *name, const TargetDesc *desc);
+u32 graph_import_target(FrameGraph *graph, const i8 *name, const TargetDesc *desc);
+
+// Keeps a transient target and the passes writing it with nothing reading
+// it, e.g. to read it back once graph_execute returns
+void graph_export(FrameGraph *graph, u32 resource);
+
+u32 graph_add_pass(FrameGraph *graph, const i8 *name, GraphExecute execute, void *user);
+void graph_read(FrameGraph *graph, u32 pass, u32 resource);
+void graph_write(FrameGraph *graph, u32 pass, u32 resource);
+
+// FALSE when the passes depend on each other in a cycle
+bool graph_compile(FrameGraph *graph);
+
+// FALSE when the pool can't hold the physical targets; nothing runs then
+bool graph_execute(FrameGraph *graph, TargetPool *pool, const TargetBackend *backend);
+
+// While executing: the pool slot behind a target, TARGET_NONE when imported
+u32 graph_target(const FrameGraph *graph, u32 resource);
+
+// Whether `pass` must store what it writes to `resource`, or can let it go
+// at the end of the pass
+bool graph_keep(const FrameGraph *graph, u32 pass, u32 resource);
+
+void graph_dump(const FrameGraph *graph, FILE *out);
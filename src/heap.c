@@ -0,0 +1,395 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "heap.h"
+
+// @Bins ====================================================================================
+
+static
+u32 heap_fls(u32 x)
+{
+#ifdef __GNUC__
+  return 31 - __builtin_clz(x);
+#else
+  u32 bit = 0;
+  while (x >>= 1) bit++;
+  return bit;
+#endif
+}
+
+static
+u32 heap_ffs(u32 x)
+{
+#ifdef __GNUC__
+  return __builtin_ctz(x);
+#else
+  u32 bit = 0;
+  while (!(x & 1))
+  {
+    x >>= 1;
+    bit++;
+  }
+  return bit;
+#endif
+}
+
+// Sizes below HEAP_SL_COUNT get a bin each, above that each power of two is
+// split in HEAP_SL_COUNT equal parts.
+static
+void heap_mapping(u32 size, u32 *fl, u32 *sl)
+{
+  if (size < HEAP_SL_COUNT)
+  {
+    *fl = 0;
+    *sl = size;
+  }
+  else
+  {
+    u32 bit = heap_fls(size);
+    *fl = bit - HEAP_SL_LOG2 + 1;
+    *sl = (size >> (bit - HEAP_SL_LOG2)) ^ HEAP_SL_COUNT;
+  }
+}
+
+static
+void heap_insert(Heap *heap, u32 index)
+{
+  HeapBlock *block = &heap->blocks[index];
+  u32 fl, sl;
+  heap_mapping(block->size, &fl, &sl);
+
+  block->prev_free = HEAP_NONE;
+  block->next_free = heap->heads[fl][sl];
+  if (block->next_free != HEAP_NONE) heap->blocks[block->next_free].prev_free = index;
+  heap->heads[fl][sl] = index;
+  heap->fl_bitmap |= 1u << fl;
+  heap->sl_bitmap[fl] |= 1u << sl;
+}
+
+static
+void heap_remove(Heap *heap, u32 index)
+{
+  HeapBlock *block = &heap->blocks[index];
+  u32 fl, sl;
+  heap_mapping(block->size, &fl, &sl);
+
+  if (block->prev_free != HEAP_NONE) heap->blocks[block->prev_free].next_free = block->next_free;
+  else heap->heads[fl][sl] = block->next_free;
+  if (block->next_free != HEAP_NONE) heap->blocks[block->next_free].prev_free = block->prev_free;
+
+  if (heap->heads[fl][sl] == HEAP_NONE)
+  {
+    heap->sl_bitmap[fl] &= ~(1u << sl);
+    if (heap->sl_bitmap[fl] == 0) heap->fl_bitmap &= ~(1u << fl);
+  }
+}
+
+// @Blocks ==================================================================================
+
+// Cuts `index`, which is in no free list, down to `size` and frees the rest.
+// Its old neighbour was in use, so the rest never needs merging.
+static
+void heap_split(Heap *heap, u32 index, u32 size)
+{
+  HeapBlock *block = &heap->blocks[index];
+  if (block->size == size) return;
+
+  ASSERT(heap->free_block_count > 0);
+  u32 rest_index = heap->free_blocks[--heap->free_block_count];
+  HeapBlock *rest = &heap->blocks[rest_index];
+  rest->offset = block->offset + size;
+  rest->size = block->size - size;
+  rest->prev_phys = index;
+  rest->next_phys = block->next_phys;
+  rest->entry = HEAP_NONE;
+
+  if (block->next_phys != HEAP_NONE) heap->blocks[block->next_phys].prev_phys = rest_index;
+  else heap->last_block = rest_index;
+  block->next_phys = rest_index;
+  block->size = size;
+
+  heap_insert(heap, rest_index);
+}
+
+static
+void heap_absorb(Heap *heap, u32 index, u32 next_index)
+{
+  HeapBlock *block = &heap->blocks[index];
+  HeapBlock *next = &heap->blocks[next_index];
+  block->size += next->size;
+  block->next_phys = next->next_phys;
+
+  if (next->next_phys != HEAP_NONE) heap->blocks[next->next_phys].prev_phys = index;
+  else heap->last_block = index;
+  heap->free_blocks[heap->free_block_count++] = next_index;
+}
+
+// Frees a block, merging it with free neighbours, and returns the block the
+// space ended up in.
+static
+u32 heap_release(Heap *heap, u32 index)
+{
+  HeapBlock *block = &heap->blocks[index];
+  block->entry = HEAP_NONE;
+
+  u32 next = block->next_phys;
+  if (next != HEAP_NONE && heap->blocks[next].entry == HEAP_NONE)
+  {
+    heap_remove(heap, next);
+    heap_absorb(heap, index, next);
+  }
+
+  u32 prev = block->prev_phys;
+  if (prev != HEAP_NONE && heap->blocks[prev].entry == HEAP_NONE)
+  {
+    heap_remove(heap, prev);
+    heap_absorb(heap, prev, index);
+    index = prev;
+  }
+
+  heap_insert(heap, index);
+
+  return index;
+}
+
+// @Heap ====================================================================================
+
+Heap heap_create(u64 size, u32 max_allocs)
+{
+  ASSERT(size >= HEAP_ALIGNMENT && size / HEAP_ALIGNMENT < HEAP_NONE);
+
+  Heap heap = {0};
+  heap.size = size / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+  heap.entry_cap = max_allocs;
+  heap.entries = calloc(max_allocs, sizeof (HeapEntry));
+  heap.free_entries = malloc(sizeof (u32) * max_allocs);
+
+  for (u32 i = 0; i < max_allocs; i++)
+  {
+    heap.free_entries[i] = max_allocs - i - 1;
+  }
+
+  heap.free_count = max_allocs;
+
+  // Free blocks are never adjacent, so there are at most two blocks per
+  // allocation plus one. A defrag move holds one more for a moment.
+  heap.block_cap = max_allocs * 2 + 3;
+  heap.blocks = malloc(sizeof (HeapBlock) * heap.block_cap);
+  heap.free_blocks = malloc(sizeof (u32) * heap.block_cap);
+
+  for (u32 i = 0; i < heap.block_cap; i++)
+  {
+    heap.free_blocks[i] = heap.block_cap - i - 1;
+  }
+
+  heap.free_block_count = heap.block_cap;
+  memset(heap.heads, 0xFF, sizeof (heap.heads));
+
+  u32 first = heap.free_blocks[--heap.free_block_count];
+  heap.blocks[first] = (HeapBlock)
+  {
+    .offset = 0,
+    .size = (u32) (heap.size / HEAP_ALIGNMENT),
+    .prev_phys = HEAP_NONE,
+    .next_phys = HEAP_NONE,
+    .entry = HEAP_NONE,
+  };
+  heap.first_block = first;
+  heap.last_block = first;
+  heap_insert(&heap, first);
+
+  return heap;
+}
+
+void heap_destroy(Heap *heap)
+{
+  free(heap->blocks);
+  free(heap->free_blocks);
+  free(heap->entries);
+  free(heap->free_entries);
+  *heap = (Heap) {0};
+}
+
+bool heap_alloc(Heap *heap, u64 size, HeapHandle *handle, u64 *offset)
+{
+  if (heap->free_count == 0 || size == 0 || size > heap->size) return FALSE;
+
+  u32 units = (u32) ((size + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT);
+
+  // Rounded up to the next bin, any block found fits without a search
+  u32 search = units;
+  if (search >= HEAP_SL_COUNT) search += (1u << (heap_fls(search) - HEAP_SL_LOG2)) - 1;
+
+  u32 fl, sl;
+  heap_mapping(search, &fl, &sl);
+
+  u32 index = HEAP_NONE;
+  u32 sl_map = heap->sl_bitmap[fl] & (~0u << sl);
+  if (sl_map == 0 && fl + 1 < HEAP_FL_COUNT)
+  {
+    u32 fl_map = heap->fl_bitmap & (~0u << (fl + 1));
+    if (fl_map)
+    {
+      fl = heap_ffs(fl_map);
+      sl_map = heap->sl_bitmap[fl];
+    }
+  }
+
+  if (sl_map) index = heap->heads[fl][heap_ffs(sl_map)];
+  else
+  {
+    // Nearly full: a block in the request's own bin may still be big enough
+    heap_mapping(units, &fl, &sl);
+    for (u32 i = heap->heads[fl][sl]; i != HEAP_NONE; i = heap->blocks[i].next_free)
+    {
+      if (heap->blocks[i].size >= units)
+      {
+        index = i;
+        break;
+      }
+    }
+
+    if (index == HEAP_NONE) return FALSE;
+  }
+
+  heap_remove(heap, index);
+  heap_split(heap, index, units);
+
+  u32 entry_index = heap->free_entries[--heap->free_count];
+  HeapEntry *entry = &heap->entries[entry_index];
+  entry->block = index;
+  entry->live = TRUE;
+  heap->blocks[index].entry = entry_index;
+  heap->used += (u64) units * HEAP_ALIGNMENT;
+  heap->alloc_count++;
+
+  handle->index = entry_index;
+  handle->generation = entry->generation;
+  *offset = (u64) heap->blocks[index].offset * HEAP_ALIGNMENT;
+
+  return TRUE;
+}
+
+void heap_free(Heap *heap, HeapHandle handle)
+{
+  if (handle.index >= heap->entry_cap) return;
+
+  HeapEntry *entry = &heap->entries[handle.index];
+  if (!entry->live || entry->generation != handle.generation) return;
+
+  heap->used -= (u64) heap->blocks[entry->block].size * HEAP_ALIGNMENT;
+  heap->alloc_count--;
+  heap_release(heap, entry->block);
+
+  entry->live = FALSE;
+  entry->generation++;
+  heap->free_entries[heap->free_count++] = handle.index;
+}
+
+bool heap_offset(const Heap *heap, HeapHandle handle, u64 *offset)
+{
+  if (handle.index >= heap->entry_cap) return FALSE;
+
+  const HeapEntry *entry = &heap->entries[handle.index];
+  if (!entry->live || entry->generation != handle.generation) return FALSE;
+
+  *offset = (u64) heap->blocks[entry->block].offset * HEAP_ALIGNMENT;
+
+  return TRUE;
+}
+
+// @Defrag ==================================================================================
+
+// The lowest free block below `limit` in the smallest bin that has one big
+// enough. Only bins that can fit are looked at, so this rarely walks far.
+static
+u32 heap_find_hole(const Heap *heap, u32 size, u32 limit)
+{
+  u32 fl, sl;
+  heap_mapping(size, &fl, &sl);
+
+  u32 fl_map = heap->fl_bitmap & (~0u << fl);
+  while (fl_map)
+  {
+    u32 l = heap_ffs(fl_map);
+    u32 sl_map = heap->sl_bitmap[l] & (l == fl ? ~0u << sl : ~0u);
+    while (sl_map)
+    {
+      u32 hole = HEAP_NONE;
+      for (u32 i = heap->heads[l][heap_ffs(sl_map)]; i != HEAP_NONE; i = heap->blocks[i].next_free)
+      {
+        const HeapBlock *block = &heap->blocks[i];
+        if (block->size < size || block->offset >= limit) continue;
+        if (hole == HEAP_NONE || block->offset < heap->blocks[hole].offset) hole = i;
+      }
+
+      if (hole != HEAP_NONE) return hole;
+      sl_map &= sl_map - 1;
+    }
+
+    fl_map &= fl_map - 1;
+  }
+
+  return HEAP_NONE;
+}
+
+u32 heap_defrag(Heap *heap, u64 max_bytes, HeapMove *moves, u32 max_moves)
+{
+  u32 count = 0;
+  u64 moved = 0;
+  u32 cursor = heap->last_block;
+
+  while (cursor != HEAP_NONE && count < max_moves && moved < max_bytes)
+  {
+    HeapBlock *block = &heap->blocks[cursor];
+    u32 hole = HEAP_NONE;
+    if (block->entry != HEAP_NONE) hole = heap_find_hole(heap, block->size, block->offset);
+
+    if (hole == HEAP_NONE)
+    {
+      cursor = block->prev_phys;
+      continue;
+    }
+
+    heap_remove(heap, hole);
+    heap_split(heap, hole, block->size);
+
+    u32 entry_index = block->entry;
+    heap->blocks[hole].entry = entry_index;
+    heap->entries[entry_index].block = hole;
+
+    HeapMove *move = &moves[count++];
+    move->handle = (HeapHandle) {entry_index, heap->entries[entry_index].generation};
+    move->from = (u64) block->offset * HEAP_ALIGNMENT;
+    move->to = (u64) heap->blocks[hole].offset * HEAP_ALIGNMENT;
+    move->size = (u64) block->size * HEAP_ALIGNMENT;
+    moved += move->size;
+
+    u32 freed = heap_release(heap, cursor);
+    cursor = heap->blocks[freed].prev_phys;
+  }
+
+  return count;
+}
+
+HeapStats heap_stats(const Heap *heap)
+{
+  HeapStats stats = {0};
+  stats.used = heap->used;
+  stats.free = heap->size - heap->used;
+  stats.alloc_count = heap->alloc_count;
+
+  for (u32 i = heap->first_block; i != HEAP_NONE; i = heap->blocks[i].next_phys)
+  {
+    const HeapBlock *block = &heap->blocks[i];
+    if (block->entry != HEAP_NONE) continue;
+
+    stats.free_blocks++;
+    stats.largest_free = MAX(stats.largest_free, (u64) block->size * HEAP_ALIGNMENT);
+  }
+
+  if (stats.free) stats.fragmentation = 1.0f - (f32) stats.largest_free / stats.free;
+
+  return stats;
+}
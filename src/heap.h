@@ -0,0 +1,110 @@
+#pragma once
+
+#include "base_common.h"
+
+// Every allocation starts on a multiple of this and is rounded up to it
+#define HEAP_ALIGNMENT 256
+
+#define HEAP_SL_LOG2 4
+#define HEAP_SL_COUNT (1 << HEAP_SL_LOG2)
+#define HEAP_FL_COUNT 32
+#define HEAP_NONE 0xFFFFFFFF
+
+// Handles go stale when their allocation is freed; generation tells them
+// apart. They stay valid across defragmentation, the offset is what moves.
+typedef struct HeapHandle HeapHandle;
+struct HeapHandle
+{
+  u32 index;
+  u32 generation;
+};
+
+// Offsets and sizes in HEAP_ALIGNMENT units
+typedef struct HeapBlock HeapBlock;
+struct HeapBlock
+{
+  u32 offset;
+  u32 size;
+  u32 prev_phys;
+  u32 next_phys;
+  u32 prev_free;
+  u32 next_free;
+  u32 entry; // HEAP_NONE when free
+};
+
+typedef struct HeapEntry HeapEntry;
+struct HeapEntry
+{
+  u32 block;
+  u32 generation;
+  bool live;
+};
+
+// TLSF allocator for memory the CPU can't touch, like ranges of a GPU
+// buffer, so all bookkeeping lives out of band. Alloc and free are O(1):
+// free blocks are binned by size into HEAP_FL_COUNT power of two classes,
+// each split into HEAP_SL_COUNT linear ones, and two levels of bitmaps find
+// the first non-empty bin that fits. Neighbouring free blocks are merged.
+typedef struct Heap Heap;
+struct Heap
+{
+  u64 size;
+
+  HeapBlock *blocks;
+  u32 *free_blocks;
+  u32 block_cap;
+  u32 free_block_count;
+  u32 first_block;
+  u32 last_block;
+
+  HeapEntry *entries;
+  u32 *free_entries;
+  u32 entry_cap;
+  u32 free_count;
+
+  u32 fl_bitmap;
+  u32 sl_bitmap[HEAP_FL_COUNT];
+  u32 heads[HEAP_FL_COUNT][HEAP_SL_COUNT];
+
+  u64 used;
+  u32 alloc_count;
+};
+
+typedef struct HeapStats HeapStats;
+struct HeapStats
+{
+  u64 used;
+  u64 free;
+  u64 largest_free;
+  u32 alloc_count;
+  u32 free_blocks;
+  f32 fragmentation; // 1 - largest_free / free, 0 when all free space is one block
+};
+
+// An allocation moved by heap_defrag. The old range is free once the copy
+// is done, so moves have to be applied before the next heap_alloc.
+typedef struct HeapMove HeapMove;
+struct HeapMove
+{
+  HeapHandle handle;
+  u64 from;
+  u64 to;
+  u64 size;
+};
+
+// `size` is rounded down to HEAP_ALIGNMENT
+Heap heap_create(u64 size, u32 max_allocs);
+void heap_destroy(Heap *heap);
+bool heap_alloc(Heap *heap, u64 size, HeapHandle *handle, u64 *offset);
+void heap_free(Heap *heap, HeapHandle handle);
+
+// FALSE for stale handles
+bool heap_offset(const Heap *heap, HeapHandle handle, u64 *offset);
+
+// Moves allocations, top of the heap first, into the tightest fitting holes
+// below them, until `max_bytes` have moved or `max_moves` are written. A hole
+// never overlaps the allocation, so each move is a plain copy. Call it every
+// frame with a small budget to compact in the background.
+u32 heap_defrag(Heap *heap, u64 max_bytes, HeapMove *moves, u32 max_moves);
+
+HeapStats heap_stats(const Heap *heap);
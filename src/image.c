@@ -0,0 +1,1088 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "base_math.h"
+#include "image.h"
+
+u64 img_level_size(ImageFormat format, i32 width, i32 height)
+{
+  u64 blocks = (u64) ((width + 3) / 4) * ((height + 3) / 4);
+
+  switch (format)
+  {
+    case IMAGE_FORMAT_RGBA8: return (u64) width * height * 4;
+    case IMAGE_FORMAT_BC1:   return blocks * 8;
+    case IMAGE_FORMAT_BC3:   return blocks * 16;
+    case IMAGE_FORMAT_BC7:   return blocks * 16;
+  }
+
+  return 0;
+}
+
+u32 img_mip_count(i32 width, i32 height)
+{
+  u32 count = 1;
+  while ((width > 1 || height > 1) && count < IMAGE_MAX_LEVELS)
+  {
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+    count++;
+  }
+
+  return count;
+}
+
+void img_free(Image *image)
+{
+  for (u32 i = 0; i < image->level_count; i++)
+  {
+    free(image->levels[i].data);
+  }
+
+  *image = (Image) {0};
+}
+
+// @Mips ====================================================================================
+
+#define IMAGE_KAISER_TAPS 6
+#define IMAGE_COVERAGE_REF 0.5f
+
+typedef struct MipLut MipLut;
+struct MipLut
+{
+  f32 to_linear[256];
+  u8 to_srgb[4096];
+  bool srgb;
+};
+
+#ifdef SIMD_SSE
+typedef __m128 Px;
+
+static inline Px px_set(f32 r, f32 g, f32 b, f32 a) { return _mm_setr_ps(r, g, b, a); }
+static inline Px px_zero(void) { return _mm_setzero_ps(); }
+static inline Px px_add(Px a, Px b) { return _mm_add_ps(a, b); }
+static inline Px px_madd(Px acc, Px a, f32 s) { return _mm_add_ps(acc, _mm_mul_ps(a, _mm_set1_ps(s))); }
+static inline void px_get(Px p, f32 out[4]) { _mm_storeu_ps(out, p); }
+#else
+typedef struct Px Px;
+struct Px
+{
+  f32 v[4];
+};
+
+static inline Px px_set(f32 r, f32 g, f32 b, f32 a) { return (Px) {{r, g, b, a}}; }
+static inline Px px_zero(void) { return (Px) {0}; }
+static inline Px px_add(Px a, Px b) { for (u32 i = 0; i < 4; i++) a.v[i] += b.v[i]; return a; }
+static inline Px px_madd(Px acc, Px a, f32 s) { for (u32 i = 0; i < 4; i++) acc.v[i] += a.v[i] * s; return acc; }
+static inline void px_get(Px p, f32 out[4]) { memcpy(out, p.v, sizeof (p.v)); }
+#endif
+
+static
+void img_mip_lut_init(MipLut *lut, bool srgb)
+{
+  lut->srgb = srgb;
+
+  for (u32 i = 0; i < 256; i++)
+  {
+    f32 c = i / 255.0f;
+    if (srgb) c = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    lut->to_linear[i] = c;
+  }
+
+  for (u32 i = 0; i < 4096; i++)
+  {
+    f32 l = i / 4095.0f;
+    if (srgb) l = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+    lut->to_srgb[i] = (u8) (l * 255.0f + 0.5f);
+  }
+}
+
+static inline
+Px img_load_px(const u8 *p, i32 channels, MipLut *lut)
+{
+  f32 g = channels >= 2 ? lut->to_linear[p[1]] : 0.0f;
+  f32 b = channels >= 3 ? lut->to_linear[p[2]] : 0.0f;
+  f32 a = channels == 4 ? p[3] / 255.0f : 1.0f;
+  return px_set(lut->to_linear[p[0]], g, b, a);
+}
+
+static inline
+void img_store_px(u8 *p, Px px, i32 channels, MipLut *lut)
+{
+  f32 v[4];
+  px_get(px, v);
+
+  for (i32 c = 0; c < channels && c < 3; c++)
+  {
+    i32 i = (i32) (v[c] * 4095.0f + 0.5f);
+    p[c] = lut->to_srgb[i < 0 ? 0 : (i > 4095 ? 4095 : i)];
+  }
+
+  if (channels == 4)
+  {
+    i32 a = (i32) (v[3] * 255.0f + 0.5f);
+    p[3] = a < 0 ? 0 : (a > 255 ? 255 : a);
+  }
+}
+
+// 2x2 box on 8-bit values, four output pixels per iteration
+static
+void img_downsample_rgba8_simd(const u8 *src, i32 width, i32 height, u8 *dst)
+{
+  i32 dst_w = width > 1 ? width / 2 : 1;
+  i32 dst_h = height > 1 ? height / 2 : 1;
+
+  for (i32 y = 0; y < dst_h; y++)
+  {
+    i32 y0 = y * 2;
+    i32 y1 = y0 + 1 < height ? y0 + 1 : y0;
+    const u8 *row0 = &src[(u64) y0 * width * 4];
+    const u8 *row1 = &src[(u64) y1 * width * 4];
+    u8 *out = &dst[(u64) y * dst_w * 4];
+    i32 x = 0;
+
+    #ifdef SIMD_SSE
+    if (width > 1)
+    {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i two = _mm_set1_epi16(2);
+
+      for (; x + 4 <= dst_w; x += 4)
+      {
+        __m128i a0 = _mm_loadu_si128((const __m128i *) &row0[x * 8]);
+        __m128i b0 = _mm_loadu_si128((const __m128i *) &row0[x * 8 + 16]);
+        __m128i a1 = _mm_loadu_si128((const __m128i *) &row1[x * 8]);
+        __m128i b1 = _mm_loadu_si128((const __m128i *) &row1[x * 8 + 16]);
+
+        // Vertical sums, one pixel pair per register
+        __m128i s0 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(a1, zero));
+        __m128i s1 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(a1, zero));
+        __m128i s2 = _mm_add_epi16(_mm_unpacklo_epi8(b0, zero), _mm_unpacklo_epi8(b1, zero));
+        __m128i s3 = _mm_add_epi16(_mm_unpackhi_epi8(b0, zero), _mm_unpackhi_epi8(b1, zero));
+
+        // Horizontal sums land in the low half of each register
+        s0 = _mm_add_epi16(s0, _mm_srli_si128(s0, 8));
+        s1 = _mm_add_epi16(s1, _mm_srli_si128(s1, 8));
+        s2 = _mm_add_epi16(s2, _mm_srli_si128(s2, 8));
+        s3 = _mm_add_epi16(s3, _mm_srli_si128(s3, 8));
+
+        __m128i lo = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s0, s1), two), 2);
+        __m128i hi = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(s2, s3), two), 2);
+        _mm_storeu_si128((__m128i *) &out[x * 4], _mm_packus_epi16(lo, hi));
+      }
+    }
+    #endif
+
+    for (; x < dst_w; x++)
+    {
+      i32 x0 = x * 2;
+      i32 x1 = x0 + 1 < width ? x0 + 1 : x0;
+
+      for (i32 c = 0; c < 4; c++)
+      {
+        u32 sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+        out[x * 4 + c] = (sum + 2) / 4;
+      }
+    }
+  }
+}
+
+// 2x2 box in linear space for sRGB data or anything that is not RGBA8
+static
+void img_downsample_box(const u8 *src, i32 width, i32 height, i32 channels, 
+                        MipLut *lut, u8 *dst)
+{
+  i32 dst_w = width > 1 ? width / 2 : 1;
+  i32 dst_h = height > 1 ? height / 2 : 1;
+
+  for (i32 y = 0; y < dst_h; y++)
+  {
+    i32 y0 = y * 2;
+    i32 y1 = y0 + 1 < height ? y0 + 1 : y0;
+
+    for (i32 x = 0; x < dst_w; x++)
+    {
+      i32 x0 = x * 2;
+      i32 x1 = x0 + 1 < width ? x0 + 1 : x0;
+
+      Px sum = img_load_px(&src[((u64) y0 * width + x0) * channels], channels, lut);
+      sum = px_add(sum, img_load_px(&src[((u64) y0 * width + x1) * channels], channels, lut));
+      sum = px_add(sum, img_load_px(&src[((u64) y1 * width + x0) * channels], channels, lut));
+      sum = px_add(sum, img_load_px(&src[((u64) y1 * width + x1) * channels], channels, lut));
+      img_store_px(&dst[((u64) y * dst_w + x) * channels], px_madd(px_zero(), sum, 0.25f), 
+                   channels, lut);
+    }
+  }
+}
+
+static
+void img_kaiser_weights(f32 weights[IMAGE_KAISER_TAPS])
+{
+  // Kaiser-windowed sinc for a 2x reduction, alpha = 4, taps at +-0.5, 1.5, 2.5
+  const f32 alpha = 4.0f;
+  const f32 half_width = IMAGE_KAISER_TAPS / 2.0f;
+  f32 sum = 0.0f;
+
+  for (u32 i = 0; i < IMAGE_KAISER_TAPS; i++)
+  {
+    f32 x = i - half_width + 0.5f;
+    f32 t = x / half_width;
+    f32 arg = alpha * sqrtf(1.0f - t * t);
+
+    // Zeroth order modified Bessel function, series expansion
+    f32 i0_arg = 1.0f;
+    f32 i0_alpha = 1.0f;
+    f32 term_arg = 1.0f;
+    f32 term_alpha = 1.0f;
+    for (u32 k = 1; k < 16; k++)
+    {
+      term_arg *= (arg / (2.0f * k)) * (arg / (2.0f * k));
+      term_alpha *= (alpha / (2.0f * k)) * (alpha / (2.0f * k));
+      i0_arg += term_arg;
+      i0_alpha += term_alpha;
+    }
+
+    f32 sx = (f32) PI * x * 0.5f;
+    f32 sinc = sinf(sx) / sx;
+    weights[i] = sinc * i0_arg / i0_alpha;
+    sum += weights[i];
+  }
+
+  for (u32 i = 0; i < IMAGE_KAISER_TAPS; i++) weights[i] /= sum;
+}
+
+// Separable Kaiser filter. Horizontally filtered source rows are kept in a
+// small ring so each is computed once.
+static
+void img_downsample_kaiser(const u8 *src, i32 width, i32 height, i32 channels, 
+                           MipLut *lut, u8 *dst)
+{
+  i32 dst_w = width > 1 ? width / 2 : 1;
+  i32 dst_h = height > 1 ? height / 2 : 1;
+
+  f32 weights[IMAGE_KAISER_TAPS];
+  img_kaiser_weights(weights);
+
+  Px *rows = malloc(sizeof (Px) * dst_w * IMAGE_KAISER_TAPS);
+  i32 row_index[IMAGE_KAISER_TAPS];
+  for (u32 i = 0; i < IMAGE_KAISER_TAPS; i++) row_index[i] = -1;
+
+  // A 1-pixel axis is passed through rather than filtered
+  bool filter_x = width > 1;
+  bool filter_y = height > 1;
+
+  for (i32 y = 0; y < dst_h; y++)
+  {
+    Px *taps[IMAGE_KAISER_TAPS];
+
+    for (i32 t = 0; t < IMAGE_KAISER_TAPS; t++)
+    {
+      i32 sy = filter_y ? y * 2 - IMAGE_KAISER_TAPS / 2 + 1 + t : y;
+      sy = sy < 0 ? 0 : (sy >= height ? height - 1 : sy);
+      i32 slot = sy % IMAGE_KAISER_TAPS;
+      taps[t] = &rows[slot * dst_w];
+
+      if (row_index[slot] == sy) continue;
+      row_index[slot] = sy;
+
+      const u8 *row = &src[(u64) sy * width * channels];
+      for (i32 x = 0; x < dst_w; x++)
+      {
+        Px sum = px_zero();
+        for (i32 k = 0; k < IMAGE_KAISER_TAPS; k++)
+        {
+          i32 sx = filter_x ? x * 2 - IMAGE_KAISER_TAPS / 2 + 1 + k : x;
+          sx = sx < 0 ? 0 : (sx >= width ? width - 1 : sx);
+          sum = px_madd(sum, img_load_px(&row[sx * channels], channels, lut), weights[k]);
+        }
+
+        taps[t][x] = sum;
+      }
+    }
+
+    for (i32 x = 0; x < dst_w; x++)
+    {
+      Px sum = px_zero();
+      for (i32 t = 0; t < IMAGE_KAISER_TAPS; t++) sum = px_madd(sum, taps[t][x], weights[t]);
+      img_store_px(&dst[((u64) y * dst_w + x) * channels], sum, channels, lut);
+    }
+  }
+
+  free(rows);
+}
+
+static
+f32 img_alpha_coverage(const u8 *rgba, u64 count, f32 scale)
+{
+  u64 covered = 0;
+  f32 ref = IMAGE_COVERAGE_REF * 255.0f;
+
+  for (u64 i = 0; i < count; i++)
+  {
+    if (rgba[i * 4 + 3] * scale > ref) covered++;
+  }
+
+  return (f32) covered / count;
+}
+
+// Rescales alpha so the fraction of pixels passing the alpha test matches the
+// top level, which keeps cutout foliage and fences from thinning out.
+static
+void img_preserve_coverage(u8 *rgba, u64 count, f32 target)
+{
+  f32 lo = 0.0f;
+  f32 hi = 4.0f;
+
+  for (u32 iter = 0; iter < 12; iter++)
+  {
+    f32 mid = (lo + hi) * 0.5f;
+    if (img_alpha_coverage(rgba, count, mid) < target) lo = mid;
+    else hi = mid;
+  }
+
+  f32 scale = (lo + hi) * 0.5f;
+  for (u64 i = 0; i < count; i++)
+  {
+    f32 a = rgba[i * 4 + 3] * scale + 0.5f;
+    rgba[i * 4 + 3] = a > 255.0f ? 255 : (u8) a;
+  }
+}
+
+u32 img_gen_mips(const u8 *pixels, i32 width, i32 height, i32 channels, 
+                 ImageFilter filter, u32 flags, ImageLevel *levels)
+{
+  ASSERT(channels >= 1 && channels <= 4);
+
+  // R and RG textures hold data (masks, normals, glyphs), not color
+  MipLut lut;
+  bool srgb = (flags & IMAGE_MIP_SRGB) && channels >= 3;
+  bool fast = filter == IMAGE_FILTER_BOX && !srgb && channels == 4;
+  bool coverage = (flags & IMAGE_MIP_PRESERVE_COVERAGE) && channels == 4;
+  if (!fast) img_mip_lut_init(&lut, srgb);
+
+  u32 count = img_mip_count(width, height);
+
+  levels[0].width = width;
+  levels[0].height = height;
+  levels[0].size = (u64) width * height * channels;
+  levels[0].data = (u8 *) pixels;
+
+  f32 target = coverage ? img_alpha_coverage(pixels, (u64) width * height, 1.0f) : 0.0f;
+
+  for (u32 i = 1; i < count; i++)
+  {
+    ImageLevel *src = &levels[i - 1];
+    ImageLevel *dst = &levels[i];
+    dst->width = src->width > 1 ? src->width / 2 : 1;
+    dst->height = src->height > 1 ? src->height / 2 : 1;
+    dst->size = (u64) dst->width * dst->height * channels;
+    dst->data = malloc(dst->size);
+
+    if (fast)
+    {
+      img_downsample_rgba8_simd(src->data, src->width, src->height, dst->data);
+    }
+    else if (filter == IMAGE_FILTER_BOX)
+    {
+      img_downsample_box(src->data, src->width, src->height, channels, &lut, dst->data);
+    }
+    else
+    {
+      img_downsample_kaiser(src->data, src->width, src->height, channels, &lut, dst->data);
+    }
+
+    if (coverage)
+    {
+      img_preserve_coverage(dst->data, (u64) dst->width * dst->height, target);
+    }
+  }
+
+  return count;
+}
+
+void img_free_levels(ImageLevel *levels, u32 count)
+{
+  for (u32 i = 1; i < count; i++)
+  {
+    free(levels[i].data);
+    levels[i] = (ImageLevel) {0};
+  }
+}
+
+// 2x2 box filter. Odd edges repeat the last row/column.
+void img_downsample_rgba8(const u8 *src, i32 width, i32 height, u8 *dst)
+{
+  i32 dst_w = width > 1 ? width / 2 : 1;
+  i32 dst_h = height > 1 ? height / 2 : 1;
+
+  for (i32 y = 0; y < dst_h; y++)
+  {
+    i32 y0 = y * 2;
+    i32 y1 = y0 + 1 < height ? y0 + 1 : y0;
+
+    for (i32 x = 0; x < dst_w; x++)
+    {
+      i32 x0 = x * 2;
+      i32 x1 = x0 + 1 < width ? x0 + 1 : x0;
+
+      for (i32 c = 0; c < 4; c++)
+      {
+        u32 sum = src[((u64) y0 * width + x0) * 4 + c] +
+                  src[((u64) y0 * width + x1) * 4 + c] +
+                  src[((u64) y1 * width + x0) * 4 + c] +
+                  src[((u64) y1 * width + x1) * 4 + c];
+        dst[((u64) y * dst_w + x) * 4 + c] = (sum + 2) / 4;
+      }
+    }
+  }
+}
+
+// @BlockCompression ========================================================================
+
+static
+void img_fetch_block(const u8 *rgba, i32 width, i32 height, i32 bx, i32 by, u8 block[16][4])
+{
+  for (i32 y = 0; y < 4; y++)
+  {
+    i32 sy = by * 4 + y < height ? by * 4 + y : height - 1;
+    for (i32 x = 0; x < 4; x++)
+    {
+      i32 sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+      memcpy(block[y * 4 + x], &rgba[((u64) sy * width + sx) * 4], 4);
+    }
+  }
+}
+
+static
+void img_store_block(u8 *rgba, i32 width, i32 height, i32 bx, i32 by, u8 block[16][4])
+{
+  for (i32 y = 0; y < 4 && by * 4 + y < height; y++)
+  {
+    for (i32 x = 0; x < 4 && bx * 4 + x < width; x++)
+    {
+      memcpy(&rgba[((u64) (by * 4 + y) * width + bx * 4 + x) * 4], block[y * 4 + x], 4);
+    }
+  }
+}
+
+// Finds the two extremes of the block along its principal axis, considering the
+// first `dims` channels.
+static
+void img_principal_endpoints(u8 block[16][4], u32 dims, f32 lo[4], f32 hi[4])
+{
+  f32 mean[4] = {0};
+  for (u32 i = 0; i < 16; i++)
+  {
+    for (u32 c = 0; c < dims; c++) mean[c] += block[i][c] / 16.0f;
+  }
+
+  f32 cov[4][4] = {0};
+  for (u32 i = 0; i < 16; i++)
+  {
+    for (u32 a = 0; a < dims; a++)
+    {
+      for (u32 b = 0; b < dims; b++)
+      {
+        cov[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+      }
+    }
+  }
+
+  // Power iteration
+  f32 axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (u32 iter = 0; iter < 8; iter++)
+  {
+    f32 next[4] = {0};
+    f32 len = 0.0f;
+    for (u32 a = 0; a < dims; a++)
+    {
+      for (u32 b = 0; b < dims; b++) next[a] += cov[a][b] * axis[b];
+      if (next[a] * next[a] > len) len = next[a] * next[a];
+    }
+
+    if (len == 0.0f) break;
+    for (u32 a = 0; a < dims; a++) axis[a] = next[a];
+
+    f32 norm = 0.0f;
+    for (u32 a = 0; a < dims; a++) norm += axis[a] * axis[a];
+    norm = 1.0f / sqrtf(norm);
+    for (u32 a = 0; a < dims; a++) axis[a] *= norm;
+  }
+
+  f32 min_t = 1e30f;
+  f32 max_t = -1e30f;
+  for (u32 i = 0; i < 16; i++)
+  {
+    f32 t = 0.0f;
+    for (u32 c = 0; c < dims; c++) t += (block[i][c] - mean[c]) * axis[c];
+    if (t < min_t) min_t = t;
+    if (t > max_t) max_t = t;
+  }
+
+  for (u32 c = 0; c < 4; c++)
+  {
+    f32 l = c < dims ? mean[c] + axis[c] * min_t : 0.0f;
+    f32 h = c < dims ? mean[c] + axis[c] * max_t : 0.0f;
+    lo[c] = l < 0.0f ? 0.0f : (l > 255.0f ? 255.0f : l);
+    hi[c] = h < 0.0f ? 0.0f : (h > 255.0f ? 255.0f : h);
+  }
+}
+
+static
+u16 img_pack_565(f32 c[4])
+{
+  u32 r = (u32) (c[0] * 31.0f / 255.0f + 0.5f);
+  u32 g = (u32) (c[1] * 63.0f / 255.0f + 0.5f);
+  u32 b = (u32) (c[2] * 31.0f / 255.0f + 0.5f);
+
+  return (r << 11) | (g << 5) | b;
+}
+
+static
+void img_unpack_565(u16 v, u8 out[4])
+{
+  u32 r = (v >> 11) & 31;
+  u32 g = (v >> 5) & 63;
+  u32 b = v & 31;
+  out[0] = (r << 3) | (r >> 2);
+  out[1] = (g << 2) | (g >> 4);
+  out[2] = (b << 3) | (b >> 2);
+  out[3] = 255;
+}
+
+static
+void img_bc1_palette(u16 c0, u16 c1, bool four_color, u8 palette[4][4])
+{
+  img_unpack_565(c0, palette[0]);
+  img_unpack_565(c1, palette[1]);
+
+  for (u32 c = 0; c < 3; c++)
+  {
+    if (four_color)
+    {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    else
+    {
+      palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+      palette[3][c] = 0;
+    }
+  }
+
+  palette[2][3] = 255;
+  palette[3][3] = four_color ? 255 : 0;
+}
+
+static
+void img_encode_bc1_block(u8 block[16][4], u8 *out)
+{
+  f32 lo[4];
+  f32 hi[4];
+  img_principal_endpoints(block, 3, lo, hi);
+
+  u16 c0 = img_pack_565(hi);
+  u16 c1 = img_pack_565(lo);
+  if (c0 < c1)
+  {
+    u16 tmp = c0;
+    c0 = c1;
+    c1 = tmp;
+  }
+
+  u32 indices = 0;
+  if (c0 != c1)
+  {
+    u8 palette[4][4];
+    img_bc1_palette(c0, c1, TRUE, palette);
+
+    for (u32 i = 0; i < 16; i++)
+    {
+      u32 best = 0;
+      u32 best_err = (u32) -1;
+      for (u32 p = 0; p < 4; p++)
+      {
+        i32 dr = block[i][0] - palette[p][0];
+        i32 dg = block[i][1] - palette[p][1];
+        i32 db = block[i][2] - palette[p][2];
+        u32 err = dr * dr + dg * dg + db * db;
+        if (err < best_err)
+        {
+          best = p;
+          best_err = err;
+        }
+      }
+
+      indices |= best << (i * 2);
+    }
+  }
+
+  out[0] = c0 & 0xFF;
+  out[1] = c0 >> 8;
+  out[2] = c1 & 0xFF;
+  out[3] = c1 >> 8;
+  memcpy(out + 4, &indices, 4);
+}
+
+static
+void img_decode_bc1_block(const u8 *in, bool force_four_color, u8 block[16][4])
+{
+  u16 c0 = in[0] | (in[1] << 8);
+  u16 c1 = in[2] | (in[3] << 8);
+  u32 indices;
+  memcpy(&indices, in + 4, 4);
+
+  u8 palette[4][4];
+  img_bc1_palette(c0, c1, force_four_color || c0 > c1, palette);
+
+  for (u32 i = 0; i < 16; i++)
+  {
+    memcpy(block[i], palette[(indices >> (i * 2)) & 3], 4);
+  }
+}
+
+static
+void img_bc4_palette(u8 a0, u8 a1, u8 palette[8])
+{
+  palette[0] = a0;
+  palette[1] = a1;
+
+  if (a0 > a1)
+  {
+    for (u32 i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+  }
+  else
+  {
+    for (u32 i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+}
+
+static
+void img_encode_bc4_block(u8 block[16][4], u32 channel, u8 *out)
+{
+  u8 a0 = 0;
+  u8 a1 = 255;
+  for (u32 i = 0; i < 16; i++)
+  {
+    if (block[i][channel] > a0) a0 = block[i][channel];
+    if (block[i][channel] < a1) a1 = block[i][channel];
+  }
+
+  u64 indices = 0;
+  if (a0 != a1)
+  {
+    u8 palette[8];
+    img_bc4_palette(a0, a1, palette);
+
+    for (u32 i = 0; i < 16; i++)
+    {
+      u64 best = 0;
+      i32 best_err = 256;
+      for (u32 p = 0; p < 8; p++)
+      {
+        i32 err = block[i][channel] - palette[p];
+        if (err < 0) err = -err;
+        if (err < best_err)
+        {
+          best = p;
+          best_err = err;
+        }
+      }
+
+      indices |= best << (i * 3);
+    }
+  }
+
+  out[0] = a0;
+  out[1] = a1;
+  for (u32 i = 0; i < 6; i++) out[2 + i] = (indices >> (i * 8)) & 0xFF;
+}
+
+static
+void img_decode_bc4_block(const u8 *in, u32 channel, u8 block[16][4])
+{
+  u8 palette[8];
+  img_bc4_palette(in[0], in[1], palette);
+
+  u64 indices = 0;
+  for (u32 i = 0; i < 6; i++) indices |= (u64) in[2 + i] << (i * 8);
+
+  for (u32 i = 0; i < 16; i++)
+  {
+    block[i][channel] = palette[(indices >> (i * 3)) & 7];
+  }
+}
+
+static const u8 bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static
+void img_bits_write(u8 *out, u32 *pos, u32 value, u32 count)
+{
+  for (u32 i = 0; i < count; i++, (*pos)++)
+  {
+    if (value & (1u << i)) out[*pos / 8] |= 1 << (*pos % 8);
+  }
+}
+
+static
+u32 img_bits_read(const u8 *in, u32 *pos, u32 count)
+{
+  u32 value = 0;
+  for (u32 i = 0; i < count; i++, (*pos)++)
+  {
+    value |= ((in[*pos / 8] >> (*pos % 8)) & 1) << i;
+  }
+
+  return value;
+}
+
+static
+void img_encode_bc7_block(u8 block[16][4], u8 *out)
+{
+  f32 ends[2][4];
+  img_principal_endpoints(block, 4, ends[0], ends[1]);
+
+  // Quantize each endpoint to 7 bits + shared p-bit, picking the p-bit with
+  // the smaller reconstruction error.
+  u8 q[2][4];
+  u8 pbit[2];
+  u8 e[2][4];
+  for (u32 k = 0; k < 2; k++)
+  {
+    f32 best_err = 1e30f;
+    for (u32 p = 0; p < 2; p++)
+    {
+      f32 err = 0.0f;
+      u8 cand[4];
+      for (u32 c = 0; c < 4; c++)
+      {
+        i32 v = (i32) ((ends[k][c] - p) / 2.0f + 0.5f);
+        cand[c] = v < 0 ? 0 : (v > 127 ? 127 : v);
+        f32 d = ((cand[c] << 1) | p) - ends[k][c];
+        err += d * d;
+      }
+
+      if (err < best_err)
+      {
+        best_err = err;
+        pbit[k] = p;
+        memcpy(q[k], cand, 4);
+      }
+    }
+
+    for (u32 c = 0; c < 4; c++) e[k][c] = (q[k][c] << 1) | pbit[k];
+  }
+
+  u8 palette[16][4];
+  for (u32 i = 0; i < 16; i++)
+  {
+    for (u32 c = 0; c < 4; c++)
+    {
+      palette[i][c] = ((64 - bc7_weights4[i]) * e[0][c] + bc7_weights4[i] * e[1][c] + 32) >> 6;
+    }
+  }
+
+  u8 indices[16];
+  for (u32 i = 0; i < 16; i++)
+  {
+    u32 best = 0;
+    u32 best_err = (u32) -1;
+    for (u32 p = 0; p < 16; p++)
+    {
+      u32 err = 0;
+      for (u32 c = 0; c < 4; c++)
+      {
+        i32 d = block[i][c] - palette[p][c];
+        err += d * d;
+      }
+
+      if (err < best_err)
+      {
+        best = p;
+        best_err = err;
+      }
+    }
+
+    indices[i] = best;
+  }
+
+  // The anchor index drops its top bit, so it must be < 8
+  if (indices[0] >= 8)
+  {
+    for (u32 c = 0; c < 4; c++)
+    {
+      u8 tmp = q[0][c];
+      q[0][c] = q[1][c];
+      q[1][c] = tmp;
+    }
+
+    u8 tmp = pbit[0];
+    pbit[0] = pbit[1];
+    pbit[1] = tmp;
+
+    for (u32 i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+  }
+
+  memset(out, 0, 16);
+  u32 pos = 0;
+  img_bits_write(out, &pos, 1 << 6, 7);
+  for (u32 c = 0; c < 4; c++)
+  {
+    img_bits_write(out, &pos, q[0][c], 7);
+    img_bits_write(out, &pos, q[1][c], 7);
+  }
+
+  img_bits_write(out, &pos, pbit[0], 1);
+  img_bits_write(out, &pos, pbit[1], 1);
+  img_bits_write(out, &pos, indices[0], 3);
+  for (u32 i = 1; i < 16; i++) img_bits_write(out, &pos, indices[i], 4);
+}
+
+static
+void img_decode_bc7_block(const u8 *in, u8 block[16][4])
+{
+  if ((in[0] & 0x7F) != 0x40)
+  {
+    for (u32 i = 0; i < 16; i++)
+    {
+      block[i][0] = 255;
+      block[i][1] = 0;
+      block[i][2] = 255;
+      block[i][3] = 255;
+    }
+
+    return;
+  }
+
+  u32 pos = 7;
+  u8 e[2][4];
+  for (u32 c = 0; c < 4; c++)
+  {
+    e[0][c] = img_bits_read(in, &pos, 7) << 1;
+    e[1][c] = img_bits_read(in, &pos, 7) << 1;
+  }
+
+  u32 p0 = img_bits_read(in, &pos, 1);
+  u32 p1 = img_bits_read(in, &pos, 1);
+  for (u32 c = 0; c < 4; c++)
+  {
+    e[0][c] |= p0;
+    e[1][c] |= p1;
+  }
+
+  for (u32 i = 0; i < 16; i++)
+  {
+    u32 index = img_bits_read(in, &pos, i == 0 ? 3 : 4);
+    for (u32 c = 0; c < 4; c++)
+    {
+      block[i][c] = ((64 - bc7_weights4[index]) * e[0][c] + bc7_weights4[index] * e[1][c] + 32) >> 6;
+    }
+  }
+}
+
+void img_encode(ImageFormat format, const u8 *rgba, i32 width, i32 height, u8 *out)
+{
+  if (format == IMAGE_FORMAT_RGBA8)
+  {
+    memcpy(out, rgba, img_level_size(format, width, height));
+    return;
+  }
+
+  i32 blocks_x = (width + 3) / 4;
+  i32 blocks_y = (height + 3) / 4;
+  u8 block[16][4];
+
+  for (i32 by = 0; by < blocks_y; by++)
+  {
+    for (i32 bx = 0; bx < blocks_x; bx++)
+    {
+      img_fetch_block(rgba, width, height, bx, by, block);
+
+      switch (format)
+      {
+        case IMAGE_FORMAT_BC1:
+        {
+          img_encode_bc1_block(block, out);
+          out += 8;
+        } break;
+        case IMAGE_FORMAT_BC3:
+        {
+          img_encode_bc4_block(block, 3, out);
+          img_encode_bc1_block(block, out + 8);
+          out += 16;
+        } break;
+        case IMAGE_FORMAT_BC7:
+        {
+          img_encode_bc7_block(block, out);
+          out += 16;
+        } break;
+        default: ASSERT(FALSE);
+      }
+    }
+  }
+}
+
+void img_decode(ImageFormat format, const u8 *blocks, i32 width, i32 height, u8 *rgba)
+{
+  if (format == IMAGE_FORMAT_RGBA8)
+  {
+    memcpy(rgba, blocks, img_level_size(format, width, height));
+    return;
+  }
+
+  i32 blocks_x = (width + 3) / 4;
+  i32 blocks_y = (height + 3) / 4;
+  u8 block[16][4];
+
+  for (i32 by = 0; by < blocks_y; by++)
+  {
+    for (i32 bx = 0; bx < blocks_x; bx++)
+    {
+      switch (format)
+      {
+        case IMAGE_FORMAT_BC1:
+        {
+          img_decode_bc1_block(blocks, FALSE, block);
+          blocks += 8;
+        } break;
+        case IMAGE_FORMAT_BC3:
+        {
+          img_decode_bc1_block(blocks + 8, TRUE, block);
+          img_decode_bc4_block(blocks, 3, block);
+          blocks += 16;
+        } break;
+        case IMAGE_FORMAT_BC7:
+        {
+          img_decode_bc7_block(blocks, block);
+          blocks += 16;
+        } break;
+        default: ASSERT(FALSE);
+      }
+
+      img_store_block(rgba, width, height, bx, by, block);
+    }
+  }
+}
+
+Image img_compress(ImageFormat format, const u8 *rgba, i32 width, i32 height, bool mips)
+{
+  Image image = {0};
+  image.format = format;
+  image.width = width;
+  image.height = height;
+
+  ImageLevel source[IMAGE_MAX_LEVELS];
+  if (mips)
+  {
+    image.level_count = img_gen_mips(rgba, width, height, 4, IMAGE_FILTER_BOX, 0, source);
+  }
+  else
+  {
+    image.level_count = 1;
+    source[0] = (ImageLevel) {width, height, (u64) width * height * 4, (u8 *) rgba};
+  }
+
+  for (u32 i = 0; i < image.level_count; i++)
+  {
+    ImageLevel *dst = &image.levels[i];
+    dst->width = source[i].width;
+    dst->height = source[i].height;
+    dst->size = img_level_size(format, dst->width, dst->height);
+    dst->data = malloc(dst->size);
+    img_encode(format, source[i].data, dst->width, dst->height, dst->data);
+  }
+
+  if (mips) img_free_levels(source, image.level_count);
+
+  return image;
+}
+
+// @Container ===============================================================================
+
+// Layout: magic, format, width, height, level_count, then per level its byte
+// size followed by the data. All fields are little-endian u32.
+bool img_save(const i8 *path, Image *image)
+{
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) return FALSE;
+
+  u32 header[5] = {IMAGE_MAGIC, image->format, image->width, image->height, image->level_count};
+  fwrite(header, sizeof (u32), 5, file);
+
+  for (u32 i = 0; i < image->level_count; i++)
+  {
+    u32 size = (u32) image->levels[i].size;
+    fwrite(&size, sizeof (u32), 1, file);
+    fwrite(image->levels[i].data, 1, size, file);
+  }
+
+  fclose(file);
+
+  return TRUE;
+}
+
+bool img_load(const i8 *path, Image *image)
+{
+  *image = (Image) {0};
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return FALSE;
+
+  fseek(file, 0, SEEK_END);
+  i64 remaining = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  // Sizes come from the file, so they are checked before anything is allocated
+  u32 header[5];
+  bool ok = fread(header, sizeof (u32), 5, file) == 5 &&
+            header[0] == IMAGE_MAGIC &&
+            header[1] <= IMAGE_FORMAT_BC7 &&
+            header[2] >= 1 && header[2] <= IMAGE_MAX_SIZE &&
+            header[3] >= 1 && header[3] <= IMAGE_MAX_SIZE &&
+            header[4] >= 1 && header[4] <= IMAGE_MAX_LEVELS;
+  remaining -= sizeof (u32) * 5;
+
+  if (ok)
+  {
+    image->format = header[1];
+    image->width = header[2];
+    image->height = header[3];
+
+    i32 w = image->width;
+    i32 h = image->height;
+
+    for (u32 i = 0; i < header[4] && ok; i++)
+    {
+      ImageLevel *level = &image->levels[i];
+      u32 size;
+      ok = fread(&size, sizeof (u32), 1, file) == 1 &&
+           size == img_level_size(image->format, w, h) &&
+           size + sizeof (u32) <= (u64) remaining;
+      if (!ok) break;
+      remaining -= size + sizeof (u32);
+
+      level->width = w;
+      level->height = h;
+      level->size = size;
+      level->data = malloc(size);
+      ok = level->data != NULL;
+      if (!ok) break;
+
+      image->level_count++;
+      ok = fread(level->data, 1, size, file) == size;
+
+      w = w > 1 ? w / 2 : 1;
+      h = h > 1 ? h / 2 : 1;
+    }
+  }
+
+  fclose(file);
+  if (!ok) img_free(image);
+
+  return ok;
+}
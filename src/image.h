@@ -0,0 +1,76 @@
+#pragma once
+
+#include "base_common.h"
+
+#define IMAGE_MAX_LEVELS 16
+#define IMAGE_MAX_SIZE 16384 // Widest and tallest img_load accepts, an RGBA8 level stays under 4 GB
+#define IMAGE_MAGIC 0x43584554 // "TEXC"
+
+typedef enum ImageFormat
+{
+  IMAGE_FORMAT_RGBA8,
+  IMAGE_FORMAT_BC1,
+  IMAGE_FORMAT_BC3,
+  IMAGE_FORMAT_BC7,
+} ImageFormat;
+
+typedef enum ImageFilter
+{
+  IMAGE_FILTER_BOX,
+  IMAGE_FILTER_KAISER,
+} ImageFilter;
+
+#define IMAGE_MIP_SRGB (1 << 0)
+#define IMAGE_MIP_PRESERVE_COVERAGE (1 << 1)
+
+typedef struct ImageLevel ImageLevel;
+struct ImageLevel
+{
+  i32 width;
+  i32 height;
+  u64 size;
+  u8 *data;
+};
+
+// A texture with its mip chain, either raw RGBA8 or block compressed.
+typedef struct Image Image;
+struct Image
+{
+  ImageFormat format;
+  i32 width;
+  i32 height;
+  u32 level_count;
+  ImageLevel levels[IMAGE_MAX_LEVELS];
+};
+
+u64 img_level_size(ImageFormat format, i32 width, i32 height);
+u32 img_mip_count(i32 width, i32 height);
+void img_free(Image *image);
+
+// @Mips ====================================================================================
+
+// Builds the full chain for an 8-bit image with 1-4 channels. IMAGE_MIP_SRGB
+// applies to RGB(A) only; 1 and 2 channel images are always filtered as
+// linear, and alpha is always linear. Level 0 aliases `pixels`;
+// the rest are freed with img_free_levels. Touches no shared state, so it can
+// run on worker threads.
+u32 img_gen_mips(const u8 *pixels, i32 width, i32 height, i32 channels, 
+                 ImageFilter filter, u32 flags, ImageLevel *levels);
+void img_free_levels(ImageLevel *levels, u32 count);
+
+// Scalar reference for the SIMD box filter
+void img_downsample_rgba8(const u8 *src, i32 width, i32 height, u8 *dst);
+
+// @BlockCompression ========================================================================
+
+// BC1 and BC3 are complete. BC7 is encoded and decoded in mode 6 only (one
+// subset, RGBA 7.7.7.7 + p-bit endpoints, 4-bit indices); other modes decode
+// to magenta.
+void img_encode(ImageFormat format, const u8 *rgba, i32 width, i32 height, u8 *out);
+void img_decode(ImageFormat format, const u8 *blocks, i32 width, i32 height, u8 *rgba);
+Image img_compress(ImageFormat format, const u8 *rgba, i32 width, i32 height, bool mips);
+
+// @Container ===============================================================================
+
+bool img_save(const i8 *path, Image *image);
+bool img_load(const i8 *path, Image *image);
@@ -1,3 +1,5 @@
+#include <math.h>
+
 #include <SDL2/SDL.h>
 
 #include "glad/glad.h"
@@ -6,8 +8,8 @@
 #include "base_math.h"
 #include "shaders.h"
 #include "render.h"
+#include "vertex.h"
 
-#define DEBUG
 // #define LOG_PERF
 
 typedef struct State State;
@@ -61,32 +63,46 @@ i32 main(void)
   SDL_GL_SetSwapInterval(VSYNC_ON);
 
   gladLoadGLLoader((GLADloadproc) SDL_GL_GetProcAddress);
+  r_init();
 
   R_Shader shader = r_create_shader(shaders_vert_src, shaders_frag_src);
 
-  R_Vertex vertices[4] = 
+  Vec3F positions[4] = 
   {
-    {{-10.0f,  10.0f, 1.0f},  {0.0f, 0.0f, 0.0f}}, // top left
-    {{ 10.0f,  10.0f, 1.0f},  {0.0f, 0.0f, 0.0f}}, // top right
-    {{ 10.0f, -10.0f, 1.0f},  {0.0f, 0.0f, 0.0f}}, // bottom right
-    {{-10.0f, -10.0f, 1.0f},  {0.0f, 0.0f, 0.0f}}  // bottom left
+    {-10.0f,  10.0f, 1.0f}, // top left
+    { 10.0f,  10.0f, 1.0f}, // top right
+    { 10.0f, -10.0f, 1.0f}, // bottom right
+    {-10.0f, -10.0f, 1.0f}  // bottom left
   };
 
+  // The fragment shader adds the vertex color to u_color, so keep it black
+  Vec4F colors[4] = {0};
+
+  VertexHalf vertices[4];
+  vertex_pack_half(positions, NULL, colors, ARR_LEN(positions), vertices);
+
   u16 indices[6] = 
   {
     0, 1, 3, // first triangle
     1, 2, 3  // second triangle
   };
 
-  R_Object vert_arr = r_create_vertex_array(2);
-  r_create_vertex_buffer(vertices, sizeof (vertices));
-  r_create_index_buffer(indices, sizeof (indices));
+  R_VertexAttrib attribs[3] = 
+  {
+    {.location = 0, .count = 3, .type = GL_HALF_FLOAT},                        // position
+    {.location = 2, .count = 2, .type = GL_UNSIGNED_SHORT, .normalized = TRUE}, // uv
+    {.location = 1, .count = 4, .type = GL_UNSIGNED_BYTE, .normalized = TRUE},  // color
+  };
 
-  R_VertexLayout vert_pos_layout = r_create_vertex_layout(&vert_arr, GL_FLOAT, 3);
-  r_bind_vertex_layout(&vert_pos_layout);
-  
-  R_VertexLayout vert_col_layout = r_create_vertex_layout(&vert_arr, GL_FLOAT, 3);
-  r_bind_vertex_layout(&vert_col_layout);
+  R_VertexFormat vert_format = r_create_vertex_format(attribs, ARR_LEN(attribs));
+  ASSERT(vert_format.strides[0] == sizeof (VertexHalf));
+
+  R_Mesh quad = r_create_mesh(&vert_format, vertices, ARR_LEN(vertices), 
+                              indices, ARR_LEN(indices), sizeof (u16));
+
+  // The player's color is well past 1.0, so the scene is drawn in HDR and
+  // tonemapped on the way to the window
+  R_Post post = r_create_post(WIDTH, HEIGHT);
 
   Transform2D player = {0};
   player.scale = v2f(1.5f, 1.5f);
@@ -123,9 +139,10 @@ i32 main(void)
       u64 t = SDL_GetTicks64();
 
       // Object
-      Mat3x3F sprite = m3x3f(1.0f);
-      sprite = mul_3x3f(scale_3x3f(sin(t * 0.005f) * 5.0f, 5.0f), sprite);
-      sprite = mul_3x3f(rotate_3x3f(t * 0.1f), sprite);
+      f32 pulse, pulse_cos;
+      sincos_f32(t * 0.005f, TRIG_FAST, &pulse, &pulse_cos);
+
+      Affine2F sprite = a2f(V2F_ZERO, t * 0.1f, v2f(pulse * 5.0f, 5.0f));
 
       // Player
       if (input->a) player.dir.x = -1.0f;
@@ -137,32 +154,45 @@ i32 main(void)
 
       player.pos = add_2f(player.pos, scale_2f(player.dir, 3.0f));
 
-      Mat3x3F p_sprite = m3x3f(1.0f);
-      p_sprite = mul_3x3f(scale_3x3f(player.scale.x, player.scale.y), p_sprite);
-      p_sprite = mul_3x3f(rotate_3x3f(player.rot), p_sprite);
-      p_sprite = mul_3x3f(translate_3x3f(player.pos.x, -player.pos.y), p_sprite);
+      Affine2F p_sprite = a2f(v2f(player.pos.x, -player.pos.y), player.rot, player.scale);
 
-      Mat3x3F camera = m3x3f(1.0f);
-      camera = mul_3x3f(translate_3x3f(WIDTH / 2.0f, HEIGHT / 2.0f), camera);
+      Affine2F camera = translate_a2f(WIDTH / 2.0f, HEIGHT / 2.0f);
+      Affine2F projection = orthographic_a2f(0.0f, WIDTH, 0.0f, HEIGHT);
+      Affine2F view_proj = mul_a2f(projection, camera);
 
-      Mat3x3F projection = m3x3f(1.0f);
-      projection = mul_3x3f(orthographic_3x3f(0.0f, WIDTH, 0.0f, HEIGHT), projection);
+      // World-space rect covered by clip space; the quad spans +-10 units
+      AABB2F view = transform_aabb2f((AABB2F) {{-1.0f, -1.0f}, {1.0f, 1.0f}}, 
+                                     invert_a2f(view_proj));
+      f32 quad_radius = 10.0f * 1.41421356f;
+      CircleF sprite_bounds = {V2F_ZERO, quad_radius * 5.0f};
+      CircleF player_bounds = 
+      {
+        v2f(player.pos.x, -player.pos.y), 
+        quad_radius * fmaxf(player.scale.x, player.scale.y),
+      };
 
       // DRAW
+      r_begin_post(&post);
       r_clear(v4f(0.1f, 0.1f, 0.1f, 1.0f));
+      r_bind_shader(&shader);
 
       // Object
-      Mat3x3F scp = mul_3x3f(mul_3x3f(projection, camera), sprite);
-      r_set_uniform_3x3f(&shader, "u_xform", scp);
-      r_set_uniform_4f(&shader, "u_color", v4f(1.0f, 0.0f, 0.0f, 1.0f));
-      r_draw(&vert_arr, &shader);
+      if (overlap_circle_aabb2f(sprite_bounds, view))
+      {
+        r_set_uniform_a2f(&shader, "u_xform", mul_a2f(view_proj, sprite));
+        r_set_uniform_4f(&shader, "u_color", v4f(1.0f, 0.0f, 0.0f, 1.0f));
+        r_draw(&quad, &shader);
+      }
       
       // Player
-      Mat3x3F player_scp = mul_3x3f(mul_3x3f(projection, camera), p_sprite);
-      r_set_uniform_3x3f(&shader, "u_xform", player_scp);
-      r_set_uniform_4f(&shader, "u_color", player.color);
-      r_draw(&vert_arr, &shader);
+      if (overlap_circle_aabb2f(player_bounds, view))
+      {
+        r_set_uniform_a2f(&shader, "u_xform", mul_a2f(view_proj, p_sprite));
+        r_set_uniform_4f(&shader, "u_color", player.color);
+        r_draw(&quad, &shader);
+      }
 
+      r_end_post(&post);
       SDL_GL_SwapWindow(window);
     }
 
@@ -174,9 +204,20 @@ i32 main(void)
     f64 frame_time = (f64) (frame_end - frame_start) / frequency * 1000.0f;
 
     printf("%.2lf ms\n", frame_time);
+
+    // GPU times are from a few frames back
+    if (post.timers.ms_count == R_POST_TIMER_COUNT)
+    {
+      f32 *gpu = post.timers.ms;
+      printf("  gpu: scene %.3f ms, bloom down %.3f ms, up %.3f ms, tonemap %.3f ms\n", 
+             gpu[R_POST_TIMER_SCENE], gpu[R_POST_TIMER_DOWNSAMPLE], 
+             gpu[R_POST_TIMER_UPSAMPLE], gpu[R_POST_TIMER_TONEMAP]);
+    }
     #endif
   }
 
+  r_destroy_post(&post);
+
   SDL_DestroyWindow(window);
   SDL_Quit();
 
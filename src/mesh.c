@@ -0,0 +1,1115 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "base_math.h"
+#include "mesh.h"
+
+#define MESH_NULL 0xFFFFFFFFu
+
+void mesh_free(Mesh *mesh)
+{
+  free(mesh->vertices);
+  free(mesh->indices);
+  *mesh = (Mesh) {0};
+}
+
+u32 mesh_index_size(u32 vertex_count)
+{
+  return vertex_count <= 0x10000 ? 2 : 4;
+}
+
+// Levels of the mesh, with lod_count 0 read as one level over every index
+static
+u32 mesh_levels(const Mesh *mesh, MeshLod *lods)
+{
+  if (mesh->lod_count == 0)
+  {
+    lods[0] = (MeshLod) {0, mesh->index_count, 0.0f};
+    return 1;
+  }
+
+  memcpy(lods, mesh->lods, sizeof (MeshLod) * mesh->lod_count);
+  return mesh->lod_count;
+}
+
+void mesh_pack_indices(const u32 *indices, u32 count, u32 index_size, void *out)
+{
+  if (index_size == 4)
+  {
+    memcpy(out, indices, sizeof (u32) * count);
+    return;
+  }
+
+  u16 *dst = out;
+  for (u32 i = 0; i < count; i++)
+  {
+    ASSERT(indices[i] <= 0xFFFF);
+    dst[i] = (u16) indices[i];
+  }
+}
+
+// @Loading =================================================================================
+
+static
+void *mesh_grow(void *data, u32 *cap, u32 count, u64 elem_size)
+{
+  if (count < *cap) return data;
+
+  *cap = *cap ? *cap * 2 : 256;
+  return realloc(data, elem_size * *cap);
+}
+
+static
+const i8 *obj_parse_floats(const i8 *p, f32 *out, u32 count)
+{
+  for (u32 i = 0; i < count; i++)
+  {
+    i8 *end;
+    out[i] = strtof(p, &end);
+    p = end;
+  }
+
+  return p;
+}
+
+// OBJ indices start at 1, negative ones count back from the last element
+static
+bool obj_resolve(i64 raw, u32 count, u32 *index)
+{
+  i64 i = raw > 0 ? raw - 1 : (i64) count + raw;
+  *index = (u32) i;
+  return raw != 0 && i >= 0 && i < count;
+}
+
+// Every face corner becomes its own vertex and mesh_dedup merges them at the
+// end, which also catches equal vertices written with different indices.
+bool mesh_parse_obj(const i8 *text, Mesh *mesh)
+{
+  *mesh = (Mesh) {0};
+
+  Vec3F *positions = NULL;
+  Vec2F *uvs = NULL;
+  Vec3F *normals = NULL;
+  u32 position_count = 0, position_cap = 0;
+  u32 uv_count = 0, uv_cap = 0;
+  u32 normal_count = 0, normal_cap = 0;
+  u32 vertex_cap = 0;
+  u32 index_cap = 0;
+  bool ok = TRUE;
+
+  const i8 *p = text;
+  while (*p && ok)
+  {
+    while (*p == ' ' || *p == '\t') p++;
+
+    if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+    {
+      positions = mesh_grow(positions, &position_cap, position_count, sizeof (Vec3F));
+      p = obj_parse_floats(p + 2, positions[position_count++].elements, 3);
+    }
+    else if (p[0] == 'v' && p[1] == 't')
+    {
+      uvs = mesh_grow(uvs, &uv_cap, uv_count, sizeof (Vec2F));
+      p = obj_parse_floats(p + 2, uvs[uv_count++].elements, 2);
+    }
+    else if (p[0] == 'v' && p[1] == 'n')
+    {
+      normals = mesh_grow(normals, &normal_cap, normal_count, sizeof (Vec3F));
+      p = obj_parse_floats(p + 2, normals[normal_count++].elements, 3);
+    }
+    else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+    {
+      p += 2;
+      u32 first = 0, prev = 0, corner = 0;
+
+      for (;;)
+      {
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p != '-' && (*p < '0' || *p > '9')) break;
+
+        // v, v/vt, v//vn or v/vt/vn
+        i8 *end;
+        i64 v = strtol(p, &end, 10);
+        i64 vt = 0, vn = 0;
+        p = end;
+        if (*p == '/')
+        {
+          p++;
+          if (*p != '/') vt = strtol(p, &end, 10), p = end;
+          if (*p == '/') p++, vn = strtol(p, &end, 10), p = end;
+        }
+
+        MeshVertex vertex = {0};
+        u32 i;
+        ok = ok && obj_resolve(v, position_count, &i);
+        if (ok) vertex.position = positions[i];
+        if (vt) ok = ok && obj_resolve(vt, uv_count, &i);
+        if (vt && ok) vertex.uv = uvs[i];
+        if (vn) ok = ok && obj_resolve(vn, normal_count, &i);
+        if (vn && ok) vertex.normal = normals[i];
+        if (!ok) break;
+
+        mesh->vertices = mesh_grow(mesh->vertices, &vertex_cap, mesh->vertex_count,
+                                   sizeof (MeshVertex));
+        u32 index = mesh->vertex_count++;
+        mesh->vertices[index] = vertex;
+
+        if (corner == 0) first = index;
+        if (corner >= 2)
+        {
+          mesh->indices = mesh_grow(mesh->indices, &index_cap, mesh->index_count + 2,
+                                    sizeof (u32));
+          mesh->indices[mesh->index_count++] = first;
+          mesh->indices[mesh->index_count++] = prev;
+          mesh->indices[mesh->index_count++] = index;
+        }
+
+        prev = index;
+        corner++;
+      }
+    }
+
+    while (*p && *p != '\n') p++;
+    if (*p) p++;
+  }
+
+  free(positions);
+  free(uvs);
+  free(normals);
+
+  if (!ok)
+  {
+    mesh_free(mesh);
+    return FALSE;
+  }
+
+  mesh_dedup(mesh);
+
+  return TRUE;
+}
+
+bool mesh_load_obj(const i8 *path, Mesh *mesh)
+{
+  *mesh = (Mesh) {0};
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return FALSE;
+
+  fseek(file, 0, SEEK_END);
+  i64 size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  i8 *text = malloc(size + 1);
+  bool ok = size >= 0 && fread(text, 1, size, file) == (u64) size;
+  fclose(file);
+
+  if (ok)
+  {
+    text[size] = '\0';
+    ok = mesh_parse_obj(text, mesh);
+  }
+
+  free(text);
+
+  return ok;
+}
+
+// Layout: magic, vertex_count, index_count, index_size, lod_count as
+// little-endian u32, then the MeshLod table, the vertices as MeshVertex and the
+// indices at index_size bytes each.
+bool mesh_save(const i8 *path, const Mesh *mesh)
+{
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) return FALSE;
+
+  MeshLod lods[MESH_MAX_LODS];
+  u32 lod_count = mesh_levels(mesh, lods);
+  u32 index_size = mesh_index_size(mesh->vertex_count);
+  u32 header[5] = {MESH_MAGIC, mesh->vertex_count, mesh->index_count, index_size, lod_count};
+  fwrite(header, sizeof (u32), 5, file);
+  fwrite(lods, sizeof (MeshLod), lod_count, file);
+  fwrite(mesh->vertices, sizeof (MeshVertex), mesh->vertex_count, file);
+
+  void *indices = malloc((u64) index_size * mesh->index_count);
+  mesh_pack_indices(mesh->indices, mesh->index_count, index_size, indices);
+  fwrite(indices, index_size, mesh->index_count, file);
+  free(indices);
+
+  fclose(file);
+
+  return TRUE;
+}
+
+bool mesh_load(const i8 *path, Mesh *mesh)
+{
+  *mesh = (Mesh) {0};
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) return FALSE;
+
+  fseek(file, 0, SEEK_END);
+  i64 file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  u32 header[5];
+  bool ok = fread(header, sizeof (u32), 5, file) == 5 &&
+            header[0] == MESH_MAGIC &&
+            header[2] % 3 == 0 &&
+            header[3] == mesh_index_size(header[1]) &&
+            header[4] >= 1 && header[4] <= MESH_MAX_LODS;
+
+  // The counts come from the file, so they have to fit in it before anything
+  // is allocated from them
+  if (ok)
+  {
+    u64 size = sizeof (u32) * 5 + sizeof (MeshLod) * header[4] +
+               sizeof (MeshVertex) * (u64) header[1] + (u64) header[3] * header[2];
+    ok = file_size >= 0 && size <= (u64) file_size;
+  }
+
+  if (ok)
+  {
+    mesh->lod_count = header[4];
+    ok = fread(mesh->lods, sizeof (MeshLod), mesh->lod_count, file) == mesh->lod_count;
+
+    for (u32 i = 0; ok && i < mesh->lod_count; i++)
+    {
+      MeshLod *lod = &mesh->lods[i];
+      ok = lod->index_count % 3 == 0 && 
+           lod->index_offset <= header[2] && 
+           lod->index_count <= header[2] - lod->index_offset;
+    }
+  }
+
+  if (ok)
+  {
+    u32 index_size = header[3];
+    mesh->vertex_count = header[1];
+    mesh->index_count = header[2];
+    mesh->vertices = malloc(sizeof (MeshVertex) * mesh->vertex_count);
+    mesh->indices = malloc(sizeof (u32) * mesh->index_count);
+
+    ok = mesh->vertices != NULL && mesh->indices != NULL;
+    ok = ok && fread(mesh->vertices, sizeof (MeshVertex), mesh->vertex_count, file) ==
+         mesh->vertex_count;
+
+    // 16-bit indices are read into the back half of the buffer and widened
+    // front to back, which never overwrites one that hasn't been read yet
+    u8 *packed = (u8 *) mesh->indices + (u64) (4 - index_size) * mesh->index_count;
+    ok = ok && fread(packed, index_size, mesh->index_count, file) == mesh->index_count;
+
+    for (u32 i = 0; ok && i < mesh->index_count; i++)
+    {
+      u32 index;
+      if (index_size == 2)
+      {
+        u16 narrow;
+        memcpy(&narrow, packed + i * 2, sizeof (u16));
+        index = narrow;
+      }
+      else index = mesh->indices[i];
+
+      mesh->indices[i] = index;
+      ok = index < mesh->vertex_count;
+    }
+  }
+
+  fclose(file);
+  if (!ok) mesh_free(mesh);
+
+  return ok;
+}
+
+// @Optimization ============================================================================
+
+static
+u32 mesh_hash_vertex(const MeshVertex *vertex)
+{
+  u32 words[sizeof (MeshVertex) / sizeof (u32)];
+  memcpy(words, vertex, sizeof (MeshVertex));
+
+  // FNV-1a over whole words
+  u32 hash = 2166136261u;
+  for (u32 i = 0; i < ARR_LEN(words); i++)
+  {
+    hash ^= words[i];
+    hash *= 16777619u;
+  }
+
+  return hash ^ (hash >> 16);
+}
+
+u32 mesh_dedup(Mesh *mesh)
+{
+  u32 table_size = 16;
+  while (table_size < mesh->vertex_count * 2) table_size *= 2;
+  u32 mask = table_size - 1;
+
+  u32 *table = malloc(sizeof (u32) * table_size);
+  u32 *remap = malloc(sizeof (u32) * mesh->vertex_count);
+  memset(table, 0xFF, sizeof (u32) * table_size);
+
+  // Unique vertices are compacted in place: slot `unique` never lies ahead of
+  // the one being read, so nothing unread is overwritten
+  MeshVertex *vertices = mesh->vertices;
+  u32 unique = 0;
+  for (u32 i = 0; i < mesh->vertex_count; i++)
+  {
+    u32 slot = mesh_hash_vertex(&vertices[i]) & mask;
+    while (table[slot] != MESH_NULL &&
+           memcmp(&vertices[table[slot]], &vertices[i], sizeof (MeshVertex)) != 0)
+    {
+      slot = (slot + 1) & mask;
+    }
+
+    if (table[slot] == MESH_NULL)
+    {
+      table[slot] = unique;
+      vertices[unique++] = vertices[i];
+    }
+
+    remap[i] = table[slot];
+  }
+
+  for (u32 i = 0; i < mesh->index_count; i++)
+  {
+    mesh->indices[i] = remap[mesh->indices[i]];
+  }
+
+  mesh->vertex_count = unique;
+  if (unique) mesh->vertices = realloc(vertices, sizeof (MeshVertex) * unique);
+
+  free(table);
+  free(remap);
+
+  return unique;
+}
+
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 32
+
+// Vertices of the last triangle get a flat score so strips aren't favoured
+// over fans. Past that it decays with cache position, and vertices with few
+// triangles left are boosted so they get finished off and leave the cache.
+typedef struct ForsythScores ForsythScores;
+struct ForsythScores
+{
+  f32 cache[FORSYTH_CACHE_SIZE];
+  f32 valence[FORSYTH_MAX_VALENCE];
+};
+
+static
+ForsythScores forsyth_scores(void)
+{
+  ForsythScores scores;
+
+  for (u32 i = 0; i < FORSYTH_CACHE_SIZE; i++)
+  {
+    f32 t = 1.0f - (f32) ((i32) i - 3) / (FORSYTH_CACHE_SIZE - 3);
+    scores.cache[i] = i < 3 ? 0.75f : powf(t, 1.5f);
+  }
+
+  for (u32 i = 0; i < FORSYTH_MAX_VALENCE; i++)
+  {
+    scores.valence[i] = i ? 2.0f / sqrtf((f32) i) : 0.0f;
+  }
+
+  return scores;
+}
+
+static inline
+f32 forsyth_vertex_score(const ForsythScores *scores, i32 cache_pos, u32 remaining)
+{
+  if (remaining == 0) return -1.0f;
+
+  f32 score = cache_pos >= 0 ? scores->cache[cache_pos] : 0.0f;
+  score += remaining < FORSYTH_MAX_VALENCE ? scores->valence[remaining]
+                                           : 2.0f / sqrtf((f32) remaining);
+  return score;
+}
+
+void mesh_optimize_vertex_cache(u32 *indices, u32 index_count, u32 vertex_count)
+{
+  u32 tri_count = index_count / 3;
+  if (tri_count == 0) return;
+
+  ForsythScores scores = forsyth_scores();
+
+  // Triangles around each vertex; the first `remaining[v]` entries of a
+  // vertex's list are the ones not emitted yet
+  u32 *offsets = calloc(vertex_count + 1, sizeof (u32));
+  u32 *remaining = calloc(vertex_count, sizeof (u32));
+  u32 *adjacency = malloc(sizeof (u32) * tri_count * 3);
+
+  for (u32 i = 0; i < tri_count * 3; i++) offsets[indices[i] + 1]++;
+  for (u32 v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+  for (u32 i = 0; i < tri_count * 3; i++)
+  {
+    u32 v = indices[i];
+    adjacency[offsets[v] + remaining[v]++] = i / 3;
+  }
+
+  i32 *cache_pos = malloc(sizeof (i32) * vertex_count);
+  f32 *vertex_score = malloc(sizeof (f32) * vertex_count);
+  f32 *tri_score = malloc(sizeof (f32) * tri_count);
+  u8 *emitted = calloc(tri_count, sizeof (u8));
+  u32 *out = malloc(sizeof (u32) * tri_count * 3);
+
+  for (u32 v = 0; v < vertex_count; v++)
+  {
+    cache_pos[v] = -1;
+    vertex_score[v] = forsyth_vertex_score(&scores, -1, remaining[v]);
+  }
+
+  u32 best = 0;
+  for (u32 t = 0; t < tri_count; t++)
+  {
+    const u32 *tri = &indices[t * 3];
+    tri_score[t] = vertex_score[tri[0]] + vertex_score[tri[1]] + vertex_score[tri[2]];
+    if (tri_score[t] > tri_score[best]) best = t;
+  }
+
+  // Three slots past the cache size hold the vertices pushed out this step
+  u32 cache[FORSYTH_CACHE_SIZE + 3];
+  u32 cache_count = 0;
+  u32 cursor = 0;
+
+  for (u32 n = 0; n < tri_count; n++)
+  {
+    // Dead end: nothing in the cache has triangles left, so restart from the
+    // next triangle in input order
+    if (best == MESH_NULL)
+    {
+      while (emitted[cursor]) cursor++;
+      best = cursor;
+    }
+
+    const u32 *tri = &indices[best * 3];
+    memcpy(&out[n * 3], tri, sizeof (u32) * 3);
+    emitted[best] = TRUE;
+
+    u32 next[FORSYTH_CACHE_SIZE + 3];
+    u32 next_count = 0;
+
+    for (u32 k = 0; k < 3; k++)
+    {
+      u32 v = tri[k];
+      u32 *list = &adjacency[offsets[v]];
+      u32 last = --remaining[v];
+      for (u32 i = 0; i <= last; i++)
+      {
+        if (list[i] == best)
+        {
+          list[i] = list[last];
+          list[last] = best;
+          break;
+        }
+      }
+
+      bool seen = FALSE;
+      for (u32 i = 0; i < next_count; i++) seen |= next[i] == v;
+      if (!seen) next[next_count++] = v;
+    }
+
+    for (u32 i = 0; i < cache_count; i++)
+    {
+      u32 v = cache[i];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) next[next_count++] = v;
+    }
+
+    for (u32 i = 0; i < next_count; i++)
+    {
+      u32 v = next[i];
+      cache_pos[v] = i < FORSYTH_CACHE_SIZE ? (i32) i : -1;
+      vertex_score[v] = forsyth_vertex_score(&scores, cache_pos[v], remaining[v]);
+    }
+
+    // Only triangles touching changed vertices change score, and the best one
+    // is picked among them
+    best = MESH_NULL;
+    f32 best_score = -1.0f;
+    for (u32 i = 0; i < next_count; i++)
+    {
+      u32 v = next[i];
+      const u32 *list = &adjacency[offsets[v]];
+      for (u32 j = 0; j < remaining[v]; j++)
+      {
+        u32 t = list[j];
+        const u32 *other = &indices[t * 3];
+        tri_score[t] = vertex_score[other[0]] + vertex_score[other[1]] + vertex_score[other[2]];
+        if (tri_score[t] > best_score)
+        {
+          best_score = tri_score[t];
+          best = t;
+        }
+      }
+    }
+
+    cache_count = MIN(next_count, FORSYTH_CACHE_SIZE);
+    memcpy(cache, next, sizeof (u32) * cache_count);
+  }
+
+  memcpy(indices, out, sizeof (u32) * tri_count * 3);
+
+  free(offsets);
+  free(remaining);
+  free(adjacency);
+  free(cache_pos);
+  free(vertex_score);
+  free(tri_score);
+  free(emitted);
+  free(out);
+}
+
+void mesh_optimize_vertex_fetch(Mesh *mesh)
+{
+  u32 *remap = malloc(sizeof (u32) * mesh->vertex_count);
+  MeshVertex *vertices = malloc(sizeof (MeshVertex) * mesh->vertex_count);
+  memset(remap, 0xFF, sizeof (u32) * mesh->vertex_count);
+
+  u32 count = 0;
+  for (u32 i = 0; i < mesh->index_count; i++)
+  {
+    u32 v = mesh->indices[i];
+    if (remap[v] == MESH_NULL)
+    {
+      remap[v] = count;
+      vertices[count++] = mesh->vertices[v];
+    }
+
+    mesh->indices[i] = remap[v];
+  }
+
+  free(mesh->vertices);
+  free(remap);
+  mesh->vertices = vertices;
+  mesh->vertex_count = count;
+}
+
+void mesh_optimize(Mesh *mesh)
+{
+  mesh_dedup(mesh);
+
+  MeshLod lods[MESH_MAX_LODS];
+  u32 lod_count = mesh_levels(mesh, lods);
+  for (u32 i = 0; i < lod_count; i++)
+  {
+    u32 *indices = mesh->indices + lods[i].index_offset;
+    mesh_optimize_vertex_cache(indices, lods[i].index_count, mesh->vertex_count);
+  }
+
+  mesh_optimize_vertex_fetch(mesh);
+}
+
+// A vertex is cached while fewer than `cache_size` misses happened since it
+// was last transformed
+f32 mesh_acmr(const u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size)
+{
+  if (index_count < 3) return 0.0f;
+
+  u32 *stamp = calloc(vertex_count, sizeof (u32));
+  u32 time = cache_size + 1;
+  u32 misses = 0;
+
+  for (u32 i = 0; i < index_count; i++)
+  {
+    u32 v = indices[i];
+    if (time - stamp[v] > cache_size)
+    {
+      stamp[v] = time++;
+      misses++;
+    }
+  }
+
+  free(stamp);
+
+  return (f32) misses / (index_count / 3);
+}
+
+// @LOD =====================================================================================
+
+// Vertices are points in position, normal, UV space. The weights set how much
+// a change of normal or UV costs against moving across the unit cube the
+// positions are scaled into.
+#define QUADRIC_DIM 8
+#define SIMPLIFY_NORMAL_WEIGHT 0.5f
+#define SIMPLIFY_UV_WEIGHT 1.0f
+#define SIMPLIFY_MAX_NEIGHBOURS 64
+
+// Sum of squared distances to the triangles' planes in QUADRIC_DIM space,
+// weighted by area: Q(p) = p'Ap + 2b'p + c. Dividing by `weight` gives a
+// squared distance again. In f64 because Q(p) is a small difference of large
+// terms, and f32 leaves flat areas with a visible error.
+typedef struct Quadric Quadric;
+struct Quadric
+{
+  f64 a[QUADRIC_DIM * (QUADRIC_DIM + 1) / 2]; // Upper triangle, row by row
+  f64 b[QUADRIC_DIM];
+  f64 c;
+  f64 weight;
+};
+
+typedef struct Collapse Collapse;
+struct Collapse
+{
+  u32 from;
+  u32 to;
+  f32 cost; // Squared error in the scaled space
+};
+
+static
+f64 quadric_dot(const f64 *a, const f64 *b)
+{
+  f64 result = 0.0;
+  for (u32 i = 0; i < QUADRIC_DIM; i++) result += a[i] * b[i];
+  return result;
+}
+
+// Garland and Heckbert 1998: with e1, e2 an orthonormal basis of the triangle's
+// plane through p0, A = I - e1e1' - e2e2', b = (p0.e1)e1 + (p0.e2)e2 - p0
+// and c = p0.p0 - (p0.e1)^2 - (p0.e2)^2.
+static
+bool quadric_from_triangle(Quadric *q, const f64 *p0, const f64 *p1, const f64 *p2, f64 weight)
+{
+  f64 e1[QUADRIC_DIM];
+  f64 e2[QUADRIC_DIM];
+  for (u32 i = 0; i < QUADRIC_DIM; i++)
+  {
+    e1[i] = p1[i] - p0[i];
+    e2[i] = p2[i] - p0[i];
+  }
+
+  f64 len1 = sqrt(quadric_dot(e1, e1));
+  if (len1 < 1e-12) return FALSE;
+  for (u32 i = 0; i < QUADRIC_DIM; i++) e1[i] /= len1;
+
+  f64 along = quadric_dot(e1, e2);
+  for (u32 i = 0; i < QUADRIC_DIM; i++) e2[i] -= along * e1[i];
+  f64 len2 = sqrt(quadric_dot(e2, e2));
+  if (len2 < 1e-12) return FALSE;
+  for (u32 i = 0; i < QUADRIC_DIM; i++) e2[i] /= len2;
+
+  f64 d1 = quadric_dot(p0, e1);
+  f64 d2 = quadric_dot(p0, e2);
+
+  u32 k = 0;
+  for (u32 i = 0; i < QUADRIC_DIM; i++)
+  {
+    for (u32 j = i; j < QUADRIC_DIM; j++)
+    {
+      q->a[k++] = weight * ((i == j) - e1[i] * e1[j] - e2[i] * e2[j]);
+    }
+
+    q->b[i] = weight * (d1 * e1[i] + d2 * e2[i] - p0[i]);
+  }
+
+  q->c = weight * (quadric_dot(p0, p0) - d1 * d1 - d2 * d2);
+  q->weight = weight;
+
+  return TRUE;
+}
+
+static
+void quadric_add(Quadric *q, const Quadric *other)
+{
+  for (u32 i = 0; i < ARR_LEN(q->a); i++) q->a[i] += other->a[i];
+  for (u32 i = 0; i < QUADRIC_DIM; i++) q->b[i] += other->b[i];
+  q->c += other->c;
+  q->weight += other->weight;
+}
+
+static
+f64 quadric_eval(const Quadric *q, const f64 *p)
+{
+  f64 result = q->c;
+
+  u32 k = 0;
+  for (u32 i = 0; i < QUADRIC_DIM; i++)
+  {
+    result += 2.0 * q->b[i] * p[i] + q->a[k++] * p[i] * p[i];
+    for (u32 j = i + 1; j < QUADRIC_DIM; j++)
+    {
+      result += 2.0 * q->a[k++] * p[i] * p[j];
+    }
+  }
+
+  return result;
+}
+
+// Error of moving `from` onto `to`, with both quadrics merged
+static
+f32 simplify_cost(const Quadric *quadrics, const f64 *points, u32 from, u32 to)
+{
+  const f64 *p = &points[to * QUADRIC_DIM];
+  f64 weight = quadrics[from].weight + quadrics[to].weight;
+  if (weight <= 0.0) return 0.0f;
+
+  f64 cost = quadric_eval(&quadrics[from], p) + quadric_eval(&quadrics[to], p);
+  return (f32) (MAX(cost, 0.0) / weight);
+}
+
+// Locks both ends of every directed edge whose reverse is missing: borders of
+// open meshes and seams where vertices are split by normal or UV.
+static
+void simplify_lock_open_edges(const u32 *indices, u32 index_count, u8 *locked)
+{
+  u32 table_size = 16;
+  while (table_size < index_count * 2) table_size *= 2;
+  u32 mask = table_size - 1;
+
+  u64 *table = malloc(sizeof (u64) * table_size);
+  memset(table, 0xFF, sizeof (u64) * table_size);
+
+  for (u32 pass = 0; pass < 2; pass++)
+  {
+    for (u32 i = 0; i < index_count; i++)
+    {
+      u32 a = indices[i];
+      u32 b = indices[i - i % 3 + (i + 1) % 3];
+
+      // Insert a->b on the first pass, look up b->a on the second
+      u64 key = pass == 0 ? (u64) a << 32 | b : (u64) b << 32 | a;
+      u32 slot = (u32) ((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+      while (table[slot] != (u64) -1 && table[slot] != key) slot = (slot + 1) & mask;
+
+      if (pass == 0) table[slot] = key;
+      else if (table[slot] != key) locked[a] = locked[b] = TRUE;
+    }
+  }
+
+  free(table);
+}
+
+static
+Vec3F simplify_normal(Vec3F a, Vec3F b, Vec3F c)
+{
+  return cross_3f(sub_3f(b, a), sub_3f(c, a));
+}
+
+// Rejects collapses that flip a triangle or that would join two surfaces,
+// i.e. when the ends share more neighbours than the two opposite vertices.
+static
+bool simplify_collapse_valid(const Mesh *mesh, const u32 *indices, const u32 *offsets, 
+                             const u32 *adjacency, u32 from, u32 to)
+{
+  const MeshVertex *v = mesh->vertices;
+  u32 neighbours[SIMPLIFY_MAX_NEIGHBOURS];
+  u32 neighbour_count = 0;
+
+  for (u32 i = offsets[from]; i < offsets[from + 1]; i++)
+  {
+    const u32 *tri = &indices[adjacency[i] * 3];
+    if (tri[0] == to || tri[1] == to || tri[2] == to) continue;
+
+    Vec3F p[3];
+    for (u32 k = 0; k < 3; k++) p[k] = v[tri[k]].position;
+    Vec3F before = simplify_normal(p[0], p[1], p[2]);
+    for (u32 k = 0; k < 3; k++) if (tri[k] == from) p[k] = v[to].position;
+    Vec3F after = simplify_normal(p[0], p[1], p[2]);
+    if (dot_3f(before, after) <= 0.0f) return FALSE;
+
+    for (u32 k = 0; k < 3; k++)
+    {
+      if (tri[k] == from) continue;
+      if (neighbour_count == SIMPLIFY_MAX_NEIGHBOURS) return FALSE;
+      neighbours[neighbour_count++] = tri[k];
+    }
+  }
+
+  u32 shared[2 * SIMPLIFY_MAX_NEIGHBOURS];
+  u32 shared_count = 0;
+  for (u32 i = offsets[to]; i < offsets[to + 1]; i++)
+  {
+    const u32 *tri = &indices[adjacency[i] * 3];
+    for (u32 k = 0; k < 3; k++)
+    {
+      u32 n = tri[k];
+      if (n == to || n == from) continue;
+
+      bool is_neighbour = FALSE;
+      for (u32 j = 0; j < neighbour_count; j++) is_neighbour |= neighbours[j] == n;
+      if (!is_neighbour) continue;
+
+      bool seen = FALSE;
+      for (u32 j = 0; j < shared_count; j++) seen |= shared[j] == n;
+      if (!seen) shared[shared_count++] = n;
+    }
+  }
+
+  return shared_count <= 2;
+}
+
+static
+i32 compare_collapse(const void *a, const void *b)
+{
+  f32 ca = ((const Collapse *) a)->cost;
+  f32 cb = ((const Collapse *) b)->cost;
+  return (ca > cb) - (ca < cb);
+}
+
+// Works in passes: every edge gets its cheaper direction, then collapses are
+// applied cheapest first. A collapse freezes the neighbourhood of `from` for
+// the rest of the pass so the checks above never see stale triangles.
+u32 mesh_simplify(const Mesh *mesh, const u32 *indices, u32 index_count, 
+                  u32 target_index_count, f32 max_error, u32 *out, f32 *error)
+{
+  u32 vertex_count = mesh->vertex_count;
+  memcpy(out, indices, sizeof (u32) * index_count);
+  *error = 0.0f;
+  if (vertex_count == 0 || index_count <= target_index_count) return index_count;
+
+  // Positions go into the unit cube so errors don't depend on the model's size
+  AABB3F box = {mesh->vertices[0].position, mesh->vertices[0].position};
+  for (u32 i = 1; i < vertex_count; i++)
+  {
+    Vec3F p = mesh->vertices[i].position;
+    box.min = v3f(fminf(box.min.x, p.x), fminf(box.min.y, p.y), fminf(box.min.z, p.z));
+    box.max = v3f(fmaxf(box.max.x, p.x), fmaxf(box.max.y, p.y), fmaxf(box.max.z, p.z));
+  }
+
+  Vec3F size = sub_3f(box.max, box.min);
+  f32 extent = fmaxf(fmaxf(size.x, size.y), size.z);
+  if (extent <= 0.0f) extent = 1.0f;
+
+  f64 *points = malloc(sizeof (f64) * QUADRIC_DIM * vertex_count);
+  for (u32 i = 0; i < vertex_count; i++)
+  {
+    const MeshVertex *v = &mesh->vertices[i];
+    Vec3F p = scale_3f(sub_3f(v->position, box.min), 1.0f / extent);
+    f64 *point = &points[i * QUADRIC_DIM];
+    point[0] = p.x;
+    point[1] = p.y;
+    point[2] = p.z;
+    point[3] = v->normal.x * SIMPLIFY_NORMAL_WEIGHT;
+    point[4] = v->normal.y * SIMPLIFY_NORMAL_WEIGHT;
+    point[5] = v->normal.z * SIMPLIFY_NORMAL_WEIGHT;
+    point[6] = v->uv.x * SIMPLIFY_UV_WEIGHT;
+    point[7] = v->uv.y * SIMPLIFY_UV_WEIGHT;
+  }
+
+  Quadric *quadrics = calloc(vertex_count, sizeof (Quadric));
+  for (u32 t = 0; t < index_count / 3; t++)
+  {
+    const u32 *tri = &out[t * 3];
+    const f64 *p[3] = {&points[tri[0] * QUADRIC_DIM], 
+                       &points[tri[1] * QUADRIC_DIM], 
+                       &points[tri[2] * QUADRIC_DIM]};
+    Vec3F n = simplify_normal(v3f((f32) p[0][0], (f32) p[0][1], (f32) p[0][2]), 
+                              v3f((f32) p[1][0], (f32) p[1][1], (f32) p[1][2]), 
+                              v3f((f32) p[2][0], (f32) p[2][1], (f32) p[2][2]));
+
+    Quadric q;
+    if (!quadric_from_triangle(&q, p[0], p[1], p[2], 0.5f * magnitude_3f(n))) continue;
+    for (u32 k = 0; k < 3; k++) quadric_add(&quadrics[tri[k]], &q);
+  }
+
+  u8 *locked = calloc(vertex_count, sizeof (u8));
+  simplify_lock_open_edges(out, index_count, locked);
+
+  u32 *offsets = malloc(sizeof (u32) * (vertex_count + 1));
+  u32 *adjacency = malloc(sizeof (u32) * index_count);
+  u32 *remap = malloc(sizeof (u32) * vertex_count);
+  u8 *frozen = malloc(vertex_count);
+  Collapse *collapses = malloc(sizeof (Collapse) * index_count);
+
+  f32 max_cost = max_error * max_error;
+  f32 result_cost = 0.0f;
+
+  while (index_count > target_index_count)
+  {
+    u32 tri_count = index_count / 3;
+
+    memset(offsets, 0, sizeof (u32) * (vertex_count + 1));
+    for (u32 i = 0; i < index_count; i++) offsets[out[i] + 1]++;
+    for (u32 i = 0; i < vertex_count; i++) offsets[i + 1] += offsets[i];
+    for (u32 i = 0; i < index_count; i++) adjacency[offsets[out[i]]++] = i / 3;
+    for (u32 i = vertex_count; i > 0; i--) offsets[i] = offsets[i - 1];
+    offsets[0] = 0;
+
+    // Interior edges show up once from each side, a < b keeps one of them
+    u32 collapse_count = 0;
+    for (u32 i = 0; i < index_count; i++)
+    {
+      u32 a = out[i];
+      u32 b = out[i - i % 3 + (i + 1) % 3];
+      if (a >= b || (locked[a] && locked[b])) continue;
+
+      f32 ab = locked[a] ? INFINITY : simplify_cost(quadrics, points, a, b);
+      f32 ba = locked[b] ? INFINITY : simplify_cost(quadrics, points, b, a);
+      collapses[collapse_count++] = ab <= ba ? (Collapse) {a, b, ab} : (Collapse) {b, a, ba};
+    }
+
+    if (collapse_count == 0) break;
+    qsort(collapses, collapse_count, sizeof (Collapse), compare_collapse);
+
+    // Roughly the collapses still needed, with some slack; anything pricier
+    // waits for the next pass, where cheaper ones may have appeared, unless
+    // nothing cheaper was valid
+    u32 needed = (tri_count - target_index_count / 3) / 2;
+    f32 pass_cost = collapses[MIN(needed, collapse_count - 1)].cost * 1.5f;
+
+    memset(frozen, 0, vertex_count);
+    for (u32 i = 0; i < vertex_count; i++) remap[i] = i;
+
+    u32 removed = 0;
+    for (u32 i = 0; i < collapse_count; i++)
+    {
+      Collapse c = collapses[i];
+      if (c.cost > max_cost || (c.cost > pass_cost && removed > 0)) break;
+      if (frozen[c.from] || frozen[c.to]) continue;
+      if (!simplify_collapse_valid(mesh, out, offsets, adjacency, c.from, c.to)) continue;
+
+      remap[c.from] = c.to;
+      quadric_add(&quadrics[c.to], &quadrics[c.from]);
+      result_cost = MAX(result_cost, c.cost);
+
+      for (u32 j = offsets[c.from]; j < offsets[c.from + 1]; j++)
+      {
+        const u32 *tri = &out[adjacency[j] * 3];
+        if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) removed++;
+        for (u32 k = 0; k < 3; k++) frozen[tri[k]] = TRUE;
+      }
+
+      if ((tri_count - removed) * 3 <= target_index_count) break;
+    }
+
+    if (removed == 0) break;
+
+    u32 write = 0;
+    for (u32 t = 0; t < tri_count; t++)
+    {
+      u32 a = remap[out[t * 3 + 0]];
+      u32 b = remap[out[t * 3 + 1]];
+      u32 c = remap[out[t * 3 + 2]];
+      if (a == b || b == c || a == c) continue;
+
+      out[write++] = a;
+      out[write++] = b;
+      out[write++] = c;
+    }
+
+    index_count = write;
+  }
+
+  *error = sqrtf(result_cost) * extent;
+
+  free(points);
+  free(quadrics);
+  free(locked);
+  free(offsets);
+  free(adjacency);
+  free(remap);
+  free(frozen);
+  free(collapses);
+
+  return index_count;
+}
+
+u32 mesh_build_lods(Mesh *mesh, u32 lod_count, f32 ratio, f32 max_error)
+{
+  ASSERT(lod_count <= MESH_MAX_LODS);
+  mesh->lod_count = mesh_levels(mesh, mesh->lods);
+
+  while (mesh->lod_count < lod_count)
+  {
+    MeshLod prev = mesh->lods[mesh->lod_count - 1];
+    u32 target = (u32) (prev.index_count / 3 * ratio) * 3;
+
+    u32 *indices = malloc(sizeof (u32) * prev.index_count);
+    f32 error;
+    u32 count = mesh_simplify(mesh, mesh->indices + prev.index_offset, prev.index_count, 
+                              target, max_error, indices, &error);
+
+    // Not worth a level of its own
+    if (count == 0 || count > prev.index_count * 0.95f)
+    {
+      free(indices);
+      break;
+    }
+
+    mesh_optimize_vertex_cache(indices, count, mesh->vertex_count);
+
+    mesh->indices = realloc(mesh->indices, sizeof (u32) * (mesh->index_count + count));
+    memcpy(mesh->indices + mesh->index_count, indices, sizeof (u32) * count);
+    mesh->lods[mesh->lod_count++] = (MeshLod) {mesh->index_count, count, prev.error + error};
+    mesh->index_count += count;
+
+    free(indices);
+  }
+
+  mesh_optimize_vertex_fetch(mesh);
+
+  return mesh->lod_count;
+}
+
+SphereF mesh_bounding_sphere(const Mesh *mesh)
+{
+  if (mesh->vertex_count == 0) return (SphereF) {0};
+
+  AABB3F box = {mesh->vertices[0].position, mesh->vertices[0].position};
+  for (u32 i = 1; i < mesh->vertex_count; i++)
+  {
+    Vec3F p = mesh->vertices[i].position;
+    box.min = v3f(fminf(box.min.x, p.x), fminf(box.min.y, p.y), fminf(box.min.z, p.z));
+    box.max = v3f(fmaxf(box.max.x, p.x), fmaxf(box.max.y, p.y), fmaxf(box.max.z, p.z));
+  }
+
+  SphereF sphere = {scale_3f(add_3f(box.min, box.max), 0.5f), 0.0f};
+  f32 radius_squared = 0.0f;
+  for (u32 i = 0; i < mesh->vertex_count; i++)
+  {
+    radius_squared = fmaxf(radius_squared, 
+                           distance_squared_3f(sphere.center, mesh->vertices[i].position));
+  }
+  sphere.radius = sqrtf(radius_squared);
+
+  return sphere;
+}
+
+// A length at view distance d covers length * P[1][1] / d of the NDC range,
+// which spans 2 units over the viewport's height
+f32 mesh_lod_scale(Mat4x4F projection, f32 viewport_height)
+{
+  return projection.elements[1][1] * viewport_height * 0.5f;
+}
+
+u32 mesh_select_lod(const Mesh *mesh, SphereF bounds, Mat4x4F model, Mat4x4F view, 
+                    f32 lod_scale, f32 max_pixels)
+{
+  Vec4F center = v4f(bounds.center.x, bounds.center.y, bounds.center.z, 1.0f);
+  center = transform_4f(transform_4f(center, model), view);
+
+  // Largest axis of the upper 3x3, to scale model space lengths
+  f32 scale_squared = 0.0f;
+  for (u32 c = 0; c < 3; c++)
+  {
+    Vec3F axis = v3f(model.elements[0][c], model.elements[1][c], model.elements[2][c]);
+    scale_squared = fmaxf(scale_squared, magnitude_squared_3f(axis));
+  }
+  f32 scale = sqrtf(scale_squared);
+
+  // The view looks down -z. Inside the sphere the distance is negative and
+  // only an exact level qualifies.
+  f32 distance = -center.z - bounds.radius * scale;
+  f32 max_error = max_pixels * distance / (scale * lod_scale);
+
+  u32 lod = 0;
+  for (u32 i = 1; i < mesh->lod_count; i++)
+  {
+    if (mesh->lods[i].error <= max_error) lod = i;
+  }
+
+  return lod;
+}
+
+void mesh_select_lods(const Mesh *mesh, SphereF bounds, const Mat4x4F *models, u32 count, 
+                      Mat4x4F view, f32 lod_scale, f32 max_pixels, u8 *lods)
+{
+  for (u32 i = 0; i < count; i++)
+  {
+    lods[i] = (u8) mesh_select_lod(mesh, bounds, models[i], view, lod_scale, max_pixels);
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "base_common.h"
+#include "base_math.h"
+
+#define MESH_MAGIC 0x4853454D // "MESH"
+#define MESH_MAX_LODS 8
+
+typedef struct MeshVertex MeshVertex;
+struct MeshVertex
+{
+  Vec3F position;
+  Vec3F normal;
+  Vec2F uv;
+};
+
+// A range of the index buffer. `error` is how far the level may deviate from
+// the full mesh, in model units.
+typedef struct MeshLod MeshLod;
+struct MeshLod
+{
+  u32 index_offset;
+  u32 index_count;
+  f32 error;
+};
+
+// Indexed triangle list. Indices are always u32 on the CPU and narrowed to
+// mesh_index_size when uploaded or saved. All levels of detail share the
+// vertices and are stored back to back in `indices`, finest first. A mesh
+// with lod_count 0 is a single level covering every index.
+typedef struct Mesh Mesh;
+struct Mesh
+{
+  MeshVertex *vertices;
+  u32 vertex_count;
+  u32 *indices;
+  u32 index_count;
+  MeshLod lods[MESH_MAX_LODS];
+  u32 lod_count;
+};
+
+void mesh_free(Mesh *mesh);
+
+// 2 when every vertex fits in a u16 index, otherwise 4
+u32 mesh_index_size(u32 vertex_count);
+void mesh_pack_indices(const u32 *indices, u32 count, u32 index_size, void *out);
+
+// @Loading =================================================================================
+
+// Reads v, vt, vn and f; polygons are split into fans and negative indices are
+// relative. Everything else (groups, materials, smoothing) is ignored. The
+// result is deduplicated but not optimized. `text` is NUL-terminated.
+bool mesh_parse_obj(const i8 *text, Mesh *mesh);
+bool mesh_load_obj(const i8 *path, Mesh *mesh);
+
+bool mesh_save(const i8 *path, const Mesh *mesh);
+bool mesh_load(const i8 *path, Mesh *mesh);
+
+// @Optimization ============================================================================
+
+// Merges bitwise identical vertices and returns the new vertex count.
+u32 mesh_dedup(Mesh *mesh);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth's linear
+// speed algorithm, tuned for a 32 entry LRU). Vertices are left alone.
+void mesh_optimize_vertex_cache(u32 *indices, u32 index_count, u32 vertex_count);
+
+// Reorders vertices by first use so the vertex fetch walks memory forward.
+// Unreferenced vertices are dropped.
+void mesh_optimize_vertex_fetch(Mesh *mesh);
+
+// Dedup, then vertex cache per level, then vertex fetch.
+void mesh_optimize(Mesh *mesh);
+
+// Average cache miss ratio: transformed vertices per triangle for a FIFO cache
+// of `cache_size` entries. 3 is the worst case, around 0.6 is good for
+// regular meshes.
+f32 mesh_acmr(const u32 *indices, u32 index_count, u32 vertex_count, u32 cache_size);
+
+// @LOD =====================================================================================
+
+// Quadric error simplification (Garland and Heckbert, with normals and UVs in
+// the quadric). Edges collapse onto one of their vertices, so the result
+// indexes the same vertex buffer. Vertices on open edges, which include UV and
+// normal seams, never move. `max_error` is relative to the mesh extent;
+// stops at `target_index_count` or when no collapse fits under it. Writes the
+// error reached in model units to `error` and returns the new index count.
+u32 mesh_simplify(const Mesh *mesh, const u32 *indices, u32 index_count, 
+                  u32 target_index_count, f32 max_error, u32 *out, f32 *error);
+
+// Appends coarser levels to the index buffer until there are `lod_count`,
+// each simplified from the previous one to `ratio` of its triangles. Stops
+// early when a level barely shrinks. Every level is cache optimized and the
+// vertices are reordered for fetch. Returns the level count.
+u32 mesh_build_lods(Mesh *mesh, u32 lod_count, f32 ratio, f32 max_error);
+
+// Center of the bounds and the farthest vertex from it
+SphereF mesh_bounding_sphere(const Mesh *mesh);
+
+// Pixels covered by one unit of length at view distance 1
+f32 mesh_lod_scale(Mat4x4F projection, f32 viewport_height);
+
+// Picks the coarsest level whose error projects to at most `max_pixels`,
+// measured at the point of the bounding sphere nearest the camera. `bounds`
+// is in model space and the model matrix's largest axis scales the error.
+u32 mesh_select_lod(const Mesh *mesh, SphereF bounds, Mat4x4F model, Mat4x4F view, 
+                    f32 lod_scale, f32 max_pixels);
+void mesh_select_lods(const Mesh *mesh, SphereF bounds, const Mat4x4F *models, u32 count, 
+                      Mat4x4F view, f32 lod_scale, f32 max_pixels, u8 *lods);
@@ -0,0 +1,65 @@
+#include <math.h>
+
+#include "base_common.h"
+#include "post.h"
+
+u32 post_bloom_levels(i32 width, i32 height)
+{
+  u32 levels = 0;
+  while (levels < POST_MAX_BLOOM_LEVELS &&
+         MIN(width, height) >> (levels + 1) >= POST_MIN_BLOOM_SIZE)
+  {
+    levels++;
+  }
+
+  return levels;
+}
+
+u32 post_estimate(i32 width, i32 height, u32 levels, PostPassCost *passes)
+{
+  const u64 hdr = 8;
+  const u64 ldr = 4;
+  u32 count = 0;
+
+  for (u32 i = 0; i < levels; i++)
+  {
+    u64 src = (u64) MAX(width >> i, 1) * MAX(height >> i, 1);
+    i32 w = MAX(width >> (i + 1), 1);
+    i32 h = MAX(height >> (i + 1), 1);
+    passes[count++] = (PostPassCost) {"downsample", i, w, h, src * hdr, (u64) w * h * hdr};
+  }
+
+  // Each level blends onto the one above it, from the smallest up to level 0
+  for (u32 i = levels; i > 1; i--)
+  {
+    u32 level = i - 2;
+    u64 src = (u64) MAX(width >> i, 1) * MAX(height >> i, 1);
+    i32 w = MAX(width >> (level + 1), 1);
+    i32 h = MAX(height >> (level + 1), 1);
+    u64 dst = (u64) w * h * hdr;
+    passes[count++] = (PostPassCost) {"upsample", level, w, h, src * hdr + dst, dst};
+  }
+
+  u64 pixels = (u64) width * height;
+  u64 bloom = levels ? (u64) MAX(width >> 1, 1) * MAX(height >> 1, 1) * hdr : 0;
+  passes[count++] = (PostPassCost)
+  {
+    "tonemap", 0, width, height, pixels * hdr + bloom, pixels * ldr
+  };
+
+  return count;
+}
+
+f32 post_tonemap_aces(f32 x)
+{
+  f32 y = (x * (2.51f * x + 0.03f)) / (x * (2.43f * x + 0.59f) + 0.14f);
+
+  return MIN(MAX(y, 0.0f), 1.0f);
+}
+
+f32 post_linear_to_srgb(f32 x)
+{
+  if (x < 0.0031308f) return 12.92f * x;
+
+  return 1.055f * powf(x, 1.0f / 2.4f) - 0.055f;
+}
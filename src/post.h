@@ -0,0 +1,32 @@
+#pragma once
+
+#include "base_common.h"
+
+#define POST_MAX_BLOOM_LEVELS 8
+#define POST_MIN_BLOOM_SIZE 8
+
+// Bloom lives in one RGBA16F texture, level i being the scene size >> (i + 1).
+// Levels stop before either side drops under POST_MIN_BLOOM_SIZE.
+u32 post_bloom_levels(i32 width, i32 height);
+
+// Memory traffic of one post pass, counting every texel read once (the
+// texture cache takes care of overlapping taps) and blending as a read
+typedef struct PostPassCost PostPassCost;
+struct PostPassCost
+{
+  const i8 *name;
+  u32 level;
+  i32 width;
+  i32 height;
+  u64 read_bytes;
+  u64 write_bytes;
+};
+
+// The chain r_end_post runs: a downsample per level, an upsample per level
+// but the last, and the tonemap. Returns the pass count, MAX(2 * levels, 1).
+u32 post_estimate(i32 width, i32 height, u32 levels, PostPassCost *passes);
+
+// The curves the tonemap shader applies, per channel: the ACES fit by
+// Krzysztof Narkowicz, then the sRGB transfer function
+f32 post_tonemap_aces(f32 x);
+f32 post_linear_to_srgb(f32 x);
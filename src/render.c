@@ -8,13 +8,45 @@
 #include "base_math.h"
 #include "render.h"
 
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
 typedef R_Shader Shader;
 typedef R_Object Object;
 typedef R_Texture2D Texture2D;
-typedef R_VertexLayout VertexLayout;
+typedef R_VertexFormat VertexFormat;
+
+typedef void (APIENTRYP R_PFNGLTEXSTORAGE2DPROC)(GLenum, GLsizei, GLenum, GLsizei, GLsizei);
+typedef void (APIENTRYP R_PFNGLVERTEXATTRIBFORMATPROC)(GLuint, GLint, GLenum, GLboolean, GLuint);
+typedef void (APIENTRYP R_PFNGLVERTEXATTRIBBINDINGPROC)(GLuint, GLuint);
+typedef void (APIENTRYP R_PFNGLBINDVERTEXBUFFERPROC)(GLuint, GLuint, GLintptr, GLsizei);
+typedef void (APIENTRYP R_PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum, GLenum, const void *, 
+                                                              GLsizei, GLsizei);
+typedef void (APIENTRYP R_PFNGLINVALIDATEFRAMEBUFFERPROC)(GLenum, GLsizei, const GLenum *);
+
+// Entry points past the 4.1 core that glad was generated for
+typedef struct R_GLExt R_GLExt;
+struct R_GLExt
+{
+  R_PFNGLTEXSTORAGE2DPROC tex_storage_2d;
+  R_PFNGLVERTEXATTRIBFORMATPROC vertex_attrib_format;
+  R_PFNGLVERTEXATTRIBBINDINGPROC vertex_attrib_binding;
+  R_PFNGLBINDVERTEXBUFFERPROC bind_vertex_buffer;
+  R_PFNGLMULTIDRAWELEMENTSINDIRECTPROC multi_draw_elements_indirect;
+  R_PFNGLINVALIDATEFRAMEBUFFERPROC invalidate_framebuffer;
+};
 
 static void r_verify_shader(u32 id, GLenum type);
 
+R_Caps r_caps;
+static R_GLExt r_gl;
+
 bool _r_check_error(void)
 {
   bool error = FALSE;
@@ -33,6 +65,74 @@ void _r_clear_error(void)
   while (glGetError() != GL_NO_ERROR);
 }
 
+void r_init(void)
+{
+  i32 major = 0;
+  i32 minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  r_caps.version = major * 10 + minor;
+
+  bool multi_draw_indirect = FALSE;
+  bool base_instance = FALSE;
+  i32 ext_count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &ext_count);
+  for (i32 i = 0; i < ext_count; i++)
+  {
+    const i8 *ext = (const i8 *) glGetStringi(GL_EXTENSIONS, i);
+    if (strcmp(ext, "GL_EXT_texture_compression_s3tc") == 0) r_caps.s3tc = TRUE;
+    if (strcmp(ext, "GL_ARB_texture_compression_bptc") == 0) r_caps.bptc = TRUE;
+    if (strcmp(ext, "GL_ARB_texture_storage") == 0) r_caps.texture_storage = TRUE;
+    if (strcmp(ext, "GL_ARB_vertex_attrib_binding") == 0) r_caps.vertex_attrib_binding = TRUE;
+    if (strcmp(ext, "GL_ARB_multi_draw_indirect") == 0) multi_draw_indirect = TRUE;
+    if (strcmp(ext, "GL_ARB_base_instance") == 0) base_instance = TRUE;
+    if (strcmp(ext, "GL_ARB_invalidate_subdata") == 0) r_caps.invalidate_framebuffer = TRUE;
+  }
+
+  if (r_caps.version >= 42)
+  {
+    r_caps.bptc = TRUE;
+    r_caps.texture_storage = TRUE;
+  }
+
+  if (r_caps.texture_storage)
+  {
+    *(void **) &r_gl.tex_storage_2d = SDL_GL_GetProcAddress("glTexStorage2D");
+    r_caps.texture_storage = r_gl.tex_storage_2d != NULL;
+  }
+
+  if (r_caps.version >= 43) r_caps.vertex_attrib_binding = TRUE;
+
+  if (r_caps.vertex_attrib_binding)
+  {
+    *(void **) &r_gl.vertex_attrib_format = SDL_GL_GetProcAddress("glVertexAttribFormat");
+    *(void **) &r_gl.vertex_attrib_binding = SDL_GL_GetProcAddress("glVertexAttribBinding");
+    *(void **) &r_gl.bind_vertex_buffer = SDL_GL_GetProcAddress("glBindVertexBuffer");
+    r_caps.vertex_attrib_binding = r_gl.vertex_attrib_format != NULL && 
+                                   r_gl.vertex_attrib_binding != NULL && 
+                                   r_gl.bind_vertex_buffer != NULL;
+  }
+
+  // Commands carry a base instance, which only takes effect with 4.2's
+  // ARB_base_instance
+  r_caps.multi_draw_indirect = r_caps.version >= 43 || (multi_draw_indirect && base_instance);
+
+  if (r_caps.multi_draw_indirect)
+  {
+    *(void **) &r_gl.multi_draw_elements_indirect = 
+      SDL_GL_GetProcAddress("glMultiDrawElementsIndirect");
+    r_caps.multi_draw_indirect = r_gl.multi_draw_elements_indirect != NULL;
+  }
+
+  if (r_caps.version >= 43) r_caps.invalidate_framebuffer = TRUE;
+
+  if (r_caps.invalidate_framebuffer)
+  {
+    *(void **) &r_gl.invalidate_framebuffer = SDL_GL_GetProcAddress("glInvalidateFramebuffer");
+    r_caps.invalidate_framebuffer = r_gl.invalidate_framebuffer != NULL;
+  }
+}
+
 // @Shader ==================================================================================
 
 Shader r_create_shader(const i8 *vert_src, const i8 *frag_src)
@@ -85,7 +185,7 @@ i32 r_set_uniform_1u(Shader *shader, i8 *name, u32 val)
   return loc;
 }
 
-i32 r_set_uniform_1(Shader *shader, i8 *name, i32 val)
+i32 r_set_uniform_1i(Shader *shader, i8 *name, i32 val)
 {
   i32 loc = glGetUniformLocation(shader->id, name);
   glUniform1i(loc, val);
@@ -140,6 +240,12 @@ i32 r_set_uniform_3x3f(Shader *shader, i8 *name, Mat3x3F mat)
   return loc;
 }
 
+// Expanded to a mat3 so shaders keep a single transform type
+i32 r_set_uniform_a2f(Shader *shader, i8 *name, Affine2F xform)
+{
+  return r_set_uniform_3x3f(shader, name, m3x3f_from_a2f(xform));
+}
+
 static
 void r_verify_shader(u32 id, GLenum type)
 {
@@ -181,7 +287,7 @@ Object r_create_vertex_buffer(void *data, u32 size)
   glBindBuffer(GL_ARRAY_BUFFER, id);
   glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
 
-  return (Object) {id, 0, 0};
+  return (Object) {id};
 }
 
 inline
@@ -203,7 +309,7 @@ Object r_create_index_buffer(void *data, u32 size)
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, id);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
 
-  return (Object) {id, 0, 0};
+  return (Object) {id};
 }
 
 inline
@@ -220,13 +326,13 @@ void r_unbind_index_buffer(void)
 
 // @VertexArray =============================================================================
 
-Object r_create_vertex_array(u8 attrib_count)
+Object r_create_vertex_array(void)
 {
   u32 id;
   R_ASSERT(glGenVertexArrays(1, &id));
   R_ASSERT(glBindVertexArray(id));
 
-  return (Object) {id, attrib_count, 0};
+  return (Object) {id};
 }
 
 inline
@@ -241,57 +347,576 @@ void r_unbind_vertex_array(void)
   glBindVertexArray(0);
 }
 
-VertexLayout r_create_vertex_layout(Object *v_arr, GLenum type, u32 count)
+static
+u8 r_gl_type_size(GLenum type)
 {
-  u8 type_size = 1;
   switch (type)
   {
-    case GL_BYTE:  type_size = sizeof (i8);  break;
-    case GL_SHORT: type_size = sizeof (i16); break;
-    case GL_INT:   type_size = sizeof (i32); break;
-    case GL_FLOAT: type_size = sizeof (f32); break;
-    default: ASSERT(FALSE);
+    case GL_BYTE:           return sizeof (i8);
+    case GL_UNSIGNED_BYTE:  return sizeof (u8);
+    case GL_SHORT:          return sizeof (i16);
+    case GL_UNSIGNED_SHORT: return sizeof (u16);
+    case GL_HALF_FLOAT:     return sizeof (u16);
+    case GL_INT:            return sizeof (i32);
+    case GL_FLOAT:          return sizeof (f32);
+    default: ASSERT(FALSE); return 1;
+  }
+}
+
+// Integer types with `normalized` are read as [0, 1] (unsigned) or [-1, 1]
+// (signed) floats; without it they are converted as is.
+VertexFormat r_create_vertex_format(const R_VertexAttrib *attribs, u32 attrib_count)
+{
+  ASSERT(attrib_count <= R_MAX_VERTEX_ATTRIBS);
+
+  VertexFormat format = {0};
+  format.attrib_count = attrib_count;
+
+  for (u32 i = 0; i < attrib_count; i++)
+  {
+    R_VertexAttrib attrib = attribs[i];
+    ASSERT(attrib.stream < R_MAX_VERTEX_STREAMS);
+
+    u32 *stride = &format.strides[attrib.stream];
+    attrib.offset = *stride;
+    attrib.normalized = attrib.normalized && attrib.type != GL_FLOAT && attrib.type != GL_HALF_FLOAT;
+    *stride += (attrib.count * r_gl_type_size(attrib.type) + 3) & ~3u;
+
+    format.attribs[i] = attrib;
+    format.stream_count = MAX(format.stream_count, attrib.stream + 1);
+  }
+
+  return format;
+}
+
+// With vertex attrib binding the format is recorded in the vertex array once
+// and buffers can be swapped under it. Without it the attribute pointers are
+// specified in r_bind_vertex_streams.
+void r_set_vertex_format(Object *vertex_array, const VertexFormat *format)
+{
+  r_bind_vertex_array(vertex_array);
+
+  for (u32 i = 0; i < format->attrib_count; i++)
+  {
+    const R_VertexAttrib *attrib = &format->attribs[i];
+    R_ASSERT(glEnableVertexAttribArray(attrib->location));
+
+    if (r_caps.vertex_attrib_binding)
+    {
+      R_ASSERT(r_gl.vertex_attrib_format(attrib->location, attrib->count, attrib->type, 
+                                         attrib->normalized, attrib->offset));
+      R_ASSERT(r_gl.vertex_attrib_binding(attrib->location, attrib->stream));
+    }
+  }
+}
+
+// `buffers` holds one vertex buffer per stream of the format
+void r_bind_vertex_streams(Object *vertex_array, const VertexFormat *format, const Object *buffers)
+{
+  r_bind_vertex_array(vertex_array);
+
+  if (r_caps.vertex_attrib_binding)
+  {
+    for (u32 i = 0; i < format->stream_count; i++)
+    {
+      R_ASSERT(r_gl.bind_vertex_buffer(i, buffers[i].id, 0, format->strides[i]));
+    }
+
+    return;
+  }
+
+  for (u32 i = 0; i < format->attrib_count; i++)
+  {
+    const R_VertexAttrib *attrib = &format->attribs[i];
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[attrib->stream].id);
+    R_ASSERT(glVertexAttribPointer(attrib->location, 
+                                   attrib->count, 
+                                   attrib->type, 
+                                   attrib->normalized, 
+                                   format->strides[attrib->stream], 
+                                   (void *) (u64) attrib->offset));
   }
+}
+
+// @Mesh ====================================================================================
+
+R_Mesh r_create_mesh(const VertexFormat *format, const void *vertices, u32 vertex_count, 
+                     const void *indices, u32 index_count, u32 index_size)
+{
+  ASSERT(format->stream_count == 1);
+  ASSERT(index_size == 2 || index_size == 4);
+
+  // The index buffer binding is recorded in the vertex array bound here
+  R_Mesh mesh = {0};
+  mesh.vertex_array = r_create_vertex_array();
+  mesh.vertex_buffer = r_create_vertex_buffer((void *) vertices, vertex_count * format->strides[0]);
+  mesh.index_buffer = r_create_index_buffer((void *) indices, index_count * index_size);
+  mesh.index_count = index_count;
+  mesh.index_type = index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  mesh.index_size = index_size;
+  mesh.lods[0] = (MeshLod) {0, index_count, 0.0f};
+  mesh.lod_count = 1;
 
-  VertexLayout layout = 
+  r_set_vertex_format(&mesh.vertex_array, format);
+  r_bind_vertex_streams(&mesh.vertex_array, format, &mesh.vertex_buffer);
+  r_unbind_vertex_array();
+
+  return mesh;
+}
+
+static
+VertexFormat r_mesh_vertex_format(void)
+{
+  static const R_VertexAttrib attribs[3] = 
   {
-    .index = v_arr->attrib_index,
-    .count = count,
-    .data_type = type,
-    .normalized = FALSE,
-    .stride = count * v_arr->attrib_count * type_size,
-    .first = (void *) (u64) (v_arr->attrib_index * count * type_size)
+    {.location = 0, .count = 3, .type = GL_FLOAT}, // position
+    {.location = 3, .count = 3, .type = GL_FLOAT}, // normal
+    {.location = 2, .count = 2, .type = GL_FLOAT}, // uv
   };
 
-  v_arr->attrib_index++;
+  VertexFormat format = r_create_vertex_format(attribs, ARR_LEN(attribs));
+  ASSERT(format.strides[0] == sizeof (MeshVertex));
+
+  return format;
+}
+
+R_Mesh r_upload_mesh(const Mesh *mesh)
+{
+  VertexFormat format = r_mesh_vertex_format();
+
+  u32 index_size = mesh_index_size(mesh->vertex_count);
+  void *indices = malloc((u64) index_size * mesh->index_count);
+  mesh_pack_indices(mesh->indices, mesh->index_count, index_size, indices);
+
+  R_Mesh result = r_create_mesh(&format, mesh->vertices, mesh->vertex_count, 
+                                indices, mesh->index_count, index_size);
+  free(indices);
+
+  if (mesh->lod_count)
+  {
+    memcpy(result.lods, mesh->lods, sizeof (MeshLod) * mesh->lod_count);
+    result.lod_count = mesh->lod_count;
+  }
+
+  return result;
+}
+
+R_Mesh r_load_mesh(const i8 *path)
+{
+  R_Mesh result = {0};
+  Mesh mesh;
+  if (!mesh_load(path, &mesh)) return result;
+
+  result = r_upload_mesh(&mesh);
+  mesh_free(&mesh);
+
+  return result;
+}
+
+void r_destroy_mesh(R_Mesh *mesh)
+{
+  glDeleteVertexArrays(1, &mesh->vertex_array.id);
+  glDeleteBuffers(1, &mesh->vertex_buffer.id);
+  glDeleteBuffers(1, &mesh->index_buffer.id);
+  *mesh = (R_Mesh) {0};
+}
+
+R_DrawPack r_create_draw_pack(const DrawPack *pack)
+{
+  VertexFormat format = r_mesh_vertex_format();
+
+  u32 index_size = draw_pack_index_size(pack);
+  void *indices = malloc((u64) index_size * pack->index_count);
+  mesh_pack_indices(pack->indices, pack->index_count, index_size, indices);
+
+  R_DrawPack result = {0};
+  result.mesh = r_create_mesh(&format, pack->vertices, pack->vertex_count, 
+                              indices, pack->index_count, index_size);
+  free(indices);
+
+  r_bind_vertex_array(&result.mesh.vertex_array);
+  glGenBuffers(1, &result.instance_buffer.id);
+  glBindBuffer(GL_ARRAY_BUFFER, result.instance_buffer.id);
+  R_ASSERT(glVertexAttribIPointer(R_INSTANCE_LOCATION, 1, GL_UNSIGNED_INT, sizeof (u32), NULL));
+  R_ASSERT(glVertexAttribDivisor(R_INSTANCE_LOCATION, 1));
+  r_unbind_vertex_array();
+
+  glGenBuffers(1, &result.indirect_buffer.id);
+
+  return result;
+}
+
+void r_destroy_draw_pack(R_DrawPack *pack)
+{
+  r_destroy_mesh(&pack->mesh);
+  glDeleteBuffers(1, &pack->instance_buffer.id);
+  glDeleteBuffers(1, &pack->indirect_buffer.id);
+  free(pack->counts);
+  free(pack->offsets);
+  free(pack->base_vertices);
+  *pack = (R_DrawPack) {0};
+}
+
+// @GeometryPool ============================================================================
+
+R_GeometryPool r_create_geometry_pool(const VertexFormat *format, u32 index_size, 
+                                      u64 vertex_bytes, u64 index_bytes, u32 max_allocs)
+{
+  ASSERT(format->stream_count == 1);
+  ASSERT(index_size == 2 || index_size == 4);
+  ASSERT(vertex_bytes <= 0xFFFFFFFF && index_bytes <= 0xFFFFFFFF);
+
+  R_GeometryPool pool = {0};
+  pool.format = *format;
+  pool.index_size = index_size;
+  pool.index_type = index_size == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+  pool.vertex_bytes = vertex_bytes / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+  pool.index_bytes = index_bytes / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+  pool.max_allocs = max_allocs;
+
+  return pool;
+}
+
+void r_destroy_geometry_pool(R_GeometryPool *pool)
+{
+  for (u32 i = 0; i < pool->page_count; i++)
+  {
+    R_GeometryPage *page = &pool->pages[i];
+    glDeleteVertexArrays(1, &page->vertex_array.id);
+    glDeleteBuffers(1, &page->vertex_buffer.id);
+    glDeleteBuffers(1, &page->index_buffer.id);
+    heap_destroy(&page->vertices);
+    heap_destroy(&page->indices);
+  }
+
+  *pool = (R_GeometryPool) {0};
+}
+
+static
+void r_geometry_add_page(R_GeometryPool *pool)
+{
+  R_GeometryPage *page = &pool->pages[pool->page_count++];
+  page->vertex_array = r_create_vertex_array();
+  page->vertex_buffer = r_create_vertex_buffer(NULL, (u32) pool->vertex_bytes);
+  page->index_buffer = r_create_index_buffer(NULL, (u32) pool->index_bytes);
+  page->vertices = heap_create(pool->vertex_bytes, pool->max_allocs);
+  page->indices = heap_create(pool->index_bytes, pool->max_allocs);
+
+  r_set_vertex_format(&page->vertex_array, &pool->format);
+  r_bind_vertex_streams(&page->vertex_array, &pool->format, &page->vertex_buffer);
+  r_unbind_vertex_array();
+}
+
+// Ranges start on HEAP_ALIGNMENT, which not every stride divides. The slack
+// lets the vertices start on the next whole vertex instead.
+static
+u32 r_geometry_vertex_slack(const R_GeometryPool *pool)
+{
+  u32 stride = pool->format.strides[0];
+  return HEAP_ALIGNMENT % stride ? stride - 1 : 0;
+}
+
+static
+u64 r_geometry_first_vertex(const R_GeometryPool *pool, u64 offset)
+{
+  u32 stride = pool->format.strides[0];
+  return (offset + stride - 1) / stride;
+}
+
+bool r_geometry_alloc(R_GeometryPool *pool, const void *vertices, u32 vertex_count, 
+                      const void *indices, u32 index_count, R_Geometry *geometry)
+{
+  u32 stride = pool->format.strides[0];
+  u64 vertex_size = (u64) vertex_count * stride;
+  u64 index_size = (u64) index_count * pool->index_size;
+  u64 slack = r_geometry_vertex_slack(pool);
+  if (vertex_size + slack > pool->vertex_bytes || index_size > pool->index_bytes) return FALSE;
+
+  for (u32 i = 0; i < R_GEOMETRY_MAX_PAGES; i++)
+  {
+    if (i == pool->page_count) r_geometry_add_page(pool);
+
+    R_GeometryPage *page = &pool->pages[i];
+    HeapHandle vertex_handle, index_handle;
+    u64 vertex_offset, index_offset;
+    if (!heap_alloc(&page->vertices, vertex_size + slack, &vertex_handle, &vertex_offset)) continue;
+    if (!heap_alloc(&page->indices, index_size, &index_handle, &index_offset))
+    {
+      heap_free(&page->vertices, vertex_handle);
+      continue;
+    }
+
+    // The copy target, binding the element array buffer would change the
+    // bound vertex array
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page->vertex_buffer.id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, r_geometry_first_vertex(pool, vertex_offset) * stride, 
+                    vertex_size, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page->index_buffer.id);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, index_offset, index_size, indices);
+
+    geometry->page = i;
+    geometry->vertices = vertex_handle;
+    geometry->indices = index_handle;
+    geometry->vertex_count = vertex_count;
+    geometry->index_count = index_count;
+
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+void r_geometry_free(R_GeometryPool *pool, R_Geometry *geometry)
+{
+  R_GeometryPage *page = &pool->pages[geometry->page];
+  heap_free(&page->vertices, geometry->vertices);
+  heap_free(&page->indices, geometry->indices);
+  *geometry = (R_Geometry) {0};
+}
+
+DrawCommand r_geometry_command(const R_GeometryPool *pool, const R_Geometry *geometry, 
+                               u32 instance_count)
+{
+  const R_GeometryPage *page = &pool->pages[geometry->page];
+  u64 vertex_offset, index_offset;
+  if (!heap_offset(&page->vertices, geometry->vertices, &vertex_offset) || 
+      !heap_offset(&page->indices, geometry->indices, &index_offset))
+  {
+    return (DrawCommand) {0};
+  }
 
-  return layout;
+  return (DrawCommand)
+  {
+    .index_count = geometry->index_count,
+    .instance_count = instance_count,
+    .first_index = (u32) (index_offset / pool->index_size),
+    .base_vertex = (i32) r_geometry_first_vertex(pool, vertex_offset),
+    .base_instance = 0,
+  };
 }
 
-void r_bind_vertex_layout(VertexLayout *layout)
+u32 r_geometry_defrag(R_GeometryPool *pool, u64 max_bytes)
 {
-  R_ASSERT(glVertexAttribPointer(
-                                 layout->index,
-                                 layout->count,
-                                 layout->data_type,
-                                 layout->normalized,
-                                 layout->stride,
-                                 layout->first));
+  HeapMove moves[64];
+  u32 stride = pool->format.strides[0];
+  u64 slack = r_geometry_vertex_slack(pool);
+  u32 moved = 0;
+
+  for (u32 i = 0; i < pool->page_count && max_bytes > 0; i++)
+  {
+    R_GeometryPage *page = &pool->pages[i];
+    Heap *heaps[2] = {&page->vertices, &page->indices};
+    u32 buffers[2] = {page->vertex_buffer.id, page->index_buffer.id};
+
+    for (u32 h = 0; h < 2 && max_bytes > 0; h++)
+    {
+      u32 count = heap_defrag(heaps[h], max_bytes, moves, ARR_LEN(moves));
+
+      // Same buffer on both ends is fine as long as the ranges don't overlap
+      glBindBuffer(GL_COPY_READ_BUFFER, buffers[h]);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[h]);
+
+      for (u32 m = 0; m < count; m++)
+      {
+        HeapMove *move = &moves[m];
+        u64 from = move->from;
+        u64 to = move->to;
+        u64 size = move->size;
+        if (h == 0)
+        {
+          from = r_geometry_first_vertex(pool, from) * stride;
+          to = r_geometry_first_vertex(pool, to) * stride;
+          size -= slack;
+        }
 
-  R_ASSERT(glEnableVertexAttribArray(layout->index));
+        R_ASSERT(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, size));
+        max_bytes -= MIN(max_bytes, move->size);
+      }
+
+      moved += count;
+    }
+  }
+
+  return moved;
 }
 
 // @Texture2D ===============================================================================
 
-Texture2D r_load_texture2d(const i8 *path)
+const R_TextureFormatDesc r_texture_formats[R_TEXTURE_FORMAT_COUNT] =
+{
+  [R_TEXTURE_FORMAT_R8]       = {GL_R8,           GL_RED,  GL_UNSIGNED_BYTE, 1, 1, FALSE},
+  [R_TEXTURE_FORMAT_RG8]      = {GL_RG8,          GL_RG,   GL_UNSIGNED_BYTE, 2, 2, FALSE},
+  [R_TEXTURE_FORMAT_RGB8]     = {GL_RGB8,         GL_RGB,  GL_UNSIGNED_BYTE, 3, 3, FALSE},
+  [R_TEXTURE_FORMAT_RGBA8]    = {GL_RGBA8,        GL_RGBA, GL_UNSIGNED_BYTE, 4, 4, FALSE},
+  [R_TEXTURE_FORMAT_SRGB8]    = {GL_SRGB8,        GL_RGB,  GL_UNSIGNED_BYTE, 3, 3, TRUE},
+  [R_TEXTURE_FORMAT_SRGB8_A8] = {GL_SRGB8_ALPHA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, 4, TRUE},
+  [R_TEXTURE_FORMAT_R16F]     = {GL_R16F,         GL_RED,  GL_HALF_FLOAT,    1, 2, FALSE},
+  [R_TEXTURE_FORMAT_RGBA16F]  = {GL_RGBA16F,      GL_RGBA, GL_HALF_FLOAT,    4, 8, FALSE},
+
+  [R_TEXTURE_FORMAT_R11G11B10F] = 
+  {
+    GL_R11F_G11F_B10F, GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV, 3, 4, FALSE
+  },
+  [R_TEXTURE_FORMAT_DEPTH24] = 
+  {
+    GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 1, 4, FALSE
+  },
+  [R_TEXTURE_FORMAT_DEPTH32F] = 
+  {
+    GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, 1, 4, FALSE
+  },
+  [R_TEXTURE_FORMAT_DEPTH24_STENCIL8] = 
+  {
+    GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 1, 4, FALSE
+  },
+};
+
+// Rows are tightly packed, so the alignment is the largest power of two that
+// divides the row size.
+static
+void r_set_unpack_alignment(i32 width, u32 bytes_per_pixel)
+{
+  u64 row = (u64) width * bytes_per_pixel;
+  i32 alignment = row % 8 == 0 ? 8 : (row % 4 == 0 ? 4 : (row % 2 == 0 ? 2 : 1));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+// Allocates storage for exactly `mip_count` levels. Immutable when
+// glTexStorage2D is available, otherwise each level is specified up front and
+// clamped with GL_TEXTURE_MAX_LEVEL.
+static
+void r_alloc_texture_storage(Texture2D *tex, const R_TextureFormatDesc *desc)
+{
+  if (r_caps.texture_storage)
+  {
+    R_ASSERT(r_gl.tex_storage_2d(GL_TEXTURE_2D, tex->mip_count, desc->internal_format, 
+                                 tex->width, tex->height));
+  }
+  else
+  {
+    i32 w = tex->width;
+    i32 h = tex->height;
+    for (i32 i = 0; i < tex->mip_count; i++)
+    {
+      R_ASSERT(glTexImage2D(GL_TEXTURE_2D, i, desc->internal_format, w, h, 0, 
+                            desc->format, desc->type, NULL));
+      w = w > 1 ? w / 2 : 1;
+      h = h > 1 ? h / 2 : 1;
+    }
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex->mip_count - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
+                  tex->mip_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// 8-bit formats get their mip chain from img_gen_mips. R16F has no CPU filter
+// and falls back to glGenerateMipmap.
+Texture2D r_create_texture2d(i32 width, i32 height, R_TextureFormat format, 
+                             const void *pixels, bool mips)
 {
+  const R_TextureFormatDesc *desc = &r_texture_formats[format];
+
   Texture2D tex = {0};
+  tex.width = width;
+  tex.height = height;
+  tex.num_channels = desc->channels;
+  tex.format = format;
+  tex.mip_count = mips ? img_mip_count(width, height) : 1;
+
   glGenTextures(1, &tex.id);
-  tex.data = stbi_load(path, &tex.width, &tex.height, &tex.num_channels, 0);
+  r_bind_texture2d(&tex);
+  r_alloc_texture_storage(&tex, desc);
+
+  for (i32 i = 0, w = width, h = height; i < tex.mip_count; i++)
+  {
+    tex.gpu_bytes += (u64) w * h * desc->bytes_per_pixel;
+    w = w > 1 ? w / 2 : 1;
+    h = h > 1 ? h / 2 : 1;
+  }
+
+  if (pixels == NULL) return tex;
+
+  if (mips && desc->type == GL_UNSIGNED_BYTE)
+  {
+    ImageLevel levels[IMAGE_MAX_LEVELS];
+    u32 level_count = img_gen_mips(pixels, 
+                                   width, 
+                                   height, 
+                                   desc->channels, 
+                                   IMAGE_FILTER_BOX, 
+                                   desc->srgb ? IMAGE_MIP_SRGB : 0, 
+                                   levels);
+
+    for (u32 i = 0; i < level_count; i++)
+    {
+      r_set_unpack_alignment(levels[i].width, desc->bytes_per_pixel);
+      R_ASSERT(glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, levels[i].width, levels[i].height, 
+                               desc->format, desc->type, levels[i].data));
+    }
+
+    img_free_levels(levels, level_count);
+  }
+  else
+  {
+    r_set_unpack_alignment(width, desc->bytes_per_pixel);
+    R_ASSERT(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, 
+                             desc->format, desc->type, pixels));
+
+    if (mips) glGenerateMipmap(GL_TEXTURE_2D);
+  }
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  return tex;
+}
+
+static
+R_TextureFormat r_format_for_channels(i32 channels, bool srgb)
+{
+  switch (channels)
+  {
+    case 1: return R_TEXTURE_FORMAT_R8;
+    case 2: return R_TEXTURE_FORMAT_RG8;
+    case 3: return srgb ? R_TEXTURE_FORMAT_SRGB8 : R_TEXTURE_FORMAT_RGB8;
+    default: return srgb ? R_TEXTURE_FORMAT_SRGB8_A8 : R_TEXTURE_FORMAT_RGBA8;
+  }
+}
+
+// The decoded image is freed once it is on the GPU.
+Texture2D r_load_texture2d(const i8 *path, bool srgb)
+{
+  i32 width, height, channels;
+  u8 *data = stbi_load(path, &width, &height, &channels, 0);
+  if (data == NULL) return (Texture2D) {0};
+
+  #ifdef LOG_PERF
+  u64 start = SDL_GetPerformanceCounter();
+  #endif
+
+  Texture2D tex = r_create_texture2d(width, height, r_format_for_channels(channels, srgb), 
+                                     data, TRUE);
+  stbi_image_free(data);
+
+  #ifdef LOG_PERF
+  u64 end = SDL_GetPerformanceCounter();
+  f64 upload_ms = (f64) (end - start) / SDL_GetPerformanceFrequency() * 1000.0f;
+  printf("[Texture] %s: %llu KiB on GPU, uploaded in %.2lf ms\n", 
+         path, (unsigned long long) tex.gpu_bytes / 1024, upload_ms);
+  #endif
 
   return tex;
 }
 
+void r_destroy_texture2d(Texture2D *texture)
+{
+  glDeleteTextures(1, &texture->id);
+  free(texture->data);
+  *texture = (Texture2D) {0};
+}
+
 inline
 void r_bind_texture2d(Texture2D *texture)
 {
@@ -304,33 +929,1309 @@ void r_unbind_texture2d(void)
   glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-void r_gen_textured2(Texture2D *texture)
+// Uploads a TEXC container. Block compressed levels go straight to the driver
+// when the format is supported, otherwise they are decoded to RGBA8 on the CPU.
+Texture2D r_load_texture2d_compressed(const i8 *path)
 {
-  glTexImage2D(
-               GL_TEXTURE_2D, 
-               0, 
-               GL_RGB, 
-               texture->width, 
-               texture->height, 
-               0, 
-               GL_RGB, 
-               GL_UNSIGNED_BYTE, 
-               texture->data);
+  Texture2D tex = {0};
+  Image image;
+  if (!img_load(path, &image)) return tex;
+
+  #ifdef LOG_PERF
+  u64 start = SDL_GetPerformanceCounter();
+  #endif
+
+  GLenum internal = 0;
+  switch (image.format)
+  {
+    case IMAGE_FORMAT_RGBA8: break;
+    case IMAGE_FORMAT_BC1: if (r_caps.s3tc) internal = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+    case IMAGE_FORMAT_BC3: if (r_caps.s3tc) internal = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+    case IMAGE_FORMAT_BC7: if (r_caps.bptc) internal = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+  }
+
+  tex.width = image.width;
+  tex.height = image.height;
+  tex.num_channels = 4;
+  tex.format = R_TEXTURE_FORMAT_RGBA8;
+  tex.mip_count = image.level_count;
+  glGenTextures(1, &tex.id);
+  r_bind_texture2d(&tex);
+
+  for (u32 i = 0; i < image.level_count; i++)
+  {
+    ImageLevel *level = &image.levels[i];
+
+    if (internal)
+    {
+      R_ASSERT(glCompressedTexImage2D(GL_TEXTURE_2D, i, internal, level->width, level->height, 
+                                      0, level->size, level->data));
+      tex.gpu_bytes += level->size;
+    }
+    else
+    {
+      u8 *rgba = level->data;
+      if (image.format != IMAGE_FORMAT_RGBA8)
+      {
+        rgba = malloc((u64) level->width * level->height * 4);
+        img_decode(image.format, level->data, level->width, level->height, rgba);
+      }
+
+      R_ASSERT(glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, level->width, level->height, 
+                            0, GL_RGBA, GL_UNSIGNED_BYTE, rgba));
+      tex.gpu_bytes += (u64) level->width * level->height * 4;
+
+      if (rgba != level->data) free(rgba);
+    }
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, image.level_count - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, 
+                  image.level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  #ifdef LOG_PERF
+  u64 end = SDL_GetPerformanceCounter();
+  f64 upload_ms = (f64) (end - start) / SDL_GetPerformanceFrequency() * 1000.0f;
+  printf("[Texture] %s: %llu KiB on GPU%s, uploaded in %.2lf ms\n", 
+         path, 
+         (unsigned long long) tex.gpu_bytes / 1024, 
+         internal ? "" : " (decoded)", 
+         upload_ms);
+  #endif
 
-  glGenerateMipmap(GL_TEXTURE_2D);
+  img_free(&image);
+
+  return tex;
 }
 
-// @Draw ====================================================================================
+// @Atlas ===================================================================================
 
-void r_clear(Vec4F color)
+R_Atlas r_load_atlas(const i8 **page_paths, u32 page_count, 
+                     const AtlasSprite *sprites, u32 sprite_count)
 {
-  glClearColor(color.r, color.g, color.b, color.a);
-  glClear(GL_COLOR_BUFFER_BIT);
+  R_Atlas atlas = {0};
+  atlas.pages = calloc(page_count, sizeof (Texture2D));
+  atlas.page_count = page_count;
+  atlas.sprites = sprites;
+  atlas.sprite_count = sprite_count;
+
+  for (u32 i = 0; i < page_count; i++)
+  {
+    // Pages are always written as RGBA8 by AtlasPacker
+    i32 width, height, channels;
+    u8 *data = stbi_load(page_paths[i], &width, &height, &channels, 4);
+    ASSERT(data != NULL);
+
+    Texture2D *page = &atlas.pages[i];
+    *page = r_create_texture2d(width, height, R_TEXTURE_FORMAT_RGBA8, data, FALSE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    stbi_image_free(data);
+  }
+
+  return atlas;
 }
 
-void r_draw(Object *vertex_array, Shader *shader)
+bool r_atlas_lookup(R_Atlas *atlas, const i8 *name, Texture2D **page, Vec4F *uv)
 {
-  r_bind_shader(shader);
-  r_bind_vertex_array(vertex_array);
-  R_ASSERT(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, NULL));
+  const AtlasSprite *sprite = atlas_find(atlas->sprites, atlas->sprite_count, name);
+  if (sprite == NULL) return FALSE;
+
+  *page = &atlas->pages[sprite->page];
+  *uv = v4f(sprite->uv[0], sprite->uv[1], sprite->uv[2], sprite->uv[3]);
+
+  return TRUE;
+}
+
+R_DynamicAtlas r_create_dynamic_atlas(i32 width, i32 height, i32 num_channels, u32 max_entries)
+{
+  ASSERT(num_channels >= 1 && num_channels <= 4);
+
+  R_TextureFormat format = r_format_for_channels(num_channels, FALSE);
+
+  R_DynamicAtlas atlas = {0};
+  atlas.alloc = shelf_atlas_create(width, height, max_entries);
+  atlas.format = r_texture_formats[format].format;
+  atlas.dirty_cap = 64;
+  atlas.dirty = malloc(sizeof (AtlasRect) * atlas.dirty_cap);
+
+  // The shadow copy stays resident and counts as CPU memory
+  Texture2D *tex = &atlas.texture;
+  *tex = r_create_texture2d(width, height, format, NULL, FALSE);
+  tex->data = calloc((u64) width * height, num_channels);
+  tex->cpu_bytes = (u64) width * height * num_channels;
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  r_set_unpack_alignment(width, num_channels);
+  R_ASSERT(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, 
+                           atlas.format, GL_UNSIGNED_BYTE, tex->data));
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  return atlas;
+}
+
+void r_destroy_dynamic_atlas(R_DynamicAtlas *atlas)
+{
+  r_destroy_texture2d(&atlas->texture);
+  free(atlas->dirty);
+  shelf_atlas_destroy(&atlas->alloc);
+  *atlas = (R_DynamicAtlas) {0};
+}
+
+static
+Vec4F r_atlas_rect_uv(R_DynamicAtlas *atlas, AtlasRect rect)
+{
+  f32 inv_w = 1.0f / atlas->texture.width;
+  f32 inv_h = 1.0f / atlas->texture.height;
+
+  return v4f(rect.x * inv_w, rect.y * inv_h, (rect.x + rect.w) * inv_w, (rect.y + rect.h) * inv_h);
+}
+
+bool r_dynamic_atlas_add(R_DynamicAtlas *atlas, const u8 *pixels, i32 w, i32 h, 
+                         AtlasHandle *handle, Vec4F *uv)
+{
+  AtlasRect rect;
+  if (!shelf_atlas_alloc(&atlas->alloc, w, h, handle, &rect)) return FALSE;
+
+  Texture2D *tex = &atlas->texture;
+  u64 row = (u64) w * tex->num_channels;
+  for (i32 y = 0; y < h; y++)
+  {
+    u8 *dst = &tex->data[((u64) (rect.y + y) * tex->width + rect.x) * tex->num_channels];
+    memcpy(dst, &pixels[y * row], row);
+  }
+
+  if (atlas->dirty_count == atlas->dirty_cap)
+  {
+    atlas->dirty_cap *= 2;
+    atlas->dirty = realloc(atlas->dirty, sizeof (AtlasRect) * atlas->dirty_cap);
+  }
+
+  atlas->dirty[atlas->dirty_count++] = rect;
+  *uv = r_atlas_rect_uv(atlas, rect);
+
+  return TRUE;
+}
+
+bool r_dynamic_atlas_get(R_DynamicAtlas *atlas, AtlasHandle handle, Vec4F *uv)
+{
+  AtlasRect rect;
+  if (!shelf_atlas_touch(&atlas->alloc, handle, &rect)) return FALSE;
+
+  *uv = r_atlas_rect_uv(atlas, rect);
+
+  return TRUE;
+}
+
+static
+i32 r_compare_rect_y(const void *a, const void *b)
+{
+  return ((const AtlasRect *) a)->y - ((const AtlasRect *) b)->y;
+}
+
+void r_flush_dynamic_atlas(R_DynamicAtlas *atlas)
+{
+  Texture2D *tex = &atlas->texture;
+  atlas->stats.upload_calls = 0;
+  atlas->stats.upload_bytes = 0;
+
+  if (atlas->dirty_count > 0)
+  {
+    // Rects that share rows are merged into one band per upload
+    qsort(atlas->dirty, atlas->dirty_count, sizeof (AtlasRect), r_compare_rect_y);
+
+    r_bind_texture2d(tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, tex->width);
+
+    for (u32 i = 0; i < atlas->dirty_count;)
+    {
+      AtlasRect band = atlas->dirty[i];
+      i32 x1 = band.x + band.w;
+      i32 y1 = band.y + band.h;
+
+      for (i++; i < atlas->dirty_count && atlas->dirty[i].y < y1; i++)
+      {
+        AtlasRect r = atlas->dirty[i];
+        if (r.x < band.x) band.x = r.x;
+        if (r.x + r.w > x1) x1 = r.x + r.w;
+        if (r.y + r.h > y1) y1 = r.y + r.h;
+      }
+
+      band.w = x1 - band.x;
+      band.h = y1 - band.y;
+
+      u8 *src = &tex->data[((u64) band.y * tex->width + band.x) * tex->num_channels];
+      R_ASSERT(glTexSubImage2D(GL_TEXTURE_2D, 0, band.x, band.y, band.w, band.h, 
+                               atlas->format, GL_UNSIGNED_BYTE, src));
+
+      atlas->stats.upload_calls++;
+      atlas->stats.upload_bytes += (u64) band.w * band.h * tex->num_channels;
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    atlas->dirty_count = 0;
+  }
+
+  atlas->stats.upload_bytes_total += atlas->stats.upload_bytes;
+  atlas->stats.occupancy = shelf_atlas_occupancy(&atlas->alloc);
+  atlas->stats.evictions = atlas->alloc.evictions;
+  shelf_atlas_next_frame(&atlas->alloc);
+}
+
+// @RenderTarget ============================================================================
+
+static const R_TextureFormat r_target_formats[TARGET_FORMAT_COUNT] =
+{
+  [TARGET_FORMAT_RGBA8]            = R_TEXTURE_FORMAT_RGBA8,
+  [TARGET_FORMAT_SRGB8_A8]         = R_TEXTURE_FORMAT_SRGB8_A8,
+  [TARGET_FORMAT_RGBA16F]          = R_TEXTURE_FORMAT_RGBA16F,
+  [TARGET_FORMAT_R11G11B10F]       = R_TEXTURE_FORMAT_R11G11B10F,
+  [TARGET_FORMAT_R16F]             = R_TEXTURE_FORMAT_R16F,
+  [TARGET_FORMAT_DEPTH24]          = R_TEXTURE_FORMAT_DEPTH24,
+  [TARGET_FORMAT_DEPTH32F]         = R_TEXTURE_FORMAT_DEPTH32F,
+  [TARGET_FORMAT_DEPTH24_STENCIL8] = R_TEXTURE_FORMAT_DEPTH24_STENCIL8,
+};
+
+static
+GLenum r_depth_attachment(TargetFormat format)
+{
+  if (format == TARGET_FORMAT_DEPTH24_STENCIL8) return GL_DEPTH_STENCIL_ATTACHMENT;
+
+  return GL_DEPTH_ATTACHMENT;
+}
+
+// Sampled by later passes, which never want to wrap
+static
+Texture2D r_create_target_texture(i32 width, i32 height, TargetFormat format)
+{
+  Texture2D tex = r_create_texture2d(width, height, r_target_formats[format], NULL, FALSE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  if (target_format_is_depth(format))
+  {
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  }
+
+  return tex;
+}
+
+static
+u32 r_create_target_renderbuffer(i32 width, i32 height, TargetFormat format, u32 samples)
+{
+  GLenum internal_format = r_texture_formats[r_target_formats[format]].internal_format;
+
+  u32 id;
+  glGenRenderbuffers(1, &id);
+  glBindRenderbuffer(GL_RENDERBUFFER, id);
+  R_ASSERT(glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, internal_format, 
+                                            width, height));
+
+  return id;
+}
+
+static
+void r_set_draw_buffers(u32 count)
+{
+  static const GLenum buffers[TARGET_MAX_COLOR] = 
+  {
+    GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2, GL_COLOR_ATTACHMENT3,
+  };
+
+  if (count)
+  {
+    glDrawBuffers(count, buffers);
+  }
+  else
+  {
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+  }
+}
+
+R_RenderTarget r_create_render_target(const TargetDesc *desc)
+{
+  R_RenderTarget target = {0};
+  target.desc = *desc;
+  target.desc.samples = MAX(desc->samples, 1);
+  target.color_count = target_desc_color_count(desc);
+
+  i32 w = desc->width;
+  i32 h = desc->height;
+  u32 samples = target.desc.samples;
+
+  glGenFramebuffers(1, &target.framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+
+  for (u32 i = 0; i < target.color_count; i++)
+  {
+    GLenum attachment = GL_COLOR_ATTACHMENT0 + i;
+    if (samples > 1)
+    {
+      target.color_buffers[i] = r_create_target_renderbuffer(w, h, desc->color[i], samples);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, 
+                                target.color_buffers[i]);
+    }
+    else
+    {
+      target.color[i] = r_create_target_texture(w, h, desc->color[i]);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.color[i].id, 0);
+    }
+  }
+
+  if (desc->depth != TARGET_FORMAT_NONE)
+  {
+    ASSERT(target_format_is_depth(desc->depth));
+    GLenum attachment = r_depth_attachment(desc->depth);
+    if (samples > 1)
+    {
+      target.depth_buffer = r_create_target_renderbuffer(w, h, desc->depth, samples);
+      glFramebufferRenderbuffer(GL_FRAMEBUFFER, attachment, GL_RENDERBUFFER, target.depth_buffer);
+    }
+    else
+    {
+      target.depth = r_create_target_texture(w, h, desc->depth);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, target.depth.id, 0);
+    }
+  }
+
+  r_set_draw_buffers(target.color_count);
+  ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+  // Resolved colors land in textures like a single sampled target's
+  if (samples > 1 && target.color_count)
+  {
+    glGenFramebuffers(1, &target.resolve_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.resolve_framebuffer);
+    for (u32 i = 0; i < target.color_count; i++)
+    {
+      target.color[i] = r_create_target_texture(w, h, desc->color[i]);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, 
+                             target.color[i].id, 0);
+    }
+
+    r_set_draw_buffers(target.color_count);
+    ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  return target;
+}
+
+void r_destroy_render_target(R_RenderTarget *target)
+{
+  glDeleteFramebuffers(1, &target->framebuffer);
+  if (target->resolve_framebuffer) glDeleteFramebuffers(1, &target->resolve_framebuffer);
+
+  for (u32 i = 0; i < target->color_count; i++)
+  {
+    if (target->color_buffers[i]) glDeleteRenderbuffers(1, &target->color_buffers[i]);
+    if (target->color[i].id) r_destroy_texture2d(&target->color[i]);
+  }
+
+  if (target->depth_buffer) glDeleteRenderbuffers(1, &target->depth_buffer);
+  if (target->depth.id) r_destroy_texture2d(&target->depth);
+  *target = (R_RenderTarget) {0};
+}
+
+void r_bind_render_target(R_RenderTarget *target)
+{
+  if (target == NULL)
+  {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  glViewport(0, 0, target->desc.width, target->desc.height);
+}
+
+void r_end_render_target(R_RenderTarget *target, u32 keep)
+{
+  i32 w = target->desc.width;
+  i32 h = target->desc.height;
+  bool multisampled = target->desc.samples > 1;
+
+  // One blit per attachment, each to the matching resolve texture
+  if (multisampled && (keep & R_KEEP_COLOR))
+  {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, target->framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->resolve_framebuffer);
+    for (u32 i = 0; i < target->color_count; i++)
+    {
+      GLenum attachment = GL_COLOR_ATTACHMENT0 + i;
+      glReadBuffer(attachment);
+      glDrawBuffers(1, &attachment);
+      R_ASSERT(glBlitFramebuffer(0, 0, w, h, 0, 0, w, h, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->resolve_framebuffer);
+    r_set_draw_buffers(target->color_count);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+  }
+
+  GLenum discard[TARGET_MAX_COLOR + 1];
+  u32 discard_count = 0;
+  if (multisampled || !(keep & R_KEEP_COLOR))
+  {
+    for (u32 i = 0; i < target->color_count; i++)
+    {
+      discard[discard_count++] = GL_COLOR_ATTACHMENT0 + i;
+    }
+  }
+
+  if (target->desc.depth != TARGET_FORMAT_NONE && (multisampled || !(keep & R_KEEP_DEPTH)))
+  {
+    discard[discard_count++] = r_depth_attachment(target->desc.depth);
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  if (discard_count && r_caps.invalidate_framebuffer)
+  {
+    R_ASSERT(r_gl.invalidate_framebuffer(GL_FRAMEBUFFER, discard_count, discard));
+  }
+}
+
+void r_read_render_target(R_RenderTarget *target, u32 attachment, void *pixels)
+{
+  ASSERT(attachment < target->color_count);
+  const R_TextureFormatDesc *desc = &r_texture_formats[target->color[attachment].format];
+
+  u32 framebuffer = target->resolve_framebuffer ? target->resolve_framebuffer : target->framebuffer;
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glReadBuffer(GL_COLOR_ATTACHMENT0 + attachment);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  R_ASSERT(glReadPixels(0, 0, target->desc.width, target->desc.height, 
+                        desc->format, desc->type, pixels));
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadBuffer(GL_COLOR_ATTACHMENT0);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+static
+void r_pool_create_target(void *user, u32 slot, const TargetDesc *desc)
+{
+  R_TargetPool *pool = user;
+  pool->targets[slot] = r_create_render_target(desc);
+}
+
+static
+void r_pool_destroy_target(void *user, u32 slot)
+{
+  R_TargetPool *pool = user;
+  r_destroy_render_target(&pool->targets[slot]);
+}
+
+static
+TargetBackend r_target_backend(R_TargetPool *pool)
+{
+  return (TargetBackend)
+  {
+    .user = pool,
+    .create = r_pool_create_target,
+    .destroy = r_pool_destroy_target,
+  };
+}
+
+R_TargetPool r_create_target_pool(u32 max_targets, u32 max_idle_frames)
+{
+  R_TargetPool pool = {0};
+  pool.pool = target_pool_create(max_targets, max_idle_frames);
+  pool.targets = calloc(max_targets, sizeof (R_RenderTarget));
+
+  return pool;
+}
+
+void r_destroy_target_pool(R_TargetPool *pool)
+{
+  TargetBackend backend = r_target_backend(pool);
+  target_pool_destroy(&pool->pool, &backend);
+  free(pool->targets);
+  *pool = (R_TargetPool) {0};
+}
+
+R_RenderTarget *r_acquire_target(R_TargetPool *pool, const TargetDesc *desc)
+{
+  TargetBackend backend = r_target_backend(pool);
+  u32 slot = target_pool_acquire(&pool->pool, desc, &backend);
+
+  return slot == TARGET_NONE ? NULL : &pool->targets[slot];
+}
+
+void r_release_target(R_TargetPool *pool, R_RenderTarget *target)
+{
+  target_pool_release(&pool->pool, (u32) (target - pool->targets));
+}
+
+void r_target_pool_next_frame(R_TargetPool *pool)
+{
+  TargetBackend backend = r_target_backend(pool);
+  target_pool_next_frame(&pool->pool, &backend);
+}
+
+bool r_execute_graph(R_TargetPool *pool, FrameGraph *graph)
+{
+  TargetBackend backend = r_target_backend(pool);
+
+  return graph_execute(graph, &pool->pool, &backend);
+}
+
+R_RenderTarget *r_graph_target(R_TargetPool *pool, const FrameGraph *graph, u32 resource)
+{
+  u32 slot = graph_target(graph, resource);
+
+  return slot == TARGET_NONE ? NULL : &pool->targets[slot];
+}
+
+// @Draw ====================================================================================
+
+void r_clear(Vec4F color)
+{
+  glClearColor(color.r, color.g, color.b, color.a);
+  glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void r_draw(R_Mesh *mesh, Shader *shader)
+{
+  r_draw_lod(mesh, shader, 0);
+}
+
+void r_draw_lod(R_Mesh *mesh, Shader *shader, u32 lod)
+{
+  ASSERT(lod < mesh->lod_count);
+  MeshLod *range = &mesh->lods[lod];
+
+  r_bind_shader(shader);
+  r_bind_vertex_array(&mesh->vertex_array);
+  R_ASSERT(glDrawElements(GL_TRIANGLES, range->index_count, mesh->index_type, 
+                          (void *) ((u64) range->index_offset * mesh->index_size)));
+}
+
+// DrawBackend over GL, `user` is the R_DrawPack
+
+// Without base instance the instance stream itself is moved
+static
+void r_gl_set_base_instance(void *user, u32 base_instance)
+{
+  (void) user;
+  glVertexAttribIPointer(R_INSTANCE_LOCATION, 1, GL_UNSIGNED_INT, sizeof (u32), 
+                         (void *) ((u64) base_instance * sizeof (u32)));
+}
+
+static
+void r_gl_draw(void *user, const DrawCommand *command)
+{
+  R_DrawPack *pack = user;
+  R_Mesh *mesh = &pack->mesh;
+  R_ASSERT(glDrawElementsInstancedBaseVertex(GL_TRIANGLES, 
+                                             command->index_count, 
+                                             mesh->index_type, 
+                                             (void *) ((u64) command->first_index * mesh->index_size), 
+                                             command->instance_count, 
+                                             command->base_vertex));
+}
+
+static
+void r_gl_multi_draw(void *user, const DrawCommand *commands, u32 count)
+{
+  R_DrawPack *pack = user;
+  R_Mesh *mesh = &pack->mesh;
+
+  if (count > pack->scratch_cap)
+  {
+    pack->scratch_cap = MAX(count, pack->scratch_cap * 2);
+    pack->counts = realloc(pack->counts, sizeof (GLsizei) * pack->scratch_cap);
+    pack->offsets = realloc(pack->offsets, sizeof (void *) * pack->scratch_cap);
+    pack->base_vertices = realloc(pack->base_vertices, sizeof (GLint) * pack->scratch_cap);
+  }
+
+  for (u32 i = 0; i < count; i++)
+  {
+    pack->counts[i] = commands[i].index_count;
+    pack->offsets[i] = (void *) ((u64) commands[i].first_index * mesh->index_size);
+    pack->base_vertices[i] = commands[i].base_vertex;
+  }
+
+  R_ASSERT(glMultiDrawElementsBaseVertex(GL_TRIANGLES, pack->counts, mesh->index_type, 
+                                         pack->offsets, count, pack->base_vertices));
+}
+
+static
+void r_gl_multi_draw_indirect(void *user, const DrawCommand *commands, u32 count)
+{
+  R_DrawPack *pack = user;
+
+  // Orphaned every frame, the driver hands out fresh storage
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, pack->indirect_buffer.id);
+  glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof (DrawCommand) * count, commands, GL_STREAM_DRAW);
+  R_ASSERT(r_gl.multi_draw_elements_indirect(GL_TRIANGLES, pack->mesh.index_type, NULL, count, 0));
+}
+
+void r_draw_list(R_DrawPack *pack, Shader *shader, const DrawList *list, const u32 *instances)
+{
+  r_bind_shader(shader);
+  r_bind_vertex_array(&pack->mesh.vertex_array);
+
+  // With no instance data the attribute reads its current value, 0
+  if (instances != NULL)
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, pack->instance_buffer.id);
+    glBufferData(GL_ARRAY_BUFFER, sizeof (u32) * list->instance_count, instances, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(R_INSTANCE_LOCATION);
+  }
+  else glDisableVertexAttribArray(R_INSTANCE_LOCATION);
+
+  DrawPath path = r_caps.multi_draw_indirect ? DRAW_PATH_INDIRECT : 
+                  instances != NULL          ? DRAW_PATH_LOOP : 
+                                               DRAW_PATH_MULTI;
+
+  DrawBackend backend = 
+  {
+    .user = pack,
+    .set_base_instance = r_gl_set_base_instance,
+    .draw = r_gl_draw,
+    .multi_draw = r_gl_multi_draw,
+    .multi_draw_indirect = r_gl_multi_draw_indirect,
+  };
+  draw_list_submit(list, path, &backend);
+}
+
+void r_draw_geometry(R_GeometryPool *pool, Shader *shader, const R_Geometry *geometry)
+{
+  DrawCommand command = r_geometry_command(pool, geometry, 1);
+
+  r_bind_shader(shader);
+  r_bind_vertex_array(&pool->pages[geometry->page].vertex_array);
+  R_ASSERT(glDrawElementsBaseVertex(GL_TRIANGLES, command.index_count, pool->index_type, 
+                                    (void *) ((u64) command.first_index * pool->index_size), 
+                                    command.base_vertex));
+}
+
+// @Text ====================================================================================
+
+static const i8 *r_text_vert_src = 
+  "#version 410 core\n"
+  "layout (location = 0) in vec2 a_pos;\n"
+  "layout (location = 1) in vec2 a_uv;\n"
+  "layout (location = 2) in vec4 a_color;\n"
+  "out vec2 uv;\n"
+  "out vec4 color;\n"
+  "uniform mat4 u_xform;\n"
+  "void main() { gl_Position = vec4(a_pos, 0.0, 1.0) * u_xform; uv = a_uv; color = a_color; }\n";
+
+// Distance fields are cut at 0.5 with about a pixel of smoothing at any scale
+static const i8 *r_text_frag_src = 
+  "#version 410 core\n"
+  "in vec2 uv;\n"
+  "in vec4 color;\n"
+  "out vec4 frag_color;\n"
+  "uniform sampler2D u_atlas;\n"
+  "uniform int u_sdf;\n"
+  "void main()\n"
+  "{\n"
+  "  float a = texture(u_atlas, uv).r;\n"
+  "  if (u_sdf != 0)\n"
+  "  {\n"
+  "    float w = fwidth(a) * 0.5;\n"
+  "    a = smoothstep(0.5 - w, 0.5 + w, a);\n"
+  "  }\n"
+  "  frag_color = vec4(color.rgb, color.a * a);\n"
+  "}\n";
+
+R_TextBatch r_create_text_batch(FontMode mode, i32 atlas_size, u32 max_glyphs)
+{
+  static const R_VertexAttrib attribs[3] = 
+  {
+    {.location = 0, .count = 2, .type = GL_FLOAT},                              // position
+    {.location = 1, .count = 2, .type = GL_UNSIGNED_SHORT, .normalized = TRUE}, // uv
+    {.location = 2, .count = 4, .type = GL_UNSIGNED_BYTE, .normalized = TRUE},  // color
+  };
+
+  VertexFormat format = r_create_vertex_format(attribs, ARR_LEN(attribs));
+  ASSERT(format.strides[0] == sizeof (FontVertex));
+
+  R_TextBatch batch = {0};
+  batch.mode = mode;
+  batch.glyphs = r_create_dynamic_atlas(atlas_size, atlas_size, 1, max_glyphs);
+  batch.shader = r_create_shader(r_text_vert_src, r_text_frag_src);
+
+  // The index buffer binding is recorded in the vertex array bound here
+  batch.vertex_array = r_create_vertex_array();
+  batch.vertex_buffer = r_create_vertex_buffer(NULL, 0);
+  batch.index_buffer = r_create_index_buffer(NULL, 0);
+  r_set_vertex_format(&batch.vertex_array, &format);
+  r_bind_vertex_streams(&batch.vertex_array, &format, &batch.vertex_buffer);
+  r_unbind_vertex_array();
+
+  batch.quad_cap = 256;
+  batch.vertices = malloc(sizeof (FontVertex) * 4 * batch.quad_cap);
+  batch.layout_cap = 256;
+  batch.quads = malloc(sizeof (FontQuad) * batch.layout_cap);
+  batch.raster_cap = 64 * 64;
+  batch.raster = malloc(batch.raster_cap);
+
+  return batch;
+}
+
+void r_destroy_text_batch(R_TextBatch *batch)
+{
+  r_destroy_dynamic_atlas(&batch->glyphs);
+  glDeleteProgram(batch->shader.id);
+  glDeleteVertexArrays(1, &batch->vertex_array.id);
+  glDeleteBuffers(1, &batch->vertex_buffer.id);
+  glDeleteBuffers(1, &batch->index_buffer.id);
+  free(batch->vertices);
+  free(batch->quads);
+  free(batch->raster);
+  *batch = (R_TextBatch) {0};
+}
+
+// Rasterizes the glyph into the atlas unless it is still there from before
+static
+bool r_text_cache_glyph(R_TextBatch *batch, Font *font, u32 glyph)
+{
+  FontGlyph *g = &font->glyphs[glyph];
+  if (g->cached && r_dynamic_atlas_get(&batch->glyphs, g->handle, &g->uv)) return TRUE;
+
+  i32 w = g->x1 - g->x0;
+  i32 h = g->y1 - g->y0;
+  if ((u64) w * h > batch->raster_cap)
+  {
+    batch->raster_cap = (u64) w * h;
+    batch->raster = realloc(batch->raster, batch->raster_cap);
+  }
+
+  batch->glyph_misses++;
+  font_rasterize(font, glyph, batch->raster);
+  g->cached = r_dynamic_atlas_add(&batch->glyphs, batch->raster, w, h, &g->handle, &g->uv);
+
+  return g->cached;
+}
+
+void r_text(R_TextBatch *batch, Font *font, const i8 *text, Vec2F position, f32 size, 
+            Vec4F color)
+{
+  ASSERT(font->mode == batch->mode);
+
+  // A quad per byte at most
+  u32 length = (u32) strlen(text);
+  if (length > batch->layout_cap)
+  {
+    while (length > batch->layout_cap) batch->layout_cap *= 2;
+    batch->quads = realloc(batch->quads, sizeof (FontQuad) * batch->layout_cap);
+  }
+
+  u32 count = font_layout(font, text, position, size, batch->quads);
+
+  // Glyphs that can't be cached are left out
+  u32 kept = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (!r_text_cache_glyph(batch, font, batch->quads[i].glyph))
+    {
+      batch->dropped++;
+      continue;
+    }
+
+    batch->quads[kept++] = batch->quads[i];
+  }
+
+  if (batch->quad_count + kept > batch->quad_cap)
+  {
+    while (batch->quad_count + kept > batch->quad_cap) batch->quad_cap *= 2;
+    batch->vertices = realloc(batch->vertices, sizeof (FontVertex) * 4 * batch->quad_cap);
+  }
+
+  font_emit(font, batch->quads, kept, color, &batch->vertices[batch->quad_count * 4]);
+  batch->quad_count += kept;
+}
+
+void r_flush_text(R_TextBatch *batch, Vec2F viewport)
+{
+  r_flush_dynamic_atlas(&batch->glyphs);
+  if (batch->quad_count == 0) return;
+
+  r_bind_vertex_array(&batch->vertex_array);
+
+  // Quads share one index pattern, regenerated only when it runs short
+  if (batch->quad_count > batch->index_quads)
+  {
+    batch->index_quads = batch->quad_cap;
+    u32 *indices = malloc(sizeof (u32) * 6 * batch->index_quads);
+    for (u32 i = 0; i < batch->index_quads; i++)
+    {
+      u32 v = i * 4;
+      u32 *quad = &indices[i * 6];
+      quad[0] = v;
+      quad[1] = v + 2;
+      quad[2] = v + 1;
+      quad[3] = v + 1;
+      quad[4] = v + 2;
+      quad[5] = v + 3;
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->index_buffer.id);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof (u32) * 6 * batch->index_quads, 
+                 indices, GL_STATIC_DRAW);
+    free(indices);
+  }
+
+  // Orphaned each frame so the driver doesn't wait on last frame's draw
+  u64 size = sizeof (FontVertex) * 4 * batch->quad_count;
+  glBindBuffer(GL_ARRAY_BUFFER, batch->vertex_buffer.id);
+  glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, size, batch->vertices);
+
+  bool blend = glIsEnabled(GL_BLEND);
+  bool depth_test = glIsEnabled(GL_DEPTH_TEST);
+  GLint blend_src, blend_dst;
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDisable(GL_DEPTH_TEST);
+
+  Mat4x4F pixels = orthographic_4x4f(0.0f, viewport.x, viewport.y, 0.0f);
+  r_bind_shader(&batch->shader);
+  glActiveTexture(GL_TEXTURE0);
+  r_bind_texture2d(&batch->glyphs.texture);
+  r_set_uniform_4x4f(&batch->shader, "u_xform", pixels);
+  r_set_uniform_1i(&batch->shader, "u_atlas", 0);
+  r_set_uniform_1i(&batch->shader, "u_sdf", batch->mode == FONT_SDF);
+  R_ASSERT(glDrawElements(GL_TRIANGLES, batch->quad_count * 6, GL_UNSIGNED_INT, NULL));
+
+  glBlendFunc(blend_src, blend_dst);
+  if (!blend) glDisable(GL_BLEND);
+  if (depth_test) glEnable(GL_DEPTH_TEST);
+  r_unbind_vertex_array();
+
+  batch->quad_count = 0;
+}
+
+// @GpuTimers ===============================================================================
+
+R_GpuTimers r_create_gpu_timers(void)
+{
+  R_GpuTimers timers = {0};
+  glGenQueries(R_GPU_LATENCY * R_GPU_MAX_MARKS, &timers.queries[0][0]);
+
+  return timers;
+}
+
+void r_destroy_gpu_timers(R_GpuTimers *timers)
+{
+  glDeleteQueries(R_GPU_LATENCY * R_GPU_MAX_MARKS, &timers->queries[0][0]);
+  *timers = (R_GpuTimers) {0};
+}
+
+void r_gpu_mark(R_GpuTimers *timers)
+{
+  u32 frame = timers->frame % R_GPU_LATENCY;
+  if (timers->mark_counts[frame] == R_GPU_MAX_MARKS) return;
+
+  u32 query = timers->queries[frame][timers->mark_counts[frame]++];
+  R_ASSERT(glQueryCounter(query, GL_TIMESTAMP));
+}
+
+void r_gpu_timers_next_frame(R_GpuTimers *timers)
+{
+  timers->frame++;
+  u32 frame = timers->frame % R_GPU_LATENCY;
+  u32 count = timers->mark_counts[frame];
+  timers->mark_counts[frame] = 0;
+  if (count < 2) return;
+
+  // Marks complete in order, so the last one being there means all are;
+  // a frame the GPU still hasn't finished is skipped rather than waited on
+  u32 available = 0;
+  glGetQueryObjectuiv(timers->queries[frame][count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) return;
+
+  u64 prev = 0;
+  glGetQueryObjectui64v(timers->queries[frame][0], GL_QUERY_RESULT, &prev);
+  for (u32 i = 1; i < count; i++)
+  {
+    u64 time = 0;
+    glGetQueryObjectui64v(timers->queries[frame][i], GL_QUERY_RESULT, &time);
+    timers->ms[i - 1] = (f32) ((f64) (time - prev) / 1000000.0);
+    prev = time;
+  }
+
+  timers->ms_count = count - 1;
+}
+
+// @Post ====================================================================================
+
+// Fullscreen triangle from gl_VertexID, drawn with an empty vertex array
+static const i8 *r_post_vert_src = 
+  "#version 410 core\n"
+  "out vec2 uv;\n"
+  "void main()\n"
+  "{\n"
+  "  uv = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+  "  gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}\n";
+
+// 13 taps as five overlapping 2x2 boxes, which keeps small bright spots from
+// flickering as they move across texels. The first level also cuts the
+// scene at the threshold, with a quadratic knee below it.
+static const i8 *r_post_downsample_src = 
+  "#version 410 core\n"
+  "in vec2 uv;\n"
+  "out vec4 frag_color;\n"
+  "uniform sampler2D u_source;\n"
+  "uniform vec2 u_texel;\n"
+  "uniform int u_prefilter;\n"
+  "uniform vec4 u_threshold;\n" // threshold, threshold - knee, 2 * knee, 0.25 / knee
+  "vec3 tap(float x, float y) { return texture(u_source, uv + u_texel * vec2(x, y)).rgb; }\n"
+  "void main()\n"
+  "{\n"
+  "  vec3 c = tap(0.0, 0.0) * 0.125;\n"
+  "  c += (tap(-1.0, -1.0) + tap(1.0, -1.0) + tap(-1.0, 1.0) + tap(1.0, 1.0)) * 0.125;\n"
+  "  c += (tap(-2.0, -2.0) + tap(2.0, -2.0) + tap(-2.0, 2.0) + tap(2.0, 2.0)) * 0.03125;\n"
+  "  c += (tap(0.0, -2.0) + tap(-2.0, 0.0) + tap(2.0, 0.0) + tap(0.0, 2.0)) * 0.0625;\n"
+  "  if (u_prefilter != 0)\n"
+  "  {\n"
+  "    float br = max(c.r, max(c.g, c.b));\n"
+  "    float soft = clamp(br - u_threshold.y, 0.0, u_threshold.z);\n"
+  "    soft = soft * soft * u_threshold.w;\n"
+  "    c *= max(soft, br - u_threshold.x) / max(br, 1e-4);\n"
+  "  }\n"
+  "  frag_color = vec4(c, 1.0);\n"
+  "}\n";
+
+// 3x3 tent, added onto the larger level by the blend
+static const i8 *r_post_upsample_src = 
+  "#version 410 core\n"
+  "in vec2 uv;\n"
+  "out vec4 frag_color;\n"
+  "uniform sampler2D u_source;\n"
+  "uniform vec2 u_texel;\n"
+  "uniform float u_radius;\n"
+  "vec3 tap(float x, float y)\n"
+  "{\n"
+  "  return texture(u_source, uv + u_texel * u_radius * vec2(x, y)).rgb;\n"
+  "}\n"
+  "void main()\n"
+  "{\n"
+  "  vec3 c = tap(0.0, 0.0) * 4.0;\n"
+  "  c += (tap(0.0, -1.0) + tap(-1.0, 0.0) + tap(1.0, 0.0) + tap(0.0, 1.0)) * 2.0;\n"
+  "  c += tap(-1.0, -1.0) + tap(1.0, -1.0) + tap(-1.0, 1.0) + tap(1.0, 1.0);\n"
+  "  frag_color = vec4(c / 16.0, 1.0);\n"
+  "}\n";
+
+// Same curves as post_tonemap_aces and post_linear_to_srgb
+static const i8 *r_post_tonemap_src = 
+  "#version 410 core\n"
+  "in vec2 uv;\n"
+  "out vec4 frag_color;\n"
+  "uniform sampler2D u_scene;\n"
+  "uniform sampler2D u_bloom;\n"
+  "uniform float u_exposure;\n"
+  "uniform float u_bloom_intensity;\n"
+  "vec3 aces(vec3 x)\n"
+  "{\n"
+  "  return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);\n"
+  "}\n"
+  "vec3 srgb(vec3 c)\n"
+  "{\n"
+  "  vec3 curve = 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055;\n"
+  "  return mix(c * 12.92, curve, step(vec3(0.0031308), c));\n"
+  "}\n"
+  "void main()\n"
+  "{\n"
+  "  vec3 hdr = texture(u_scene, uv).rgb + texture(u_bloom, uv).rgb * u_bloom_intensity;\n"
+  "  frag_color = vec4(srgb(aces(hdr * u_exposure)), 1.0);\n"
+  "}\n";
+
+R_Post r_create_post(i32 width, i32 height)
+{
+  R_Post post = {0};
+  post.settings = (R_PostSettings)
+  {
+    .exposure = 1.0f,
+    .bloom_threshold = 1.0f,
+    .bloom_knee = 0.5f,
+    .bloom_intensity = 0.5f,
+    .bloom_radius = 1.0f,
+  };
+
+  TargetDesc scene = {width, height, {TARGET_FORMAT_RGBA16F}, TARGET_FORMAT_DEPTH24, 1};
+  post.scene = r_create_render_target(&scene);
+
+  post.bloom_levels = post_bloom_levels(width, height);
+  if (post.bloom_levels)
+  {
+    // Filtering within a level only, so a pass reads nothing but the base
+    // level it is pointed at
+    post.bloom = r_create_texture2d(width / 2, height / 2, R_TEXTURE_FORMAT_RGBA16F, NULL, TRUE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glGenFramebuffers(post.bloom_levels, post.bloom_framebuffers);
+    for (u32 i = 0; i < post.bloom_levels; i++)
+    {
+      glBindFramebuffer(GL_FRAMEBUFFER, post.bloom_framebuffers[i]);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 
+                             post.bloom.id, i);
+      ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  post.downsample = r_create_shader(r_post_vert_src, r_post_downsample_src);
+  post.upsample = r_create_shader(r_post_vert_src, r_post_upsample_src);
+  post.tonemap = r_create_shader(r_post_vert_src, r_post_tonemap_src);
+  post.vertex_array = r_create_vertex_array();
+  r_unbind_vertex_array();
+  post.timers = r_create_gpu_timers();
+
+  return post;
+}
+
+void r_destroy_post(R_Post *post)
+{
+  r_destroy_render_target(&post->scene);
+  if (post->bloom_levels)
+  {
+    glDeleteFramebuffers(post->bloom_levels, post->bloom_framebuffers);
+    r_destroy_texture2d(&post->bloom);
+  }
+
+  glDeleteProgram(post->downsample.id);
+  glDeleteProgram(post->upsample.id);
+  glDeleteProgram(post->tonemap.id);
+  glDeleteVertexArrays(1, &post->vertex_array.id);
+  r_destroy_gpu_timers(&post->timers);
+  *post = (R_Post) {0};
+}
+
+void r_begin_post(R_Post *post)
+{
+  r_gpu_timers_next_frame(&post->timers);
+  r_gpu_mark(&post->timers);
+  r_bind_render_target(&post->scene);
 }
+
+// Points the bound bloom texture at one level, the only one sampled
+static
+void r_post_read_level(u32 level)
+{
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level);
+}
+
+static
+Vec2F r_post_texel(i32 width, i32 height, u32 level)
+{
+  return v2f(1.0f / MAX(width >> level, 1), 1.0f / MAX(height >> level, 1));
+}
+
+static
+void r_post_draw_level(R_Post *post, u32 level)
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, post->bloom_framebuffers[level]);
+  glViewport(0, 0, MAX(post->bloom.width >> level, 1), MAX(post->bloom.height >> level, 1));
+  R_ASSERT(glDrawArrays(GL_TRIANGLES, 0, 3));
+}
+
+void r_end_post(R_Post *post)
+{
+  R_PostSettings *s = &post->settings;
+  i32 w = post->scene.desc.width;
+  i32 h = post->scene.desc.height;
+
+  r_gpu_mark(&post->timers);
+  r_end_render_target(&post->scene, R_KEEP_COLOR);
+
+  bool blend = glIsEnabled(GL_BLEND);
+  bool depth_test = glIsEnabled(GL_DEPTH_TEST);
+  GLint blend_src, blend_dst;
+  glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src);
+  glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst);
+  glDisable(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+
+  r_bind_vertex_array(&post->vertex_array);
+  glActiveTexture(GL_TEXTURE0);
+
+  // Level 0 from the scene, each level after from the one before
+  f32 knee = MAX(s->bloom_threshold * s->bloom_knee, 1e-4f);
+  Vec4F threshold = v4f(s->bloom_threshold, s->bloom_threshold - knee, 2.0f * knee, 0.25f / knee);
+  r_bind_shader(&post->downsample);
+  r_set_uniform_1i(&post->downsample, "u_source", 0);
+  r_set_uniform_4f(&post->downsample, "u_threshold", threshold);
+  for (u32 i = 0; i < post->bloom_levels; i++)
+  {
+    if (i == 0)
+    {
+      r_bind_texture2d(&post->scene.color[0]);
+      r_set_uniform_2f(&post->downsample, "u_texel", r_post_texel(w, h, 0));
+    }
+    else
+    {
+      r_bind_texture2d(&post->bloom);
+      r_post_read_level(i - 1);
+      r_set_uniform_2f(&post->downsample, "u_texel", 
+                       r_post_texel(post->bloom.width, post->bloom.height, i - 1));
+    }
+
+    r_set_uniform_1i(&post->downsample, "u_prefilter", i == 0);
+    r_post_draw_level(post, i);
+  }
+
+  r_gpu_mark(&post->timers);
+
+  // Smallest level up; level 0 ends up holding every level blurred together
+  r_bind_shader(&post->upsample);
+  r_set_uniform_1i(&post->upsample, "u_source", 0);
+  r_set_uniform_1f(&post->upsample, "u_radius", s->bloom_radius);
+  r_bind_texture2d(&post->bloom);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  for (u32 i = post->bloom_levels; i > 1; i--)
+  {
+    r_post_read_level(i - 1);
+    r_set_uniform_2f(&post->upsample, "u_texel", 
+                     r_post_texel(post->bloom.width, post->bloom.height, i - 1));
+    r_post_draw_level(post, i - 2);
+  }
+
+  glDisable(GL_BLEND);
+  r_gpu_mark(&post->timers);
+
+  // The scene at full size with bloom level 0 stretched over it
+  r_bind_render_target(NULL);
+  glViewport(0, 0, w, h);
+  r_bind_shader(&post->tonemap);
+  r_set_uniform_1i(&post->tonemap, "u_scene", 0);
+  r_set_uniform_1i(&post->tonemap, "u_bloom", 1);
+  r_set_uniform_1f(&post->tonemap, "u_exposure", s->exposure);
+  r_set_uniform_1f(&post->tonemap, "u_bloom_intensity", 
+                   post->bloom_levels ? s->bloom_intensity : 0.0f);
+  r_bind_texture2d(&post->scene.color[0]);
+  glActiveTexture(GL_TEXTURE1);
+  r_bind_texture2d(&post->bloom);
+  if (post->bloom_levels) r_post_read_level(0);
+  R_ASSERT(glDrawArrays(GL_TRIANGLES, 0, 3));
+  r_unbind_texture2d();
+  glActiveTexture(GL_TEXTURE0);
+
+  r_gpu_mark(&post->timers);
+
+  glBlendFunc(blend_src, blend_dst);
+  if (blend) glEnable(GL_BLEND);
+  if (depth_test) glEnable(GL_DEPTH_TEST);
+  r_unbind_vertex_array();
+}
+
+// @Debug ===================================================================================
+
+#ifdef DEBUG
+
+static const i8 *r_debug_vert_src = 
+  "#version 410 core\n"
+  "layout (location = 0) in vec3 a_pos;\n"
+  "layout (location = 1) in vec4 a_color;\n"
+  "out vec4 color;\n"
+  "uniform mat4 u_xform;\n"
+  "void main() { gl_Position = vec4(a_pos, 1.0) * u_xform; color = a_color; }\n";
+
+static const i8 *r_debug_frag_src = 
+  "#version 410 core\n"
+  "in vec4 color;\n"
+  "out vec4 frag_color;\n"
+  "void main() { frag_color = color; }\n";
+
+typedef struct R_DebugDraw R_DebugDraw;
+struct R_DebugDraw
+{
+  Shader shader;
+  Object vertex_array;
+  Object vertex_buffer;
+};
+
+static R_DebugDraw r_debug;
+
+void r_flush_debug(Mat4x4F view_proj, Vec2F viewport)
+{
+  u32 depth_count = dbg_frame.lines[DBG_DEPTH].count;
+  u32 overlay_count = dbg_frame.lines[DBG_OVERLAY].count;
+  u32 text_count = dbg_frame.text.count;
+  if (depth_count + overlay_count + text_count == 0) return;
+
+  if (r_debug.shader.id == 0)
+  {
+    static const R_VertexAttrib attribs[2] = 
+    {
+      {.location = 0, .count = 3, .type = GL_FLOAT},                            // position
+      {.location = 1, .count = 4, .type = GL_UNSIGNED_BYTE, .normalized = TRUE}, // color
+    };
+
+    VertexFormat format = r_create_vertex_format(attribs, ARR_LEN(attribs));
+    ASSERT(format.strides[0] == sizeof (DbgVertex));
+
+    r_debug.shader = r_create_shader(r_debug_vert_src, r_debug_frag_src);
+    r_debug.vertex_array = r_create_vertex_array();
+    r_debug.vertex_buffer = r_create_vertex_buffer(NULL, 0);
+    r_set_vertex_format(&r_debug.vertex_array, &format);
+    r_bind_vertex_streams(&r_debug.vertex_array, &format, &r_debug.vertex_buffer);
+  }
+
+  // One orphaned upload for the frame, batches back to back
+  DbgBatch *batches[3] = 
+  {
+    &dbg_frame.lines[DBG_DEPTH], 
+    &dbg_frame.lines[DBG_OVERLAY], 
+    &dbg_frame.text,
+  };
+  u64 size = sizeof (DbgVertex) * ((u64) depth_count + overlay_count + text_count);
+  glBindBuffer(GL_ARRAY_BUFFER, r_debug.vertex_buffer.id);
+  glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+  u64 offset = 0;
+  for (u32 i = 0; i < ARR_LEN(batches); i++)
+  {
+    u64 batch_size = sizeof (DbgVertex) * batches[i]->count;
+    if (batch_size) glBufferSubData(GL_ARRAY_BUFFER, offset, batch_size, batches[i]->vertices);
+    offset += batch_size;
+  }
+
+  bool depth_test = glIsEnabled(GL_DEPTH_TEST);
+  r_bind_shader(&r_debug.shader);
+  r_bind_vertex_array(&r_debug.vertex_array);
+  r_set_uniform_4x4f(&r_debug.shader, "u_xform", view_proj);
+
+  if (depth_count)
+  {
+    glEnable(GL_DEPTH_TEST);
+    R_ASSERT(glDrawArrays(GL_LINES, 0, depth_count));
+  }
+
+  glDisable(GL_DEPTH_TEST);
+  if (overlay_count)
+  {
+    R_ASSERT(glDrawArrays(GL_LINES, depth_count, overlay_count));
+  }
+
+  if (text_count)
+  {
+    Mat4x4F pixels = orthographic_4x4f(0.0f, viewport.x, viewport.y, 0.0f);
+    r_set_uniform_4x4f(&r_debug.shader, "u_xform", pixels);
+    R_ASSERT(glDrawArrays(GL_TRIANGLES, depth_count + overlay_count, text_count));
+  }
+
+  if (depth_test) glEnable(GL_DEPTH_TEST);
+  r_unbind_vertex_array();
+  dbg_clear();
+}
+
+#endif
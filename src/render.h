@@ -5,31 +5,136 @@
 
 #include "base_common.h"
 #include "base_math.h"
+#include "atlas.h"
+#include "image.h"
+#include "mesh.h"
+#include "draw.h"
+#include "heap.h"
+#include "dbg.h"
+#include "font.h"
+#include "target.h"
+#include "graph.h"
+#include "post.h"
 
-typedef struct R_Vertex R_Vertex;
-struct R_Vertex
+typedef struct R_Caps R_Caps;
+struct R_Caps
 {
-  f32 position[3];
-  f32 color[3];
+  i32 version; // major * 10 + minor
+  bool s3tc;
+  bool bptc;
+  bool texture_storage;
+  bool vertex_attrib_binding;
+  bool multi_draw_indirect; // With base instance
+  bool invalidate_framebuffer;
 };
 
-typedef struct R_VertexLayout R_VertexLayout;
-struct R_VertexLayout
+#define R_MAX_VERTEX_ATTRIBS 8
+#define R_MAX_VERTEX_STREAMS 4
+
+// One attribute of a vertex format. `stream` picks the vertex buffer it is
+// read from, so positions can live apart from the rest (e.g. for depth-only
+// passes).
+typedef struct R_VertexAttrib R_VertexAttrib;
+struct R_VertexAttrib
 {
-  u32 index;
+  u32 location;
   u32 count;
-  GLenum data_type;
+  GLenum type;
   bool normalized;
-  u32 stride;
-  void *first;
+  u32 stream;
+  u32 offset; // Filled in by r_create_vertex_format
+};
+
+// Attributes are laid out in declaration order within their stream, each
+// starting on a 4-byte boundary, which matches C structs like VertexHalf.
+typedef struct R_VertexFormat R_VertexFormat;
+struct R_VertexFormat
+{
+  R_VertexAttrib attribs[R_MAX_VERTEX_ATTRIBS];
+  u32 attrib_count;
+  u32 strides[R_MAX_VERTEX_STREAMS];
+  u32 stream_count;
 };
 
 typedef struct R_Object R_Object;
 struct R_Object
 {
   u32 id;
-  u8 attrib_count;
-  u8 attrib_index;
+};
+
+// Vertex array with its buffers. Draws take the index range and type from
+// here; levels of detail are ranges of the one index buffer.
+typedef struct R_Mesh R_Mesh;
+struct R_Mesh
+{
+  R_Object vertex_array;
+  R_Object vertex_buffer;
+  R_Object index_buffer;
+  u32 index_count;
+  GLenum index_type;
+  u32 index_size;
+  MeshLod lods[MESH_MAX_LODS];
+  u32 lod_count;
+};
+
+#define R_INSTANCE_LOCATION 7
+
+// A DrawPack on the GPU. The instance stream is one u32 per instance slot at
+// location R_INSTANCE_LOCATION (a uint attribute with divisor 1), usually an
+// index into per-object data.
+typedef struct R_DrawPack R_DrawPack;
+struct R_DrawPack
+{
+  R_Mesh mesh;
+  R_Object instance_buffer;
+  R_Object indirect_buffer;
+
+  // Scratch for glMultiDrawElementsBaseVertex
+  GLsizei *counts;
+  const void **offsets;
+  GLint *base_vertices;
+  u32 scratch_cap;
+};
+
+#define R_GEOMETRY_MAX_PAGES 8
+
+// One vertex and one index buffer, suballocated, with a vertex array over
+// them. Everything in a page can be drawn with the vertex array bound once.
+typedef struct R_GeometryPage R_GeometryPage;
+struct R_GeometryPage
+{
+  R_Object vertex_array;
+  R_Object vertex_buffer;
+  R_Object index_buffer;
+  Heap vertices;
+  Heap indices;
+};
+
+// Meshes of one vertex format and index size share a few large buffers
+// instead of owning a buffer object each. Pages are created as the ones
+// before fill up.
+typedef struct R_GeometryPool R_GeometryPool;
+struct R_GeometryPool
+{
+  R_VertexFormat format;
+  u32 index_size;
+  GLenum index_type;
+  u64 vertex_bytes;
+  u64 index_bytes;
+  u32 max_allocs;
+
+  R_GeometryPage pages[R_GEOMETRY_MAX_PAGES];
+  u32 page_count;
+};
+
+typedef struct R_Geometry R_Geometry;
+struct R_Geometry
+{
+  u32 page;
+  HeapHandle vertices;
+  HeapHandle indices;
+  u32 vertex_count;
+  u32 index_count;
 };
 
 typedef struct R_Shader R_Shader;
@@ -38,6 +143,34 @@ struct R_Shader
   u32 id;
 };
 
+typedef enum R_TextureFormat
+{
+  R_TEXTURE_FORMAT_R8,
+  R_TEXTURE_FORMAT_RG8,
+  R_TEXTURE_FORMAT_RGB8,
+  R_TEXTURE_FORMAT_RGBA8,
+  R_TEXTURE_FORMAT_SRGB8,
+  R_TEXTURE_FORMAT_SRGB8_A8,
+  R_TEXTURE_FORMAT_R16F,
+  R_TEXTURE_FORMAT_RGBA16F,
+  R_TEXTURE_FORMAT_R11G11B10F,
+  R_TEXTURE_FORMAT_DEPTH24,
+  R_TEXTURE_FORMAT_DEPTH32F,
+  R_TEXTURE_FORMAT_DEPTH24_STENCIL8,
+  R_TEXTURE_FORMAT_COUNT,
+} R_TextureFormat;
+
+typedef struct R_TextureFormatDesc R_TextureFormatDesc;
+struct R_TextureFormatDesc
+{
+  GLenum internal_format;
+  GLenum format;
+  GLenum type;
+  u8 channels;
+  u8 bytes_per_pixel;
+  bool srgb;
+};
+
 typedef struct R_Texture2D R_Texture2D;
 struct R_Texture2D
 {
@@ -46,9 +179,165 @@ struct R_Texture2D
   i32 height;
   i32 num_channels;
   u8 *data;
+  R_TextureFormat format;
+  i32 mip_count;
+  u64 gpu_bytes;
+  u64 cpu_bytes;
+};
+
+typedef struct R_Atlas R_Atlas;
+struct R_Atlas
+{
+  R_Texture2D *pages;
+  u32 page_count;
+  const AtlasSprite *sprites;
+  u32 sprite_count;
+};
+
+typedef struct R_AtlasStats R_AtlasStats;
+struct R_AtlasStats
+{
+  f32 occupancy;
+  u32 evictions;
+  u32 upload_calls;
+  u64 upload_bytes;
+  u64 upload_bytes_total;
 };
 
-#define DEBUG
+// Atlas filled at runtime. Pixels land in a CPU shadow copy and dirty regions
+// are uploaded once per frame in r_flush_dynamic_atlas.
+typedef struct R_DynamicAtlas R_DynamicAtlas;
+struct R_DynamicAtlas
+{
+  R_Texture2D texture;
+  ShelfAtlas alloc;
+  GLenum format;
+
+  AtlasRect *dirty;
+  u32 dirty_count;
+  u32 dirty_cap;
+
+  R_AtlasStats stats;
+};
+
+// Text for one screen, drawn in a single call. Glyph bitmaps are cached in
+// `glyphs` on first use and stay until their shelf is evicted; a font must
+// only ever be drawn through one batch since its glyphs remember where they
+// were cached.
+typedef struct R_TextBatch R_TextBatch;
+struct R_TextBatch
+{
+  FontMode mode;
+  R_DynamicAtlas glyphs;
+  R_Shader shader;
+  R_Object vertex_array;
+  R_Object vertex_buffer;
+  R_Object index_buffer;
+  u32 index_quads;
+
+  FontVertex *vertices;
+  u32 quad_count;
+  u32 quad_cap;
+  FontQuad *quads;
+  u32 layout_cap;
+  u8 *raster;
+  u64 raster_cap;
+
+  u32 glyph_misses;
+  u32 dropped;
+};
+
+// A framebuffer and its attachments. Single sampled targets draw straight
+// into `color` and `depth`, which can be sampled afterwards. Multisampled
+// ones draw into renderbuffers and r_end_render_target resolves the colors
+// into `color`; their depth stays in a renderbuffer.
+typedef struct R_RenderTarget R_RenderTarget;
+struct R_RenderTarget
+{
+  TargetDesc desc;
+  u32 framebuffer;
+  u32 resolve_framebuffer;
+  u32 color_buffers[TARGET_MAX_COLOR];
+  u32 depth_buffer;
+  R_Texture2D color[TARGET_MAX_COLOR];
+  R_Texture2D depth;
+  u32 color_count;
+};
+
+// What r_end_render_target keeps for later passes. The rest is invalidated
+// so tiled GPUs don't write it back to memory.
+typedef enum R_TargetKeep
+{
+  R_KEEP_NONE = 0,
+  R_KEEP_COLOR = 1 << 0,
+  R_KEEP_DEPTH = 1 << 1,
+} R_TargetKeep;
+
+// TargetPool slots backed by render targets, which stay put for the pool's
+// lifetime.
+typedef struct R_TargetPool R_TargetPool;
+struct R_TargetPool
+{
+  TargetPool pool;
+  R_RenderTarget *targets;
+};
+
+#define R_GPU_MAX_MARKS 8
+#define R_GPU_LATENCY 3
+
+// GL_TIMESTAMP queries marked through the frame. Results are read
+// R_GPU_LATENCY frames later, once the GPU is done with them, so reading
+// never stalls.
+typedef struct R_GpuTimers R_GpuTimers;
+struct R_GpuTimers
+{
+  u32 queries[R_GPU_LATENCY][R_GPU_MAX_MARKS];
+  u32 mark_counts[R_GPU_LATENCY];
+  u32 frame;
+
+  // Milliseconds between consecutive marks of the last frame read back
+  f32 ms[R_GPU_MAX_MARKS - 1];
+  u32 ms_count;
+};
+
+typedef struct R_PostSettings R_PostSettings;
+struct R_PostSettings
+{
+  f32 exposure;
+  f32 bloom_threshold; // Luminance where bloom starts
+  f32 bloom_knee;      // Fraction of the threshold blended in softly below it
+  f32 bloom_intensity;
+  f32 bloom_radius;    // Of the upsample tent, in source texels
+};
+
+// Stages of R_Post::timers.ms
+typedef enum R_PostTimer
+{
+  R_POST_TIMER_SCENE,
+  R_POST_TIMER_DOWNSAMPLE,
+  R_POST_TIMER_UPSAMPLE,
+  R_POST_TIMER_TONEMAP,
+  R_POST_TIMER_COUNT,
+} R_PostTimer;
+
+// HDR scene target and the bloom mip chain. Each bloom level has its own
+// framebuffer; passes read the level before through GL_TEXTURE_BASE_LEVEL.
+typedef struct R_Post R_Post;
+struct R_Post
+{
+  R_RenderTarget scene;
+  R_Texture2D bloom;
+  u32 bloom_framebuffers[POST_MAX_BLOOM_LEVELS];
+  u32 bloom_levels;
+
+  R_Shader downsample;
+  R_Shader upsample;
+  R_Shader tonemap;
+  R_Object vertex_array;
+
+  R_PostSettings settings;
+  R_GpuTimers timers;
+};
 
 #ifdef DEBUG
 #define R_ASSERT(call) \
@@ -60,9 +349,13 @@ struct R_Texture2D
   call;
 #endif
 
+extern R_Caps r_caps;
+
 bool _r_check_error(void);
 void _r_clear_error(void);
 
+void r_init(void);
+
 // @Shader ==================================================================================
 
 R_Shader r_create_shader(const i8 *vert_src, const i8 *frag_src);
@@ -75,6 +368,7 @@ i32 r_set_uniform_2f(R_Shader *shader, i8 *name, Vec2F vec);
 i32 r_set_uniform_3f(R_Shader *shader, i8 *name, Vec3F vec);
 i32 r_set_uniform_4f(R_Shader *shader, i8 *name, Vec4F vec);
 i32 r_set_uniform_3x3f(R_Shader *shader, i8 *name, Mat3x3F mat);
+i32 r_set_uniform_a2f(R_Shader *shader, i8 *name, Affine2F xform);
 i32 r_set_uniform_4x4f(R_Shader *shader, i8 *name, Mat4x4F mat);
 
 // @Buffer ==================================================================================
@@ -88,20 +382,163 @@ void r_unbind_index_buffer(void);
 
 // @VertexArray =============================================================================
 
-R_Object r_create_vertex_array(u8 attrib_count);
+R_Object r_create_vertex_array(void);
 void r_bind_vertex_array(R_Object *vertex_array);
 void r_unbind_vertex_array(void);
-R_VertexLayout r_create_vertex_layout(R_Object *v_arr, GLenum type, u32 count);
-void r_bind_vertex_layout(R_VertexLayout *layout);
+
+R_VertexFormat r_create_vertex_format(const R_VertexAttrib *attribs, u32 attrib_count);
+void r_set_vertex_format(R_Object *vertex_array, const R_VertexFormat *format);
+void r_bind_vertex_streams(R_Object *vertex_array, const R_VertexFormat *format, 
+                           const R_Object *buffers);
+
+// @Mesh ====================================================================================
+
+// Vertices in a single stream; `index_size` is 2 or 4. The mesh gets a single
+// level over all indices.
+R_Mesh r_create_mesh(const R_VertexFormat *format, const void *vertices, u32 vertex_count, 
+                     const void *indices, u32 index_count, u32 index_size);
+
+// MeshVertex attributes go to location 0 (position), 2 (uv) and 3 (normal).
+// Keeps the mesh's levels of detail.
+R_Mesh r_upload_mesh(const Mesh *mesh);
+R_Mesh r_load_mesh(const i8 *path);
+void r_destroy_mesh(R_Mesh *mesh);
+
+R_DrawPack r_create_draw_pack(const DrawPack *pack);
+void r_destroy_draw_pack(R_DrawPack *pack);
+
+// @GeometryPool ============================================================================
+
+// `vertex_bytes` and `index_bytes` size each page's buffers, `max_allocs` is
+// the number of meshes per page.
+R_GeometryPool r_create_geometry_pool(const R_VertexFormat *format, u32 index_size, 
+                                      u64 vertex_bytes, u64 index_bytes, u32 max_allocs);
+void r_destroy_geometry_pool(R_GeometryPool *pool);
+
+// Indices are relative to the mesh, like r_create_mesh's. FALSE when the mesh
+// fits in no page and no page can be added.
+bool r_geometry_alloc(R_GeometryPool *pool, const void *vertices, u32 vertex_count, 
+                      const void *indices, u32 index_count, R_Geometry *geometry);
+void r_geometry_free(R_GeometryPool *pool, R_Geometry *geometry);
+
+// Where the geometry is now; it changes after r_geometry_defrag.
+DrawCommand r_geometry_command(const R_GeometryPool *pool, const R_Geometry *geometry, 
+                               u32 instance_count);
+
+// Compacts each page by copying about `max_bytes` on the GPU. Returns the
+// number of vertex and index ranges moved.
+u32 r_geometry_defrag(R_GeometryPool *pool, u64 max_bytes);
 
 // @Texture =================================================================================
 
-R_Texture2D r_create_texture2d(const i8 *path);
+extern const R_TextureFormatDesc r_texture_formats[R_TEXTURE_FORMAT_COUNT];
+
+R_Texture2D r_create_texture2d(i32 width, i32 height, R_TextureFormat format, 
+                               const void *pixels, bool mips);
+R_Texture2D r_load_texture2d(const i8 *path, bool srgb);
+void r_destroy_texture2d(R_Texture2D *texture);
 void r_bind_texture2d(R_Texture2D *texture);
 void r_unbind_texture2d(void);
-void r_gen_texture2d(R_Texture2D *texture);
+R_Texture2D r_load_texture2d_compressed(const i8 *path);
+
+// @RenderTarget ============================================================================
+
+R_RenderTarget r_create_render_target(const TargetDesc *desc);
+void r_destroy_render_target(R_RenderTarget *target);
+
+// Sets the viewport to the whole target. NULL binds the default framebuffer
+// and leaves the viewport alone.
+void r_bind_render_target(R_RenderTarget *target);
+
+// Resolves multisampled colors when they are kept, then invalidates what
+// isn't. Multisampled attachments are always invalidated, resolved or not.
+void r_end_render_target(R_RenderTarget *target, u32 keep);
+
+// Reads back a color attachment, resolved, in its upload format with rows
+// tightly packed, bottom row first
+void r_read_render_target(R_RenderTarget *target, u32 attachment, void *pixels);
+
+R_TargetPool r_create_target_pool(u32 max_targets, u32 max_idle_frames);
+void r_destroy_target_pool(R_TargetPool *pool);
+
+// NULL when the pool is full
+R_RenderTarget *r_acquire_target(R_TargetPool *pool, const TargetDesc *desc);
+void r_release_target(R_TargetPool *pool, R_RenderTarget *target);
+void r_target_pool_next_frame(R_TargetPool *pool);
+
+// Runs a compiled graph on physical targets from `pool`. Passes look up their
+// targets with r_graph_target, NULL for imported ones.
+bool r_execute_graph(R_TargetPool *pool, FrameGraph *graph);
+R_RenderTarget *r_graph_target(R_TargetPool *pool, const FrameGraph *graph, u32 resource);
+
+// @Atlas ===================================================================================
+
+R_Atlas r_load_atlas(const i8 **page_paths, u32 page_count, 
+                     const AtlasSprite *sprites, u32 sprite_count);
+bool r_atlas_lookup(R_Atlas *atlas, const i8 *name, R_Texture2D **page, Vec4F *uv);
+
+R_DynamicAtlas r_create_dynamic_atlas(i32 width, i32 height, i32 num_channels, u32 max_entries);
+void r_destroy_dynamic_atlas(R_DynamicAtlas *atlas);
+bool r_dynamic_atlas_add(R_DynamicAtlas *atlas, const u8 *pixels, i32 w, i32 h, 
+                         AtlasHandle *handle, Vec4F *uv);
+bool r_dynamic_atlas_get(R_DynamicAtlas *atlas, AtlasHandle handle, Vec4F *uv);
+void r_flush_dynamic_atlas(R_DynamicAtlas *atlas);
 
 // @Draw ====================================================================================
 
 void r_clear(Vec4F color);
-void r_draw(R_Object *vertex_array, R_Shader *shader);
+void r_draw(R_Mesh *mesh, R_Shader *shader);
+void r_draw_lod(R_Mesh *mesh, R_Shader *shader, u32 lod);
+
+// `instances` holds list->instance_count values for the instance stream.
+// Submits with DRAW_PATH_INDIRECT when available, otherwise DRAW_PATH_LOOP,
+// or DRAW_PATH_MULTI when `instances` is NULL.
+void r_draw_list(R_DrawPack *pack, R_Shader *shader, const DrawList *list, const u32 *instances);
+void r_draw_geometry(R_GeometryPool *pool, R_Shader *shader, const R_Geometry *geometry);
+
+// @Text ====================================================================================
+
+// `atlas_size` squared single channel texels hold up to `max_glyphs`
+R_TextBatch r_create_text_batch(FontMode mode, i32 atlas_size, u32 max_glyphs);
+void r_destroy_text_batch(R_TextBatch *batch);
+
+// Lays out UTF-8 `text` from the top left `position`, `size` pixels tall,
+// and queues it. Glyphs that don't fit in the atlas are counted in `dropped`.
+void r_text(R_TextBatch *batch, Font *font, const i8 *text, Vec2F position, f32 size, 
+            Vec4F color);
+
+// Uploads new glyphs and draws everything queued with one call, in pixels of
+// a `viewport` sized target, alpha blended. Blend state is restored.
+void r_flush_text(R_TextBatch *batch, Vec2F viewport);
+
+// @GpuTimers ===============================================================================
+
+R_GpuTimers r_create_gpu_timers(void);
+void r_destroy_gpu_timers(R_GpuTimers *timers);
+void r_gpu_mark(R_GpuTimers *timers);
+
+// Reads back the frame that used this frame's queries before, if the GPU is
+// done with it, and starts marking the new frame
+void r_gpu_timers_next_frame(R_GpuTimers *timers);
+
+// @Post ====================================================================================
+
+R_Post r_create_post(i32 width, i32 height);
+void r_destroy_post(R_Post *post);
+
+// Binds the HDR scene target; draw the frame after this
+void r_begin_post(R_Post *post);
+
+// Blooms the scene and tonemaps it into the default framebuffer. Blend and
+// depth test state are restored, the viewport is left covering the window.
+void r_end_post(R_Post *post);
+
+// @Debug ===================================================================================
+
+#ifdef DEBUG
+// Draws and clears dbg_frame. Lines go through `view_proj`, text is in
+// pixels of a `viewport` sized target. Depth test state is restored.
+void r_flush_debug(Mat4x4F view_proj, Vec2F viewport);
+#else
+#define r_flush_debug(...) ((void) 0)
+#endif
@@ -0,0 +1,803 @@
+// Queries and refits are made of small box helpers, so pull the math in inline
+#define BASE_MATH_HEADER_ONLY
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "base_math.h"
+#include "spatial.h"
+
+// @SpatialGrid =============================================================================
+
+typedef struct GridCoord GridCoord;
+struct GridCoord
+{
+  i32 x;
+  i32 y;
+};
+
+// floorf is a libm call without SSE4.1, and this runs for every point scanned
+static inline
+i32 grid_floor(f32 x)
+{
+  i32 i = (i32) x;
+  return i - (x < (f32) i);
+}
+
+static inline
+GridCoord grid_coord(SpatialGrid *grid, Vec2F p)
+{
+  return (GridCoord) {grid_floor(p.x * grid->inv_cell_size), grid_floor(p.y * grid->inv_cell_size)};
+}
+
+// Only the row is hashed, so neighbouring cells in a row land in neighbouring
+// buckets and a query walks contiguous memory along x.
+static inline
+u32 grid_hash(SpatialGrid *grid, i32 x, i32 y)
+{
+  u32 row = (u32) y * 0x9E3779B1u;
+  row ^= row >> 15;
+  row *= 0x85EBCA77u;
+  row ^= row >> 13;
+  return (row + (u32) x) & grid->cell_mask;
+}
+
+SpatialGrid spatial_grid_create(f32 cell_size, u32 max_points)
+{
+  // Twice as many buckets as points keeps collisions rare
+  u32 cell_count = 16;
+  while (cell_count < max_points * 2) cell_count *= 2;
+
+  SpatialGrid grid = {0};
+  grid.cell_size = cell_size;
+  grid.inv_cell_size = 1.0f / cell_size;
+  grid.cell_mask = cell_count - 1;
+  grid.cell_start = malloc(sizeof (u32) * (cell_count + 1));
+  grid.point_cell = malloc(sizeof (u32) * max_points);
+  grid.indices = malloc(sizeof (u32) * max_points);
+  grid.points = malloc(sizeof (Vec2F) * max_points);
+  grid.point_cap = max_points;
+
+  return grid;
+}
+
+void spatial_grid_destroy(SpatialGrid *grid)
+{
+  free(grid->cell_start);
+  free(grid->point_cell);
+  free(grid->indices);
+  free(grid->points);
+  *grid = (SpatialGrid) {0};
+}
+
+void spatial_grid_build(SpatialGrid *grid, const Vec2F *points, u32 count)
+{
+  ASSERT(count <= grid->point_cap);
+
+  u32 cell_count = grid->cell_mask + 1;
+  memset(grid->cell_start, 0, sizeof (u32) * (cell_count + 1));
+
+  for (u32 i = 0; i < count; i++)
+  {
+    GridCoord c = grid_coord(grid, points[i]);
+    u32 cell = grid_hash(grid, c.x, c.y);
+    grid->point_cell[i] = cell;
+    grid->cell_start[cell]++;
+  }
+
+  // Inclusive prefix sums give each cell's end; scattering in reverse and
+  // decrementing leaves them at each cell's start with input order preserved
+  u32 sum = 0;
+  for (u32 c = 0; c < cell_count; c++)
+  {
+    sum += grid->cell_start[c];
+    grid->cell_start[c] = sum;
+  }
+  grid->cell_start[cell_count] = sum;
+
+  for (u32 i = count; i-- > 0;)
+  {
+    u32 slot = --grid->cell_start[grid->point_cell[i]];
+    grid->indices[slot] = i;
+    grid->points[slot] = points[i];
+  }
+
+  grid->point_count = count;
+}
+
+// Two cells can share a bucket, so points are only taken from the bucket when
+// they really lie in cell (x, y). This also keeps results free of duplicates.
+static inline
+bool grid_in_cell(SpatialGrid *grid, Vec2F p, i32 x, i32 y)
+{
+  GridCoord c = grid_coord(grid, p);
+  return c.x == x && c.y == y;
+}
+
+u32 spatial_grid_query_aabb(SpatialGrid *grid, AABB2F box, u32 *out, u32 max_out)
+{
+  GridCoord lo = grid_coord(grid, box.min);
+  GridCoord hi = grid_coord(grid, box.max);
+  u32 n = 0;
+
+  for (i32 y = lo.y; y <= hi.y; y++)
+  {
+    for (i32 x = lo.x; x <= hi.x; x++)
+    {
+      // Interior cells lie fully inside the box and need no per-point test
+      bool interior = x > lo.x && x < hi.x && y > lo.y && y < hi.y;
+      u32 cell = grid_hash(grid, x, y);
+
+      for (u32 slot = grid->cell_start[cell]; slot < grid->cell_start[cell + 1]; slot++)
+      {
+        Vec2F p = grid->points[slot];
+        if (!grid_in_cell(grid, p, x, y)) continue;
+        if (!interior && (p.x < box.min.x || p.x > box.max.x || 
+                          p.y < box.min.y || p.y > box.max.y)) continue;
+
+        if (n == max_out) return n;
+        out[n++] = grid->indices[slot];
+      }
+    }
+  }
+
+  return n;
+}
+
+u32 spatial_grid_query_radius(SpatialGrid *grid, Vec2F center, f32 radius, 
+                              u32 *out, u32 max_out)
+{
+  GridCoord lo = grid_coord(grid, v2f(center.x - radius, center.y - radius));
+  GridCoord hi = grid_coord(grid, v2f(center.x + radius, center.y + radius));
+  f32 r2 = radius * radius;
+  u32 n = 0;
+
+  for (i32 y = lo.y; y <= hi.y; y++)
+  {
+    for (i32 x = lo.x; x <= hi.x; x++)
+    {
+      u32 cell = grid_hash(grid, x, y);
+
+      for (u32 slot = grid->cell_start[cell]; slot < grid->cell_start[cell + 1]; slot++)
+      {
+        Vec2F p = grid->points[slot];
+        if (distance_squared_2f(p, center) > r2 || !grid_in_cell(grid, p, x, y)) continue;
+
+        if (n == max_out) return n;
+        out[n++] = grid->indices[slot];
+      }
+    }
+  }
+
+  return n;
+}
+
+// Searches square rings of cells outward. Everything past ring k is at least k
+// cells away, so the search stops once the best hit is closer than that.
+i32 spatial_grid_nearest(SpatialGrid *grid, Vec2F p, f32 max_radius)
+{
+  GridCoord c = grid_coord(grid, p);
+  i32 max_ring = (i32) ceilf(max_radius * grid->inv_cell_size) + 1;
+  f32 best_d2 = max_radius * max_radius;
+  i32 best = -1;
+
+  for (i32 ring = 0; ring <= max_ring; ring++)
+  {
+    for (i32 y = c.y - ring; y <= c.y + ring; y++)
+    {
+      // Only the border of the ring; its inside was searched already
+      bool edge_row = y == c.y - ring || y == c.y + ring;
+      i32 step = edge_row || ring == 0 ? 1 : 2 * ring;
+
+      for (i32 x = c.x - ring; x <= c.x + ring; x += step)
+      {
+        u32 cell = grid_hash(grid, x, y);
+
+        for (u32 slot = grid->cell_start[cell]; slot < grid->cell_start[cell + 1]; slot++)
+        {
+          Vec2F q = grid->points[slot];
+          f32 d2 = distance_squared_2f(q, p);
+          if (d2 > best_d2 || !grid_in_cell(grid, q, x, y)) continue;
+
+          // Ties go to the lowest index so results don't depend on search order
+          i32 index = (i32) grid->indices[slot];
+          if (d2 < best_d2 || best < 0 || index < best)
+          {
+            best_d2 = d2;
+            best = index;
+          }
+        }
+      }
+    }
+
+    f32 reach = ring * grid->cell_size;
+    if (best >= 0 && best_d2 < reach * reach) break;
+  }
+
+  return best;
+}
+
+// @BVH =====================================================================================
+
+// Half the surface area, the SAH cost of a node
+static inline
+f32 bvh_area(AABB3F box)
+{
+  Vec3F d = sub_3f(box.max, box.min);
+  return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static inline
+AABB3F bvh_fatten(AABB3F box, f32 margin)
+{
+  Vec3F m = v3f(margin, margin, margin);
+  return (AABB3F) {sub_3f(box.min, m), add_3f(box.max, m)};
+}
+
+// Links nodes [first, cap) into the front of the free list.
+static
+void bvh_link_free(BVH *bvh, u32 first)
+{
+  for (u32 i = first; i < bvh->node_cap; i++)
+  {
+    bvh->nodes[i].next = i + 1 < bvh->node_cap ? i + 1 : bvh->free_list;
+    bvh->nodes[i].height = -1;
+  }
+
+  if (first < bvh->node_cap) bvh->free_list = first;
+}
+
+static
+void bvh_grow(BVH *bvh, u32 cap)
+{
+  if (cap <= bvh->node_cap) return;
+
+  u32 first = bvh->node_cap;
+  bvh->nodes = realloc(bvh->nodes, sizeof (BVHNode) * cap);
+  bvh->tight = realloc(bvh->tight, sizeof (AABB3F) * cap);
+  bvh->node_cap = cap;
+  bvh_link_free(bvh, first);
+}
+
+// May grow the pool, so callers hold indices rather than pointers across it.
+static
+u32 bvh_alloc_node(BVH *bvh)
+{
+  if (bvh->free_list == BVH_NULL) bvh_grow(bvh, bvh->node_cap * 2);
+
+  u32 index = bvh->free_list;
+  BVHNode *node = &bvh->nodes[index];
+  bvh->free_list = node->next;
+  bvh->node_count++;
+
+  *node = (BVHNode) {.parent = BVH_NULL, .child = {BVH_NULL, BVH_NULL}, .user = BVH_NULL};
+
+  return index;
+}
+
+static
+void bvh_free_node(BVH *bvh, u32 index)
+{
+  bvh->nodes[index].next = bvh->free_list;
+  bvh->nodes[index].height = -1;
+  bvh->free_list = index;
+  bvh->node_count--;
+}
+
+BVH bvh_create(u32 capacity, f32 margin)
+{
+  // A full tree of n leaves has n - 1 internal nodes
+  BVH bvh = {0};
+  bvh.margin = margin;
+  bvh.free_list = BVH_NULL;
+  bvh.root = BVH_NULL;
+  bvh_grow(&bvh, capacity < 8 ? 16 : capacity * 2);
+
+  return bvh;
+}
+
+void bvh_destroy(BVH *bvh)
+{
+  free(bvh->nodes);
+  free(bvh->tight);
+  *bvh = (BVH) {0};
+}
+
+void bvh_clear(BVH *bvh)
+{
+  bvh->free_list = BVH_NULL;
+  bvh->node_count = 0;
+  bvh->root = BVH_NULL;
+  bvh_link_free(bvh, 0);
+}
+
+static
+void bvh_fit(BVH *bvh, u32 index)
+{
+  BVHNode *node = &bvh->nodes[index];
+  BVHNode *a = &bvh->nodes[node->child[0]];
+  BVHNode *b = &bvh->nodes[node->child[1]];
+  node->box = union_aabb3f(a->box, b->box);
+  node->height = 1 + MAX(a->height, b->height);
+}
+
+// Height difference between siblings that balancing tolerates. Trees built
+// from ordinary boxes stay within it through area rotations alone, so it only
+// kicks in where the area cost can't tell placements apart.
+#define BVH_MAX_IMBALANCE 16
+
+// Lifts the taller child when the children's heights differ by more than
+// BVH_MAX_IMBALANCE, as Box2D does. The child takes the node's place and
+// keeps its own taller child, the node takes the shorter one. Returns the
+// subtree's new root.
+static
+u32 bvh_balance(BVH *bvh, u32 index)
+{
+  BVHNode *nodes = bvh->nodes;
+  i32 h0 = nodes[nodes[index].child[0]].height;
+  i32 h1 = nodes[nodes[index].child[1]].height;
+  if (abs(h1 - h0) <= BVH_MAX_IMBALANCE) return index;
+
+  u32 side = h1 > h0;
+  u32 lifted = nodes[index].child[side];
+  u32 f = nodes[lifted].child[0];
+  u32 g = nodes[lifted].child[1];
+  u32 tall = nodes[f].height > nodes[g].height ? f : g;
+  u32 moved = tall == f ? g : f;
+
+  u32 parent = nodes[index].parent;
+  nodes[lifted].parent = parent;
+  if (parent == BVH_NULL)
+  {
+    bvh->root = lifted;
+  }
+  else
+  {
+    nodes[parent].child[nodes[parent].child[1] == index] = lifted;
+  }
+
+  nodes[lifted].child[0] = index;
+  nodes[lifted].child[1] = tall;
+  nodes[index].parent = lifted;
+  nodes[index].child[side] = moved;
+  nodes[moved].parent = index;
+  bvh_fit(bvh, index);
+  bvh_fit(bvh, lifted);
+
+  return lifted;
+}
+
+// Tries swapping one child of `index` with a grandchild under the other child,
+// keeping the swap that shrinks the surface area of the child it changes most
+// (Kopta et al., "Fast, Effective BVH Updates for Animated Scenes").
+static
+bool bvh_rotate(BVH *bvh, u32 index)
+{
+  BVHNode *nodes = bvh->nodes;
+  u32 b = nodes[index].child[0];
+  u32 c = nodes[index].child[1];
+
+  f32 best_gain = 0.0f;
+  u32 best_side = 0;
+  u32 best_k = 0;
+
+  for (u32 side = 0; side < 2; side++)
+  {
+    u32 inner = side ? c : b;
+    u32 outer = side ? b : c;
+    if (nodes[inner].height == 0) continue;
+
+    f32 area = bvh_area(nodes[inner].box);
+    for (u32 k = 0; k < 2; k++)
+    {
+      // outer trades places with grandchild k, so inner then holds outer and 1 - k
+      u32 kept = nodes[inner].child[1 - k];
+      f32 gain = area - bvh_area(union_aabb3f(nodes[outer].box, nodes[kept].box));
+      if (gain > best_gain)
+      {
+        best_gain = gain;
+        best_side = side;
+        best_k = k;
+      }
+    }
+  }
+
+  if (best_gain <= 0.0f) return FALSE;
+
+  u32 inner = best_side ? c : b;
+  u32 outer = best_side ? b : c;
+  u32 grandchild = nodes[inner].child[best_k];
+
+  nodes[index].child[best_side ? 0 : 1] = grandchild;
+  nodes[grandchild].parent = index;
+  nodes[inner].child[best_k] = outer;
+  nodes[outer].parent = inner;
+  bvh_fit(bvh, inner);
+
+  return TRUE;
+}
+
+// Walks up refitting, balancing and rotating. Balancing comes first: where
+// every placement costs the same, like coincident or nested boxes, the area
+// cost alone builds a list. Once a node comes out unchanged nothing above it
+// can change either, so the walk stops there.
+static
+void bvh_refit(BVH *bvh, u32 index)
+{
+  while (index != BVH_NULL)
+  {
+    AABB3F box = bvh->nodes[index].box;
+    i32 height = bvh->nodes[index].height;
+
+    bvh_fit(bvh, index);
+    u32 top = bvh_balance(bvh, index);
+    bool rotated = top != index;
+    if (!rotated)
+    {
+      rotated = bvh_rotate(bvh, index);
+      bvh_fit(bvh, index);
+    }
+
+    BVHNode *node = &bvh->nodes[top];
+    if (!rotated && height == node->height && memcmp(&box, &node->box, sizeof (box)) == 0) break;
+
+    index = node->parent;
+  }
+}
+
+// Greedy descent: go down while pushing the leaf into a child is cheaper than
+// pairing it with the current node, counting the growth of every ancestor.
+static
+void bvh_insert_leaf(BVH *bvh, u32 leaf)
+{
+  if (bvh->root == BVH_NULL)
+  {
+    bvh->root = leaf;
+    bvh->nodes[leaf].parent = BVH_NULL;
+    return;
+  }
+
+  AABB3F box = bvh->nodes[leaf].box;
+  u32 sibling = bvh->root;
+
+  while (bvh->nodes[sibling].height > 0)
+  {
+    BVHNode *node = &bvh->nodes[sibling];
+    f32 combined = bvh_area(union_aabb3f(node->box, box));
+    f32 here = 2.0f * combined;
+    f32 inherited = 2.0f * (combined - bvh_area(node->box));
+
+    f32 cost[2];
+    for (u32 k = 0; k < 2; k++)
+    {
+      BVHNode *child = &bvh->nodes[node->child[k]];
+      cost[k] = bvh_area(union_aabb3f(child->box, box)) + inherited;
+      if (child->height > 0) cost[k] -= bvh_area(child->box);
+    }
+
+    if (here < cost[0] && here < cost[1]) break;
+
+    // Ties go to the smaller child, then the shorter one
+    u32 k = cost[1] < cost[0];
+    if (cost[1] == cost[0])
+    {
+      BVHNode *c0 = &bvh->nodes[node->child[0]];
+      BVHNode *c1 = &bvh->nodes[node->child[1]];
+      f32 a0 = bvh_area(c0->box);
+      f32 a1 = bvh_area(c1->box);
+      k = a1 < a0 || (a1 == a0 && c1->height < c0->height);
+    }
+
+    sibling = node->child[k];
+  }
+
+  u32 parent = bvh_alloc_node(bvh);
+  BVHNode *nodes = bvh->nodes;
+  u32 old_parent = nodes[sibling].parent;
+
+  nodes[parent].parent = old_parent;
+  nodes[parent].child[0] = sibling;
+  nodes[parent].child[1] = leaf;
+  nodes[sibling].parent = parent;
+  nodes[leaf].parent = parent;
+
+  if (old_parent == BVH_NULL)
+  {
+    bvh->root = parent;
+  }
+  else
+  {
+    u32 k = nodes[old_parent].child[1] == sibling;
+    nodes[old_parent].child[k] = parent;
+  }
+
+  bvh_refit(bvh, parent);
+}
+
+static
+void bvh_remove_leaf(BVH *bvh, u32 leaf)
+{
+  if (leaf == bvh->root)
+  {
+    bvh->root = BVH_NULL;
+    return;
+  }
+
+  BVHNode *nodes = bvh->nodes;
+  u32 parent = nodes[leaf].parent;
+  u32 grandparent = nodes[parent].parent;
+  u32 sibling = nodes[parent].child[nodes[parent].child[0] == leaf];
+
+  nodes[sibling].parent = grandparent;
+  bvh_free_node(bvh, parent);
+
+  if (grandparent == BVH_NULL)
+  {
+    bvh->root = sibling;
+    return;
+  }
+
+  u32 k = nodes[grandparent].child[1] == parent;
+  nodes[grandparent].child[k] = sibling;
+  bvh_refit(bvh, grandparent);
+}
+
+u32 bvh_insert(BVH *bvh, AABB3F box, u32 user)
+{
+  u32 leaf = bvh_alloc_node(bvh);
+  bvh->nodes[leaf].box = bvh_fatten(box, bvh->margin);
+  bvh->nodes[leaf].user = user;
+  bvh->tight[leaf] = box;
+  bvh_insert_leaf(bvh, leaf);
+
+  return leaf;
+}
+
+void bvh_remove(BVH *bvh, u32 proxy)
+{
+  ASSERT(bvh->nodes[proxy].height == 0);
+
+  bvh_remove_leaf(bvh, proxy);
+  bvh_free_node(bvh, proxy);
+}
+
+bool bvh_move(BVH *bvh, u32 proxy, AABB3F box)
+{
+  ASSERT(bvh->nodes[proxy].height == 0);
+
+  bvh->tight[proxy] = box;
+  if (contains_aabb3f(bvh->nodes[proxy].box, box)) return FALSE;
+
+  bvh_remove_leaf(bvh, proxy);
+  bvh->nodes[proxy].box = bvh_fatten(box, bvh->margin);
+  bvh_insert_leaf(bvh, proxy);
+
+  return TRUE;
+}
+
+static inline
+f32 bvh_center(BVH *bvh, u32 index, u32 axis)
+{
+  AABB3F *box = &bvh->nodes[index].box;
+  return box->min.elements[axis] + box->max.elements[axis];
+}
+
+// Quickselect: afterwards leaves[k] has the k-th smallest center on `axis`,
+// with smaller ones before it and larger ones after.
+static
+void bvh_select(BVH *bvh, u32 *leaves, i32 count, i32 k, u32 axis)
+{
+  i32 lo = 0;
+  i32 hi = count - 1;
+
+  while (lo < hi)
+  {
+    f32 pivot = bvh_center(bvh, leaves[lo + (hi - lo) / 2], axis);
+    i32 i = lo;
+    i32 j = hi;
+
+    while (i <= j)
+    {
+      while (bvh_center(bvh, leaves[i], axis) < pivot) i++;
+      while (bvh_center(bvh, leaves[j], axis) > pivot) j--;
+      if (i <= j)
+      {
+        u32 tmp = leaves[i];
+        leaves[i++] = leaves[j];
+        leaves[j--] = tmp;
+      }
+    }
+
+    if (k <= j) hi = j;
+    else if (k >= i) lo = i;
+    else break;
+  }
+}
+
+static
+u32 bvh_build_node(BVH *bvh, u32 *leaves, u32 count)
+{
+  if (count == 1) return leaves[0];
+
+  Vec3F lo = v3f(INFINITY, INFINITY, INFINITY);
+  Vec3F hi = v3f(-INFINITY, -INFINITY, -INFINITY);
+  for (u32 i = 0; i < count; i++)
+  {
+    for (u32 axis = 0; axis < 3; axis++)
+    {
+      f32 c = bvh_center(bvh, leaves[i], axis);
+      lo.elements[axis] = MIN(lo.elements[axis], c);
+      hi.elements[axis] = MAX(hi.elements[axis], c);
+    }
+  }
+
+  Vec3F extent = sub_3f(hi, lo);
+  u32 axis = extent.y > extent.x;
+  if (extent.z > extent.elements[axis]) axis = 2;
+
+  u32 half = count / 2;
+  bvh_select(bvh, leaves, count, half, axis);
+
+  u32 left = bvh_build_node(bvh, leaves, half);
+  u32 right = bvh_build_node(bvh, leaves + half, count - half);
+  u32 node = bvh_alloc_node(bvh);
+
+  bvh->nodes[node].child[0] = left;
+  bvh->nodes[node].child[1] = right;
+  bvh->nodes[left].parent = node;
+  bvh->nodes[right].parent = node;
+  bvh_fit(bvh, node);
+
+  return node;
+}
+
+void bvh_build(BVH *bvh, const AABB3F *boxes, u32 count, u32 *proxies)
+{
+  bvh_clear(bvh);
+  if (count == 0) return;
+
+  bvh_grow(bvh, count * 2);
+  u32 *leaves = malloc(sizeof (u32) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    u32 leaf = bvh_alloc_node(bvh);
+    bvh->nodes[leaf].box = bvh_fatten(boxes[i], bvh->margin);
+    bvh->nodes[leaf].user = i;
+    bvh->tight[leaf] = boxes[i];
+    leaves[i] = leaf;
+    if (proxies) proxies[i] = leaf;
+  }
+
+  bvh->root = bvh_build_node(bvh, leaves, count);
+  bvh->nodes[bvh->root].parent = BVH_NULL;
+
+  free(leaves);
+}
+
+// Traversal stacks live on the C stack unless the tree is deeper than this.
+// Depth first, a stack never holds more than height + 1 nodes.
+#define BVH_STACK_SIZE 256
+
+static
+u32 *bvh_stack(BVH *bvh, u32 *local)
+{
+  u32 need = bvh_height(bvh) + 2;
+
+  return need <= BVH_STACK_SIZE ? local : malloc(sizeof (u32) * need);
+}
+
+static
+void bvh_free_stack(u32 *stack, u32 *local)
+{
+  if (stack != local) free(stack);
+}
+
+u32 bvh_query_aabb(BVH *bvh, AABB3F box, u32 *out, u32 max_out)
+{
+  if (bvh->root == BVH_NULL) return 0;
+
+  u32 local[BVH_STACK_SIZE];
+  u32 *stack = bvh_stack(bvh, local);
+  u32 top = 0;
+  u32 n = 0;
+  stack[top++] = bvh->root;
+
+  while (top > 0)
+  {
+    u32 index = stack[--top];
+    BVHNode *node = &bvh->nodes[index];
+    if (!overlap_aabb3f(node->box, box)) continue;
+
+    if (node->height == 0)
+    {
+      if (!overlap_aabb3f(bvh->tight[index], box)) continue;
+      if (n == max_out) break;
+      out[n++] = node->user;
+    }
+    else
+    {
+      stack[top++] = node->child[0];
+      stack[top++] = node->child[1];
+    }
+  }
+
+  bvh_free_stack(stack, local);
+
+  return n;
+}
+
+// Slab test; returns the entry distance, or INFINITY on a miss.
+static inline
+f32 bvh_ray_box(Vec3F origin, Vec3F inv_dir, AABB3F box, f32 max_t)
+{
+  f32 t0 = 0.0f;
+  f32 t1 = max_t;
+
+  for (u32 axis = 0; axis < 3; axis++)
+  {
+    f32 a = (box.min.elements[axis] - origin.elements[axis]) * inv_dir.elements[axis];
+    f32 b = (box.max.elements[axis] - origin.elements[axis]) * inv_dir.elements[axis];
+    t0 = MAX(t0, MIN(a, b));
+    t1 = MIN(t1, MAX(a, b));
+  }
+
+  return t0 <= t1 ? t0 : INFINITY;
+}
+
+// Closest exact box along the ray, visiting the nearer child first so later
+// subtrees are culled by the best hit so far.
+bool bvh_ray_cast(BVH *bvh, Vec3F origin, Vec3F dir, f32 max_t, BVHRayHit *hit)
+{
+  if (bvh->root == BVH_NULL) return FALSE;
+
+  Vec3F inv_dir = v3f(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+  f32 best_t = max_t;
+  u32 best = BVH_NULL;
+
+  u32 local[BVH_STACK_SIZE];
+  u32 *stack = bvh_stack(bvh, local);
+  u32 top = 0;
+  if (bvh_ray_box(origin, inv_dir, bvh->nodes[bvh->root].box, best_t) < INFINITY)
+  {
+    stack[top++] = bvh->root;
+  }
+
+  while (top > 0)
+  {
+    u32 index = stack[--top];
+    BVHNode *node = &bvh->nodes[index];
+
+    if (node->height == 0)
+    {
+      f32 t = bvh_ray_box(origin, inv_dir, bvh->tight[index], best_t);
+      if (t < best_t || (t == best_t && best == BVH_NULL))
+      {
+        best_t = t;
+        best = index;
+      }
+      continue;
+    }
+
+    f32 t0 = bvh_ray_box(origin, inv_dir, bvh->nodes[node->child[0]].box, best_t);
+    f32 t1 = bvh_ray_box(origin, inv_dir, bvh->nodes[node->child[1]].box, best_t);
+    u32 near = t1 < t0;
+
+    if ((near ? t0 : t1) < INFINITY) stack[top++] = node->child[1 - near];
+    if ((near ? t1 : t0) < INFINITY) stack[top++] = node->child[near];
+  }
+
+  bvh_free_stack(stack, local);
+  if (best == BVH_NULL) return FALSE;
+
+  *hit = (BVHRayHit) {best, bvh->nodes[best].user, best_t};
+
+  return TRUE;
+}
+
+u32 bvh_height(BVH *bvh)
+{
+  return bvh->root == BVH_NULL ? 0 : (u32) bvh->nodes[bvh->root].height;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "base_common.h"
+#include "base_math.h"
+
+// @SpatialGrid =============================================================================
+
+// Uniform grid over 2D points, hashed so the world needs no bounds. Rebuilt
+// from scratch every frame with a counting sort: points sharing a cell end up
+// contiguous, with their positions copied alongside for cache-friendly scans.
+typedef struct SpatialGrid SpatialGrid;
+struct SpatialGrid
+{
+  f32 cell_size;
+  f32 inv_cell_size;
+  u32 cell_mask;
+  u32 *cell_start; // cell_mask + 2 entries; cell c spans [cell_start[c], cell_start[c + 1])
+  u32 *point_cell;
+  u32 *indices;    // Original point index, sorted by cell
+  Vec2F *points;   // Positions in the same order as indices
+  u32 point_count;
+  u32 point_cap;
+};
+
+SpatialGrid spatial_grid_create(f32 cell_size, u32 max_points);
+void spatial_grid_destroy(SpatialGrid *grid);
+void spatial_grid_build(SpatialGrid *grid, const Vec2F *points, u32 count);
+
+// Queries write original point indices to `out`, at most `max_out` of them,
+// and return how many were written.
+u32 spatial_grid_query_aabb(SpatialGrid *grid, AABB2F box, u32 *out, u32 max_out);
+u32 spatial_grid_query_radius(SpatialGrid *grid, Vec2F center, f32 radius, 
+                              u32 *out, u32 max_out);
+
+// Returns the closest point within `max_radius`, or -1.
+i32 spatial_grid_nearest(SpatialGrid *grid, Vec2F p, f32 max_radius);
+
+// @BVH =====================================================================================
+
+#define BVH_NULL 0xFFFFFFFFu
+
+typedef struct BVHNode BVHNode;
+struct BVHNode
+{
+  AABB3F box; // Fattened by the tree margin for leaves
+  union
+  {
+    u32 parent;
+    u32 next; // Free list link while unused
+  };
+  u32 child[2];
+  u32 user;
+  i32 height; // 0 for leaves, -1 while free
+};
+
+// Dynamic AABB tree for moving objects of very different sizes. Leaves keep a
+// fattened box so small moves need no update. Insertion descends by surface
+// area cost and every refit tries a rotation that lowers it, or a balancing
+// one when coincident or nested boxes leave the area no guide. Nodes live in
+// one pool and are referred to by index, so proxies stay valid when it grows.
+// 2D objects use boxes with a zero z extent.
+typedef struct BVH BVH;
+struct BVH
+{
+  BVHNode *nodes;
+  AABB3F *tight; // Exact box of each leaf, indexed like nodes
+  u32 node_cap;
+  u32 node_count;
+  u32 free_list;
+  u32 root;
+  f32 margin;
+};
+
+typedef struct BVHRayHit BVHRayHit;
+struct BVHRayHit
+{
+  u32 proxy;
+  u32 user;
+  f32 t;
+};
+
+BVH bvh_create(u32 capacity, f32 margin);
+void bvh_destroy(BVH *bvh);
+void bvh_clear(BVH *bvh);
+
+// Proxies are leaf node indices.
+u32 bvh_insert(BVH *bvh, AABB3F box, u32 user);
+void bvh_remove(BVH *bvh, u32 proxy);
+
+// Returns TRUE when the box left its fattened bounds and the leaf was reinserted.
+bool bvh_move(BVH *bvh, u32 proxy, AABB3F box);
+
+// Replaces the tree with a top-down median split over `boxes`, with user = i.
+// Writes each box's proxy to `proxies` when it isn't NULL.
+void bvh_build(BVH *bvh, const AABB3F *boxes, u32 count, u32 *proxies);
+
+// Both test the exact boxes. Queries write user values and return how many
+// were written, at most `max_out`.
+u32 bvh_query_aabb(BVH *bvh, AABB3F box, u32 *out, u32 max_out);
+bool bvh_ray_cast(BVH *bvh, Vec3F origin, Vec3F dir, f32 max_t, BVHRayHit *hit);
+
+u32 bvh_height(BVH *bvh);
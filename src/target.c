@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "base_common.h"
+#include "target.h"
+
+u32 target_format_size(TargetFormat format)
+{
+  switch (format)
+  {
+    case TARGET_FORMAT_NONE: return 0;
+    case TARGET_FORMAT_R16F: return 2;
+    case TARGET_FORMAT_RGBA16F: return 8;
+    default: return 4;
+  }
+}
+
+bool target_format_is_depth(TargetFormat format)
+{
+  return format == TARGET_FORMAT_DEPTH24 ||
+         format == TARGET_FORMAT_DEPTH32F ||
+         format == TARGET_FORMAT_DEPTH24_STENCIL8;
+}
+
+bool target_desc_equal(const TargetDesc *a, const TargetDesc *b)
+{
+  return a->width == b->width &&
+         a->height == b->height &&
+         memcmp(a->color, b->color, sizeof (a->color)) == 0 &&
+         a->depth == b->depth &&
+         MAX(a->samples, 1) == MAX(b->samples, 1);
+}
+
+u32 target_desc_color_count(const TargetDesc *desc)
+{
+  u32 count = 0;
+  while (count < TARGET_MAX_COLOR && desc->color[count] != TARGET_FORMAT_NONE) count++;
+
+  return count;
+}
+
+u64 target_desc_bytes(const TargetDesc *desc)
+{
+  u64 pixels = (u64) desc->width * desc->height;
+  u32 samples = MAX(desc->samples, 1);
+
+  u64 bytes = pixels * samples * target_format_size(desc->depth);
+  for (u32 i = 0; i < target_desc_color_count(desc); i++)
+  {
+    u64 color = pixels * target_format_size(desc->color[i]);
+    bytes += samples > 1 ? color * (samples + 1) : color;
+  }
+
+  return bytes;
+}
+
+// @TargetPool ==============================================================================
+
+TargetPool target_pool_create(u32 max_targets, u32 max_idle_frames)
+{
+  TargetPool pool = {0};
+  pool.slot_count = max_targets;
+  pool.max_idle_frames = max_idle_frames;
+  pool.slots = calloc(max_targets, sizeof (TargetSlot));
+
+  return pool;
+}
+
+static
+void target_pool_evict(TargetPool *pool, u32 slot, const TargetBackend *backend)
+{
+  TargetSlot *s = &pool->slots[slot];
+  backend->destroy(backend->user, slot);
+  pool->live_count--;
+  pool->live_bytes -= target_desc_bytes(&s->desc);
+  pool->destroyed++;
+  *s = (TargetSlot) {0};
+}
+
+void target_pool_destroy(TargetPool *pool, const TargetBackend *backend)
+{
+  for (u32 i = 0; i < pool->slot_count; i++)
+  {
+    if (pool->slots[i].live) target_pool_evict(pool, i, backend);
+  }
+
+  free(pool->slots);
+  *pool = (TargetPool) {0};
+}
+
+u32 target_pool_acquire(TargetPool *pool, const TargetDesc *desc, const TargetBackend *backend)
+{
+  // Same description first, then an empty slot, then the longest idle target
+  u32 empty = TARGET_NONE;
+  u32 idle = TARGET_NONE;
+  for (u32 i = 0; i < pool->slot_count; i++)
+  {
+    TargetSlot *s = &pool->slots[i];
+    if (!s->live)
+    {
+      if (empty == TARGET_NONE) empty = i;
+      continue;
+    }
+
+    if (s->in_use) continue;
+
+    if (target_desc_equal(&s->desc, desc))
+    {
+      s->in_use = TRUE;
+      s->last_used = pool->frame;
+      pool->reused++;
+      return i;
+    }
+
+    if (s->last_used < pool->frame &&
+        (idle == TARGET_NONE || s->last_used < pool->slots[idle].last_used))
+    {
+      idle = i;
+    }
+  }
+
+  u32 slot = empty;
+  if (slot == TARGET_NONE)
+  {
+    if (idle == TARGET_NONE) return TARGET_NONE;
+    target_pool_evict(pool, idle, backend);
+    slot = idle;
+  }
+
+  TargetSlot *s = &pool->slots[slot];
+  s->desc = *desc;
+  s->desc.samples = MAX(desc->samples, 1);
+  s->last_used = pool->frame;
+  s->live = TRUE;
+  s->in_use = TRUE;
+  backend->create(backend->user, slot, &s->desc);
+
+  pool->live_count++;
+  pool->live_bytes += target_desc_bytes(&s->desc);
+  pool->created++;
+
+  return slot;
+}
+
+void target_pool_release(TargetPool *pool, u32 slot)
+{
+  ASSERT(slot < pool->slot_count && pool->slots[slot].in_use);
+  pool->slots[slot].in_use = FALSE;
+}
+
+void target_pool_next_frame(TargetPool *pool, const TargetBackend *backend)
+{
+  for (u32 i = 0; i < pool->slot_count; i++)
+  {
+    TargetSlot *s = &pool->slots[i];
+    if (s->live && !s->in_use && pool->frame - s->last_used >= pool->max_idle_frames)
+    {
+      target_pool_evict(pool, i, backend);
+    }
+  }
+
+  pool->frame++;
+}
+
+// @TargetRecorder ==========================================================================
+
+TargetRecorder target_recorder_create(u32 max_targets)
+{
+  TargetRecorder recorder = {0};
+  recorder.descs = calloc(max_targets, sizeof (TargetDesc));
+
+  return recorder;
+}
+
+void target_recorder_destroy(TargetRecorder *recorder)
+{
+  free(recorder->descs);
+  *recorder = (TargetRecorder) {0};
+}
+
+static
+void recorder_create(void *user, u32 slot, const TargetDesc *desc)
+{
+  TargetRecorder *recorder = user;
+  recorder->descs[slot] = *desc;
+  recorder->creates++;
+  recorder->live_bytes += target_desc_bytes(desc);
+  recorder->peak_bytes = MAX(recorder->peak_bytes, recorder->live_bytes);
+}
+
+static
+void recorder_destroy(void *user, u32 slot)
+{
+  TargetRecorder *recorder = user;
+  recorder->destroys++;
+  recorder->live_bytes -= target_desc_bytes(&recorder->descs[slot]);
+}
+
+TargetBackend target_recorder_backend(TargetRecorder *recorder)
+{
+  return (TargetBackend)
+  {
+    .user = recorder,
+    .create = recorder_create,
+    .destroy = recorder_destroy,
+  };
+}
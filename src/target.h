@@ -0,0 +1,110 @@
+#pragma once
+
+#include "base_common.h"
+
+#define TARGET_MAX_COLOR 4
+#define TARGET_NONE 0xFFFFFFFF
+
+typedef enum TargetFormat
+{
+  TARGET_FORMAT_NONE,
+  TARGET_FORMAT_RGBA8,
+  TARGET_FORMAT_SRGB8_A8,
+  TARGET_FORMAT_RGBA16F,
+  TARGET_FORMAT_R11G11B10F,
+  TARGET_FORMAT_R16F,
+  TARGET_FORMAT_DEPTH24,
+  TARGET_FORMAT_DEPTH32F,
+  TARGET_FORMAT_DEPTH24_STENCIL8,
+  TARGET_FORMAT_COUNT,
+} TargetFormat;
+
+u32 target_format_size(TargetFormat format);
+bool target_format_is_depth(TargetFormat format);
+
+// Color attachments are packed from the front, the first NONE ends them.
+// Multisampled targets draw into `samples` per pixel and resolve colors into
+// single sampled textures; their depth is never resolved.
+typedef struct TargetDesc TargetDesc;
+struct TargetDesc
+{
+  i32 width;
+  i32 height;
+  u8 color[TARGET_MAX_COLOR];
+  u8 depth;
+  u8 samples; // 0 and 1 both mean no multisampling
+};
+
+bool target_desc_equal(const TargetDesc *a, const TargetDesc *b);
+u32 target_desc_color_count(const TargetDesc *desc);
+
+// GPU memory the target takes, resolve textures included
+u64 target_desc_bytes(const TargetDesc *desc);
+
+// @TargetPool ==============================================================================
+
+// Creates and destroys the real targets; `slot` indexes the backend's own
+// array, one per pool slot.
+typedef struct TargetBackend TargetBackend;
+struct TargetBackend
+{
+  void *user;
+  void (*create)(void *user, u32 slot, const TargetDesc *desc);
+  void (*destroy)(void *user, u32 slot);
+};
+
+typedef struct TargetSlot TargetSlot;
+struct TargetSlot
+{
+  TargetDesc desc;
+  u64 last_used;
+  bool live;
+  bool in_use;
+};
+
+// Targets for passes that only need them for part of a frame. Released
+// targets are handed out again to the next request with the same
+// description, in this frame or a later one, and destroyed once they have
+// sat unused for `max_idle_frames`.
+typedef struct TargetPool TargetPool;
+struct TargetPool
+{
+  TargetSlot *slots;
+  u32 slot_count;
+  u32 max_idle_frames;
+  u64 frame;
+
+  u32 live_count;
+  u64 live_bytes;
+  u32 created;
+  u32 reused;
+  u32 destroyed;
+};
+
+TargetPool target_pool_create(u32 max_targets, u32 max_idle_frames);
+
+// Destroys every live target
+void target_pool_destroy(TargetPool *pool, const TargetBackend *backend);
+
+// TARGET_NONE when every slot holds a target in use or one not idle long
+// enough to be replaced
+u32 target_pool_acquire(TargetPool *pool, const TargetDesc *desc, const TargetBackend *backend);
+void target_pool_release(TargetPool *pool, u32 slot);
+
+// Destroys targets idle for too long. Targets still in use stay in use.
+void target_pool_next_frame(TargetPool *pool, const TargetBackend *backend);
+
+// Counts creations and the memory they hold, for tests and benchmarks
+typedef struct TargetRecorder TargetRecorder;
+struct TargetRecorder
+{
+  TargetDesc *descs; // One per slot, for the byte counts
+  u32 creates;
+  u32 destroys;
+  u64 live_bytes;
+  u64 peak_bytes;
+};
+
+TargetRecorder target_recorder_create(u32 max_targets);
+void target_recorder_destroy(TargetRecorder *recorder);
+TargetBackend target_recorder_backend(TargetRecorder *recorder);
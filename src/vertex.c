@@ -0,0 +1,334 @@
+#include <string.h>
+
+#include "base_common.h"
+#include "base_math.h"
+#include "vertex.h"
+
+// @Half ====================================================================================
+
+// After F. Giesen's float_to_half_fast3_rtne and half_to_float
+u16 half_from_f32(f32 x)
+{
+  union { f32 f; u32 u; } in = {x};
+  union { u32 u; f32 f; } denorm_magic = {((127 - 15) + (23 - 10) + 1) << 23};
+
+  u32 sign = in.u & 0x80000000u;
+  in.u ^= sign;
+
+  u16 h;
+  if (in.u >= (127 + 16) << 23)
+  {
+    h = in.u > 255u << 23 ? 0x7E00 : 0x7C00;
+  }
+  else if (in.u < 113 << 23)
+  {
+    // The add shifts the mantissa into place and rounds it in hardware
+    in.f += denorm_magic.f;
+    h = (u16) (in.u - denorm_magic.u);
+  }
+  else
+  {
+    u32 odd = (in.u >> 13) & 1;
+    in.u += ((u32) (15 - 127) << 23) + 0xFFF + odd;
+    h = (u16) (in.u >> 13);
+  }
+
+  return h | (u16) (sign >> 16);
+}
+
+f32 f32_from_half(u16 h)
+{
+  const u32 shifted_exp = 0x7C00 << 13;
+  union { u32 u; f32 f; } out = {(h & 0x7FFFu) << 13};
+  union { u32 u; f32 f; } magic = {113 << 23};
+
+  u32 exp = out.u & shifted_exp;
+  out.u += (127 - 15) << 23;
+
+  if (exp == shifted_exp)
+  {
+    out.u += (128 - 16) << 23;
+  }
+  else if (exp == 0)
+  {
+    out.u += 1 << 23;
+    out.f -= magic.f;
+  }
+
+  out.u |= (u32) (h & 0x8000) << 16;
+
+  return out.f;
+}
+
+#ifdef SIMD_SSE
+static inline
+__m128i select_si128(__m128i mask, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Four halves in the low 64 bits. Same steps as half_from_f32 with every
+// branch computed and masked.
+static inline
+__m128i half_from_ps(__m128 v)
+{
+  #ifdef SIMD_F16C
+  return _mm_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+  #else
+  const __m128i denorm_magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+  const __m128i one = _mm_set1_epi32(1);
+
+  __m128i x = _mm_castps_si128(v);
+  __m128i sign = _mm_and_si128(x, _mm_set1_epi32((i32) 0x80000000u));
+  x = _mm_xor_si128(x, sign);
+
+  __m128i is_nan = _mm_cmpgt_epi32(x, _mm_set1_epi32(255 << 23));
+  __m128i inf_nan = _mm_or_si128(_mm_set1_epi32(0x7C00),
+                                 _mm_and_si128(is_nan, _mm_set1_epi32(0x0200)));
+
+  __m128 denorm_f = _mm_add_ps(_mm_castsi128_ps(x), _mm_castsi128_ps(denorm_magic));
+  __m128i denorm = _mm_sub_epi32(_mm_castps_si128(denorm_f), denorm_magic);
+
+  __m128i odd = _mm_and_si128(_mm_srli_epi32(x, 13), one);
+  __m128i rebias = _mm_set1_epi32((i32) ((u32) (15 - 127) << 23) + 0xFFF);
+  __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(x, rebias), odd), 13);
+
+  __m128i is_denorm = _mm_cmplt_epi32(x, _mm_set1_epi32(113 << 23));
+  __m128i is_big = _mm_cmpgt_epi32(x, _mm_set1_epi32(((127 + 16) << 23) - 1));
+  __m128i h = select_si128(is_big, inf_nan, select_si128(is_denorm, denorm, normal));
+  h = _mm_or_si128(h, _mm_srli_epi32(sign, 16));
+
+  // Sign-extend so the saturating pack keeps all 16 bits
+  h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+
+  return _mm_packs_epi32(h, h);
+  #endif
+}
+#endif
+
+void half_from_f32_n(const f32 *src, u16 *dst, u64 count)
+{
+  u64 i = 0;
+
+  #ifdef SIMD_SSE
+  for (; i + 4 <= count; i += 4)
+  {
+    _mm_storel_epi64((__m128i *) &dst[i], half_from_ps(_mm_loadu_ps(&src[i])));
+  }
+  #endif
+
+  for (; i < count; i++) dst[i] = half_from_f32(src[i]);
+}
+
+// @Normalized ==============================================================================
+
+// Rounds half away from zero. The SIMD paths round half to even, which only
+// differs on exact ties.
+static inline
+i32 round_f32(f32 x)
+{
+  return (i32) (x + (x >= 0.0f ? 0.5f : -0.5f));
+}
+
+// MAX comes first so NaN clamps to the low end, as _mm_max_ps does
+u8 unorm8_from_f32(f32 x)
+{
+  return (u8) round_f32(MIN(MAX(x, 0.0f), 1.0f) * 255.0f);
+}
+
+u16 unorm16_from_f32(f32 x)
+{
+  return (u16) round_f32(MIN(MAX(x, 0.0f), 1.0f) * 65535.0f);
+}
+
+i16 snorm16_from_f32(f32 x)
+{
+  return (i16) round_f32(MIN(MAX(x, -1.0f), 1.0f) * 32767.0f);
+}
+
+#ifdef SIMD_SSE
+// Four bytes in the low 32 bits
+static inline
+__m128i unorm8_from_ps(__m128 v)
+{
+  v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  __m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+  i = _mm_packs_epi32(i, i);
+
+  return _mm_packus_epi16(i, i);
+}
+
+// Four shorts in the low 64 bits. SSE2 only has a signed pack, so the range is
+// shifted down by 32768 around it.
+static inline
+__m128i unorm16_from_ps(__m128 v)
+{
+  v = _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+  __m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(65535.0f)));
+  i = _mm_sub_epi32(i, _mm_set1_epi32(32768));
+  i = _mm_packs_epi32(i, i);
+
+  return _mm_xor_si128(i, _mm_set1_epi16((i16) 0x8000));
+}
+
+static inline
+__m128i snorm16_from_ps(__m128 v)
+{
+  v = _mm_min_ps(_mm_max_ps(v, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+  __m128i i = _mm_cvtps_epi32(_mm_mul_ps(v, _mm_set1_ps(32767.0f)));
+
+  return _mm_packs_epi32(i, i);
+}
+#endif
+
+void unorm8_from_f32_n(const f32 *src, u8 *dst, u64 count)
+{
+  u64 i = 0;
+
+  #ifdef SIMD_SSE
+  for (; i + 4 <= count; i += 4)
+  {
+    i32 packed = _mm_cvtsi128_si32(unorm8_from_ps(_mm_loadu_ps(&src[i])));
+    memcpy(&dst[i], &packed, 4);
+  }
+  #endif
+
+  for (; i < count; i++) dst[i] = unorm8_from_f32(src[i]);
+}
+
+void unorm16_from_f32_n(const f32 *src, u16 *dst, u64 count)
+{
+  u64 i = 0;
+
+  #ifdef SIMD_SSE
+  for (; i + 4 <= count; i += 4)
+  {
+    _mm_storel_epi64((__m128i *) &dst[i], unorm16_from_ps(_mm_loadu_ps(&src[i])));
+  }
+  #endif
+
+  for (; i < count; i++) dst[i] = unorm16_from_f32(src[i]);
+}
+
+void snorm16_from_f32_n(const f32 *src, i16 *dst, u64 count)
+{
+  u64 i = 0;
+
+  #ifdef SIMD_SSE
+  for (; i + 4 <= count; i += 4)
+  {
+    _mm_storel_epi64((__m128i *) &dst[i], snorm16_from_ps(_mm_loadu_ps(&src[i])));
+  }
+  #endif
+
+  for (; i < count; i++) dst[i] = snorm16_from_f32(src[i]);
+}
+
+// @PackedVertex ============================================================================
+
+AABB3F vertex_bounds(const Vec3F *positions, u32 count)
+{
+  if (count == 0) return (AABB3F) {0};
+
+  AABB3F box = {positions[0], positions[0]};
+  for (u32 i = 1; i < count; i++)
+  {
+    for (u32 k = 0; k < 3; k++)
+    {
+      box.min.elements[k] = MIN(box.min.elements[k], positions[i].elements[k]);
+      box.max.elements[k] = MAX(box.max.elements[k], positions[i].elements[k]);
+    }
+  }
+
+  return box;
+}
+
+// Flat axes keep a unit extent so nothing divides by zero
+static
+void vertex_quantize_params(AABB3F bounds, Vec3F *center, Vec3F *extent)
+{
+  *center = scale_3f(add_3f(bounds.min, bounds.max), 0.5f);
+  *extent = scale_3f(sub_3f(bounds.max, bounds.min), 0.5f);
+
+  for (u32 k = 0; k < 3; k++)
+  {
+    if (!(extent->elements[k] > 0.0f)) extent->elements[k] = 1.0f;
+  }
+}
+
+// Applied before the model matrix: mul_4x4f(vertex_dequantize_4x4f(bounds), model)
+Mat4x4F vertex_dequantize_4x4f(AABB3F bounds)
+{
+  Vec3F center, extent;
+  vertex_quantize_params(bounds, &center, &extent);
+
+  return mul_4x4f(scale_4x4f(extent.x, extent.y, extent.z),
+                  translate_4x4f(center.x, center.y, center.z));
+}
+
+// UV and color are laid out the same in every packed vertex
+static inline
+void vertex_pack_attribs(const Vec2F *uvs, const Vec4F *colors, u32 i, u16 *uv_out, u8 *color_out)
+{
+  Vec2F uv = uvs ? uvs[i] : V2F_ZERO;
+  Vec4F color = colors ? colors[i] : v4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+  #ifdef SIMD_SSE
+  i32 uv_packed = _mm_cvtsi128_si32(unorm16_from_ps(_mm_setr_ps(uv.x, uv.y, 0.0f, 0.0f)));
+  i32 color_packed = _mm_cvtsi128_si32(unorm8_from_ps(_mm_loadu_ps(color.elements)));
+  memcpy(uv_out, &uv_packed, 4);
+  memcpy(color_out, &color_packed, 4);
+  #else
+  for (u32 k = 0; k < 2; k++) uv_out[k] = unorm16_from_f32(uv.elements[k]);
+  for (u32 k = 0; k < 4; k++) color_out[k] = unorm8_from_f32(color.elements[k]);
+  #endif
+}
+
+void vertex_pack_snorm(const Vec3F *positions, const Vec2F *uvs, const Vec4F *colors, u32 count,
+                       AABB3F bounds, VertexSnorm *out)
+{
+  Vec3F center, extent;
+  vertex_quantize_params(bounds, &center, &extent);
+  Vec3F inv = v3f(1.0f / extent.x, 1.0f / extent.y, 1.0f / extent.z);
+
+  #ifdef SIMD_SSE
+  // w passes through as 1
+  const __m128 center_ps = _mm_setr_ps(center.x, center.y, center.z, 0.0f);
+  const __m128 inv_ps = _mm_setr_ps(inv.x, inv.y, inv.z, 1.0f);
+  #endif
+
+  for (u32 i = 0; i < count; i++)
+  {
+    const Vec3F *p = &positions[i];
+
+    #ifdef SIMD_SSE
+    __m128 q = _mm_mul_ps(_mm_sub_ps(_mm_setr_ps(p->x, p->y, p->z, 1.0f), center_ps), inv_ps);
+    _mm_storel_epi64((__m128i *) out[i].position, snorm16_from_ps(q));
+    #else
+    Vec3F q = mul_3f(sub_3f(*p, center), inv);
+    for (u32 k = 0; k < 3; k++) out[i].position[k] = snorm16_from_f32(q.elements[k]);
+    out[i].position[3] = 32767;
+    #endif
+
+    vertex_pack_attribs(uvs, colors, i, out[i].uv, out[i].color);
+  }
+}
+
+void vertex_pack_half(const Vec3F *positions, const Vec2F *uvs, const Vec4F *colors, u32 count,
+                      VertexHalf *out)
+{
+  for (u32 i = 0; i < count; i++)
+  {
+    const Vec3F *p = &positions[i];
+
+    #ifdef SIMD_SSE
+    __m128i h = half_from_ps(_mm_setr_ps(p->x, p->y, p->z, 1.0f));
+    _mm_storel_epi64((__m128i *) out[i].position, h);
+    #else
+    for (u32 k = 0; k < 3; k++) out[i].position[k] = half_from_f32(p->elements[k]);
+    out[i].position[3] = 0x3C00;
+    #endif
+
+    vertex_pack_attribs(uvs, colors, i, out[i].uv, out[i].color);
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "base_common.h"
+#include "base_math.h"
+
+// @Half ====================================================================================
+
+// IEEE binary16, round to nearest even. Out of range values become infinity,
+// NaN stays NaN.
+u16 half_from_f32(f32 x);
+f32 f32_from_half(u16 h);
+void half_from_f32_n(const f32 *src, u16 *dst, u64 count);
+
+// @Normalized ==============================================================================
+
+// Clamped to the representable range and rounded to nearest. GL reads them
+// back as c / 255, c / 65535 and max(c / 32767, -1).
+u8 unorm8_from_f32(f32 x);
+u16 unorm16_from_f32(f32 x);
+i16 snorm16_from_f32(f32 x);
+void unorm8_from_f32_n(const f32 *src, u8 *dst, u64 count);
+void unorm16_from_f32_n(const f32 *src, u16 *dst, u64 count);
+void snorm16_from_f32_n(const f32 *src, i16 *dst, u64 count);
+
+// @PackedVertex ============================================================================
+
+// Both layouts are 16 bytes against 36 for the same attributes in f32. The
+// fourth position lane pads each attribute to a 4-byte boundary and holds 1.
+//
+// Snorm positions are relative to the mesh bounds, so the model matrix must be
+// multiplied by vertex_dequantize_4x4f(bounds). UVs are clamped to [0, 1], so
+// tiling has to happen in the shader.
+typedef struct VertexSnorm VertexSnorm;
+struct VertexSnorm
+{
+  i16 position[4];
+  u16 uv[2];
+  u8 color[4];
+};
+
+// Half positions need no bounds, at 11 bits of precision relative to their
+// magnitude.
+typedef struct VertexHalf VertexHalf;
+struct VertexHalf
+{
+  u16 position[4];
+  u16 uv[2];
+  u8 color[4];
+};
+
+// `uvs` and `colors` may be NULL, for zero UVs and opaque white.
+AABB3F vertex_bounds(const Vec3F *positions, u32 count);
+Mat4x4F vertex_dequantize_4x4f(AABB3F bounds);
+void vertex_pack_snorm(const Vec3F *positions, const Vec2F *uvs, const Vec4F *colors, u32 count,
+                       AABB3F bounds, VertexSnorm *out);
+void vertex_pack_half(const Vec3F *positions, const Vec2F *uvs, const Vec4F *colors, u32 count,
+                      VertexHalf *out);
@@ -0,0 +1,1734 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/base_common.h"
+#include "../src/base_math.h"
+#include "../src/atlas.h"
+#include "../src/image.h"
+#include "../src/spatial.h"
+#include "../src/vertex.h"
+#include "../src/mesh.h"
+#include "../src/draw.h"
+#include "../src/heap.h"
+#include "../src/dbg.h"
+#include "../src/font.h"
+#include "../src/target.h"
+#include "../src/graph.h"
+#include "../src/post.h"
+
+#include "bench_math.h"
+
+#include "hmm/hmm.h"
+
+static u32 rng_state = 0x9E3779B9;
+
+static
+u32 rng_next(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static
+f64 now_ms(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Counts how many draw batches a scene breaks into when every change of bound
+// texture forces a flush.
+static
+u32 count_batches(u32 *texture_of_sprite, u32 sprite_count)
+{
+  u32 batches = 0;
+  u32 bound = (u32) -1;
+
+  for (u32 i = 0; i < sprite_count; i++)
+  {
+    if (texture_of_sprite[i] != bound)
+    {
+      bound = texture_of_sprite[i];
+      batches++;
+    }
+  }
+
+  return batches;
+}
+
+static
+void bench_atlas_batches(void)
+{
+  const u32 texture_count = 64;
+  const u32 sprite_count = 10000;
+  const i32 page_size = 512;
+  const i32 padding = 2;
+  const i32 extrude = 1;
+
+  // Every texture fits an empty page, so there are never more pages than textures
+  u32 *page_of_texture = malloc(sizeof (u32) * texture_count);
+  Skyline *pages = malloc(sizeof (Skyline) * texture_count);
+  u32 page_count = 0;
+
+  for (u32 t = 0; t < texture_count; t++)
+  {
+    i32 w = 16 + rng_next() % 112 + extrude * 2 + padding;
+    i32 h = 16 + rng_next() % 112 + extrude * 2 + padding;
+    AtlasRect rect;
+
+    u32 p = 0;
+    for (; p < page_count; p++)
+    {
+      if (skyline_insert(&pages[p], w, h, &rect)) break;
+    }
+
+    if (p == page_count)
+    {
+      pages[page_count++] = skyline_create(page_size, page_size);
+      skyline_insert(&pages[p], w, h, &rect);
+    }
+
+    page_of_texture[t] = p;
+  }
+
+  u32 *by_texture = malloc(sizeof (u32) * sprite_count);
+  u32 *by_page = malloc(sizeof (u32) * sprite_count);
+  for (u32 i = 0; i < sprite_count; i++)
+  {
+    by_texture[i] = rng_next() % texture_count;
+    by_page[i] = page_of_texture[by_texture[i]];
+  }
+
+  printf("[atlas] %u sprites, %u textures -> %u pages\n", sprite_count, texture_count, page_count);
+  printf("[atlas] batches without atlas: %u\n", count_batches(by_texture, sprite_count));
+  printf("[atlas] batches with atlas:    %u\n", count_batches(by_page, sprite_count));
+
+  for (u32 p = 0; p < page_count; p++) skyline_destroy(&pages[p]);
+  free(pages);
+  free(page_of_texture);
+  free(by_texture);
+  free(by_page);
+}
+
+// Simulates a glyph cache: each frame requests a working set drawn from a
+// larger population, allocating whatever is not resident.
+static
+void bench_shelf_atlas(void)
+{
+  const u32 population = 4096;
+  const u32 working_set = 300;
+  const u32 frames = 1000;
+
+  ShelfAtlas atlas = shelf_atlas_create(512, 512, population);
+  AtlasHandle *handles = calloc(population, sizeof (AtlasHandle));
+  bool *resident = calloc(population, sizeof (bool));
+  i32 *sizes = malloc(sizeof (i32) * population * 2);
+  u32 misses = 0;
+
+  for (u32 i = 0; i < population; i++)
+  {
+    sizes[i * 2] = 6 + rng_next() % 20;
+    sizes[i * 2 + 1] = 10 + rng_next() % 14;
+  }
+
+  f64 start = now_ms();
+  for (u32 f = 0; f < frames; f++)
+  {
+    u32 base = (f * 7) % population;
+    for (u32 i = 0; i < working_set; i++)
+    {
+      u32 id = (base + rng_next() % (working_set * 4)) % population;
+      if (resident[id] && shelf_atlas_touch(&atlas, handles[id], NULL)) continue;
+
+      AtlasRect rect;
+      resident[id] = shelf_atlas_alloc(&atlas, sizes[id * 2], sizes[id * 2 + 1], &handles[id], &rect);
+      misses++;
+    }
+
+    shelf_atlas_next_frame(&atlas);
+  }
+  f64 elapsed = now_ms() - start;
+
+  printf("[shelf] %u frames: %u misses, %u evictions, %.1f%% occupied, %.3f ms/frame\n",
+         frames, misses, atlas.evictions, shelf_atlas_occupancy(&atlas) * 100.0f, elapsed / frames);
+
+  shelf_atlas_destroy(&atlas);
+  free(handles);
+  free(resident);
+  free(sizes);
+}
+
+static
+void bench_block_compression(void)
+{
+  const i32 size = 1024;
+  u8 *rgba = malloc((u64) size * size * 4);
+  u8 *decoded = malloc((u64) size * size * 4);
+
+  for (i32 y = 0; y < size; y++)
+  {
+    for (i32 x = 0; x < size; x++)
+    {
+      u8 *p = &rgba[((u64) y * size + x) * 4];
+      p[0] = x;
+      p[1] = y;
+      p[2] = (x ^ y) + rng_next() % 16;
+      p[3] = 255;
+    }
+  }
+
+  const i8 *names[4] = {"RGBA8", "BC1", "BC3", "BC7"};
+  for (ImageFormat f = IMAGE_FORMAT_RGBA8; f <= IMAGE_FORMAT_BC7; f++)
+  {
+    f64 start = now_ms();
+    Image image = img_compress(f, rgba, size, size, TRUE);
+    f64 encode = now_ms() - start;
+
+    start = now_ms();
+    img_decode(f, image.levels[0].data, size, size, decoded);
+    f64 decode = now_ms() - start;
+
+    u64 bytes = 0;
+    for (u32 i = 0; i < image.level_count; i++) bytes += image.levels[i].size;
+
+    printf("[bc] %-5s %ix%i + mips: %6llu KiB, encode %7.1f ms, cpu decode %6.1f ms\n",
+           names[f], size, size, (unsigned long long) bytes / 1024, encode, decode);
+
+    img_free(&image);
+  }
+
+  free(rgba);
+  free(decoded);
+}
+
+static
+void bench_mips(void)
+{
+  const i32 size = 4096;
+  u8 *rgba = malloc((u64) size * size * 4);
+  for (u64 i = 0; i < (u64) size * size * 4; i++) rgba[i] = rng_next();
+
+  // Naive scalar chain
+  f64 start = now_ms();
+  u8 *src = rgba;
+  i32 w = size;
+  i32 h = size;
+  while (w > 1 || h > 1)
+  {
+    u8 *dst = malloc((u64) (w > 1 ? w / 2 : 1) * (h > 1 ? h / 2 : 1) * 4);
+    img_downsample_rgba8(src, w, h, dst);
+    if (src != rgba) free(src);
+    src = dst;
+    w = w > 1 ? w / 2 : 1;
+    h = h > 1 ? h / 2 : 1;
+  }
+  free(src);
+  f64 scalar = now_ms() - start;
+  printf("[mips] 4096^2 RGBA8 scalar box         %7.1f ms\n", scalar);
+
+  // Naive gamma-correct level 1 with powf per sample
+  start = now_ms();
+  u8 *dst = malloc((u64) size * size);
+  for (i32 y = 0; y < size / 2; y++)
+  {
+    for (i32 x = 0; x < size / 2; x++)
+    {
+      for (i32 c = 0; c < 4; c++)
+      {
+        f32 sum = 0.0f;
+        for (i32 k = 0; k < 4; k++)
+        {
+          f32 v = rgba[((u64) (y * 2 + k / 2) * size + x * 2 + k % 2) * 4 + c] / 255.0f;
+          sum += c == 3 ? v : powf(v, 2.2f);
+        }
+        sum *= 0.25f;
+        dst[((u64) y * (size / 2) + x) * 4 + c] = (u8) ((c == 3 ? sum : powf(sum, 1.0f / 2.2f)) * 255.0f + 0.5f);
+      }
+    }
+  }
+  free(dst);
+  f64 scalar_srgb = (now_ms() - start) * 4.0f / 3.0f;
+  printf("[mips] 4096^2 RGBA8 scalar box srgb    %7.1f ms (level 1 x 4/3)\n", scalar_srgb);
+
+  struct { const i8 *name; ImageFilter filter; u32 flags; } runs[3] =
+  {
+    {"simd box", IMAGE_FILTER_BOX, 0},
+    {"simd box srgb", IMAGE_FILTER_BOX, IMAGE_MIP_SRGB},
+    {"kaiser srgb", IMAGE_FILTER_KAISER, IMAGE_MIP_SRGB},
+  };
+
+  // The box runs replace the scalar box above, so they report a speedup. Kaiser
+  // is a different, wider filter with nothing before it to beat: it reports
+  // what it costs over the box filter it is an alternative to.
+  f64 box_srgb = 0.0;
+  for (u32 r = 0; r < 3; r++)
+  {
+    ImageLevel levels[IMAGE_MAX_LEVELS];
+    start = now_ms();
+    u32 count = img_gen_mips(rgba, size, size, 4, runs[r].filter, runs[r].flags, levels);
+    f64 elapsed = now_ms() - start;
+    if (runs[r].filter == IMAGE_FILTER_KAISER)
+    {
+      printf("[mips] 4096^2 RGBA8 %-18s %7.1f ms (%.2fx the time of simd box srgb)\n",
+             runs[r].name, elapsed, elapsed / box_srgb);
+    }
+    else
+    {
+      f64 base = runs[r].flags & IMAGE_MIP_SRGB ? scalar_srgb : scalar;
+      printf("[mips] 4096^2 RGBA8 %-18s %7.1f ms (%.2fx faster than scalar)\n",
+             runs[r].name, elapsed, base / elapsed);
+      if (runs[r].flags & IMAGE_MIP_SRGB) box_srgb = elapsed;
+    }
+    img_free_levels(levels, count);
+  }
+
+  free(rgba);
+}
+
+// Identical to bench_math_update_inline, but every vector op is a call into
+// base_math.c.
+static
+void bench_math_update_call(BenchEntity *entities, u32 count, f32 dt)
+{
+  const Vec2F gravity = {0.0f, -9.8f};
+  const Vec2F bounds = {800.0f, 450.0f};
+
+  for (u32 i = 0; i < count; i++)
+  {
+    BenchEntity *e = &entities[i];
+    e->vel = add_2f(e->vel, scale_2f(gravity, dt));
+    e->pos = add_2f(e->pos, scale_2f(e->vel, dt));
+
+    if (distance_squared_2f(e->pos, bounds) < e->radius * e->radius)
+    {
+      e->vel = scale_2f(e->vel, -0.5f);
+    }
+
+    e->xform = mul_3x3f(translate_3x3f(e->pos.x, e->pos.y), scale_3x3f(e->radius, e->radius));
+  }
+}
+
+static
+void bench_math(void)
+{
+  const u32 count = 1000000;
+  const u32 frames = 20;
+  const f32 dt = 1.0f / 60.0f;
+
+  BenchEntity *a = malloc(sizeof (BenchEntity) * count);
+  BenchEntity *b = malloc(sizeof (BenchEntity) * count);
+  for (u32 i = 0; i < count; i++)
+  {
+    a[i] = (BenchEntity)
+    {
+      .pos = {(f32) (rng_next() % 800), (f32) (rng_next() % 450)},
+      .vel = {(f32) (rng_next() % 200) - 100.0f, (f32) (rng_next() % 200) - 100.0f},
+      .radius = 1.0f + (f32) (rng_next() % 16),
+    };
+    b[i] = a[i];
+  }
+
+  f64 start = now_ms();
+  for (u32 f = 0; f < frames; f++) bench_math_update_call(a, count, dt);
+  f64 call = (now_ms() - start) / frames;
+
+  start = now_ms();
+  for (u32 f = 0; f < frames; f++) bench_math_update_inline(b, count, dt);
+  f64 inlined = (now_ms() - start) / frames;
+
+  f64 drift = 0.0;
+  for (u32 i = 0; i < count; i++) drift += fabs(a[i].xform.elements[0][2] - b[i].xform.elements[0][2]);
+
+  printf("[math] 1M entities, out-of-line: %6.2f ms/frame (%.2f ns/entity)\n",
+         call, call * 1e6 / count);
+  printf("[math] 1M entities, header-only: %6.2f ms/frame (%.2f ns/entity, %.2fx, drift %g)\n",
+         inlined, inlined * 1e6 / count, call / inlined, drift);
+
+  free(a);
+  free(b);
+}
+
+static
+void bench_trig(void)
+{
+  const u32 count = 1 << 22;
+  f32 *x = malloc(sizeof (f32) * count);
+  f32 *s = malloc(sizeof (f32) * count);
+  f32 *c = malloc(sizeof (f32) * count);
+  for (u32 i = 0; i < count; i++) x[i] = ((f32) rng_next() / 4294967295.0f - 0.5f) * 200.0f;
+
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    s[i] = sinf(x[i]);
+    c[i] = cosf(x[i]);
+  }
+  f64 libm = now_ms() - start;
+  printf("[trig] 4M sincos, libm sinf+cosf:  %6.2f ms\n", libm);
+
+  const i8 *names[2] = {"precise", "fast"};
+  for (u32 t = 0; t < 2; t++)
+  {
+    start = now_ms();
+    for (u32 i = 0; i < count; i++) sincos_f32(x[i], t, &s[i], &c[i]);
+    f64 scalar = now_ms() - start;
+
+    start = now_ms();
+    for (u32 i = 0; i < count; i += 4) sincos_4f32(&x[i], t, &s[i], &c[i]);
+    f64 wide4 = now_ms() - start;
+
+    start = now_ms();
+    for (u32 i = 0; i < count; i += 8) sincos_8f32(&x[i], t, &s[i], &c[i]);
+    f64 wide8 = now_ms() - start;
+
+    printf("[trig] 4M sincos, %-7s scalar: %6.2f ms (%.2fx libm), 4-wide %.2f ms (%.2fx), "
+           "8-wide %.2f ms (%.2fx)\n",
+           names[t], scalar, libm / scalar, wide4, libm / wide4, wide8, libm / wide8);
+  }
+
+  free(x);
+  free(s);
+  free(c);
+}
+
+// The vector kernels as they were before the @SIMD rewrite, kept to measure
+// against. magnitude_4f also carried the z-for-w typo.
+static
+f32 legacy_magnitude_3f(Vec3F v)
+{
+  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f));
+}
+
+static
+f32 legacy_magnitude_4f(Vec4F v)
+{
+  return sqrtf(powf(v.x, 2.0f) + powf(v.y, 2.0f) + powf(v.z, 2.0f) + powf(v.z, 2.0f));
+}
+
+static
+Vec4F legacy_transform_4f(Vec4F v, Mat4x4F m)
+{
+  Vec4F result = {0};
+
+  for (u8 c = 0; c < 4; c++)
+  {
+    result.x += m.elements[0][c] * v.elements[c];
+    result.y += m.elements[1][c] * v.elements[c];
+    result.z += m.elements[2][c] * v.elements[c];
+    result.w += m.elements[3][c] * v.elements[c];
+  }
+
+  return result;
+}
+
+static
+void bench_normalize(void)
+{
+  const u32 count = 1 << 22;
+  Vec3F *v3 = malloc(sizeof (Vec3F) * count);
+  Vec4F *v4 = malloc(sizeof (Vec4F) * count);
+  Vec3F *out3 = malloc(sizeof (Vec3F) * count);
+  Vec4F *out4 = malloc(sizeof (Vec4F) * count);
+  f32 *len = malloc(sizeof (f32) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    for (u32 k = 0; k < 4; k++)
+    {
+      v4[i].elements[k] = ((f32) rng_next() / 4294967295.0f - 0.5f) * 200.0f;
+    }
+    v3[i] = v3f(v4[i].x, v4[i].y, v4[i].z);
+  }
+
+  memset(out3, 0, sizeof (Vec3F) * count);
+  memset(out4, 0, sizeof (Vec4F) * count);
+  memset(len, 0, sizeof (f32) * count);
+
+  // Old code, inlined here, against the library through the regular build and
+  // the header-only one; Vec4F kernels inline in both, so the two should match
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++) len[i] = legacy_magnitude_4f(v4[i]);
+  f64 old_mag = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) len[i] = magnitude_4f(v4[i]);
+  f64 reg_mag = now_ms() - start;
+
+  start = now_ms();
+  bench_math_magnitude_inline(v4, len, count);
+  f64 inline_mag = now_ms() - start;
+
+  printf("[vector] 4M magnitude_4f, old: %6.2f ms, regular: %6.2f ms (%.2fx), "
+         "header-only: %6.2f ms (%.2fx)\n",
+         old_mag, reg_mag, old_mag / reg_mag, inline_mag, old_mag / inline_mag);
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out3[i] = scale_3f(v3[i], 1.0f / legacy_magnitude_3f(v3[i]));
+  f64 old_norm3 = now_ms() - start;
+
+  const i8 *names[3] = {"exact", "fast", "safe"};
+  for (u32 variant = 0; variant < 3; variant++)
+  {
+    start = now_ms();
+    bench_math_normalize3_inline(v3, out3, count, variant);
+    f64 t = now_ms() - start;
+    printf("[vector] 4M normalize_3f, old: %6.2f ms, %-5s inline: %6.2f ms (%.2fx)\n",
+           old_norm3, names[variant], t, old_norm3 / t);
+  }
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out4[i] = scale_4f(v4[i], 1.0f / legacy_magnitude_4f(v4[i]));
+  f64 old_norm4 = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out4[i] = normalize_4f(v4[i]);
+  f64 reg_norm4 = now_ms() - start;
+  printf("[vector] 4M normalize_4f, old: %6.2f ms, exact regular: %6.2f ms (%.2fx)\n",
+         old_norm4, reg_norm4, old_norm4 / reg_norm4);
+
+  for (u32 variant = 0; variant < 3; variant++)
+  {
+    start = now_ms();
+    bench_math_normalize4_inline(v4, out4, count, variant);
+    f64 t = now_ms() - start;
+    printf("[vector] 4M normalize_4f, old: %6.2f ms, %-5s inline: %6.2f ms (%.2fx)\n",
+           old_norm4, names[variant], t, old_norm4 / t);
+  }
+
+  Mat4x4F m = trs_4x4f(v3f(1.0f, 2.0f, 3.0f),
+                       axis_angle_qf(v3f(0.0f, 1.0f, 0.0f), 30.0f),
+                       v3f(2.0f, 2.0f, 2.0f));
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out4[i] = legacy_transform_4f(v4[i], m);
+  f64 old_xf = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out4[i] = transform_4f(v4[i], m);
+  f64 reg_xf = now_ms() - start;
+
+  start = now_ms();
+  bench_math_transform_inline(v4, out4, count, m);
+  f64 inline_xf = now_ms() - start;
+
+  printf("[vector] 4M transform_4f, old: %6.2f ms, regular: %6.2f ms (%.2fx), "
+         "header-only: %6.2f ms (%.2fx)\n",
+         old_xf, reg_xf, old_xf / reg_xf, inline_xf, old_xf / inline_xf);
+
+  free(v3);
+  free(v4);
+  free(out3);
+  free(out4);
+  free(len);
+}
+
+static
+void bench_trs(void)
+{
+  const u32 count = 1000000;
+  Vec3F *t = malloc(sizeof (Vec3F) * count);
+  Vec3F *sc = malloc(sizeof (Vec3F) * count);
+  QuatF *r = malloc(sizeof (QuatF) * count);
+  Mat4x4F *out = malloc(sizeof (Mat4x4F) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    t[i] = v3f((f32) (rng_next() % 1000), (f32) (rng_next() % 1000), (f32) (rng_next() % 1000));
+    sc[i] = v3f(1.0f + (rng_next() % 4), 1.0f, 1.0f + (rng_next() % 4));
+    r[i] = axis_angle_qf(v3f(0.0f, 1.0f, 0.0f), (f32) (rng_next() % 360));
+  }
+
+  // What callers wrote before TRS existed: three matrices and two multiplies
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    Mat4x4F m = mul_4x4f(scale_4x4f(sc[i].x, sc[i].y, sc[i].z), m4x4f_from_qf(r[i]));
+    out[i] = mul_4x4f(m, translate_4x4f(t[i].x, t[i].y, t[i].z));
+  }
+  f64 chain = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out[i] = trs_4x4f(t[i], r[i], sc[i]);
+  f64 direct = now_ms() - start;
+
+  start = now_ms();
+  trs_batch_4x4f(t, r, sc, out, count);
+  f64 batch = now_ms() - start;
+
+  printf("[trs] 1M transforms, T * R * S chain: %6.2f ms\n", chain);
+  printf("[trs] 1M transforms, trs_4x4f:        %6.2f ms (%.2fx)\n", direct, chain / direct);
+  printf("[trs] 1M transforms, trs_batch_4x4f:  %6.2f ms (%.2fx)\n", batch, chain / batch);
+
+  free(t);
+  free(sc);
+  free(r);
+  free(out);
+}
+
+static
+void bench_affine(void)
+{
+  const u32 count = 1000000;
+  Vec2F *pos = malloc(sizeof (Vec2F) * count);
+  f32 *rot = malloc(sizeof (f32) * count);
+  Mat3x3F *out_3x3 = malloc(sizeof (Mat3x3F) * count);
+  Affine2F *out_a2f = malloc(sizeof (Affine2F) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    pos[i] = v2f((f32) (rng_next() % 800), (f32) (rng_next() % 450));
+    rot[i] = (f32) (rng_next() % 360);
+  }
+
+  // The chain main.c used per sprite
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    Mat3x3F camera = mul_3x3f(translate_3x3f(400.0f, 225.0f), m3x3f(1.0f));
+    Mat3x3F projection = mul_3x3f(orthographic_3x3f(0, 800, 0, 450), m3x3f(1.0f));
+
+    Mat3x3F sprite = m3x3f(1.0f);
+    sprite = mul_3x3f(scale_3x3f(2.0f, 2.0f), sprite);
+    sprite = mul_3x3f(rotate_3x3f(rot[i]), sprite);
+    sprite = mul_3x3f(translate_3x3f(pos[i].x, pos[i].y), sprite);
+    out_3x3[i] = mul_3x3f(mul_3x3f(projection, camera), sprite);
+  }
+  f64 chain = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    Affine2F view = mul_a2f(orthographic_a2f(0, 800, 0, 450), translate_a2f(400.0f, 225.0f));
+    out_a2f[i] = mul_a2f(view, a2f(pos[i], rot[i], v2f(2.0f, 2.0f)));
+  }
+  f64 affine = now_ms() - start;
+
+  printf("[affine] 1M sprites, Mat3x3F chain: %6.2f ms\n", chain);
+  printf("[affine] 1M sprites, Affine2F:      %6.2f ms (%.2fx)\n", affine, chain / affine);
+
+  free(pos);
+  free(rot);
+  free(out_3x3);
+  free(out_a2f);
+}
+
+static
+void bench_inverse(void)
+{
+  const u32 count = 1000000;
+  Mat4x4F *m = malloc(sizeof (Mat4x4F) * count);
+  Mat4x4F *out = malloc(sizeof (Mat4x4F) * count);
+  HMM_Mat4 *hout = malloc(sizeof (HMM_Mat4) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    Vec3F t = v3f((f32) (rng_next() % 100), (f32) (rng_next() % 100), (f32) (rng_next() % 100));
+    QuatF r = axis_angle_qf(v3f(0.0f, 1.0f, 0.0f), (f32) (rng_next() % 360));
+    m[i] = trs_4x4f(t, r, v3f(2.0f, 1.0f, 3.0f));
+  }
+
+  // Fault the outputs in up front so the first timed loop does not pay for it
+  memset(out, 0, sizeof (Mat4x4F) * count);
+  memset(hout, 0, sizeof (HMM_Mat4) * count);
+
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    HMM_Mat4 h;
+    memcpy(&h, &m[i], sizeof (h));
+    hout[i] = HMM_InvGeneralM4(h);
+  }
+  f64 hmm = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out[i] = inverse_4x4f(m[i]);
+  f64 general = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++) out[i] = inverse_affine_4x4f(m[i]);
+  f64 affine = now_ms() - start;
+
+  printf("[inverse] 1M 4x4, HMM_InvGeneralM4:    %6.2f ms\n", hmm);
+  printf("[inverse] 1M 4x4, inverse_4x4f:        %6.2f ms (%.2fx)\n", general, hmm / general);
+  printf("[inverse] 1M 4x4, inverse_affine_4x4f: %6.2f ms (%.2fx)\n", affine, hmm / affine);
+
+  free(m);
+  free(out);
+  free(hout);
+}
+
+static
+void bench_culling(void)
+{
+  const u32 count = 1000000;
+  SphereF *spheres = malloc(sizeof (SphereF) * count);
+  AABB3F *boxes = malloc(sizeof (AABB3F) * count);
+  CircleF *circles = malloc(sizeof (CircleF) * count);
+  u32 *visible = malloc(sizeof (u32) * count);
+  memset(visible, 0, sizeof (u32) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    Vec3F c = v3f((f32) (rng_next() % 2000) - 1000.0f, 
+                  (f32) (rng_next() % 200) - 100.0f,
+                  (f32) (rng_next() % 2000) - 1000.0f);
+    f32 r = 1.0f + (f32) (rng_next() % 8);
+    spheres[i] = (SphereF) {c, r};
+    boxes[i] = (AABB3F) {v3f(c.x - r, c.y - r, c.z - r), v3f(c.x + r, c.y + r, c.z + r)};
+    circles[i] = (CircleF) {v2f(c.x, c.z), r};
+  }
+
+  Mat4x4F view = look_at_4x4f(v3f(0.0f, 50.0f, 0.0f), v3f(1.0f, 50.0f, -1.0f), v3f(0, 1, 0));
+  Mat4x4F proj = perspective_4x4f(70.0f, 16.0f / 9.0f, 0.5f, 800.0f);
+  FrustumF frustum = frustum_from_4x4f(mul_4x4f(view, proj));
+  AABB2F view_2d = {v2f(-400.0f, -225.0f), v2f(400.0f, 225.0f)};
+
+  f64 start = now_ms();
+  u32 n = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (sphere_in_frustum(&frustum, spheres[i])) visible[n++] = i;
+  }
+  f64 scalar = now_ms() - start;
+
+  start = now_ms();
+  u32 batch_n = cull_spheres(&frustum, spheres, count, visible);
+  f64 batch = now_ms() - start;
+  printf("[cull] 1M spheres: scalar %6.2f ms, batch %6.2f ms (%.2fx), %u visible\n",
+         scalar, batch, scalar / batch, batch_n);
+  (void) n;
+
+  start = now_ms();
+  n = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (aabb_in_frustum(&frustum, boxes[i])) visible[n++] = i;
+  }
+  scalar = now_ms() - start;
+
+  start = now_ms();
+  batch_n = cull_aabbs(&frustum, boxes, count, visible);
+  batch = now_ms() - start;
+  printf("[cull] 1M AABBs:   scalar %6.2f ms, batch %6.2f ms (%.2fx), %u visible\n",
+         scalar, batch, scalar / batch, batch_n);
+
+  start = now_ms();
+  n = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (overlap_circle_aabb2f(circles[i], view_2d)) visible[n++] = i;
+  }
+  scalar = now_ms() - start;
+
+  start = now_ms();
+  batch_n = cull_circles_2d(view_2d, circles, count, visible);
+  batch = now_ms() - start;
+  printf("[cull] 1M circles: scalar %6.2f ms, batch %6.2f ms (%.2fx), %u visible\n",
+         scalar, batch, scalar / batch, batch_n);
+
+  free(spheres);
+  free(boxes);
+  free(circles);
+  free(visible);
+}
+
+// Points spread over a world sized so each 16 unit cell holds about 4 of them.
+static
+void bench_spatial_grid_run(u32 count)
+{
+  const u32 query_count = 10000;
+  const u32 brute_count = 100;
+  const f32 cell = 16.0f;
+  f32 side = sqrtf((f32) count / 4.0f) * cell;
+
+  Vec2F *points = malloc(sizeof (Vec2F) * count);
+  Vec2F *queries = malloc(sizeof (Vec2F) * query_count);
+  u32 *found = malloc(sizeof (u32) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    points[i] = v2f((f32) rng_next() / 4294967296.0f * side, (f32) rng_next() / 4294967296.0f * side);
+  }
+  for (u32 i = 0; i < query_count; i++)
+  {
+    queries[i] = v2f((f32) rng_next() / 4294967296.0f * side, (f32) rng_next() / 4294967296.0f * side);
+  }
+
+  SpatialGrid grid = spatial_grid_create(cell, count);
+  spatial_grid_build(&grid, points, count);
+
+  const u32 frames = 10;
+  f64 start = now_ms();
+  for (u32 f = 0; f < frames; f++) spatial_grid_build(&grid, points, count);
+  f64 build = (now_ms() - start) / frames;
+
+  u64 hits = 0;
+  start = now_ms();
+  for (u32 i = 0; i < query_count; i++)
+  {
+    AABB2F box = {v2f(queries[i].x - 32.0f, queries[i].y - 32.0f), 
+                  v2f(queries[i].x + 32.0f, queries[i].y + 32.0f)};
+    hits += spatial_grid_query_aabb(&grid, box, found, count);
+  }
+  f64 aabb = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < query_count; i++)
+  {
+    hits += spatial_grid_query_radius(&grid, queries[i], 32.0f, found, count);
+  }
+  f64 radius = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < query_count; i++)
+  {
+    hits += spatial_grid_nearest(&grid, queries[i], 64.0f) >= 0;
+  }
+  f64 nearest = now_ms() - start;
+
+  // Brute force over a few queries, scaled to the same count
+  start = now_ms();
+  for (u32 i = 0; i < brute_count; i++)
+  {
+    for (u32 j = 0; j < count; j++)
+    {
+      if (distance_squared_2f(points[j], queries[i]) <= 32.0f * 32.0f) hits++;
+    }
+  }
+  f64 brute = (now_ms() - start) * query_count / brute_count;
+
+  printf("[grid] %7u points: rebuild %6.2f ms | 10k queries: aabb %6.2f ms, "
+         "radius %6.2f ms (%.0fx brute), nearest %6.2f ms (%llu hits)\n",
+         count, build, aabb, radius, brute / radius, nearest, (unsigned long long) hits);
+
+  spatial_grid_destroy(&grid);
+  free(points);
+  free(queries);
+  free(found);
+}
+
+static
+void bench_spatial_grid(void)
+{
+  bench_spatial_grid_run(100000);
+  bench_spatial_grid_run(1000000);
+}
+
+static
+f32 bench_rng_f32(f32 lo, f32 hi)
+{
+  return lo + (hi - lo) * ((f32) rng_next() / 4294967296.0f);
+}
+
+// SAH cost of the tree relative to its root: the expected number of nodes a
+// random ray visits, up to a constant.
+static
+f32 bench_bvh_cost(BVH *bvh)
+{
+  AABB3F root = bvh->nodes[bvh->root].box;
+  Vec3F d = sub_3f(root.max, root.min);
+  f64 root_area = d.x * d.y + d.y * d.z + d.z * d.x;
+  f64 sum = 0.0;
+
+  for (u32 i = 0; i < bvh->node_cap; i++)
+  {
+    if (bvh->nodes[i].height <= 0) continue;
+    d = sub_3f(bvh->nodes[i].box.max, bvh->nodes[i].box.min);
+    sum += d.x * d.y + d.y * d.z + d.z * d.x;
+  }
+
+  return (f32) (sum / root_area);
+}
+
+static
+void bench_bvh_queries(BVH *bvh, const i8 *label, AABB3F *queries, Vec3F *origins, u32 count)
+{
+  u32 *found = malloc(sizeof (u32) * 100000);
+  u64 hits = 0;
+
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++) hits += bvh_query_aabb(bvh, queries[i], found, 100000);
+  f64 query = now_ms() - start;
+
+  start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    BVHRayHit hit;
+    Vec3F dir = normalize_3f(sub_3f(V3F_ZERO, origins[i]));
+    hits += bvh_ray_cast(bvh, origins[i], dir, 2000.0f, &hit);
+  }
+  f64 ray = now_ms() - start;
+
+  printf("[bvh]  %-9s height %2u, cost %6.1f | 10k aabb %6.2f ms, 10k rays %6.2f ms (%llu hits)\n",
+         label, bvh_height(bvh), bench_bvh_cost(bvh), query, ray, (unsigned long long) hits);
+  free(found);
+}
+
+static
+void bench_bvh(void)
+{
+  const u32 count = 100000;
+  const u32 frames = 30;
+  const u32 query_count = 10000;
+
+  AABB3F *boxes = malloc(sizeof (AABB3F) * count);
+  Vec3F *velocity = malloc(sizeof (Vec3F) * count);
+  u32 *proxies = malloc(sizeof (u32) * count);
+  AABB3F *queries = malloc(sizeof (AABB3F) * query_count);
+  Vec3F *origins = malloc(sizeof (Vec3F) * query_count);
+
+  // Sizes from 0.1 to 100 units, which a uniform grid can't serve well
+  for (u32 i = 0; i < count; i++)
+  {
+    Vec3F c = v3f(bench_rng_f32(-1000, 1000), bench_rng_f32(-1000, 1000), bench_rng_f32(-1000, 1000));
+    f32 size = powf(10.0f, bench_rng_f32(-1, 2));
+    Vec3F e = v3f(size, size * bench_rng_f32(0.5f, 1), size * bench_rng_f32(0.5f, 1));
+    boxes[i] = (AABB3F) {sub_3f(c, e), add_3f(c, e)};
+    velocity[i] = v3f(bench_rng_f32(-1, 1), bench_rng_f32(-1, 1), bench_rng_f32(-1, 1));
+  }
+
+  for (u32 i = 0; i < query_count; i++)
+  {
+    Vec3F c = v3f(bench_rng_f32(-1000, 1000), bench_rng_f32(-1000, 1000), bench_rng_f32(-1000, 1000));
+    queries[i] = (AABB3F) {sub_3f(c, v3f(20, 20, 20)), add_3f(c, v3f(20, 20, 20))};
+    origins[i] = v3f(bench_rng_f32(-1500, 1500), bench_rng_f32(-1500, 1500), 1500.0f);
+  }
+
+  BVH incremental = bvh_create(count, 1.0f);
+  BVH rebuilt = bvh_create(count, 1.0f);
+
+  f64 start = now_ms();
+  for (u32 i = 0; i < count; i++) proxies[i] = bvh_insert(&incremental, boxes[i], i);
+  f64 insert = now_ms() - start;
+
+  f64 churn = 0.0;
+  f64 rebuild = 0.0;
+  u32 reinserted = 0;
+
+  for (u32 f = 0; f < frames; f++)
+  {
+    // A different 10% moves each frame
+    for (u32 i = f % 10; i < count; i += 10)
+    {
+      Vec3F d = velocity[i];
+      boxes[i] = (AABB3F) {add_3f(boxes[i].min, d), add_3f(boxes[i].max, d)};
+    }
+
+    start = now_ms();
+    for (u32 i = f % 10; i < count; i += 10) reinserted += bvh_move(&incremental, proxies[i], boxes[i]);
+    churn += now_ms() - start;
+
+    start = now_ms();
+    bvh_build(&rebuilt, boxes, count, NULL);
+    rebuild += now_ms() - start;
+  }
+
+  printf("[bvh]  100k boxes: insert all %6.2f ms | per frame with 10%% moving: "
+         "incremental %5.2f ms (%u reinserts), rebuild %5.2f ms\n",
+         insert, churn / frames, reinserted / frames, rebuild / frames);
+  bench_bvh_queries(&incremental, "churned", queries, origins, query_count);
+  bench_bvh_queries(&rebuilt, "rebuilt", queries, origins, query_count);
+
+  // Nested boxes tie on area at every step; balancing keeps inserts logarithmic
+  bvh_clear(&incremental);
+  start = now_ms();
+  for (u32 i = 0; i < count; i++)
+  {
+    f32 r = 1.0f + i;
+    bvh_insert(&incremental, (AABB3F) {v3f(-r, -r, 0.0f), v3f(r, r, 0.0f)}, i);
+  }
+  printf("[bvh]  100k nested boxes: insert all %6.2f ms, height %u\n", 
+         now_ms() - start, bvh_height(&incremental));
+
+  bvh_destroy(&incremental);
+  bvh_destroy(&rebuilt);
+  free(boxes);
+  free(velocity);
+  free(proxies);
+  free(queries);
+  free(origins);
+}
+
+static
+void bench_vertex_pack(void)
+{
+  const u32 count = 1000000;
+  Vec3F *positions = malloc(sizeof (Vec3F) * count);
+  Vec2F *uvs = malloc(sizeof (Vec2F) * count);
+  Vec4F *colors = malloc(sizeof (Vec4F) * count);
+  VertexSnorm *snorm = malloc(sizeof (VertexSnorm) * count);
+  VertexHalf *half = malloc(sizeof (VertexHalf) * count);
+  f32 *floats = malloc(sizeof (f32) * count * 4);
+  u16 *halves = malloc(sizeof (u16) * count * 4);
+  u8 *bytes = malloc(count * 4);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    positions[i] = v3f(bench_rng_f32(-500, 500), bench_rng_f32(-500, 500), bench_rng_f32(-50, 50));
+    uvs[i] = v2f(bench_rng_f32(0, 1), bench_rng_f32(0, 1));
+    colors[i] = v4f(bench_rng_f32(0, 1), bench_rng_f32(0, 1), bench_rng_f32(0, 1), 1.0f);
+    memcpy(&floats[i * 4], colors[i].elements, sizeof (Vec4F));
+  }
+
+  memset(snorm, 0, sizeof (VertexSnorm) * count);
+  memset(half, 0, sizeof (VertexHalf) * count);
+  memset(halves, 0, sizeof (u16) * count * 4);
+  memset(bytes, 0, count * 4);
+
+  // The old f32 position[3] + color[3] vertex; the full set adds UVs and alpha
+  u64 r_vertex = sizeof (f32) * (3 + 3);
+  u64 full = sizeof (f32) * (3 + 2 + 4);
+  printf("[vertex] bytes per vertex: f32 pos+rgb %u, f32 pos+uv+rgba %u, VertexSnorm %u, "
+         "VertexHalf %u\n",
+         (u32) r_vertex, (u32) full, (u32) sizeof (VertexSnorm), 
+         (u32) sizeof (VertexHalf));
+  printf("[vertex] 1M vertex upload: %.1f MiB as f32, %.1f MiB packed (%.0f%% less)\n",
+         full * count / 1048576.0, sizeof (VertexSnorm) * count / 1048576.0,
+         100.0 * (1.0 - (f64) sizeof (VertexSnorm) / full));
+
+  f64 start = now_ms();
+  for (u64 i = 0; i < (u64) count * 4; i++) halves[i] = half_from_f32(floats[i]);
+  f64 half_scalar = now_ms() - start;
+
+  start = now_ms();
+  half_from_f32_n(floats, halves, (u64) count * 4);
+  f64 half_simd = now_ms() - start;
+
+  start = now_ms();
+  for (u64 i = 0; i < (u64) count * 4; i++) bytes[i] = unorm8_from_f32(floats[i]);
+  f64 unorm_scalar = now_ms() - start;
+
+  start = now_ms();
+  unorm8_from_f32_n(floats, bytes, (u64) count * 4);
+  f64 unorm_simd = now_ms() - start;
+
+  printf("[vertex] 4M f32 -> half:   scalar %6.2f ms, SIMD %6.2f ms (%.2fx)\n",
+         half_scalar, half_simd, half_scalar / half_simd);
+  printf("[vertex] 4M f32 -> unorm8: scalar %6.2f ms, SIMD %6.2f ms (%.2fx)\n",
+         unorm_scalar, unorm_simd, unorm_scalar / unorm_simd);
+
+  AABB3F bounds = vertex_bounds(positions, count);
+  start = now_ms();
+  vertex_pack_snorm(positions, uvs, colors, count, bounds, snorm);
+  f64 pack_snorm = now_ms() - start;
+
+  start = now_ms();
+  vertex_pack_half(positions, uvs, colors, count, half);
+  f64 pack_half = now_ms() - start;
+
+  printf("[vertex] 1M vertex_pack_snorm: %6.2f ms, vertex_pack_half: %6.2f ms\n",
+         pack_snorm, pack_half);
+
+  free(positions);
+  free(uvs);
+  free(colors);
+  free(snorm);
+  free(half);
+  free(floats);
+  free(halves);
+  free(bytes);
+}
+
+// UV sphere in ring order, the usual layout of generated and exported meshes
+static
+Mesh make_sphere_mesh(u32 rings, u32 segments)
+{
+  Mesh mesh = {0};
+  mesh.vertex_count = (rings + 1) * (segments + 1);
+  mesh.index_count = rings * segments * 6;
+  mesh.vertices = calloc(mesh.vertex_count, sizeof (MeshVertex));
+  mesh.indices = malloc(sizeof (u32) * mesh.index_count);
+
+  for (u32 r = 0; r <= rings; r++)
+  {
+    for (u32 s = 0; s <= segments; s++)
+    {
+      f32 theta = 3.14159265f * r / rings;
+      f32 phi = 6.28318531f * s / segments;
+      Vec3F n = v3f(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+      MeshVertex *v = &mesh.vertices[r * (segments + 1) + s];
+      v->position = n;
+      v->normal = n;
+      v->uv = v2f((f32) s / segments, (f32) r / rings);
+    }
+  }
+
+  u32 *i = mesh.indices;
+  for (u32 r = 0; r < rings; r++)
+  {
+    for (u32 s = 0; s < segments; s++)
+    {
+      u32 v = r * (segments + 1) + s;
+      *i++ = v; *i++ = v + segments + 1; *i++ = v + 1;
+      *i++ = v + 1; *i++ = v + segments + 1; *i++ = v + segments + 2;
+    }
+  }
+
+  return mesh;
+}
+
+static
+void bench_mesh_run(const i8 *label, Mesh mesh, bool shuffle)
+{
+  u32 tri_count = mesh.index_count / 3;
+  if (shuffle)
+  {
+    for (u32 t = tri_count - 1; t > 0; t--)
+    {
+      u32 j = rng_next() % (t + 1);
+      for (u32 k = 0; k < 3; k++)
+      {
+        u32 tmp = mesh.indices[t * 3 + k];
+        mesh.indices[t * 3 + k] = mesh.indices[j * 3 + k];
+        mesh.indices[j * 3 + k] = tmp;
+      }
+    }
+  }
+
+  f32 before16 = mesh_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 16);
+  f32 before32 = mesh_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 32);
+
+  f64 start = now_ms();
+  mesh_optimize(&mesh);
+  f64 elapsed = now_ms() - start;
+
+  f32 after16 = mesh_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 16);
+  f32 after32 = mesh_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 32);
+
+  printf("[mesh] %-18s %6u tris, ACMR fifo16 %.3f -> %.3f, fifo32 %.3f -> %.3f, %6.2f ms\n",
+         label, tri_count, before16, after16, before32, after32, elapsed);
+
+  mesh_free(&mesh);
+}
+
+static
+void bench_mesh(void)
+{
+  bench_mesh_run("sphere 128x256", make_sphere_mesh(128, 256), FALSE);
+  bench_mesh_run("sphere shuffled", make_sphere_mesh(128, 256), TRUE);
+  bench_mesh_run("sphere 16x32", make_sphere_mesh(16, 32), FALSE);
+}
+
+static
+void bench_lod(void)
+{
+  // Rolling terrain patch, 128x128 quads over 64 units
+  const u32 n = 128;
+  Mesh mesh = {0};
+  mesh.vertex_count = (n + 1) * (n + 1);
+  mesh.index_count = n * n * 6;
+  mesh.vertices = calloc(mesh.vertex_count, sizeof (MeshVertex));
+  mesh.indices = malloc(sizeof (u32) * mesh.index_count);
+
+  for (u32 y = 0; y <= n; y++)
+  {
+    for (u32 x = 0; x <= n; x++)
+    {
+      f32 fx = x * 0.5f, fy = y * 0.5f;
+      MeshVertex *v = &mesh.vertices[y * (n + 1) + x];
+      v->position = v3f(fx, fy, 1.5f * sinf(fx * 0.3f) * cosf(fy * 0.2f) + 0.3f * sinf(fx + fy));
+      v->normal = v3f(0.0f, 0.0f, 1.0f);
+      v->uv = v2f((f32) x / n, (f32) y / n);
+    }
+  }
+
+  u32 *index = mesh.indices;
+  for (u32 y = 0; y < n; y++)
+  {
+    for (u32 x = 0; x < n; x++)
+    {
+      u32 v = y * (n + 1) + x;
+      *index++ = v; *index++ = v + 1; *index++ = v + n + 1;
+      *index++ = v + 1; *index++ = v + n + 2; *index++ = v + n + 1;
+    }
+  }
+
+  mesh_optimize(&mesh);
+
+  f64 start = now_ms();
+  u32 lod_count = mesh_build_lods(&mesh, 6, 0.5f, 0.05f);
+  f64 build = now_ms() - start;
+
+  printf("[lod] terrain built %u levels in %.1f ms:", lod_count, build);
+  for (u32 i = 0; i < lod_count; i++)
+  {
+    printf(" %u (%.3f)", mesh.lods[i].index_count / 3, mesh.lods[i].error);
+  }
+  printf(" tris (error)\n");
+
+  // 10k instances scattered up to 2 km in front of the camera
+  const u32 count = 10000;
+  Mat4x4F *models = malloc(sizeof (Mat4x4F) * count);
+  u8 *lods = malloc(count);
+  for (u32 i = 0; i < count; i++)
+  {
+    f32 d = 10.0f + (f32) (rng_next() % 2000);
+    f32 x = ((f32) (rng_next() % 2001) - 1000.0f) * d / 2000.0f;
+    f32 s = 0.5f + (rng_next() % 100) / 100.0f;
+    models[i] = mul_4x4f(scale_4x4f(s, s, s), translate_4x4f(x, 0.0f, -d));
+  }
+
+  SphereF bounds = mesh_bounding_sphere(&mesh);
+  Mat4x4F view = look_at_4x4f(v3f(0.0f, 20.0f, 0.0f), v3f(0.0f, 20.0f, -1.0f), v3f(0.0f, 1.0f, 0.0f));
+  f32 lod_scale = mesh_lod_scale(perspective_4x4f(60.0f, 16.0f / 9.0f, 0.1f, 5000.0f), 1080.0f);
+
+  const u32 runs = 100;
+  start = now_ms();
+  for (u32 r = 0; r < runs; r++)
+  {
+    mesh_select_lods(&mesh, bounds, models, count, view, lod_scale, 1.0f, lods);
+  }
+  f64 select = (now_ms() - start) / runs;
+
+  u32 histogram[MESH_MAX_LODS] = {0};
+  u64 triangles = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    histogram[lods[i]]++;
+    triangles += mesh.lods[lods[i]].index_count / 3;
+  }
+
+  printf("[lod] 10k instances at 1 px: select %.3f ms (%.1f ns each), per level:", 
+         select, select * 1e6 / count);
+  for (u32 i = 0; i < lod_count; i++) printf(" %u", histogram[i]);
+  printf("\n[lod] triangles %.2fM with LODs vs %.2fM at full detail (%.1fx fewer)\n", 
+         triangles / 1e6, (f64) mesh.lods[0].index_count / 3 * count / 1e6, 
+         (f64) mesh.lods[0].index_count / 3 * count / triangles);
+
+  free(models);
+  free(lods);
+  mesh_free(&mesh);
+}
+
+static
+void bench_draw(void)
+{
+  // 64 sphere variants with 4 levels each, packed into one buffer
+  DrawPack pack = draw_pack_create(1 << 16, 1 << 18);
+  for (u32 i = 0; i < 64; i++)
+  {
+    Mesh mesh = make_sphere_mesh(8 + i % 8, 16 + i % 16);
+    mesh_build_lods(&mesh, 4, 0.5f, 0.1f);
+    draw_pack_add(&pack, &mesh);
+    mesh_free(&mesh);
+  }
+
+  // 10k objects, one draw each
+  const u32 count = 10000;
+  DrawList list = draw_list_create(count);
+  for (u32 i = 0; i < count; i++)
+  {
+    u32 mesh = rng_next() % pack.mesh_count;
+    u32 lod = rng_next() % pack.meshes[mesh].lod_count;
+    draw_list_add(&list, &pack, mesh, lod, 1);
+  }
+
+  printf("[draw] %u meshes, %u vertices, %u-bit indices, %u draws\n", pack.mesh_count, 
+         pack.vertex_count, draw_pack_index_size(&pack) * 8, list.count);
+
+  // Before packing every object bound its shader, its vertex array and drew
+  printf("[draw] %-9s %6u calls\n", "per mesh", count * 3);
+
+  const i8 *labels[] = {"loop", "multi", "indirect"};
+  DrawPath paths[] = {DRAW_PATH_LOOP, DRAW_PATH_MULTI, DRAW_PATH_INDIRECT};
+  const u32 runs = 100;
+  for (u32 p = 0; p < ARR_LEN(paths); p++)
+  {
+    DrawRecorder recorder = {0};
+    DrawBackend backend = draw_recorder_backend(&recorder);
+    f64 start = now_ms();
+    for (u32 r = 0; r < runs; r++)
+    {
+      recorder = (DrawRecorder) {0};
+      draw_list_submit(&list, paths[p], &backend);
+    }
+    f64 submit = (now_ms() - start) / runs;
+
+    printf("[draw] %-9s %6u calls, %6.1f KB commands, %.3f ms to submit\n", labels[p], 
+           recorder.api_calls, recorder.upload_bytes / 1024.0, submit);
+  }
+
+  draw_list_destroy(&list);
+  draw_pack_destroy(&pack);
+}
+
+// Streams meshes in and out of a 64 MB pool, 100 operations per frame, with
+// `budget` bytes of defragmentation per frame.
+static
+void bench_heap_run(u64 budget)
+{
+  const u32 max_allocs = 1024;
+  const u32 frames = 2000;
+  Heap heap = heap_create(64 << 20, max_allocs);
+  HeapHandle *handles = malloc(sizeof (HeapHandle) * max_allocs);
+  memset(handles, 0xFF, sizeof (HeapHandle) * max_allocs);
+  HeapMove moves[256];
+
+  u32 allocs = 0, failures = 0, move_count = 0;
+  u64 moved = 0;
+  f64 fragmentation = 0.0, occupancy = 0.0;
+  f64 op_time = 0.0, defrag_time = 0.0;
+
+  for (u32 frame = 0; frame < frames; frame++)
+  {
+    f64 start = now_ms();
+    for (u32 op = 0; op < 100; op++)
+    {
+      u32 i = rng_next() % max_allocs;
+      u64 offset;
+      if (heap_offset(&heap, handles[i], &offset))
+      {
+        heap_free(&heap, handles[i]);
+        continue;
+      }
+
+      // Mostly small meshes, a few up to 512 KB
+      u32 r = rng_next();
+      u64 size = 1024 + (u64) (r % 16384) * ((r >> 20) % 8 + 1) * ((r >> 24) % 4 + 1);
+      allocs++;
+      if (!heap_alloc(&heap, size, &handles[i], &offset))
+      {
+        handles[i].index = HEAP_NONE;
+        failures++;
+      }
+    }
+    op_time += now_ms() - start;
+
+    if (budget)
+    {
+      start = now_ms();
+      u32 count = heap_defrag(&heap, budget, moves, ARR_LEN(moves));
+      defrag_time += now_ms() - start;
+      move_count += count;
+      for (u32 m = 0; m < count; m++) moved += moves[m].size;
+    }
+
+    // Steady state only
+    if (frame >= frames / 2)
+    {
+      HeapStats stats = heap_stats(&heap);
+      fragmentation += stats.fragmentation;
+      occupancy += (f64) stats.used / heap.size;
+    }
+  }
+
+  printf("[heap] defrag %4llu KB/frame: occupancy %4.1f%%, fragmentation %.3f, "
+         "failed %4.1f%%, %.0f ns/op", 
+         (unsigned long long) budget / 1024, occupancy / (frames / 2) * 100.0, 
+         fragmentation / (frames / 2), 100.0 * failures / allocs, op_time * 1e6 / (frames * 100));
+  if (budget)
+  {
+    printf(", %.1f moves and %.0f KB per frame in %.1f us", (f64) move_count / frames, 
+           moved / 1024.0 / frames, defrag_time * 1000.0 / frames);
+  }
+  printf("\n");
+
+  free(handles);
+  heap_destroy(&heap);
+}
+
+static
+void bench_heap(void)
+{
+  bench_heap_run(0);
+  bench_heap_run(256 * 1024);
+  bench_heap_run(1024 * 1024);
+}
+
+#ifdef DEBUG
+static
+void bench_dbg(void)
+{
+  const u32 count = 1000000;
+  Vec3F *points = malloc(sizeof (Vec3F) * count * 2);
+  for (u32 i = 0; i < count * 2; i++)
+  {
+    points[i] = v3f((f32) (rng_next() % 1000), (f32) (rng_next() % 1000), 0.0f);
+  }
+
+  // The first frame grows the batch, the rest reuse it
+  const u32 frames = 10;
+  f64 line_time = 0.0, lines_time = 0.0;
+  for (u32 f = 0; f <= frames; f++)
+  {
+    dbg_clear();
+    f64 start = now_ms();
+    for (u32 i = 0; i < count; i++)
+    {
+      dbg_line(points[i * 2], points[i * 2 + 1], v4f(0.0f, 1.0f, 0.0f, 1.0f), DBG_DEPTH);
+    }
+    if (f) line_time += now_ms() - start;
+
+    dbg_clear();
+    start = now_ms();
+    dbg_lines(points, count * 2, v4f(0.0f, 1.0f, 0.0f, 1.0f), DBG_DEPTH);
+    if (f) lines_time += now_ms() - start;
+  }
+
+  dbg_clear();
+  f64 start = now_ms();
+  for (u32 i = 0; i < 1000; i++)
+  {
+    dbg_text(v2f(0.0f, i * 12.0f), 2.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), "frame 16.67 ms, draws 1234");
+  }
+  f64 text_time = now_ms() - start;
+
+  printf("[dbg] 1M segments: dbg_line %.2f ms, dbg_lines %.2f ms, %.0f MB to upload in one buffer\n", 
+         line_time / frames, lines_time / frames, count * 2.0 * sizeof (DbgVertex) / (1 << 20));
+  printf("[dbg] 1000 lines of text: %.2f ms, %u vertices\n", text_time, dbg_frame.text.count);
+
+  dbg_shutdown();
+  free(points);
+}
+#endif
+
+// Solid glyphs with widths varying by codepoint, kerning every pair of capitals
+static
+f32 bench_font_scale(void *user, f32 pixel_height)
+{
+  (void) user;
+  return pixel_height / 10.0f;
+}
+
+static
+void bench_font_v_metrics(void *user, f32 scale, f32 *ascent, f32 *descent, f32 *line_gap)
+{
+  (void) user;
+  *ascent = 8.0f * scale;
+  *descent = -2.0f * scale;
+  *line_gap = 1.0f * scale;
+}
+
+static
+u32 bench_font_glyph_index(void *user, u32 codepoint)
+{
+  (void) user;
+  return codepoint;
+}
+
+static
+void bench_font_glyph_metrics(void *user, u32 glyph, f32 scale, f32 *advance, i32 box[4])
+{
+  (void) user;
+  f32 width = 3.0f + glyph % 4;
+  *advance = (width + 1.0f) * scale;
+  box[0] = 0;
+  box[1] = (i32) floorf(-7.0f * scale);
+  box[2] = glyph == ' ' ? 0 : (i32) ceilf(width * scale);
+  box[3] = 0;
+}
+
+static
+f32 bench_font_kerning(void *user, u32 a, u32 b, f32 scale)
+{
+  (void) user;
+  return a >= 'A' && a <= 'Z' && b >= 'A' && b <= 'Z' ? -0.5f * scale : 0.0f;
+}
+
+static
+void bench_font_rasterize(void *user, u32 glyph, f32 scale, u8 *out, i32 w, i32 h, i32 stride)
+{
+  (void) user;
+  (void) scale;
+  for (i32 y = 0; y < h; y++)
+  {
+    for (i32 x = 0; x < w; x++) out[y * stride + x] = (u8) ((x * 7 + y * 3 + glyph) % 2 ? 255 : 0);
+  }
+}
+
+static
+void bench_font(void)
+{
+  FontSource source =
+  {
+    .scale_for_size = bench_font_scale,
+    .v_metrics = bench_font_v_metrics,
+    .glyph_index = bench_font_glyph_index,
+    .glyph_metrics = bench_font_glyph_metrics,
+    .kerning = bench_font_kerning,
+    .rasterize = bench_font_rasterize,
+  };
+
+  // 250 lines of 40 glyphs a frame, with the atlas lookup r_text does
+  const u32 lines = 250;
+  const u32 length = 40;
+  i8 *text = malloc((u64) lines * (length + 1));
+  for (u32 i = 0; i < lines; i++)
+  {
+    for (u32 j = 0; j < length; j++) text[i * (length + 1) + j] = (i8) (32 + rng_next() % 95);
+    text[i * (length + 1) + length] = 0;
+  }
+
+  Font font = font_create(source, 16.0f, FONT_BITMAP);
+  ShelfAtlas atlas = shelf_atlas_create(512, 512, 256);
+  FontQuad *quads = malloc(sizeof (FontQuad) * length);
+  FontVertex *vertices = malloc(sizeof (FontVertex) * 4 * lines * length);
+
+  const u32 frames = 100;
+  f64 layout_time = 0.0, emit_time = 0.0;
+  u32 quad_count = 0;
+  for (u32 f = 0; f <= frames; f++)
+  {
+    quad_count = 0;
+    for (u32 i = 0; i < lines; i++)
+    {
+      f64 start = now_ms();
+      u32 count = font_layout(&font, &text[i * (length + 1)], v2f(0.0f, i * 18.0f), 16.0f, quads);
+      for (u32 q = 0; q < count; q++)
+      {
+        FontGlyph *g = &font.glyphs[quads[q].glyph];
+        if (g->cached && shelf_atlas_touch(&atlas, g->handle, NULL)) continue;
+
+        AtlasRect rect;
+        g->cached = shelf_atlas_alloc(&atlas, g->x1 - g->x0, g->y1 - g->y0, &g->handle, &rect);
+        g->uv = v4f(rect.x / 512.0f, rect.y / 512.0f, 
+                    (rect.x + rect.w) / 512.0f, (rect.y + rect.h) / 512.0f);
+      }
+      f64 mid = now_ms();
+      font_emit(&font, quads, count, v4f(1.0f, 1.0f, 1.0f, 1.0f), &vertices[quad_count * 4]);
+      quad_count += count;
+      if (f)
+      {
+        layout_time += mid - start;
+        emit_time += now_ms() - mid;
+      }
+    }
+    shelf_atlas_next_frame(&atlas);
+  }
+
+  printf("[font] %u glyphs/frame: layout + cache %.3f ms, emit %.3f ms, %.0f KB of vertices, "
+         "1 draw instead of %u\n", quad_count, layout_time / frames, emit_time / frames, 
+         quad_count * 4.0 * sizeof (FontVertex) / 1024.0, quad_count);
+  font_destroy(&font);
+
+  // Cache misses: what a new glyph costs to rasterize in each mode
+  const u32 misses = 95;
+  u8 *raster = malloc(64 * 64);
+  for (u32 mode = FONT_BITMAP; mode <= FONT_SDF; mode++)
+  {
+    font = font_create(source, 32.0f, mode);
+    f64 start = now_ms();
+    for (u32 c = 32; c < 32 + misses; c++) font_rasterize(&font, font_glyph(&font, c), raster);
+    f64 time = now_ms() - start;
+
+    printf("[font] %s miss at 32 px: %.1f us per glyph\n", mode == FONT_SDF ? "sdf" : "bitmap", 
+           time * 1000.0 / misses);
+    font_destroy(&font);
+  }
+
+  shelf_atlas_destroy(&atlas);
+  free(raster);
+  free(vertices);
+  free(quads);
+  free(text);
+}
+
+static
+TargetDesc bench_graph_desc(i32 width, i32 height, TargetFormat color, TargetFormat depth)
+{
+  return (TargetDesc) {width, height, {color}, depth, 1};
+}
+
+// A deferred frame: shadows, G-buffer, SSAO, lighting, TAA, motion blur,
+// a five level bloom, tonemap and FXAA, plus a debug view nothing reads
+static
+void bench_graph_build(FrameGraph *graph, i32 w, i32 h)
+{
+  graph_reset(graph);
+
+  TargetDesc gbuffer_desc = 
+  {
+    w, h, {TARGET_FORMAT_RGBA8, TARGET_FORMAT_RGBA8, TARGET_FORMAT_RGBA16F}, 
+    TARGET_FORMAT_DEPTH24_STENCIL8, 1
+  };
+  TargetDesc screen_desc = bench_graph_desc(w, h, TARGET_FORMAT_RGBA8, TARGET_FORMAT_NONE);
+  TargetDesc hdr_desc = bench_graph_desc(w, h, TARGET_FORMAT_RGBA16F, TARGET_FORMAT_NONE);
+  TargetDesc ao_desc = bench_graph_desc(w / 2, h / 2, TARGET_FORMAT_R16F, TARGET_FORMAT_NONE);
+  TargetDesc shadow_desc = bench_graph_desc(2048, 2048, TARGET_FORMAT_NONE, TARGET_FORMAT_DEPTH32F);
+
+  u32 backbuffer = graph_import_target(graph, "backbuffer", &screen_desc);
+  u32 shadow = graph_create_target(graph, "shadow_map", &shadow_desc);
+  u32 gbuffer = graph_create_target(graph, "gbuffer", &gbuffer_desc);
+  u32 ao = graph_create_target(graph, "ssao", &ao_desc);
+  u32 ao_blur = graph_create_target(graph, "ssao_blur", &ao_desc);
+  u32 lit = graph_create_target(graph, "lit", &hdr_desc);
+  u32 taa = graph_create_target(graph, "taa", &hdr_desc);
+  u32 motion = graph_create_target(graph, "motion_blur", &hdr_desc);
+  u32 ldr = graph_create_target(graph, "ldr", &screen_desc);
+  u32 debug = graph_create_target(graph, "debug", &screen_desc);
+
+  u32 pass = graph_add_pass(graph, "shadows", NULL, NULL);
+  graph_write(graph, pass, shadow);
+  pass = graph_add_pass(graph, "gbuffer", NULL, NULL);
+  graph_write(graph, pass, gbuffer);
+  pass = graph_add_pass(graph, "debug_normals", NULL, NULL);
+  graph_read(graph, pass, gbuffer);
+  graph_write(graph, pass, debug);
+  pass = graph_add_pass(graph, "ssao", NULL, NULL);
+  graph_read(graph, pass, gbuffer);
+  graph_write(graph, pass, ao);
+  pass = graph_add_pass(graph, "ssao_blur", NULL, NULL);
+  graph_read(graph, pass, ao);
+  graph_write(graph, pass, ao_blur);
+  pass = graph_add_pass(graph, "lighting", NULL, NULL);
+  graph_read(graph, pass, gbuffer);
+  graph_read(graph, pass, shadow);
+  graph_read(graph, pass, ao_blur);
+  graph_write(graph, pass, lit);
+  pass = graph_add_pass(graph, "taa", NULL, NULL);
+  graph_read(graph, pass, lit);
+  graph_write(graph, pass, taa);
+  pass = graph_add_pass(graph, "motion_blur", NULL, NULL);
+  graph_read(graph, pass, taa);
+  graph_read(graph, pass, gbuffer);
+  graph_write(graph, pass, motion);
+
+  static const i8 *down_names[5] = {"bloom_down0", "bloom_down1", "bloom_down2", 
+                                    "bloom_down3", "bloom_down4"};
+  static const i8 *up_names[4] = {"bloom_up0", "bloom_up1", "bloom_up2", "bloom_up3"};
+  u32 down[5];
+  u32 up[4];
+  u32 source = motion;
+  for (u32 i = 0; i < 5; i++)
+  {
+    TargetDesc desc = bench_graph_desc(w >> (i + 1), h >> (i + 1), TARGET_FORMAT_RGBA16F, 
+                                       TARGET_FORMAT_NONE);
+    down[i] = graph_create_target(graph, down_names[i], &desc);
+    pass = graph_add_pass(graph, down_names[i], NULL, NULL);
+    graph_read(graph, pass, source);
+    graph_write(graph, pass, down[i]);
+    source = down[i];
+  }
+
+  for (i32 i = 3; i >= 0; i--)
+  {
+    TargetDesc desc = bench_graph_desc(w >> (i + 1), h >> (i + 1), TARGET_FORMAT_RGBA16F, 
+                                       TARGET_FORMAT_NONE);
+    up[i] = graph_create_target(graph, up_names[i], &desc);
+    pass = graph_add_pass(graph, up_names[i], NULL, NULL);
+    graph_read(graph, pass, source);
+    graph_read(graph, pass, down[i]);
+    graph_write(graph, pass, up[i]);
+    source = up[i];
+  }
+
+  pass = graph_add_pass(graph, "tonemap", NULL, NULL);
+  graph_read(graph, pass, motion);
+  graph_read(graph, pass, up[0]);
+  graph_write(graph, pass, ldr);
+  pass = graph_add_pass(graph, "fxaa", NULL, NULL);
+  graph_read(graph, pass, ldr);
+  graph_write(graph, pass, backbuffer);
+}
+
+static
+void bench_graph(void)
+{
+  static FrameGraph graph;
+  bench_graph_build(&graph, 1920, 1080);
+  graph_compile(&graph);
+  printf("[graph] sample pipeline at 1920x1080\n");
+  graph_dump(&graph, stdout);
+
+  const u32 iterations = 10000;
+  f64 start = now_ms();
+  for (u32 i = 0; i < iterations; i++)
+  {
+    bench_graph_build(&graph, 1920, 1080);
+    graph_compile(&graph);
+  }
+  f64 build_time = (now_ms() - start) / iterations;
+  printf("[graph] build + compile: %.2f us\n", build_time * 1000.0);
+
+  // Executed on the recording backend for a few frames, the pool keeps the
+  // physical targets alive between them
+  i32 sizes[3][2] = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+  for (u32 s = 0; s < ARR_LEN(sizes); s++)
+  {
+    TargetRecorder recorder = target_recorder_create(32);
+    TargetBackend backend = target_recorder_backend(&recorder);
+    TargetPool pool = target_pool_create(32, 2);
+
+    for (u32 frame = 0; frame < 4; frame++)
+    {
+      bench_graph_build(&graph, sizes[s][0], sizes[s][1]);
+      graph_compile(&graph);
+      graph_execute(&graph, &pool, &backend);
+      target_pool_next_frame(&pool, &backend);
+    }
+
+    printf("[graph] %4ix%-4i %u passes: %6.1f MB of targets on %2u physical, %6.1f MB "
+           "(%.0f%% saved), %u created over 4 frames\n", 
+           sizes[s][0], sizes[s][1], graph.order_count, graph.transient_bytes / 1048576.0, 
+           graph.physical_count, recorder.peak_bytes / 1048576.0, 
+           100.0 * (1.0 - (f64) graph.physical_bytes / graph.transient_bytes), recorder.creates);
+
+    target_pool_destroy(&pool, &backend);
+    target_recorder_destroy(&recorder);
+  }
+}
+
+// No GPU here; these are the bytes r_end_post moves, which bound the bloom's
+// cost on bandwidth limited hardware. The GPU timers measure the real thing.
+static
+void bench_post(void)
+{
+  PostPassCost passes[2 * POST_MAX_BLOOM_LEVELS];
+  u32 count = post_estimate(1920, 1080, post_bloom_levels(1920, 1080), passes);
+  printf("[post] passes at 1920x1080\n");
+  for (u32 i = 0; i < count; i++)
+  {
+    printf("[post]   %-10s %u %4ix%-4i read %6.2f MB, write %6.2f MB\n", 
+           passes[i].name, passes[i].level, passes[i].width, passes[i].height, 
+           passes[i].read_bytes / 1048576.0, passes[i].write_bytes / 1048576.0);
+  }
+
+  i32 sizes[4][2] = {{1280, 720}, {1920, 1080}, {2560, 1440}, {3840, 2160}};
+  for (u32 s = 0; s < ARR_LEN(sizes); s++)
+  {
+    u32 levels = post_bloom_levels(sizes[s][0], sizes[s][1]);
+    count = post_estimate(sizes[s][0], sizes[s][1], levels, passes);
+
+    u64 bytes = 0;
+    for (u32 i = 0; i < count; i++) bytes += passes[i].read_bytes + passes[i].write_bytes;
+
+    printf("[post] %4ix%-4i %u levels, %2u passes: %6.1f MB per frame, %5.2f GB/s at 60 fps\n", 
+           sizes[s][0], sizes[s][1], levels, count, bytes / 1048576.0, bytes * 60.0 / 1e9);
+  }
+}
+
+i32 main(void)
+{
+  bench_atlas_batches();
+  bench_shelf_atlas();
+  bench_block_compression();
+  bench_mips();
+  bench_math();
+  bench_trig();
+  bench_normalize();
+  bench_trs();
+  bench_affine();
+  bench_inverse();
+  bench_culling();
+  bench_spatial_grid();
+  bench_bvh();
+  bench_vertex_pack();
+  bench_mesh();
+  bench_lod();
+  bench_draw();
+  bench_heap();
+  #ifdef DEBUG
+  bench_dbg();
+  #endif
+  bench_font();
+  bench_graph();
+  bench_post();
+
+  return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "../src/base_common.h"
+#include "../src/base_math.h"
+
+typedef struct BenchEntity BenchEntity;
+struct BenchEntity
+{
+  Vec2F pos;
+  Vec2F vel;
+  f32 radius;
+  Mat3x3F xform;
+};
+
+void bench_math_update_inline(BenchEntity *entities, u32 count, f32 dt);
+
+// variant: 0 exact, 1 fast, 2 safe
+void bench_math_magnitude_inline(const Vec4F *v, f32 *out, u32 count);
+void bench_math_normalize3_inline(const Vec3F *v, Vec3F *out, u32 count, u32 variant);
+void bench_math_normalize4_inline(const Vec4F *v, Vec4F *out, u32 count, u32 variant);
+void bench_math_transform_inline(const Vec4F *v, Vec4F *out, u32 count, Mat4x4F m);
@@ -0,0 +1,62 @@
+// Same entity update as bench_math_call in bench.c, built against the
+// header-only math so every vector op can be inlined.
+
+#define BASE_MATH_HEADER_ONLY
+#define BASE_MATH_FORCE_INLINE
+
+#include "../src/base_common.h"
+#include "../src/base_math.h"
+
+#include "bench_math.h"
+
+void bench_math_update_inline(BenchEntity *entities, u32 count, f32 dt)
+{
+  const Vec2F gravity = {0.0f, -9.8f};
+  const Vec2F bounds = {800.0f, 450.0f};
+
+  for (u32 i = 0; i < count; i++)
+  {
+    BenchEntity *e = &entities[i];
+    e->vel = add_2f(e->vel, scale_2f(gravity, dt));
+    e->pos = add_2f(e->pos, scale_2f(e->vel, dt));
+
+    if (distance_squared_2f(e->pos, bounds) < e->radius * e->radius)
+    {
+      e->vel = scale_2f(e->vel, -0.5f);
+    }
+
+    e->xform = mul_3x3f(translate_3x3f(e->pos.x, e->pos.y), scale_3x3f(e->radius, e->radius));
+  }
+}
+
+// Vector kernel loops for bench_normalize, inlined so the SSE Vec4F paths are
+// the ones measured.
+void bench_math_magnitude_inline(const Vec4F *v, f32 *out, u32 count)
+{
+  for (u32 i = 0; i < count; i++) out[i] = magnitude_4f(v[i]);
+}
+
+void bench_math_normalize3_inline(const Vec3F *v, Vec3F *out, u32 count, u32 variant)
+{
+  switch (variant)
+  {
+    case 0: for (u32 i = 0; i < count; i++) out[i] = normalize_3f(v[i]); break;
+    case 1: for (u32 i = 0; i < count; i++) out[i] = normalize_fast_3f(v[i]); break;
+    case 2: for (u32 i = 0; i < count; i++) out[i] = normalize_safe_3f(v[i]); break;
+  }
+}
+
+void bench_math_normalize4_inline(const Vec4F *v, Vec4F *out, u32 count, u32 variant)
+{
+  switch (variant)
+  {
+    case 0: for (u32 i = 0; i < count; i++) out[i] = normalize_4f(v[i]); break;
+    case 1: for (u32 i = 0; i < count; i++) out[i] = normalize_fast_4f(v[i]); break;
+    case 2: for (u32 i = 0; i < count; i++) out[i] = normalize_safe_4f(v[i]); break;
+  }
+}
+
+void bench_math_transform_inline(const Vec4F *v, Vec4F *out, u32 count, Mat4x4F m)
+{
+  for (u32 i = 0; i < count; i++) out[i] = transform_4f(v[i], m);
+}
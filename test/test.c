@@ -1,16 +1,2492 @@
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "../src/base_common.h"
 #include "../src/base_math.h"
+#include "../src/atlas.h"
+#include "../src/image.h"
+#include "../src/spatial.h"
+#include "../src/vertex.h"
+#include "../src/mesh.h"
+#include "../src/draw.h"
+#include "../src/heap.h"
+#include "../src/dbg.h"
+#include "../src/font.h"
+#include "../src/target.h"
+#include "../src/graph.h"
+#include "../src/post.h"
+
+#include "test_math.h"
+
+#include "hmm/hmm.h"
 
 #define DeferLoop(start, end) \
   for (int _i_ = ((start), 0); _i_ == 0; (_i_ += 1), (end))
 
+#define EXPECT(exp) \
+  if (!(exp)) \
+  { \
+    printf("[Test Failed]: %s:%i: %s\n", __FILE__, __LINE__, #exp); \
+    test_failures++; \
+  }
+
+static i32 test_failures;
+
+static u32 rng_state = 0x12345678;
+
+static
+u32 rng_next(void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static
+bool rects_overlap(AtlasRect a, AtlasRect b)
+{
+  return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+}
+
+static
+void test_skyline(void)
+{
+  Skyline skyline = skyline_create(256, 256);
+  AtlasRect rects[512];
+  i32 count = 0;
+
+  for (i32 i = 0; i < 512; i++)
+  {
+    i32 w = 4 + rng_next() % 28;
+    i32 h = 4 + rng_next() % 28;
+    if (skyline_insert(&skyline, w, h, &rects[count]))
+    {
+      EXPECT(rects[count].w == w && rects[count].h == h);
+      count++;
+    }
+  }
+
+  EXPECT(count > 0);
+
+  for (i32 i = 0; i < count; i++)
+  {
+    AtlasRect r = rects[i];
+    EXPECT(r.x >= 0 && r.y >= 0 && r.x + r.w <= 256 && r.y + r.h <= 256);
+
+    for (i32 j = i + 1; j < count; j++)
+    {
+      EXPECT(!rects_overlap(r, rects[j]));
+    }
+  }
+
+  // A page-sized rect only fits once
+  skyline_reset(&skyline);
+  AtlasRect full;
+  EXPECT(skyline_insert(&skyline, 256, 256, &full));
+  EXPECT(!skyline_insert(&skyline, 1, 1, &full));
+
+  skyline_destroy(&skyline);
+}
+
+static
+void test_atlas_find(void)
+{
+  const i8 *names[] = {"player", "enemy", "coin", "tile_grass", "tile_stone"};
+  AtlasSprite sprites[ARR_LEN(names)];
+
+  for (u32 i = 0; i < ARR_LEN(names); i++)
+  {
+    sprites[i] = (AtlasSprite) {.hash = atlas_hash(names[i]), .page = i, .name = names[i]};
+  }
+
+  // Sort by hash the same way AtlasPacker does
+  for (u32 i = 1; i < ARR_LEN(sprites); i++)
+  {
+    for (u32 j = i; j > 0 && sprites[j - 1].hash > sprites[j].hash; j--)
+    {
+      AtlasSprite tmp = sprites[j];
+      sprites[j] = sprites[j - 1];
+      sprites[j - 1] = tmp;
+    }
+  }
+
+  for (u32 i = 0; i < ARR_LEN(names); i++)
+  {
+    const AtlasSprite *sprite = atlas_find(sprites, ARR_LEN(sprites), names[i]);
+    EXPECT(sprite != NULL && strcmp(sprite->name, names[i]) == 0);
+  }
+
+  EXPECT(atlas_find(sprites, ARR_LEN(sprites), "missing") == NULL);
+}
+
+static
+void test_shelf_atlas(void)
+{
+  ShelfAtlas atlas = shelf_atlas_create(128, 128, 256);
+  AtlasHandle handles[256];
+  AtlasRect rects[256];
+  u32 count = 0;
+
+  // Fill the atlas within a single frame; nothing may be evicted
+  for (; count < 256; count++)
+  {
+    i32 w = 4 + rng_next() % 12;
+    i32 h = 4 + rng_next() % 12;
+    if (!shelf_atlas_alloc(&atlas, w, h, &handles[count], &rects[count])) break;
+  }
+
+  EXPECT(count > 0);
+  EXPECT(atlas.evictions == 0);
+  EXPECT(shelf_atlas_occupancy(&atlas) > 0.5f);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    AtlasRect r = rects[i];
+    EXPECT(r.x >= 0 && r.y >= 0 && r.x + r.w <= 128 && r.y + r.h <= 128);
+
+    for (u32 j = i + 1; j < count; j++)
+    {
+      EXPECT(!rects_overlap(r, rects[j]));
+    }
+  }
+
+  // Next frame, keep the first entry alive and force evictions
+  shelf_atlas_next_frame(&atlas);
+  AtlasRect kept;
+  EXPECT(shelf_atlas_touch(&atlas, handles[0], &kept));
+
+  AtlasHandle big;
+  AtlasRect big_rect;
+  EXPECT(shelf_atlas_alloc(&atlas, 100, 64, &big, &big_rect));
+  EXPECT(atlas.evictions > 0);
+  EXPECT(shelf_atlas_touch(&atlas, handles[0], NULL));
+  EXPECT(!rects_overlap(kept, big_rect));
+
+  u32 stale = 0;
+  for (u32 i = 1; i < count; i++)
+  {
+    AtlasRect r;
+    if (!shelf_atlas_touch(&atlas, handles[i], &r))
+    {
+      stale++;
+    }
+    else
+    {
+      EXPECT(!rects_overlap(r, big_rect));
+    }
+  }
+
+  EXPECT(stale > 0);
+
+  // Freeing everything gives the whole atlas back
+  shelf_atlas_free(&atlas, big);
+  for (u32 i = 0; i < count; i++) shelf_atlas_free(&atlas, handles[i]);
+  EXPECT(atlas.used_area == 0);
+  EXPECT(atlas.shelf_count == 0 && atlas.shelf_top == 0);
+
+  AtlasHandle full;
+  AtlasRect full_rect;
+  EXPECT(shelf_atlas_alloc(&atlas, 128, 128, &full, &full_rect));
+
+  shelf_atlas_destroy(&atlas);
+}
+
+static
+f64 psnr_rgba8(const u8 *a, const u8 *b, u64 count)
+{
+  f64 mse = 0.0;
+  for (u64 i = 0; i < count; i++)
+  {
+    f64 d = (f64) a[i] - b[i];
+    mse += d * d;
+  }
+
+  mse /= count;
+  if (mse == 0.0) return 99.0;
+
+  return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+// Smooth gradients with a little noise, roughly what real art compresses like
+static
+u8 *make_test_image(i32 width, i32 height)
+{
+  u8 *rgba = malloc((u64) width * height * 4);
+  for (i32 y = 0; y < height; y++)
+  {
+    for (i32 x = 0; x < width; x++)
+    {
+      u8 *p = &rgba[((u64) y * width + x) * 4];
+      p[0] = (x * 3) & 0xFF;
+      p[1] = (y * 3) & 0xFF;
+      p[2] = ((x + y) & 0xFF) / 2 + (rng_next() % 8);
+      p[3] = 255 - ((x * 3) & 0x7F);
+    }
+  }
+
+  return rgba;
+}
+
+static
+void test_block_compression(void)
+{
+  const i32 sizes[2][2] = {{64, 64}, {13, 7}};
+  const ImageFormat formats[3] = {IMAGE_FORMAT_BC1, IMAGE_FORMAT_BC3, IMAGE_FORMAT_BC7};
+  const f64 min_psnr[3] = {36.0, 36.0, 38.0};
+
+  for (u32 s = 0; s < 2; s++)
+  {
+    i32 w = sizes[s][0];
+    i32 h = sizes[s][1];
+    u8 *rgba = make_test_image(w, h);
+    u8 *decoded = malloc((u64) w * h * 4);
+    u8 *blocks = malloc(img_level_size(IMAGE_FORMAT_BC7, w, h));
+
+    for (u32 f = 0; f < 3; f++)
+    {
+      img_encode(formats[f], rgba, w, h, blocks);
+      img_decode(formats[f], blocks, w, h, decoded);
+
+      // BC1 carries no alpha, compare it as opaque
+      if (formats[f] == IMAGE_FORMAT_BC1)
+      {
+        u8 *opaque = malloc((u64) w * h * 4);
+        memcpy(opaque, rgba, (u64) w * h * 4);
+        for (i32 i = 0; i < w * h; i++) opaque[i * 4 + 3] = 255;
+        EXPECT(psnr_rgba8(opaque, decoded, (u64) w * h * 4) > min_psnr[f]);
+        free(opaque);
+      }
+      else
+      {
+        EXPECT(psnr_rgba8(rgba, decoded, (u64) w * h * 4) > min_psnr[f]);
+      }
+    }
+
+    free(rgba);
+    free(decoded);
+    free(blocks);
+  }
+
+  // Solid blocks survive BC7 within the p-bit rounding
+  u8 solid[16 * 4];
+  u8 block[16];
+  u8 out[16 * 4];
+  for (u32 i = 0; i < 16; i++)
+  {
+    solid[i * 4 + 0] = 201;
+    solid[i * 4 + 1] = 34;
+    solid[i * 4 + 2] = 90;
+    solid[i * 4 + 3] = 77;
+  }
+
+  img_encode(IMAGE_FORMAT_BC7, solid, 4, 4, block);
+  img_decode(IMAGE_FORMAT_BC7, block, 4, 4, out);
+  for (u32 i = 0; i < sizeof (solid); i++)
+  {
+    EXPECT(abs(solid[i] - out[i]) <= 1);
+  }
+}
+
+static
+void test_mips(void)
+{
+  const i32 sizes[3][2] = {{64, 32}, {37, 19}, {1, 9}};
+
+  // SIMD box chain matches the scalar reference bit for bit
+  for (u32 s = 0; s < 3; s++)
+  {
+    i32 w = sizes[s][0];
+    i32 h = sizes[s][1];
+    u8 *rgba = make_test_image(w, h);
+    ImageLevel levels[IMAGE_MAX_LEVELS];
+    u32 count = img_gen_mips(rgba, w, h, 4, IMAGE_FILTER_BOX, 0, levels);
+
+    EXPECT(count == img_mip_count(w, h));
+    EXPECT(levels[count - 1].width == 1 && levels[count - 1].height == 1);
+
+    for (u32 i = 1; i < count; i++)
+    {
+      u8 *ref = malloc(levels[i].size);
+      img_downsample_rgba8(levels[i - 1].data, levels[i - 1].width, levels[i - 1].height, ref);
+      EXPECT(memcmp(ref, levels[i].data, levels[i].size) == 0);
+      free(ref);
+    }
+
+    img_free_levels(levels, count);
+    free(rgba);
+  }
+
+  // A black/white checkerboard averages to linear 0.5, which is sRGB 188
+  u8 checker[4 * 4 * 3];
+  for (u32 i = 0; i < 16; i++)
+  {
+    u8 v = ((i % 4) + (i / 4)) % 2 ? 255 : 0;
+    checker[i * 3 + 0] = v;
+    checker[i * 3 + 1] = v;
+    checker[i * 3 + 2] = v;
+  }
+
+  ImageLevel levels[IMAGE_MAX_LEVELS];
+  u32 count = img_gen_mips(checker, 4, 4, 3, IMAGE_FILTER_BOX, IMAGE_MIP_SRGB, levels);
+  EXPECT(count == 3);
+  EXPECT(abs(levels[1].data[0] - 188) <= 1);
+  EXPECT(abs(levels[2].data[0] - 188) <= 1);
+  img_free_levels(levels, count);
+
+  // The sRGB flag leaves R and RG images linear, every channel of them
+  u8 stripes[4 * 2] = {0, 0, 255, 255, 0, 0, 255, 255};
+  count = img_gen_mips(stripes, 4, 1, 2, IMAGE_FILTER_BOX, IMAGE_MIP_SRGB, levels);
+  EXPECT(abs(levels[1].data[0] - 128) <= 1 && abs(levels[1].data[1] - 128) <= 1);
+  img_free_levels(levels, count);
+  u8 alternate[4] = {0, 255, 0, 255};
+  count = img_gen_mips(alternate, 4, 1, 1, IMAGE_FILTER_BOX, IMAGE_MIP_SRGB, levels);
+  EXPECT(abs(levels[1].data[0] - 128) <= 1 && abs(levels[2].data[0] - 128) <= 1);
+  img_free_levels(levels, count);
+
+  // Kaiser keeps flat images flat
+  u8 flat[16 * 16 * 4];
+  memset(flat, 120, sizeof (flat));
+  count = img_gen_mips(flat, 16, 16, 4, IMAGE_FILTER_KAISER, IMAGE_MIP_SRGB, levels);
+  for (u32 i = 1; i < count; i++)
+  {
+    for (u64 b = 0; b < levels[i].size; b++) EXPECT(abs(levels[i].data[b] - 120) <= 1);
+  }
+  img_free_levels(levels, count);
+
+  // Box filtering noisy alpha pulls everything towards 0.5; coverage
+  // preservation keeps the alpha-tested fraction close to the top level
+  u8 *cutout = malloc(64 * 64 * 4);
+  u32 covered = 0;
+  for (u32 i = 0; i < 64 * 64; i++)
+  {
+    u8 a = (rng_next() % 256) * (rng_next() % 256) / 255;
+    cutout[i * 4 + 3] = a;
+    covered += a > 127;
+  }
+
+  f32 target = (f32) covered / (64 * 64);
+  count = img_gen_mips(cutout, 64, 64, 4, IMAGE_FILTER_BOX, IMAGE_MIP_PRESERVE_COVERAGE, levels);
+  for (u32 i = 1; i < count && levels[i].width >= 8; i++)
+  {
+    u32 pass = 0;
+    u32 pixels = levels[i].width * levels[i].height;
+    for (u32 p = 0; p < pixels; p++) pass += levels[i].data[p * 4 + 3] > 127;
+    EXPECT(fabsf((f32) pass / pixels - target) < 0.05f);
+  }
+  img_free_levels(levels, count);
+  free(cutout);
+}
+
+static
+void test_image_container(void)
+{
+  const i8 *path = "test_image.tex";
+  u8 *rgba = make_test_image(40, 24);
+  Image image = img_compress(IMAGE_FORMAT_BC3, rgba, 40, 24, TRUE);
+
+  EXPECT(image.level_count == img_mip_count(40, 24));
+  EXPECT(image.levels[image.level_count - 1].width == 1);
+  EXPECT(image.levels[image.level_count - 1].height == 1);
+  EXPECT(img_save(path, &image));
+
+  Image loaded;
+  EXPECT(img_load(path, &loaded));
+  EXPECT(loaded.format == image.format && loaded.level_count == image.level_count);
+
+  for (u32 i = 0; i < loaded.level_count && i < image.level_count; i++)
+  {
+    EXPECT(loaded.levels[i].size == image.levels[i].size);
+    EXPECT(memcmp(loaded.levels[i].data, image.levels[i].data, image.levels[i].size) == 0);
+  }
+
+  img_free(&loaded);
+
+  // Zero, negative and huge sizes, and a level longer than the file, fail to load
+  u32 corrupt[4][7] =
+  {
+    {IMAGE_MAGIC, IMAGE_FORMAT_RGBA8, 0, 4, 1, 0, 0},
+    {IMAGE_MAGIC, IMAGE_FORMAT_RGBA8, 0x80000000u, 1, 1, 0, 0},
+    {IMAGE_MAGIC, IMAGE_FORMAT_RGBA8, 0x10000u, 0x10000u, 1, 0, 0},
+    {IMAGE_MAGIC, IMAGE_FORMAT_RGBA8, IMAGE_MAX_SIZE, IMAGE_MAX_SIZE, 1, 1u << 30, 0},
+  };
+  for (u32 i = 0; i < ARR_LEN(corrupt); i++)
+  {
+    FILE *file = fopen(path, "wb");
+    fwrite(corrupt[i], sizeof (u32), ARR_LEN(corrupt[i]), file);
+    fclose(file);
+    EXPECT(!img_load(path, &loaded) && loaded.level_count == 0);
+  }
+
+  remove(path);
+  img_free(&image);
+  free(rgba);
+}
+
+static
+void test_trig(void)
+{
+  const TrigPrecision tiers[2] = {TRIG_PRECISE, TRIG_FAST};
+  const f64 max_error[2] = {2e-6, 1e-3};
+
+  for (u32 t = 0; t < 2; t++)
+  {
+    f64 err = 0.0;
+    f64 wide_err = 0.0;
+
+    for (u32 i = 0; i < 100000; i += 8)
+    {
+      f32 x[8], s[8], c[8];
+      for (u32 j = 0; j < 8; j++)
+      {
+        x[j] = i + j < 50000 
+          ? -10.0f + 20.0f * (i + j) / 50000.0f
+          : ((f32) rng_next() / 4294967295.0f - 0.5f) * 2000.0f;
+      }
+
+      sincos_8f32(x, tiers[t], s, c);
+      for (u32 j = 0; j < 8; j++)
+      {
+        f32 ss, sc;
+        sincos_f32(x[j], tiers[t], &ss, &sc);
+        err = fmax(err, fmax(fabs(ss - sin(x[j])), fabs(sc - cos(x[j]))));
+        wide_err = fmax(wide_err, fmax(fabs(s[j] - sin(x[j])), fabs(c[j] - cos(x[j]))));
+      }
+
+      sincos_4f32(x, tiers[t], s, c);
+      for (u32 j = 0; j < 4; j++)
+      {
+        wide_err = fmax(wide_err, fmax(fabs(s[j] - sin(x[j])), fabs(c[j] - cos(x[j]))));
+      }
+    }
+
+    EXPECT(err < max_error[t]);
+    EXPECT(wide_err < max_error[t]);
+  }
+
+  // Exact at the quadrant boundaries, where the sign and swap logic flips
+  f32 s, c;
+  sincos_f32(0.0f, TRIG_PRECISE, &s, &c);
+  EXPECT(s == 0.0f && c == 1.0f);
+  sincos_f32((f32) -PI, TRIG_PRECISE, &s, &c);
+  EXPECT(fabsf(s) < 1e-6f && fabsf(c + 1.0f) < 1e-6f);
+
+  Mat3x3F r = rotate_3x3f(90.0f);
+  Vec3F v = transform_3f(v3f(1.0f, 0.0f, 1.0f), r);
+  EXPECT(fabsf(v.x) < 1e-6f && fabsf(v.y - 1.0f) < 1e-6f);
+
+  Mat4x4F r4 = rotate_4x4f(90.0f, v3f(0.0f, 0.0f, 1.0f));
+  Vec4F v4 = transform_4f(v4f(1.0f, 0.0f, 0.0f, 1.0f), r4);
+  EXPECT(fabsf(v4.x) < 1e-6f && fabsf(v4.y - 1.0f) < 1e-6f && v4.z == 0.0f);
+}
+
+static
+bool mat4_near(Mat4x4F a, Mat4x4F b, f32 eps)
+{
+  for (u32 r = 0; r < 4; r++)
+  {
+    for (u32 c = 0; c < 4; c++)
+    {
+      if (fabsf(a.elements[r][c] - b.elements[r][c]) > eps) return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static
+f32 rng_f32(f32 lo, f32 hi)
+{
+  return lo + (hi - lo) * ((f32) rng_next() / 4294967295.0f);
+}
+
+static
+QuatF rng_qf(void)
+{
+  Vec3F axis = normalize_3f(v3f(rng_f32(-1, 1), rng_f32(-1, 1), rng_f32(-1, 1)));
+  return axis_angle_qf(axis, rng_f32(-180.0f, 180.0f));
+}
+
+static
+void test_quat(void)
+{
+  // Agrees with the axis-angle matrix, and converts back up to sign
+  for (u32 i = 0; i < 100; i++)
+  {
+    Vec3F axis = normalize_3f(v3f(rng_f32(-1, 1), rng_f32(-1, 1), rng_f32(-1, 1)));
+    f32 angle = rng_f32(-179.0f, 179.0f);
+    QuatF q = axis_angle_qf(axis, angle);
+
+    EXPECT(mat4_near(m4x4f_from_qf(q), rotate_4x4f(angle, axis), 1e-5f));
+
+    QuatF back = qf_from_4x4f(m4x4f_from_qf(q));
+    EXPECT(fabsf(fabsf(dot_qf(back, q)) - 1.0f) < 1e-5f);
+
+    Vec3F v = v3f(rng_f32(-5, 5), rng_f32(-5, 5), rng_f32(-5, 5));
+    Vec3F a = rotate_qf(q, v);
+    Vec4F b = transform_4f(v4f(v.x, v.y, v.z, 1.0f), m4x4f_from_qf(q));
+    EXPECT(fabsf(a.x - b.x) < 1e-4f && fabsf(a.y - b.y) < 1e-4f && fabsf(a.z - b.z) < 1e-4f);
+  }
+
+  // mul_qf(a, b) applies b first; mul_4x4f(a, b) computes b * a
+  QuatF a = rng_qf();
+  QuatF b = rng_qf();
+  Mat4x4F ab = mul_4x4f(m4x4f_from_qf(b), m4x4f_from_qf(a));
+  EXPECT(mat4_near(m4x4f_from_qf(mul_qf(a, b)), ab, 1e-5f));
+  EXPECT(fabsf(dot_qf(mul_qf(a, conjugate_qf(a)), QF_IDENTITY) - 1.0f) < 1e-5f);
+
+  QuatF n = normalize_qf(qf(1.0f, 2.0f, 3.0f, 4.0f));
+  EXPECT(fabsf(dot_qf(n, n) - 1.0f) < 1e-6f);
+
+  // Slerp hits both ends and moves at constant angular speed
+  QuatF q0 = axis_angle_qf(v3f(0.0f, 1.0f, 0.0f), 0.0f);
+  QuatF q1 = axis_angle_qf(v3f(0.0f, 1.0f, 0.0f), 120.0f);
+  QuatF q_mid = axis_angle_qf(v3f(0.0f, 1.0f, 0.0f), 30.0f);
+  EXPECT(fabsf(dot_qf(slerp_qf(q0, q1, 0.0f), q0) - 1.0f) < 1e-6f);
+  EXPECT(fabsf(dot_qf(slerp_qf(q0, q1, 1.0f), q1) - 1.0f) < 1e-6f);
+  EXPECT(fabsf(dot_qf(slerp_qf(q0, q1, 0.25f), q_mid) - 1.0f) < 1e-6f);
+  QuatF nl = nlerp_qf(q0, q1, 0.5f);
+  EXPECT(fabsf(dot_qf(nl, nl) - 1.0f) < 1e-5f);
+
+  // TRS matches the chained build, and the batch matches the scalar path
+  Vec3F t[7], sc[7];
+  QuatF r[7];
+  Mat4x4F batch[7];
+  for (u32 i = 0; i < 7; i++)
+  {
+    t[i] = v3f(rng_f32(-100, 100), rng_f32(-100, 100), rng_f32(-100, 100));
+    sc[i] = v3f(rng_f32(0.1f, 4), rng_f32(0.1f, 4), rng_f32(0.1f, 4));
+    r[i] = rng_qf();
+  }
+
+  trs_batch_4x4f(t, r, sc, batch, 7);
+  for (u32 i = 0; i < 7; i++)
+  {
+    Mat4x4F chain = mul_4x4f(scale_4x4f(sc[i].x, sc[i].y, sc[i].z), m4x4f_from_qf(r[i]));
+    chain = mul_4x4f(chain, translate_4x4f(t[i].x, t[i].y, t[i].z));
+    Mat4x4F trs = trs_4x4f(t[i], r[i], sc[i]);
+    EXPECT(mat4_near(trs, chain, 1e-4f));
+    EXPECT(mat4_near(batch[i], trs, 1e-5f));
+  }
+}
+
+static
+bool affine_near(Mat3x3F a, Affine2F b, f32 eps)
+{
+  Mat3x3F m = m3x3f_from_a2f(b);
+  for (u32 r = 0; r < 3; r++)
+  {
+    for (u32 c = 0; c < 3; c++)
+    {
+      if (fabsf(a.elements[r][c] - m.elements[r][c]) > eps) return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static
+void test_affine(void)
+{
+  for (u32 i = 0; i < 100; i++)
+  {
+    Vec2F pos = v2f(rng_f32(-400, 400), rng_f32(-400, 400));
+    Vec2F scale = v2f(rng_f32(0.1f, 8), rng_f32(0.1f, 8));
+    f32 angle = rng_f32(-360, 360);
+
+    Mat3x3F chain = m3x3f(1.0f);
+    chain = mul_3x3f(scale_3x3f(scale.x, scale.y), chain);
+    chain = mul_3x3f(rotate_3x3f(angle), chain);
+    chain = mul_3x3f(translate_3x3f(pos.x, pos.y), chain);
+
+    Affine2F xform = a2f(pos, angle, scale);
+    EXPECT(affine_near(chain, xform, 1e-4f));
+
+    Affine2F view = mul_a2f(orthographic_a2f(0, 800, 0, 450), translate_a2f(400, 225));
+    Mat3x3F view_3x3 = mul_3x3f(orthographic_3x3f(0, 800, 0, 450), translate_3x3f(400, 225));
+    EXPECT(affine_near(view_3x3, view, 1e-6f));
+    EXPECT(affine_near(mul_3x3f(view_3x3, chain), mul_a2f(view, xform), 1e-4f));
+
+    Vec2F p = v2f(rng_f32(-10, 10), rng_f32(-10, 10));
+    Vec2F q = transform_a2f(p, xform);
+    Vec3F q3 = transform_3f(v3f(p.x, p.y, 1.0f), chain);
+    EXPECT(fabsf(q.x - q3.x) < 1e-3f && fabsf(q.y - q3.y) < 1e-3f);
+
+    Vec2F back = transform_a2f(q, invert_a2f(xform));
+    EXPECT(fabsf(back.x - p.x) < 1e-3f && fabsf(back.y - p.y) < 1e-3f);
+    EXPECT(affine_near(m3x3f(1.0f), mul_a2f(invert_a2f(xform), xform), 1e-4f));
+  }
+}
+
+// HMM stores column-major, elements[column][row]
+static
+bool mat4_near_hmm(Mat4x4F a, HMM_Mat4 b, f32 eps)
+{
+  for (u32 r = 0; r < 4; r++)
+  {
+    for (u32 c = 0; c < 4; c++)
+    {
+      f32 ref = b.elements[c][r];
+      if (fabsf(a.elements[r][c] - ref) > eps * fmaxf(1.0f, fabsf(ref))) return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static
+void test_camera(void)
+{
+  for (u32 i = 0; i < 200; i++)
+  {
+    Mat4x4F m;
+    HMM_Mat4 h;
+    for (u32 r = 0; r < 4; r++)
+    {
+      for (u32 c = 0; c < 4; c++)
+      {
+        m.elements[r][c] = rng_f32(-2, 2) + (r == c ? 4.0f : 0.0f);
+        h.elements[c][r] = m.elements[r][c];
+      }
+    }
+
+    Mat4x4F inv = inverse_4x4f(m);
+    EXPECT(mat4_near_hmm(inv, HMM_InvGeneralM4(h), 1e-4f));
+    EXPECT(mat4_near(mul_4x4f(inv, m), m4x4f(1.0f), 1e-4f));
+
+    QuatF q = rng_qf();
+    Vec3F t = v3f(rng_f32(-50, 50), rng_f32(-50, 50), rng_f32(-50, 50));
+    Vec3F sc = v3f(rng_f32(0.2f, 5), rng_f32(0.2f, 5), rng_f32(0.2f, 5));
+    Mat4x4F trs = trs_4x4f(t, q, sc);
+    EXPECT(mat4_near(inverse_affine_4x4f(trs), inverse_4x4f(trs), 1e-4f));
+    EXPECT(mat4_near(mul_4x4f(inverse_affine_4x4f(trs), trs), m4x4f(1.0f), 1e-4f));
+  }
+
+  Mat4x4F persp = perspective_4x4f(70.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+  HMM_Mat4 hpersp = HMM_Perspective_RH_NO(70.0f * HMM_DegToRad, 16.0f / 9.0f, 0.1f, 500.0f);
+  EXPECT(mat4_near_hmm(persp, hpersp, 1e-5f));
+
+  Vec3F eye = v3f(3.0f, 4.0f, 5.0f);
+  Vec3F center = v3f(-1.0f, 0.5f, 2.0f);
+  Vec3F up = v3f(0.0f, 1.0f, 0.0f);
+  Mat4x4F view = look_at_4x4f(eye, center, up);
+  HMM_Mat4 hview = HMM_LookAt_RH(HMM_V3(3.0f, 4.0f, 5.0f), HMM_V3(-1.0f, 0.5f, 2.0f), 
+                                 HMM_V3(0.0f, 1.0f, 0.0f));
+  EXPECT(mat4_near_hmm(view, hview, 1e-5f));
+
+  // HMM_InvLookAt gets the translation wrong in this HMM version; the camera's
+  // world transform must put it back at the eye
+  Mat4x4F cam = inverse_affine_4x4f(view);
+  EXPECT(mat4_near_hmm(cam, HMM_InvGeneralM4(hview), 1e-5f));
+  EXPECT(fabsf(cam.elements[0][3] - eye.x) < 1e-5f && fabsf(cam.elements[1][3] - eye.y) < 1e-5f);
+  EXPECT(fabsf(cam.elements[2][3] - eye.z) < 1e-5f);
+
+  // Reversed infinite: near lands on 1, far points approach 0
+  Mat4x4F rev = perspective_reversed_4x4f(70.0f, 16.0f / 9.0f, 0.1f);
+  Vec4F near_clip = transform_4f(v4f(0.0f, 0.0f, -0.1f, 1.0f), rev);
+  Vec4F far_clip = transform_4f(v4f(0.0f, 0.0f, -1e6f, 1.0f), rev);
+  EXPECT(fabsf(near_clip.z / near_clip.w - 1.0f) < 1e-6f);
+  EXPECT(far_clip.z / far_clip.w > 0.0f && far_clip.z / far_clip.w < 1e-6f);
+
+  // Project to pixels and back; mul_4x4f(a, b) computes b * a
+  Vec2F viewport = v2f(800.0f, 450.0f);
+  Mat4x4F view_proj = mul_4x4f(view, persp);
+  Mat4x4F inv_view_proj = inverse_4x4f(view_proj);
+  for (u32 i = 0; i < 50; i++)
+  {
+    Vec3F p = add_3f(center, v3f(rng_f32(-1, 1), rng_f32(-1, 1), rng_f32(-1, 1)));
+    Vec4F clip = transform_4f(v4f(p.x, p.y, p.z, 1.0f), view_proj);
+    Vec2F screen = 
+    {
+      (clip.x / clip.w * 0.5f + 0.5f) * viewport.x,
+      (0.5f - clip.y / clip.w * 0.5f) * viewport.y,
+    };
+
+    Vec3F back = unproject_4x4f(screen, clip.z / clip.w, viewport, inv_view_proj);
+    EXPECT(distance_3f(back, p) < 1e-3f);
+  }
+}
+
+static
+void test_culling(void)
+{
+  Mat4x4F view = look_at_4x4f(v3f(0.0f, 5.0f, 20.0f), V3F_ZERO, v3f(0.0f, 1.0f, 0.0f));
+  Mat4x4F proj = perspective_4x4f(60.0f, 16.0f / 9.0f, 0.5f, 100.0f);
+  Mat4x4F view_proj = mul_4x4f(view, proj);
+  FrustumF frustum = frustum_from_4x4f(view_proj);
+
+  // Points agree with the clip-space test
+  for (u32 i = 0; i < 1000; i++)
+  {
+    Vec3F p = v3f(rng_f32(-60, 60), rng_f32(-60, 60), rng_f32(-100, 30));
+    Vec4F clip = transform_4f(v4f(p.x, p.y, p.z, 1.0f), view_proj);
+    bool in_clip = fabsf(clip.x) <= clip.w && fabsf(clip.y) <= clip.w && fabsf(clip.z) <= clip.w;
+    f32 margin = fminf(fminf(clip.w - fabsf(clip.x), clip.w - fabsf(clip.y)), clip.w - fabsf(clip.z));
+    if (fabsf(margin) > 1e-3f) EXPECT(sphere_in_frustum(&frustum, (SphereF) {p, 0.0f}) == in_clip);
+  }
+
+  // Batch kernels match the scalar tests, including the tail
+  const u32 count = 1003;
+  SphereF *spheres = malloc(sizeof (SphereF) * count);
+  AABB3F *boxes = malloc(sizeof (AABB3F) * count);
+  CircleF *circles = malloc(sizeof (CircleF) * count);
+  AABB2F *rects = malloc(sizeof (AABB2F) * count);
+  u32 *visible = malloc(sizeof (u32) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    Vec3F c = v3f(rng_f32(-80, 80), rng_f32(-80, 80), rng_f32(-120, 40));
+    Vec3F e = v3f(rng_f32(0, 5), rng_f32(0, 5), rng_f32(0, 5));
+    spheres[i] = (SphereF) {c, rng_f32(0, 5)};
+    boxes[i] = (AABB3F) {sub_3f(c, e), add_3f(c, e)};
+    circles[i] = (CircleF) {v2f(c.x, c.y), e.x};
+    rects[i] = (AABB2F) {v2f(c.x - e.x, c.y - e.y), v2f(c.x + e.x, c.y + e.y)};
+  }
+
+  AABB2F view_2d = {v2f(-40.0f, -20.0f), v2f(30.0f, 25.0f)};
+
+  u32 n = cull_spheres(&frustum, spheres, count, visible);
+  u32 expected = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (!sphere_in_frustum(&frustum, spheres[i])) continue;
+    EXPECT(expected < n && visible[expected] == i);
+    expected++;
+  }
+  EXPECT(n == expected && n > 0 && n < count);
+
+  n = cull_aabbs(&frustum, boxes, count, visible);
+  expected = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (!aabb_in_frustum(&frustum, boxes[i])) continue;
+    EXPECT(expected < n && visible[expected] == i);
+    expected++;
+  }
+  EXPECT(n == expected && n > 0 && n < count);
+
+  n = cull_circles_2d(view_2d, circles, count, visible);
+  expected = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (!overlap_circle_aabb2f(circles[i], view_2d)) continue;
+    EXPECT(expected < n && visible[expected] == i);
+    expected++;
+  }
+  EXPECT(n == expected && n > 0 && n < count);
+
+  n = cull_aabbs_2d(view_2d, rects, count, visible);
+  expected = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (!overlap_aabb2f(rects[i], view_2d)) continue;
+    EXPECT(expected < n && visible[expected] == i);
+    expected++;
+  }
+  EXPECT(n == expected && n > 0 && n < count);
+
+  // Transformed boxes still contain every transformed corner
+  Affine2F xform = a2f(v2f(3.0f, -2.0f), 33.0f, v2f(2.0f, 0.5f));
+  AABB2F moved = transform_aabb2f(rects[0], xform);
+  for (u32 k = 0; k < 4; k++)
+  {
+    Vec2F corner = 
+    {
+      k & 1 ? rects[0].max.x : rects[0].min.x,
+      k & 2 ? rects[0].max.y : rects[0].min.y,
+    };
+    Vec2F p = transform_a2f(corner, xform);
+    EXPECT(p.x >= moved.min.x - 1e-4f && p.x <= moved.max.x + 1e-4f);
+    EXPECT(p.y >= moved.min.y - 1e-4f && p.y <= moved.max.y + 1e-4f);
+  }
+
+  free(spheres);
+  free(boxes);
+  free(circles);
+  free(rects);
+  free(visible);
+}
+
+static
+i32 compare_u32(const void *a, const void *b)
+{
+  u32 ua = *(const u32 *) a;
+  u32 ub = *(const u32 *) b;
+  return (ua > ub) - (ua < ub);
+}
+
+static
+void test_spatial_grid(void)
+{
+  // Few buckets for the spread of points, so many cells share one
+  const u32 count = 2000;
+  Vec2F *points = malloc(sizeof (Vec2F) * count);
+  u32 *found = malloc(sizeof (u32) * count);
+  u32 *expected = malloc(sizeof (u32) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    points[i] = v2f(rng_f32(-500, 500), rng_f32(-300, 300));
+  }
+
+  // Exact duplicates and points on cell borders
+  points[1] = points[0];
+  points[2] = v2f(-16.0f, 32.0f);
+
+  SpatialGrid grid = spatial_grid_create(16.0f, count);
+  spatial_grid_build(&grid, points, count);
+
+  for (u32 q = 0; q < 200; q++)
+  {
+    Vec2F c = v2f(rng_f32(-550, 550), rng_f32(-350, 350));
+    Vec2F e = v2f(rng_f32(0, 120), rng_f32(0, 120));
+    AABB2F box = {sub_2f(c, e), add_2f(c, e)};
+
+    u32 n = spatial_grid_query_aabb(&grid, box, found, count);
+    u32 m = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+      Vec2F p = points[i];
+      bool inside = p.x >= box.min.x && p.x <= box.max.x && p.y >= box.min.y && p.y <= box.max.y;
+      if (inside) expected[m++] = i;
+    }
+    qsort(found, n, sizeof (u32), compare_u32);
+    EXPECT(n == m && memcmp(found, expected, sizeof (u32) * m) == 0);
+
+    f32 radius = e.x;
+    n = spatial_grid_query_radius(&grid, c, radius, found, count);
+    m = 0;
+    for (u32 i = 0; i < count; i++)
+    {
+      if (distance_squared_2f(points[i], c) <= radius * radius) expected[m++] = i;
+    }
+    qsort(found, n, sizeof (u32), compare_u32);
+    EXPECT(n == m && memcmp(found, expected, sizeof (u32) * m) == 0);
+
+    i32 best = -1;
+    f32 best_d2 = radius * radius;
+    for (u32 i = 0; i < count; i++)
+    {
+      f32 d2 = distance_squared_2f(points[i], c);
+      if (d2 < best_d2 || (d2 == best_d2 && best < 0))
+      {
+        best = i;
+        best_d2 = d2;
+      }
+    }
+    EXPECT(spatial_grid_nearest(&grid, c, radius) == best);
+  }
+
+  // Duplicates resolve to the lowest index; output stops at max_out
+  EXPECT(spatial_grid_nearest(&grid, points[0], 1.0f) == 0);
+  AABB2F everything = {v2f(-1000.0f, -1000.0f), v2f(1000.0f, 1000.0f)};
+  EXPECT(spatial_grid_query_aabb(&grid, everything, found, 10) == 10);
+  EXPECT(spatial_grid_query_aabb(&grid, everything, found, count) == count);
+
+  spatial_grid_build(&grid, points, 0);
+  EXPECT(spatial_grid_nearest(&grid, V2F_ZERO, 100.0f) == -1);
+
+  spatial_grid_destroy(&grid);
+  free(points);
+  free(found);
+  free(expected);
+}
+
+// Walks the tree checking links, heights and that parents contain children.
+// Returns the number of leaves below `index`.
+static
+u32 bvh_check(BVH *bvh, u32 index, u32 parent)
+{
+  BVHNode *node = &bvh->nodes[index];
+  EXPECT(node->parent == parent && node->height >= 0);
+
+  if (node->height == 0)
+  {
+    EXPECT(contains_aabb3f(node->box, bvh->tight[index]));
+    return 1;
+  }
+
+  BVHNode *a = &bvh->nodes[node->child[0]];
+  BVHNode *b = &bvh->nodes[node->child[1]];
+  EXPECT(node->height == 1 + (a->height > b->height ? a->height : b->height));
+  EXPECT(contains_aabb3f(node->box, a->box) && contains_aabb3f(node->box, b->box));
+
+  return bvh_check(bvh, node->child[0], index) + bvh_check(bvh, node->child[1], index);
+}
+
+static
+AABB3F random_box(void)
+{
+  // Sizes span three orders of magnitude
+  Vec3F c = v3f(rng_f32(-200, 200), rng_f32(-200, 200), rng_f32(-200, 200));
+  f32 size = powf(10.0f, rng_f32(-1, 2));
+  Vec3F e = v3f(size * rng_f32(0.2f, 1), size * rng_f32(0.2f, 1), size * rng_f32(0.2f, 1));
+  return (AABB3F) {sub_3f(c, e), add_3f(c, e)};
+}
+
+static
+void test_bvh(void)
+{
+  const u32 count = 1500;
+  AABB3F *boxes = malloc(sizeof (AABB3F) * count);
+  u32 *proxies = malloc(sizeof (u32) * count);
+  bool *alive = malloc(sizeof (bool) * count);
+  u32 *found = malloc(sizeof (u32) * count);
+  u32 *expected = malloc(sizeof (u32) * count);
+
+  // Starts small so the pool has to grow under live proxies
+  BVH bvh = bvh_create(4, 0.5f);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    boxes[i] = random_box();
+    proxies[i] = bvh_insert(&bvh, boxes[i], i);
+    alive[i] = TRUE;
+  }
+
+  for (u32 round = 0; round < 3; round++)
+  {
+    for (u32 i = 0; i < count; i++)
+    {
+      u32 op = rng_next() % 10;
+      if (alive[i] && op < 3)
+      {
+        Vec3F d = v3f(rng_f32(-2, 2), rng_f32(-2, 2), rng_f32(-2, 2));
+        boxes[i] = (AABB3F) {add_3f(boxes[i].min, d), add_3f(boxes[i].max, d)};
+        bvh_move(&bvh, proxies[i], boxes[i]);
+      }
+      else if (alive[i] && op == 3)
+      {
+        bvh_remove(&bvh, proxies[i]);
+        alive[i] = FALSE;
+      }
+      else if (!alive[i] && op < 5)
+      {
+        boxes[i] = random_box();
+        proxies[i] = bvh_insert(&bvh, boxes[i], i);
+        alive[i] = TRUE;
+      }
+    }
+
+    u32 live = 0;
+    for (u32 i = 0; i < count; i++) live += alive[i];
+    EXPECT(bvh_check(&bvh, bvh.root, BVH_NULL) == live);
+    EXPECT(bvh.node_count == live * 2 - 1);
+
+    // Rotations keep it near log2(n) deep even with random churn
+    EXPECT(bvh_height(&bvh) < 32);
+
+    for (u32 q = 0; q < 100; q++)
+    {
+      AABB3F box = random_box();
+      u32 n = bvh_query_aabb(&bvh, box, found, count);
+      u32 m = 0;
+      for (u32 i = 0; i < count; i++)
+      {
+        if (alive[i] && overlap_aabb3f(boxes[i], box)) expected[m++] = i;
+      }
+      qsort(found, n, sizeof (u32), compare_u32);
+      EXPECT(n == m && memcmp(found, expected, sizeof (u32) * m) == 0);
+
+      Vec3F origin = v3f(rng_f32(-250, 250), rng_f32(-250, 250), rng_f32(-250, 250));
+      Vec3F dir = normalize_3f(sub_3f(v3f(rng_f32(-50, 50), rng_f32(-50, 50), 0.0f), origin));
+      f32 best_t = INFINITY;
+      for (u32 i = 0; i < count; i++)
+      {
+        if (!alive[i]) continue;
+        f32 t0 = 0.0f;
+        f32 t1 = 1000.0f;
+        for (u32 axis = 0; axis < 3; axis++)
+        {
+          f32 a = (boxes[i].min.elements[axis] - origin.elements[axis]) / dir.elements[axis];
+          f32 b = (boxes[i].max.elements[axis] - origin.elements[axis]) / dir.elements[axis];
+          t0 = fmaxf(t0, fminf(a, b));
+          t1 = fminf(t1, fmaxf(a, b));
+        }
+        if (t0 <= t1 && t0 < best_t) best_t = t0;
+      }
+
+      BVHRayHit hit;
+      bool any = bvh_ray_cast(&bvh, origin, dir, 1000.0f, &hit);
+      EXPECT(any == (best_t < INFINITY));
+      if (any) EXPECT(fabsf(hit.t - best_t) < 1e-3f && alive[hit.user]);
+    }
+  }
+
+  // A fresh build holds the same boxes
+  bvh_build(&bvh, boxes, count, proxies);
+  EXPECT(bvh_check(&bvh, bvh.root, BVH_NULL) == count);
+  EXPECT(bvh.nodes[proxies[7]].user == 7);
+  AABB3F all = {v3f(-1e4f, -1e4f, -1e4f), v3f(1e4f, 1e4f, 1e4f)};
+  EXPECT(bvh_query_aabb(&bvh, all, found, count) == count);
+
+  bvh_clear(&bvh);
+  EXPECT(bvh_query_aabb(&bvh, all, found, count) == 0);
+
+  bvh_destroy(&bvh);
+  free(boxes);
+  free(proxies);
+  free(alive);
+  free(found);
+  free(expected);
+}
+
+// Boxes where every placement costs the same area, so only balancing keeps
+// the tree from turning into a list
+static
+void test_bvh_degenerate(void)
+{
+  const u32 count = 10000;
+  u32 *found = malloc(sizeof (u32) * count);
+  BVH bvh = bvh_create(count, 0.1f);
+
+  AABB3F unit = {v3f(0.0f, 0.0f, 0.0f), v3f(1.0f, 1.0f, 0.0f)};
+  for (u32 i = 0; i < 2000; i++) bvh_insert(&bvh, unit, i);
+  EXPECT(bvh_check(&bvh, bvh.root, BVH_NULL) == 2000);
+  EXPECT(bvh_height(&bvh) <= 32);
+  EXPECT(bvh_query_aabb(&bvh, unit, found, count) == 2000);
+
+  BVHRayHit hit;
+  EXPECT(bvh_ray_cast(&bvh, v3f(0.5f, 0.5f, 5.0f), v3f(0.0f, 0.0f, -1.0f), 10.0f, &hit));
+  EXPECT(fabsf(hit.t - 5.0f) < 1e-4f);
+
+  // Nested, each box around all the ones before it, then half removed
+  bvh_clear(&bvh);
+  u32 *proxies = malloc(sizeof (u32) * count);
+  for (u32 i = 0; i < count; i++)
+  {
+    f32 r = 1.0f + i;
+    proxies[i] = bvh_insert(&bvh, (AABB3F) {v3f(-r, -r, 0.0f), v3f(r, r, 0.0f)}, i);
+  }
+
+  EXPECT(bvh_check(&bvh, bvh.root, BVH_NULL) == count);
+  EXPECT(bvh_height(&bvh) <= 64);
+  EXPECT(bvh_query_aabb(&bvh, unit, found, count) == count);
+
+  AABB3F ring = {v3f(5000.5f, 0.0f, 0.0f), v3f(5000.5f, 0.0f, 0.0f)};
+  EXPECT(bvh_query_aabb(&bvh, ring, found, count) == count - 5000);
+
+  for (u32 i = 0; i < count; i += 2) bvh_remove(&bvh, proxies[i]);
+  EXPECT(bvh_check(&bvh, bvh.root, BVH_NULL) == count / 2);
+  EXPECT(bvh_height(&bvh) <= 64);
+  EXPECT(bvh_ray_cast(&bvh, v3f(0.0f, 0.0f, 5.0f), v3f(0.0f, 0.0f, -1.0f), 10.0f, &hit));
+  EXPECT(hit.user % 2 == 1);
+
+  bvh_destroy(&bvh);
+  free(proxies);
+  free(found);
+}
+
+static
+bool half_is_nan(u16 h)
+{
+  return (h & 0x7C00) == 0x7C00 && (h & 0x03FF) != 0;
+}
+
+static
+void test_vertex_half(void)
+{
+  // Every half survives a round trip through f32; NaNs stay NaN
+  bool round_trip = TRUE;
+  for (u32 h = 0; h < 65536; h++)
+  {
+    u16 back = half_from_f32(f32_from_half((u16) h));
+    if (half_is_nan((u16) h) ? !half_is_nan(back) : back != h) round_trip = FALSE;
+  }
+  EXPECT(round_trip);
+
+  EXPECT(half_from_f32(1.0f) == 0x3C00);
+  EXPECT(half_from_f32(-2.0f) == 0xC000);
+  EXPECT(half_from_f32(65504.0f) == 0x7BFF);
+  EXPECT(half_from_f32(65520.0f) == 0x7C00); // Rounds up to infinity
+  EXPECT(half_from_f32(1e10f) == 0x7C00);
+  EXPECT(half_from_f32(-INFINITY) == 0xFC00);
+  EXPECT(half_is_nan(half_from_f32(NAN)));
+  EXPECT(half_from_f32(-0.0f) == 0x8000);
+  EXPECT(half_from_f32(5.9604645e-8f) == 0x0001); // Smallest denormal
+  EXPECT(half_from_f32(2.9e-8f) == 0x0000);
+  EXPECT(f32_from_half(0x0001) == 5.9604645e-8f);
+
+  // Random floats round to the nearest half, ties to even
+  bool nearest = TRUE;
+  for (u32 i = 0; i < 100000; i++)
+  {
+    f32 x = ldexpf(rng_f32(-1.0f, 1.0f), (i32) (rng_next() % 36) - 26);
+    u16 h = half_from_f32(x);
+    f64 err = fabs((f64) f32_from_half(h) - x);
+    f64 err_up = fabs((f64) f32_from_half(h + 1) - x);
+    f64 err_down = (h & 0x7FFF) ? fabs((f64) f32_from_half(h - 1) - x) : INFINITY;
+    if (err > err_up || err > err_down) nearest = FALSE;
+    if ((err == err_up || err == err_down) && (h & 1)) nearest = FALSE;
+  }
+  EXPECT(nearest);
+
+  // The SIMD batch matches the scalar path, specials and the tail included
+  const u32 count = 103;
+  f32 src[103];
+  u16 batch[103];
+  for (u32 i = 0; i < count; i++) src[i] = ldexpf(rng_f32(-1.0f, 1.0f), (i32) (rng_next() % 40) - 28);
+  src[0] = NAN;
+  src[1] = -INFINITY;
+  src[2] = 65520.0f;
+  src[3] = -0.0f;
+  src[4] = 3e-8f;
+  src[5] = 6.1035156e-5f; // Smallest normal
+
+  half_from_f32_n(src, batch, count);
+  bool same = TRUE;
+  for (u32 i = 0; i < count; i++)
+  {
+    u16 h = half_from_f32(src[i]);
+    if (half_is_nan(h) ? !half_is_nan(batch[i]) : batch[i] != h) same = FALSE;
+  }
+  EXPECT(same);
+}
+
+static
+void test_vertex_normalized(void)
+{
+  EXPECT(unorm8_from_f32(0.0f) == 0 && unorm8_from_f32(1.0f) == 255);
+  EXPECT(unorm8_from_f32(-3.0f) == 0 && unorm8_from_f32(7.0f) == 255);
+  EXPECT(unorm8_from_f32(NAN) == 0);
+  EXPECT(unorm16_from_f32(1.0f) == 65535 && unorm16_from_f32(0.5f) == 32768);
+  EXPECT(snorm16_from_f32(-1.0f) == -32767 && snorm16_from_f32(-2.0f) == -32767);
+  EXPECT(snorm16_from_f32(1.0f) == 32767 && snorm16_from_f32(0.0f) == 0);
+
+  const u32 count = 1001;
+  f32 *src = malloc(sizeof (f32) * count);
+  u8 *u8_out = malloc(count);
+  u16 *u16_out = malloc(sizeof (u16) * count);
+  i16 *i16_out = malloc(sizeof (i16) * count);
+  for (u32 i = 0; i < count; i++) src[i] = rng_f32(-1.25f, 1.25f);
+  src[0] = NAN;
+
+  unorm8_from_f32_n(src, u8_out, count);
+  unorm16_from_f32_n(src, u16_out, count);
+  snorm16_from_f32_n(src, i16_out, count);
+
+  // Within half a step of the clamped input, and at most a tie away from the
+  // scalar rounding
+  bool close = TRUE;
+  for (u32 i = 1; i < count; i++)
+  {
+    f32 u = MIN(MAX(src[i], 0.0f), 1.0f);
+    f32 s = MIN(MAX(src[i], -1.0f), 1.0f);
+    if (fabsf(u8_out[i] / 255.0f - u) > 0.5f / 255.0f + 1e-6f) close = FALSE;
+    if (fabsf(u16_out[i] / 65535.0f - u) > 0.5f / 65535.0f + 1e-6f) close = FALSE;
+    if (fabsf(i16_out[i] / 32767.0f - s) > 0.5f / 32767.0f + 1e-6f) close = FALSE;
+    if (abs(u8_out[i] - unorm8_from_f32(src[i])) > 1) close = FALSE;
+    if (abs(u16_out[i] - unorm16_from_f32(src[i])) > 1) close = FALSE;
+    if (abs(i16_out[i] - snorm16_from_f32(src[i])) > 1) close = FALSE;
+  }
+  EXPECT(close);
+  EXPECT(u8_out[0] == 0 && u16_out[0] == 0 && i16_out[0] == -32767);
+
+  free(src);
+  free(u8_out);
+  free(u16_out);
+  free(i16_out);
+}
+
+static
+void test_vertex_pack(void)
+{
+  const u32 count = 500;
+  Vec3F *positions = malloc(sizeof (Vec3F) * count);
+  Vec2F *uvs = malloc(sizeof (Vec2F) * count);
+  Vec4F *colors = malloc(sizeof (Vec4F) * count);
+  VertexSnorm *snorm = malloc(sizeof (VertexSnorm) * count);
+  VertexHalf *half = malloc(sizeof (VertexHalf) * count);
+
+  for (u32 i = 0; i < count; i++)
+  {
+    positions[i] = v3f(rng_f32(-40, 120), rng_f32(3, 5), 1.0f);
+    uvs[i] = v2f(rng_f32(0, 1), rng_f32(0, 1));
+    colors[i] = v4f(rng_f32(0, 1), rng_f32(0, 1), rng_f32(0, 1), rng_f32(0, 1));
+  }
+
+  EXPECT(sizeof (VertexSnorm) == 16 && sizeof (VertexHalf) == 16);
+
+  // z is flat, the dequantize matrix must still bring it back
+  AABB3F bounds = vertex_bounds(positions, count);
+  EXPECT(bounds.min.z == 1.0f && bounds.max.z == 1.0f);
+  vertex_pack_snorm(positions, uvs, colors, count, bounds, snorm);
+  vertex_pack_half(positions, uvs, colors, count, half);
+
+  Mat4x4F dequantize = vertex_dequantize_4x4f(bounds);
+  f32 step = (bounds.max.x - bounds.min.x) / 65534.0f;
+  bool snorm_ok = TRUE;
+  bool half_ok = TRUE;
+  bool attribs_ok = TRUE;
+  for (u32 i = 0; i < count; i++)
+  {
+    VertexSnorm *v = &snorm[i];
+    Vec4F q = v4f(v->position[0] / 32767.0f, v->position[1] / 32767.0f, 
+                  v->position[2] / 32767.0f, v->position[3] / 32767.0f);
+    Vec4F p = transform_4f(q, dequantize);
+    if (fabsf(p.x - positions[i].x) > step || fabsf(p.y - positions[i].y) > step) snorm_ok = FALSE;
+    if (fabsf(p.z - 1.0f) > 1e-5f || p.w != 1.0f) snorm_ok = FALSE;
+
+    for (u32 k = 0; k < 3; k++)
+    {
+      f32 x = positions[i].elements[k];
+      if (fabsf(f32_from_half(half[i].position[k]) - x) > fabsf(x) / 2048.0f) half_ok = FALSE;
+    }
+    if (half[i].position[3] != 0x3C00) half_ok = FALSE;
+
+    for (u32 k = 0; k < 2; k++)
+    {
+      if (abs(v->uv[k] - unorm16_from_f32(uvs[i].elements[k])) > 1) attribs_ok = FALSE;
+      if (v->uv[k] != half[i].uv[k]) attribs_ok = FALSE;
+    }
+    for (u32 k = 0; k < 4; k++)
+    {
+      if (abs(v->color[k] - unorm8_from_f32(colors[i].elements[k])) > 1) attribs_ok = FALSE;
+      if (v->color[k] != half[i].color[k]) attribs_ok = FALSE;
+    }
+  }
+  EXPECT(snorm_ok);
+  EXPECT(half_ok);
+  EXPECT(attribs_ok);
+
+  // Missing UVs and colors default to zero and opaque white
+  vertex_pack_half(positions, NULL, NULL, 1, half);
+  EXPECT(half[0].uv[0] == 0 && half[0].uv[1] == 0);
+  EXPECT(half[0].color[0] == 255 && half[0].color[3] == 255);
+
+  free(positions);
+  free(uvs);
+  free(colors);
+  free(snorm);
+  free(half);
+}
+
+static
+void test_mesh_obj(void)
+{
+  // Two quads sharing an edge, the second written with relative indices
+  const i8 *obj = 
+    "# test\n"
+    "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0 0\nv 2 1 0\n"
+    "vt 0 0\nvt 1 1\n"
+    "vn 0 0 1\n"
+    "g quads\n"
+    "f 1/1/1 2/1/1 3/2/1 4/2/1\n"
+    "  f -5/-2/-1 -2/-2/-1 -1/-1/-1 -4/-1/-1\r\n";
+
+  Mesh mesh;
+  EXPECT(mesh_parse_obj(obj, &mesh));
+  EXPECT(mesh.vertex_count == 6);
+  EXPECT(mesh.index_count == 12);
+
+  if (mesh.index_count == 12)
+  {
+    // Fans keep the winding: (1, 2, 3) then (1, 3, 4)
+    MeshVertex *a = &mesh.vertices[mesh.indices[0]];
+    MeshVertex *b = &mesh.vertices[mesh.indices[4]];
+    MeshVertex *c = &mesh.vertices[mesh.indices[5]];
+    EXPECT(a->position.x == 0.0f && a->position.y == 0.0f);
+    EXPECT(b->position.x == 1.0f && b->position.y == 1.0f && b->uv.x == 1.0f);
+    EXPECT(c->position.x == 0.0f && c->position.y == 1.0f);
+    EXPECT(c->normal.z == 1.0f);
+    EXPECT(mesh.indices[6] == mesh.indices[1]);
+  }
+  mesh_free(&mesh);
+
+  EXPECT(mesh_parse_obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1//1 2//1 3//1\n", &mesh) == FALSE);
+  EXPECT(mesh_parse_obj("v 0 0 0\nv 1 0 0\nf 1 2 4\n", &mesh) == FALSE);
+  EXPECT(mesh_parse_obj("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", &mesh));
+  EXPECT(mesh.vertex_count == 3 && mesh.index_count == 3);
+  mesh_free(&mesh);
+}
+
+// Grid of (n + 1)^2 vertices with triangles in row order
+static
+Mesh make_grid_mesh(u32 n)
+{
+  Mesh mesh = {0};
+  mesh.vertex_count = (n + 1) * (n + 1);
+  mesh.index_count = n * n * 6;
+  mesh.vertices = calloc(mesh.vertex_count, sizeof (MeshVertex));
+  mesh.indices = malloc(sizeof (u32) * mesh.index_count);
+
+  for (u32 y = 0; y <= n; y++)
+  {
+    for (u32 x = 0; x <= n; x++)
+    {
+      MeshVertex *v = &mesh.vertices[y * (n + 1) + x];
+      v->position = v3f((f32) x, (f32) y, 0.0f);
+      v->normal = v3f(0.0f, 0.0f, 1.0f);
+      v->uv = v2f((f32) x / n, (f32) y / n);
+    }
+  }
+
+  u32 *i = mesh.indices;
+  for (u32 y = 0; y < n; y++)
+  {
+    for (u32 x = 0; x < n; x++)
+    {
+      u32 v = y * (n + 1) + x;
+      *i++ = v; *i++ = v + 1; *i++ = v + n + 1;
+      *i++ = v + 1; *i++ = v + n + 2; *i++ = v + n + 1;
+    }
+  }
+
+  return mesh;
+}
+
+// Triangles as sorted keys of their grid positions, rotated to start at the
+// smallest one so winding still matters
+static
+u32 *grid_triangle_keys(Mesh *mesh, u32 n)
+{
+  u32 count = mesh->index_count / 3;
+  u32 *keys = malloc(sizeof (u32) * count);
+
+  for (u32 t = 0; t < count; t++)
+  {
+    u32 id[3];
+    for (u32 k = 0; k < 3; k++)
+    {
+      Vec3F p = mesh->vertices[mesh->indices[t * 3 + k]].position;
+      id[k] = (u32) p.y * (n + 1) + (u32) p.x;
+    }
+
+    u32 r = id[0] < id[1] ? (id[0] < id[2] ? 0 : 2) : (id[1] < id[2] ? 1 : 2);
+    keys[t] = id[r] << 20 | id[(r + 1) % 3] << 10 | id[(r + 2) % 3];
+  }
+
+  qsort(keys, count, sizeof (u32), compare_u32);
+
+  return keys;
+}
+
+static
+void test_mesh_optimize(void)
+{
+  const u32 n = 31;
+  Mesh mesh = make_grid_mesh(n);
+  u32 vertex_count = mesh.vertex_count;
+  u32 tri_count = mesh.index_count / 3;
+  u32 *expected = grid_triangle_keys(&mesh, n);
+
+  // Shuffle the triangles and point half of them at a copy of the vertices
+  mesh.vertices = realloc(mesh.vertices, sizeof (MeshVertex) * vertex_count * 2);
+  memcpy(mesh.vertices + vertex_count, mesh.vertices, sizeof (MeshVertex) * vertex_count);
+  mesh.vertex_count *= 2;
+
+  for (u32 t = tri_count - 1; t > 0; t--)
+  {
+    u32 j = rng_next() % (t + 1);
+    for (u32 k = 0; k < 3; k++)
+    {
+      u32 tmp = mesh.indices[t * 3 + k];
+      mesh.indices[t * 3 + k] = mesh.indices[j * 3 + k];
+      mesh.indices[j * 3 + k] = tmp;
+    }
+  }
+  for (u32 i = 0; i < mesh.index_count / 2; i++) mesh.indices[i] += vertex_count;
+
+  f32 acmr_before = mesh_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 16);
+  EXPECT(acmr_before > 2.0f);
+
+  EXPECT(mesh_dedup(&mesh) == vertex_count);
+  mesh_optimize(&mesh);
+  EXPECT(mesh.vertex_count == vertex_count);
+  EXPECT(mesh.index_count == tri_count * 3);
+
+  f32 acmr_after = mesh_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 16);
+  EXPECT(acmr_after < 0.8f);
+
+  // Same triangles with the same winding
+  u32 *keys = grid_triangle_keys(&mesh, n);
+  EXPECT(memcmp(keys, expected, sizeof (u32) * tri_count) == 0);
+
+  // Vertices appear in order of first use
+  u32 next = 0;
+  bool fetch_ok = TRUE;
+  for (u32 i = 0; i < mesh.index_count; i++)
+  {
+    if (mesh.indices[i] > next) fetch_ok = FALSE;
+    if (mesh.indices[i] == next) next++;
+  }
+  EXPECT(fetch_ok && next == vertex_count);
+
+  EXPECT(mesh_index_size(0x10000) == 2);
+  EXPECT(mesh_index_size(0x10001) == 4);
+
+  free(expected);
+  free(keys);
+  mesh_free(&mesh);
+}
+
+static
+void test_mesh_lod(void)
+{
+  const u32 n = 31;
+  Mesh mesh = make_grid_mesh(n);
+  u32 tri_count = mesh.index_count / 3;
+
+  // A flat grid simplifies without error down to its locked border
+  u32 *out = malloc(sizeof (u32) * mesh.index_count);
+  f32 error;
+  u32 count = mesh_simplify(&mesh, mesh.indices, mesh.index_count, tri_count / 10 * 3, 0.01f, 
+                            out, &error);
+  EXPECT(count <= tri_count / 10 * 3 && count >= (4 * n - 2) * 3);
+  EXPECT(error < 1e-3f);
+
+  bool upright = TRUE;
+  u8 *used = calloc(mesh.vertex_count, sizeof (u8));
+  for (u32 t = 0; t < count / 3; t++)
+  {
+    Vec3F a = mesh.vertices[out[t * 3 + 0]].position;
+    Vec3F b = mesh.vertices[out[t * 3 + 1]].position;
+    Vec3F c = mesh.vertices[out[t * 3 + 2]].position;
+    if (cross_3f(sub_3f(b, a), sub_3f(c, a)).z <= 0.0f) upright = FALSE;
+    for (u32 k = 0; k < 3; k++) used[out[t * 3 + k]] = TRUE;
+  }
+  EXPECT(upright);
+
+  bool border_kept = TRUE;
+  for (u32 i = 0; i <= n; i++)
+  {
+    border_kept &= used[i] && used[n * (n + 1) + i];
+    border_kept &= used[i * (n + 1)] && used[i * (n + 1) + n];
+  }
+  EXPECT(border_kept);
+  free(used);
+  free(out);
+
+  // Bumps make every level cost something
+  for (u32 i = 0; i < mesh.vertex_count; i++)
+  {
+    Vec3F *p = &mesh.vertices[i].position;
+    p->z = 2.0f * sinf(p->x * 0.4f) * cosf(p->y * 0.3f);
+  }
+
+  u32 lod_count = mesh_build_lods(&mesh, 4, 0.5f, 0.05f);
+  EXPECT(lod_count == 4);
+  EXPECT(mesh.lods[0].index_offset == 0 && mesh.lods[0].index_count == tri_count * 3);
+
+  bool levels_ok = TRUE;
+  for (u32 i = 1; i < lod_count; i++)
+  {
+    MeshLod *lod = &mesh.lods[i];
+    MeshLod *prev = &mesh.lods[i - 1];
+    levels_ok &= lod->index_offset == prev->index_offset + prev->index_count;
+    levels_ok &= lod->index_count < prev->index_count && lod->index_count % 3 == 0;
+    levels_ok &= lod->error > prev->error && lod->error < 0.05f * n * i;
+  }
+  EXPECT(levels_ok);
+  EXPECT(mesh.lods[lod_count - 1].index_offset + mesh.lods[lod_count - 1].index_count == 
+         mesh.index_count);
+
+  bool indices_ok = TRUE;
+  for (u32 i = 0; i < mesh.index_count; i++) indices_ok &= mesh.indices[i] < mesh.vertex_count;
+  EXPECT(indices_ok);
+
+  // Coarser levels as the mesh moves away, finer when it is scaled up
+  SphereF bounds = mesh_bounding_sphere(&mesh);
+  EXPECT(bounds.radius >= n * 0.70710678f);
+
+  Mat4x4F view = look_at_4x4f(v3f(0.0f, 0.0f, 0.0f), v3f(0.0f, 0.0f, -1.0f), v3f(0.0f, 1.0f, 0.0f));
+  f32 lod_scale = mesh_lod_scale(perspective_4x4f(60.0f, 16.0f / 9.0f, 0.1f, 1000.0f), 1080.0f);
+  EXPECT(fabsf(lod_scale - 1080.0f * 0.5f * 1.7320508f) < 0.1f);
+
+  u32 prev_lod = 0;
+  bool monotonic = TRUE;
+  for (f32 d = 1.0f; d < 1e5f; d *= 2.0f)
+  {
+    u32 lod = mesh_select_lod(&mesh, bounds, translate_4x4f(0.0f, 0.0f, -d), view, lod_scale, 1.0f);
+    monotonic &= lod >= prev_lod;
+    prev_lod = lod;
+  }
+  EXPECT(monotonic && prev_lod == lod_count - 1);
+
+  // Error e at distance d covers e * lod_scale / d pixels
+  f32 d = bounds.radius + mesh.lods[1].error * lod_scale / 1.0f * 1.01f;
+  Mat4x4F model = translate_4x4f(0.0f, 0.0f, -d);
+  EXPECT(mesh_select_lod(&mesh, bounds, model, view, lod_scale, 1.0f) >= 1);
+  model = mul_4x4f(scale_4x4f(1.05f, 1.05f, 1.05f), model);
+  EXPECT(mesh_select_lod(&mesh, bounds, model, view, lod_scale, 1.0f) == 0);
+
+  // Inside the bounds only the full mesh is exact enough
+  EXPECT(mesh_select_lod(&mesh, bounds, m4x4f(1.0f), view, lod_scale, 1.0f) == 0);
+
+  u8 lods[3];
+  Mat4x4F models[3] = {translate_4x4f(0, 0, -1), translate_4x4f(0, 0, -1e4f), m4x4f(1.0f)};
+  mesh_select_lods(&mesh, bounds, models, 3, view, lod_scale, 1.0f, lods);
+  EXPECT(lods[0] == 0 && lods[1] == lod_count - 1 && lods[2] == 0);
+
+  mesh_free(&mesh);
+}
+
+static
+void test_mesh_container(void)
+{
+  const i8 *path = "test_mesh.mesh";
+
+  // One mesh per index size, the small one with levels of detail
+  Mesh small = make_grid_mesh(8);
+  for (u32 i = 0; i < small.vertex_count; i++) small.vertices[i].position.z = (f32) (i % 3);
+  EXPECT(mesh_build_lods(&small, 3, 0.5f, 1.0f) >= 2);
+  Mesh large = {0};
+  large.vertex_count = 70000;
+  large.index_count = 3;
+  large.vertices = calloc(large.vertex_count, sizeof (MeshVertex));
+  large.indices = malloc(sizeof (u32) * 3);
+  large.indices[0] = 0;
+  large.indices[1] = 69999;
+  large.indices[2] = 35000;
+  large.vertices[69999].uv = v2f(0.5f, 0.25f);
+
+  Mesh *meshes[2] = {&small, &large};
+  for (u32 m = 0; m < ARR_LEN(meshes); m++)
+  {
+    Mesh *mesh = meshes[m];
+    EXPECT(mesh_save(path, mesh));
+
+    Mesh loaded;
+    EXPECT(mesh_load(path, &loaded));
+    EXPECT(loaded.vertex_count == mesh->vertex_count && loaded.index_count == mesh->index_count);
+
+    if (loaded.vertex_count == mesh->vertex_count && loaded.index_count == mesh->index_count)
+    {
+      EXPECT(memcmp(loaded.vertices, mesh->vertices, 
+                    sizeof (MeshVertex) * mesh->vertex_count) == 0);
+      EXPECT(memcmp(loaded.indices, mesh->indices, sizeof (u32) * mesh->index_count) == 0);
+    }
+
+    u32 lod_count = MAX(mesh->lod_count, 1);
+    EXPECT(loaded.lod_count == lod_count);
+    EXPECT(loaded.lods[lod_count - 1].index_offset + loaded.lods[lod_count - 1].index_count == 
+           mesh->index_count);
+    if (mesh->lod_count) EXPECT(memcmp(loaded.lods, mesh->lods, sizeof (MeshLod) * lod_count) == 0);
+
+    mesh_free(&loaded);
+  }
+
+  // Counts larger than the file fail before anything is allocated from them
+  u32 huge[8] = {MESH_MAGIC, 0xFFFFFFF0u, 0xFFFFFFF0u, 4, 1, 0, 3, 0};
+  FILE *file = fopen(path, "wb");
+  fwrite(huge, sizeof (u32), ARR_LEN(huge), file);
+  fclose(file);
+  Mesh loaded;
+  EXPECT(!mesh_load(path, &loaded) && loaded.vertices == NULL);
+
+  remove(path);
+  mesh_free(&small);
+  mesh_free(&large);
+}
+
+static
+void test_draw_list(void)
+{
+  Mesh small = make_grid_mesh(2);
+  Mesh large = make_grid_mesh(8);
+  for (u32 i = 0; i < large.vertex_count; i++) large.vertices[i].position.z = (f32) (i % 3);
+  EXPECT(mesh_build_lods(&large, 2, 0.5f, 1.0f) == 2);
+
+  DrawPack pack = draw_pack_create(1, 1);
+  u32 a = draw_pack_add(&pack, &small);
+  u32 b = draw_pack_add(&pack, &large);
+  u32 c = draw_pack_add(&pack, &small);
+  EXPECT(a == 0 && b == 1 && c == 2 && pack.mesh_count == 3);
+  EXPECT(pack.vertex_count == small.vertex_count * 2 + large.vertex_count);
+  EXPECT(pack.index_count == small.index_count * 2 + large.index_count);
+  EXPECT(draw_pack_index_size(&pack) == 2);
+
+  // Indices stay relative to their mesh
+  DrawPackMesh *entry = &pack.meshes[c];
+  EXPECT(entry->base_vertex == small.vertex_count + large.vertex_count);
+  EXPECT(entry->first_index == small.index_count + large.index_count);
+  EXPECT(entry->lod_count == 1 && entry->lods[0].index_count == small.index_count);
+  EXPECT(memcmp(pack.indices + entry->first_index, small.indices, 
+                sizeof (u32) * small.index_count) == 0);
+  EXPECT(memcmp(pack.vertices + entry->base_vertex, small.vertices, 
+                sizeof (MeshVertex) * small.vertex_count) == 0);
+  EXPECT(pack.meshes[b].lod_count == 2);
+
+  // Instances take consecutive slots
+  DrawList list = draw_list_create(1);
+  EXPECT(draw_list_add(&list, &pack, a, 0, 3) == 0);
+  EXPECT(draw_list_add(&list, &pack, b, 1, 1) == 3);
+  EXPECT(draw_list_add(&list, &pack, c, 0, 2) == 4);
+  EXPECT(list.count == 3 && list.instance_count == 6);
+
+  DrawCommand *lod = &list.commands[1];
+  EXPECT(lod->first_index == pack.meshes[b].first_index + large.lods[1].index_offset);
+  EXPECT(lod->index_count == large.lods[1].index_count);
+  EXPECT(lod->base_vertex == (i32) small.vertex_count && lod->base_instance == 3);
+
+  // One driver call per command and instance rebind, one in total, or upload plus draw
+  DrawRecorder loop = {0}, multi = {0}, indirect = {0};
+  DrawBackend backend = draw_recorder_backend(&loop);
+  draw_list_submit(&list, DRAW_PATH_LOOP, &backend);
+  backend = draw_recorder_backend(&multi);
+  draw_list_submit(&list, DRAW_PATH_MULTI, &backend);
+  backend = draw_recorder_backend(&indirect);
+  draw_list_submit(&list, DRAW_PATH_INDIRECT, &backend);
+
+  EXPECT(loop.api_calls == 6 && loop.draws == 3);
+  EXPECT(multi.api_calls == 1 && multi.draws == 3);
+  EXPECT(indirect.api_calls == 2 && indirect.draws == 3);
+  EXPECT(indirect.upload_bytes == 20 * 3 && sizeof (DrawCommand) == 20);
+  EXPECT(loop.indices == indirect.indices);
+  EXPECT(loop.indices == small.index_count * 5 + large.lods[1].index_count);
+
+  draw_list_clear(&list);
+  DrawRecorder empty = {0};
+  backend = draw_recorder_backend(&empty);
+  draw_list_submit(&list, DRAW_PATH_INDIRECT, &backend);
+  EXPECT(empty.api_calls == 0 && list.instance_count == 0);
+
+  draw_list_destroy(&list);
+  draw_pack_destroy(&pack);
+  mesh_free(&small);
+  mesh_free(&large);
+}
+
+// Live ranges sorted by offset must not overlap and must add up to `used`
+static
+bool heap_consistent(const Heap *heap, const HeapHandle *handles, const u64 *sizes, u32 count)
+{
+  u64 *ranges = malloc(sizeof (u64) * 2 * count);
+  u64 used = 0;
+  u32 live = 0;
+  bool aligned = TRUE;
+  for (u32 i = 0; i < count; i++)
+  {
+    u64 offset;
+    if (!heap_offset(heap, handles[i], &offset)) continue;
+    aligned &= offset % HEAP_ALIGNMENT == 0;
+
+    u64 size = (sizes[i] + HEAP_ALIGNMENT - 1) / HEAP_ALIGNMENT * HEAP_ALIGNMENT;
+    ranges[live * 2 + 0] = offset;
+    ranges[live * 2 + 1] = offset + size;
+    used += size;
+    live++;
+  }
+
+  // Insertion sort, counts are small
+  for (u32 i = 1; i < live; i++)
+  {
+    for (u32 j = i; j > 0 && ranges[j * 2] < ranges[(j - 1) * 2]; j--)
+    {
+      u64 lo = ranges[j * 2], hi = ranges[j * 2 + 1];
+      ranges[j * 2] = ranges[(j - 1) * 2];
+      ranges[j * 2 + 1] = ranges[(j - 1) * 2 + 1];
+      ranges[(j - 1) * 2] = lo;
+      ranges[(j - 1) * 2 + 1] = hi;
+    }
+  }
+
+  bool ok = aligned && used == heap->used && live == heap->alloc_count;
+  for (u32 i = 0; i < live; i++)
+  {
+    ok &= ranges[i * 2 + 1] <= heap->size;
+    if (i > 0) ok &= ranges[i * 2] >= ranges[(i - 1) * 2 + 1];
+  }
+
+  HeapStats stats = heap_stats(heap);
+  ok &= stats.used + stats.free == heap->size;
+
+  free(ranges);
+
+  return ok;
+}
+
+static
+void test_heap(void)
+{
+  Heap heap = heap_create(64 * 1024 + 100, 32);
+  EXPECT(heap.size == 64 * 1024);
+
+  // Everything lands on HEAP_ALIGNMENT and sizes round up to it
+  HeapHandle a, b, c;
+  u64 offset_a, offset_b, offset_c;
+  EXPECT(heap_alloc(&heap, 1, &a, &offset_a));
+  EXPECT(heap_alloc(&heap, 300, &b, &offset_b));
+  EXPECT(heap_alloc(&heap, 256, &c, &offset_c));
+  EXPECT(offset_a == 0 && offset_b == 256 && offset_c == 768);
+  EXPECT(heap.used == 1024);
+  EXPECT(!heap_alloc(&heap, 0, &a, &offset_a) && !heap_alloc(&heap, 65 * 1024, &a, &offset_a));
+
+  // Freeing merges neighbours back into one block
+  heap_free(&heap, b);
+  heap_free(&heap, b);
+  u64 offset;
+  EXPECT(!heap_offset(&heap, b, &offset));
+  EXPECT(heap_offset(&heap, c, &offset) && offset == 768);
+  heap_free(&heap, a);
+  heap_free(&heap, c);
+  HeapStats stats = heap_stats(&heap);
+  EXPECT(stats.free_blocks == 1 && stats.free == heap.size && stats.fragmentation == 0.0f);
+
+  // The whole heap fits even though its size is not a bin boundary
+  Heap odd = heap_create(1000 * HEAP_ALIGNMENT, 4);
+  EXPECT(heap_alloc(&odd, odd.size, &a, &offset) && offset == 0);
+  EXPECT(!heap_alloc(&odd, 1, &b, &offset));
+  heap_destroy(&odd);
+
+  // Holes left by every other 4 KB block can't take 8 KB until defragmented
+  HeapHandle handles[32];
+  u64 sizes[32];
+  for (u32 i = 0; i < 16; i++)
+  {
+    sizes[i] = 4096;
+    EXPECT(heap_alloc(&heap, sizes[i], &handles[i], &offset) && offset == i * 4096);
+  }
+  EXPECT(!heap_alloc(&heap, 1, &a, &offset));
+  for (u32 i = 0; i < 16; i += 2) heap_free(&heap, handles[i]);
+
+  stats = heap_stats(&heap);
+  EXPECT(stats.free == 32 * 1024 && stats.largest_free == 4096 && stats.free_blocks == 8);
+  EXPECT(fabsf(stats.fragmentation - 0.875f) < 1e-6f);
+  EXPECT(!heap_alloc(&heap, 8192, &a, &offset));
+
+  // A small budget moves one block at a time, from the top into the lowest hole
+  HeapMove moves[16];
+  EXPECT(heap_defrag(&heap, 1, moves, ARR_LEN(moves)) == 1);
+  EXPECT(moves[0].from == 15 * 4096 && moves[0].to == 0 && moves[0].size == 4096);
+  EXPECT(heap_offset(&heap, handles[15], &offset) && offset == 0);
+  EXPECT(moves[0].handle.index == handles[15].index);
+
+  u32 count = heap_defrag(&heap, 1 << 20, moves, ARR_LEN(moves));
+  bool downward = TRUE;
+  for (u32 i = 0; i < count; i++) downward &= moves[i].to + moves[i].size <= moves[i].from;
+  EXPECT(count == 3 && downward);
+
+  stats = heap_stats(&heap);
+  EXPECT(stats.free_blocks == 1 && stats.largest_free == 32 * 1024);
+  EXPECT(heap_defrag(&heap, 1 << 20, moves, ARR_LEN(moves)) == 0);
+  EXPECT(heap_consistent(&heap, handles, sizes, 16));
+  EXPECT(heap_alloc(&heap, 8192, &a, &offset) && offset == 32 * 1024);
+  heap_destroy(&heap);
+
+  // Churn of mixed sizes, checked after every step
+  heap = heap_create(1 << 20, ARR_LEN(handles));
+  memset(handles, 0xFF, sizeof (handles));
+  bool consistent = TRUE;
+  for (u32 step = 0; step < 2000; step++)
+  {
+    u32 i = rng_next() % ARR_LEN(handles);
+    if (heap_offset(&heap, handles[i], &offset)) heap_free(&heap, handles[i]);
+    else
+    {
+      sizes[i] = 1 + rng_next() % (64 * 1024);
+      if (!heap_alloc(&heap, sizes[i], &handles[i], &offset)) handles[i].index = HEAP_NONE;
+    }
+
+    if (step % 100 == 99) heap_defrag(&heap, 16 * 1024, moves, ARR_LEN(moves));
+    if (step % 10 == 0) consistent &= heap_consistent(&heap, handles, sizes, ARR_LEN(handles));
+  }
+  EXPECT(consistent);
+
+  heap_defrag(&heap, 1 << 30, moves, ARR_LEN(moves));
+  heap_defrag(&heap, 1 << 30, moves, ARR_LEN(moves));
+  EXPECT(heap_consistent(&heap, handles, sizes, ARR_LEN(handles)));
+
+  for (u32 i = 0; i < ARR_LEN(handles); i++) heap_free(&heap, handles[i]);
+  stats = heap_stats(&heap);
+  EXPECT(stats.alloc_count == 0 && stats.free_blocks == 1);
+  heap_destroy(&heap);
+}
+
+// Checks the batches in dbg_frame, which only DEBUG builds have
+#ifdef DEBUG
+static
+void test_dbg(void)
+{
+  dbg_clear();
+  DbgBatch *depth = &dbg_frame.lines[DBG_DEPTH];
+  DbgBatch *overlay = &dbg_frame.lines[DBG_OVERLAY];
+  DbgBatch *text = &dbg_frame.text;
+
+  u8 red[4] = {255, 0, 0, 255};
+  u32 packed = dbg_color(v4f(1.0f, 0.0f, 0.0f, 1.0f));
+  EXPECT(memcmp(&packed, red, 4) == 0);
+
+  dbg_line(v3f(1.0f, 2.0f, 3.0f), v3f(4.0f, 5.0f, 6.0f), v4f(1.0f, 0.0f, 0.0f, 1.0f), DBG_DEPTH);
+  EXPECT(depth->count == 2 && overlay->count == 0);
+  EXPECT(depth->vertices[1].position.z == 6.0f && depth->vertices[1].color == packed);
+
+  // Odd point counts drop the last point
+  Vec3F points[5] = {0};
+  dbg_lines(points, ARR_LEN(points), v4f(1.0f, 1.0f, 1.0f, 1.0f), DBG_DEPTH);
+  EXPECT(depth->count == 6);
+
+  // Closed outlines, one segment per edge
+  dbg_rect((AABB2F) {{0.0f, 0.0f}, {2.0f, 1.0f}}, 5.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), DBG_OVERLAY);
+  EXPECT(overlay->count == 8);
+  EXPECT(overlay->vertices[7].position.x == 0.0f && overlay->vertices[7].position.y == 0.0f);
+  EXPECT(overlay->vertices[3].position.z == 5.0f);
+
+  dbg_box((AABB3F) {{0.0f, 0.0f, 0.0f}, {1.0f, 2.0f, 3.0f}}, v4f(1.0f, 1.0f, 1.0f, 1.0f), DBG_OVERLAY);
+  EXPECT(overlay->count == 32);
+  bool axis_aligned = TRUE;
+  for (u32 i = 8; i < 32; i += 2)
+  {
+    Vec3F a = overlay->vertices[i].position;
+    Vec3F b = overlay->vertices[i + 1].position;
+    axis_aligned &= (a.x != b.x) + (a.y != b.y) + (a.z != b.z) == 1;
+  }
+  EXPECT(axis_aligned);
+
+  dbg_circle(v3f(1.0f, 1.0f, 2.0f), 3.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), DBG_DEPTH);
+  EXPECT(depth->count == 6 + DBG_CIRCLE_SEGMENTS * 2);
+  bool on_circle = TRUE;
+  for (u32 i = 6; i < depth->count; i++)
+  {
+    Vec3F p = depth->vertices[i].position;
+    on_circle &= fabsf(sqrtf((p.x - 1.0f) * (p.x - 1.0f) + (p.y - 1.0f) * (p.y - 1.0f)) - 3.0f) < 1e-4f;
+    on_circle &= p.z == 2.0f;
+  }
+  EXPECT(on_circle);
+
+  // One quad per horizontal run: I has a run per row, A has 1, 2, 1, 2, 2
+  dbg_text(v2f(10.0f, 20.0f), 2.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), "I");
+  EXPECT(text->count == 5 * 6);
+  AABB2F bounds = {{1e9f, 1e9f}, {-1e9f, -1e9f}};
+  for (u32 i = 0; i < text->count; i++)
+  {
+    Vec3F p = text->vertices[i].position;
+    bounds.min = v2f(fminf(bounds.min.x, p.x), fminf(bounds.min.y, p.y));
+    bounds.max = v2f(fmaxf(bounds.max.x, p.x), fmaxf(bounds.max.y, p.y));
+  }
+  EXPECT(bounds.min.x == 10.0f && bounds.max.x == 16.0f);
+  EXPECT(bounds.min.y == 20.0f && bounds.max.y == 30.0f);
+
+  dbg_text(v2f(0.0f, 0.0f), 1.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), "a");
+  EXPECT(text->count == (5 + 8) * 6);
+  dbg_text(v2f(0.0f, 0.0f), 1.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), "");
+  EXPECT(text->count == (5 + 8) * 6);
+
+  // A new line goes back to x and down a glyph and a gap
+  dbg_text(v2f(0.0f, 0.0f), 1.0f, v4f(1.0f, 1.0f, 1.0f, 1.0f), " \n.");
+  EXPECT(text->count == 14 * 6);
+  Vec3F dot = text->vertices[text->count - 1].position;
+  EXPECT(dot.x == 2.0f && dot.y == 11.0f);
+
+  u32 cap = depth->cap;
+  dbg_clear();
+  EXPECT(depth->count == 0 && overlay->count == 0 && text->count == 0 && depth->cap == cap);
+
+  dbg_shutdown();
+  EXPECT(depth->vertices == NULL && depth->cap == 0);
+}
+#endif
+
+// A font of solid boxes on a 10 unit em: every glyph is 4 by 7 units on the
+// baseline with an advance of 6, space is blank, and "AV" kerns by -1.
+static
+f32 box_font_scale(void *user, f32 pixel_height)
+{
+  (void) user;
+  return pixel_height / 10.0f;
+}
+
+static
+void box_font_v_metrics(void *user, f32 scale, f32 *ascent, f32 *descent, f32 *line_gap)
+{
+  (void) user;
+  *ascent = 8.0f * scale;
+  *descent = -2.0f * scale;
+  *line_gap = 0.0f;
+}
+
+static
+u32 box_font_glyph_index(void *user, u32 codepoint)
+{
+  (void) user;
+  return codepoint;
+}
+
+static
+void box_font_glyph_metrics(void *user, u32 glyph, f32 scale, f32 *advance, i32 box[4])
+{
+  (void) user;
+  *advance = 6.0f * scale;
+  box[0] = box[1] = box[2] = box[3] = 0;
+  if (glyph == ' ') return;
+
+  box[0] = (i32) floorf(1.0f * scale);
+  box[1] = (i32) floorf(-7.0f * scale);
+  box[2] = (i32) ceilf(5.0f * scale);
+  box[3] = 0;
+}
+
+static
+f32 box_font_kerning(void *user, u32 a, u32 b, f32 scale)
+{
+  (void) user;
+  return a == 'A' && b == 'V' ? -1.0f * scale : 0.0f;
+}
+
+static
+void box_font_rasterize(void *user, u32 glyph, f32 scale, u8 *out, i32 w, i32 h, i32 stride)
+{
+  (void) user;
+  (void) glyph;
+  (void) scale;
+  for (i32 y = 0; y < h; y++) memset(&out[y * stride], 255, w);
+}
+
+static
+FontSource box_font(void)
+{
+  return (FontSource)
+  {
+    .scale_for_size = box_font_scale,
+    .v_metrics = box_font_v_metrics,
+    .glyph_index = box_font_glyph_index,
+    .glyph_metrics = box_font_glyph_metrics,
+    .kerning = box_font_kerning,
+    .rasterize = box_font_rasterize,
+  };
+}
+
+static
+void test_font(void)
+{
+  Font font = font_create(box_font(), 20.0f, FONT_BITMAP);
+  EXPECT(font.scale == 2.0f && font.ascent == 16.0f && font.line_height == 20.0f);
+
+  // Boxes are 2..10 by -14..0 at scale 2, padded by a pixel
+  FontQuad quads[16];
+  u32 count = font_layout(&font, "AV", v2f(0.0f, 0.0f), 20.0f, quads);
+  EXPECT(count == 2);
+  EXPECT(quads[0].x0 == 1.0f && quads[0].x1 == 11.0f);
+  EXPECT(quads[0].y0 == 1.0f && quads[0].y1 == 17.0f);
+  EXPECT(quads[1].x0 == 11.0f);
+
+  // Space advances without a quad, new lines go back and down
+  count = font_layout(&font, "A B\nC", v2f(5.0f, 0.0f), 20.0f, quads);
+  EXPECT(count == 3);
+  EXPECT(quads[1].x0 == 5.0f + 24.0f + 1.0f);
+  EXPECT(quads[2].x0 == 6.0f && quads[2].y0 == 21.0f);
+
+  // Scaled layouts scale glyphs, advances and kerning alike
+  count = font_layout(&font, "AV", v2f(0.0f, 0.0f), 40.0f, quads);
+  EXPECT(quads[0].x1 == 22.0f && quads[1].x0 == 22.0f && quads[1].y1 == 34.0f);
+
+  Vec2F extent = font_measure(&font, "AV\nA", 20.0f);
+  EXPECT(extent.x == 22.0f && extent.y == 40.0f);
+
+  // ASCII is cached directly, the rest goes through the table as it grows
+  u32 glyph_count = font.glyph_count;
+  EXPECT(font_glyph(&font, 'A') == quads[0].glyph && font.glyph_count == glyph_count);
+  count = font_layout(&font, "\xC3\xA9\xFF", v2f(0.0f, 0.0f), 20.0f, quads);
+  EXPECT(count == 2);
+  EXPECT(font.glyphs[quads[0].glyph].codepoint == 0xE9);
+  EXPECT(font.glyphs[quads[1].glyph].codepoint == 0xFFFD);
+
+  bool found = TRUE;
+  for (u32 c = 0x100; c < 0x500; c++) font_glyph(&font, c);
+  for (u32 c = 0x100; c < 0x500; c++) found &= font.glyphs[font_glyph(&font, c)].codepoint == c;
+  EXPECT(found);
+  EXPECT(font.glyphs[font_glyph(&font, 0xE9)].codepoint == 0xE9);
+  EXPECT(font.glyph_count == glyph_count + 2 + 0x400);
+
+  // Bitmaps keep a blank border
+  u32 a = font_glyph(&font, 'A');
+  u8 bitmap[10 * 16];
+  font_rasterize(&font, a, bitmap);
+  u32 border = 0;
+  u32 inside = 0;
+  for (i32 y = 0; y < 16; y++)
+  {
+    for (i32 x = 0; x < 10; x++)
+    {
+      bool edge = x == 0 || y == 0 || x == 9 || y == 15;
+      if (edge) border += bitmap[y * 10 + x];
+      else inside += bitmap[y * 10 + x] == 255;
+    }
+  }
+  EXPECT(border == 0 && inside == 8 * 14);
+
+  // Four vertices per quad with the cached UVs
+  font.glyphs[a].uv = v4f(0.0f, 0.5f, 0.25f, 1.0f);
+  count = font_layout(&font, "A", v2f(0.0f, 0.0f), 20.0f, quads);
+  FontVertex vertices[4];
+  font_emit(&font, quads, count, v4f(1.0f, 0.0f, 0.0f, 1.0f), vertices);
+  EXPECT(vertices[0].position.x == 1.0f && vertices[0].position.y == 1.0f);
+  EXPECT(vertices[3].position.x == 11.0f && vertices[3].position.y == 17.0f);
+  EXPECT(vertices[1].uv[0] == 16384 && vertices[1].uv[1] == 32768);
+  EXPECT(vertices[2].uv[0] == 0 && vertices[2].uv[1] == 65535);
+  EXPECT(vertices[2].color[0] == 255 && vertices[2].color[1] == 0 && vertices[2].color[3] == 255);
+
+  font_destroy(&font);
+  EXPECT(font.glyphs == NULL);
+
+  // A 32 texel square in 64, down to 16: the edge sits between texels 3 and
+  // 4, which straddle 128 by half a texel, and it rises a texel per 32
+  u8 coverage[64 * 64] = {0};
+  for (i32 y = 16; y < 48; y++) memset(&coverage[y * 64 + 16], 255, 32);
+  u8 sdf[16 * 16];
+  font_sdf(coverage, 64, 64, 4, 4.0f, sdf);
+  EXPECT(abs(sdf[8 * 16 + 5] - sdf[8 * 16 + 4] - 32) <= 1 && sdf[0] == 0);
+  EXPECT(sdf[8 * 16 + 3] < 128 && sdf[8 * 16 + 4] > 128);
+  EXPECT(abs(sdf[8 * 16 + 3] + sdf[8 * 16 + 4] - 256) <= 1);
+  EXPECT(sdf[8 * 16 + 2] < sdf[8 * 16 + 3] && sdf[8 * 16 + 4] < sdf[8 * 16 + 5]);
+  EXPECT(sdf[3 * 16 + 8] == sdf[8 * 16 + 3] && sdf[8 * 16 + 12] == sdf[8 * 16 + 3]);
+
+  // Distance field glyphs are padded by the spread on every side
+  font = font_create(box_font(), 20.0f, FONT_SDF);
+  a = font_glyph(&font, 'A');
+  FontGlyph *g = &font.glyphs[a];
+  EXPECT(g->x0 == 2 - FONT_SDF_PADDING && g->x1 == 10 + FONT_SDF_PADDING);
+  EXPECT(g->y0 == -14 - FONT_SDF_PADDING && g->y1 == FONT_SDF_PADDING);
+
+  i32 w = g->x1 - g->x0;
+  i32 h = g->y1 - g->y0;
+  u8 *field = malloc((u64) w * h);
+  font_rasterize(&font, a, field);
+  i32 mid = h / 2 * w;
+  EXPECT(field[0] == 0 && field[mid + w / 2] > 200);
+  EXPECT(field[mid + FONT_SDF_PADDING - 1] < 128 && field[mid + FONT_SDF_PADDING] > 128);
+  free(field);
+  font_destroy(&font);
+}
+
+// Coverage of one glyph, and how much of it lands in the given rows
+static
+u32 ttf_glyph_ink(Font *font, u32 codepoint, i32 y0, i32 y1, u8 *center)
+{
+  u32 glyph = font_glyph(font, codepoint);
+  const FontGlyph *g = &font->glyphs[glyph];
+  i32 w = g->x1 - g->x0;
+  i32 h = g->y1 - g->y0;
+  u8 *bitmap = malloc((u64) w * h);
+  font_rasterize(font, glyph, bitmap);
+
+  u32 ink = 0;
+  for (i32 y = MAX(y0 - g->y0, 0); y < MIN(y1 - g->y0, h); y++)
+  {
+    for (i32 x = 0; x < w; x++) ink += bitmap[y * w + x];
+  }
+  if (center) *center = bitmap[h / 2 * w + w / 2];
+
+  free(bitmap);
+  return ink;
+}
+
+// The vendored Lato Regular: 2000 units to the em, ascender 1974, descender
+// -426, a format 4 cmap and a kern table
+static
+void test_font_ttf(void)
+{
+  FontSource source;
+  EXPECT(!font_load_ttf("res/fonts/missing.ttf", &source) && source.user == NULL);
+  EXPECT(!font_source_ttf((const u8 *) "OTTO\0\0\0\0", 8, &source));
+  EXPECT(font_load_ttf("res/fonts/Lato-Regular.ttf", &source));
+  if (source.user == NULL) return;
+
+  Font font = font_create(source, 32.0f, FONT_BITMAP);
+  EXPECT(fabsf(font.scale - 32.0f / 2400.0f) < 1e-6f);
+  EXPECT(fabsf(font.ascent - 26.32f) < 1e-3f && fabsf(font.line_height - 32.0f) < 1e-3f);
+  EXPECT(source.glyph_index(source.user, 'A') != 0 && source.glyph_index(source.user, 0xE000) == 0);
+
+  // Capitals sit on the baseline, padded by a pixel, g descends below it
+  FontGlyph *a = &font.glyphs[font_glyph(&font, 'A')];
+  EXPECT(a->y1 == 1 && a->y0 < -20 && a->advance > 17.0f && a->advance < 19.0f);
+  EXPECT(font.glyphs[font_glyph(&font, 'g')].y1 > 4);
+  EXPECT(font.glyphs[font_glyph(&font, ' ')].x1 == font.glyphs[font_glyph(&font, ' ')].x0);
+
+  // AV kerns tighter than AX, from the table and through the layout
+  FontQuad quads[2];
+  font_layout(&font, "AV", v2f(0.0f, 0.0f), 32.0f, quads);
+  f32 av = quads[1].x0 - quads[0].x0;
+  font_layout(&font, "AX", v2f(0.0f, 0.0f), 32.0f, quads);
+  f32 ax = quads[1].x0 - quads[0].x0;
+  EXPECT(av < ax - 1.0f);
+
+  // O is a ring with a hole, and é is a composite: e with an accent above
+  u8 center;
+  EXPECT(ttf_glyph_ink(&font, 'O', -32, 32, &center) > 255 * 40 && center == 0);
+  i32 e_top = font.glyphs[font_glyph(&font, 'e')].y0;
+  EXPECT(ttf_glyph_ink(&font, 'e', -32, e_top + 1, NULL) == 0);
+  EXPECT(ttf_glyph_ink(&font, 0xE9, -32, e_top, NULL) > 255 * 4);
+  EXPECT(ttf_glyph_ink(&font, 0xE9, e_top, 32, NULL) == ttf_glyph_ink(&font, 'e', e_top, 32, NULL));
+  font_destroy(&font);
+
+  // Distance fields of the same outlines are inside on the stroke
+  font = font_create(source, 32.0f, FONT_SDF);
+  EXPECT(ttf_glyph_ink(&font, 'O', -64, 64, &center) > 0 && center < 128);
+  font_destroy(&font);
+
+  // Every printable glyph from 4 to 64 px, where stepping x down the rows used
+  // to round past column 0 on some (8 at 25 px) and add into the cell before
+  // the row. The one pixel padding stays clear
+  bool clear = TRUE;
+  for (f32 size = 4.0f; size <= 64.0f; size += 1.0f)
+  {
+    font = font_create(source, size, FONT_BITMAP);
+    for (u32 c = 33; c < 127; c++)
+    {
+      const FontGlyph *g = &font.glyphs[font_glyph(&font, c)];
+      i32 w = g->x1 - g->x0;
+      i32 h = g->y1 - g->y0;
+      u8 *bitmap = malloc((u64) w * h);
+      font_rasterize(&font, font_glyph(&font, c), bitmap);
+      for (i32 x = 0; x < w; x++) clear &= bitmap[x] == 0 && bitmap[(h - 1) * w + x] == 0;
+      for (i32 y = 0; y < h; y++) clear &= bitmap[y * w] == 0 && bitmap[y * w + w - 1] == 0;
+      free(bitmap);
+    }
+    font_destroy(&font);
+  }
+  EXPECT(clear);
+
+  font_source_ttf_free(&source);
+  EXPECT(source.user == NULL);
+
+  // A copy with O's box inverted by 60 units, xMin 136 and xMax 76. Rounded
+  // out at 32 px it still looks a pixel wide, at the SDF scale it's -2: the
+  // glyph is blank in both modes instead of rasterizing at a negative width
+  FILE *file = fopen("res/fonts/Lato-Regular.ttf", "rb");
+  fseek(file, 0, SEEK_END);
+  u64 size = (u64) ftell(file);
+  fseek(file, 0, SEEK_SET);
+  u8 *data = malloc(size);
+  EXPECT(fread(data, 1, size, file) == size);
+  fclose(file);
+
+  u32 head = 0, loca = 0, glyf = 0;
+  for (u32 i = 0; i < (u32) (data[4] << 8 | data[5]); i++)
+  {
+    const u8 *record = &data[12 + 16 * i];
+    u32 offset = (u32) record[8] << 24 | record[9] << 16 | record[10] << 8 | record[11];
+    if (memcmp(record, "head", 4) == 0) head = offset;
+    if (memcmp(record, "loca", 4) == 0) loca = offset;
+    if (memcmp(record, "glyf", 4) == 0) glyf = offset;
+  }
+
+  EXPECT(font_source_ttf(data, size, &source));
+  u32 o = source.glyph_index(source.user, 'O');
+  const u8 *entry = &data[loca + (data[head + 51] ? 4 * o : 2 * o)];
+  u32 start = data[head + 51] ? (u32) entry[0] << 24 | entry[1] << 16 | entry[2] << 8 | entry[3]
+                              : (u32) (entry[0] << 8 | entry[1]) * 2;
+  u8 *header = &data[glyf + start];
+  header[2] = 0;
+  header[3] = 136;
+  header[6] = 0;
+  header[7] = 76;
+
+  for (u32 mode = FONT_BITMAP; mode <= FONT_SDF; mode++)
+  {
+    font = font_create(source, 32.0f, mode);
+    const FontGlyph *g = &font.glyphs[font_glyph(&font, 'O')];
+    EXPECT(g->x1 == g->x0 && g->y1 == g->y0 && g->advance > 0.0f);
+    EXPECT(ttf_glyph_ink(&font, 'O', -64, 64, NULL) == 0);
+    EXPECT(ttf_glyph_ink(&font, 'Q', -64, 64, NULL) > 0);
+    font_destroy(&font);
+  }
+
+  font_source_ttf_free(&source);
+  free(data);
+}
+
+static
+void test_target_pool(void)
+{
+  TargetDesc hdr = {1280, 720, {TARGET_FORMAT_RGBA16F}, TARGET_FORMAT_DEPTH24, 1};
+  TargetDesc msaa = 
+  {
+    1280, 720, {TARGET_FORMAT_RGBA8, TARGET_FORMAT_RGBA8}, TARGET_FORMAT_DEPTH24, 4
+  };
+  TargetDesc half = {640, 360, {TARGET_FORMAT_RGBA16F}, TARGET_FORMAT_NONE, 0};
+
+  // Multisampled colors carry a resolve texture each, depth doesn't
+  u64 pixels = 1280 * 720;
+  EXPECT(target_desc_bytes(&hdr) == pixels * (8 + 4));
+  EXPECT(target_desc_bytes(&msaa) == pixels * (2 * 4 * 5 + 4 * 4));
+  EXPECT(target_desc_color_count(&msaa) == 2 && target_desc_color_count(&half) == 1);
+
+  // No multisampling is the same whether it's spelled 0 or 1
+  TargetDesc half_1 = half;
+  half_1.samples = 1;
+  EXPECT(target_desc_equal(&half, &half_1) && !target_desc_equal(&half, &hdr));
+
+  TargetRecorder recorder = target_recorder_create(4);
+  TargetBackend backend = target_recorder_backend(&recorder);
+  TargetPool pool = target_pool_create(4, 2);
+
+  // Targets in use are never shared, released ones are handed out again
+  u32 a = target_pool_acquire(&pool, &hdr, &backend);
+  u32 b = target_pool_acquire(&pool, &hdr, &backend);
+  EXPECT(a != b && recorder.creates == 2);
+  target_pool_release(&pool, a);
+  u32 c = target_pool_acquire(&pool, &half_1, &backend);
+  EXPECT(c != a && recorder.creates == 3);
+  target_pool_release(&pool, b);
+  target_pool_release(&pool, c);
+  EXPECT(pool.live_bytes == recorder.live_bytes);
+
+  // Later frames reuse by description
+  target_pool_next_frame(&pool, &backend);
+  EXPECT(target_pool_acquire(&pool, &half, &backend) == c);
+  EXPECT(target_pool_acquire(&pool, &hdr, &backend) != TARGET_NONE);
+  EXPECT(recorder.creates == 3 && pool.reused == 2);
+
+  // A full pool replaces an idle target, but not one used this frame
+  u32 d = target_pool_acquire(&pool, &msaa, &backend);
+  EXPECT(d != TARGET_NONE);
+  EXPECT(target_pool_acquire(&pool, &msaa, &backend) != TARGET_NONE);
+  EXPECT(recorder.creates == 5 && recorder.destroys == 1 && pool.live_count == 4);
+  EXPECT(target_pool_acquire(&pool, &msaa, &backend) == TARGET_NONE);
+
+  // Idle targets go after max_idle_frames without use, targets in use stay
+  target_pool_release(&pool, c);
+  target_pool_release(&pool, d);
+  target_pool_next_frame(&pool, &backend);
+  target_pool_next_frame(&pool, &backend);
+  EXPECT(pool.live_count == 4);
+  target_pool_next_frame(&pool, &backend);
+  EXPECT(pool.live_count == 2 && recorder.destroys == 3);
+  EXPECT(pool.live_bytes == recorder.live_bytes);
+
+  target_pool_destroy(&pool, &backend);
+  EXPECT(recorder.live_bytes == 0 && recorder.creates == recorder.destroys);
+  EXPECT(recorder.peak_bytes >= 2 * target_desc_bytes(&msaa));
+  target_recorder_destroy(&recorder);
+}
+
+typedef struct GraphLog GraphLog;
+struct GraphLog
+{
+  u32 passes[GRAPH_MAX_PASSES];
+  u32 slots[GRAPH_MAX_PASSES];
+  u32 count;
+  u32 resource;
+};
+
+static
+void graph_log_pass(void *user, FrameGraph *graph, u32 pass)
+{
+  GraphLog *log = user;
+  log->slots[log->count] = graph_target(graph, log->resource);
+  log->passes[log->count++] = pass;
+}
+
+static
+void test_graph(void)
+{
+  TargetDesc hdr = {64, 64, {TARGET_FORMAT_RGBA16F}, TARGET_FORMAT_DEPTH24, 1};
+  TargetDesc half = {32, 32, {TARGET_FORMAT_RGBA16F}, TARGET_FORMAT_NONE, 1};
+  TargetDesc velocity = {64, 64, {TARGET_FORMAT_R16F}, TARGET_FORMAT_NONE, 1};
+  TargetDesc screen = {64, 64, {TARGET_FORMAT_RGBA8}, TARGET_FORMAT_NONE, 1};
+
+  // Declared out of order; the debug view feeds nothing and goes
+  static FrameGraph graph;
+  GraphLog log = {0};
+  graph_reset(&graph);
+  u32 backbuffer = graph_import_target(&graph, "backbuffer", &screen);
+  u32 color = graph_create_target(&graph, "hdr", &hdr);
+  u32 motion = graph_create_target(&graph, "velocity", &velocity);
+  u32 bright = graph_create_target(&graph, "bright", &half);
+  u32 blur = graph_create_target(&graph, "blur", &half);
+  u32 bloom = graph_create_target(&graph, "bloom", &half);
+  u32 debug = graph_create_target(&graph, "debug", &screen);
+
+  u32 tonemap = graph_add_pass(&graph, "tonemap", graph_log_pass, &log);
+  graph_read(&graph, tonemap, color);
+  graph_read(&graph, tonemap, bloom);
+  graph_write(&graph, tonemap, backbuffer);
+  u32 scene = graph_add_pass(&graph, "scene", graph_log_pass, &log);
+  graph_write(&graph, scene, color);
+  graph_write(&graph, scene, motion);
+  u32 blur_v = graph_add_pass(&graph, "blur_v", graph_log_pass, &log);
+  graph_read(&graph, blur_v, blur);
+  graph_write(&graph, blur_v, bloom);
+  u32 blur_h = graph_add_pass(&graph, "blur_h", graph_log_pass, &log);
+  graph_read(&graph, blur_h, bright);
+  graph_write(&graph, blur_h, blur);
+  u32 threshold = graph_add_pass(&graph, "threshold", graph_log_pass, &log);
+  graph_read(&graph, threshold, color);
+  graph_write(&graph, threshold, bright);
+  u32 debug_view = graph_add_pass(&graph, "debug", graph_log_pass, &log);
+  graph_read(&graph, debug_view, motion);
+  graph_write(&graph, debug_view, debug);
+  u32 ui = graph_add_pass(&graph, "ui", graph_log_pass, &log);
+  graph_read(&graph, ui, backbuffer);
+  graph_write(&graph, ui, backbuffer);
+
+  EXPECT(graph_compile(&graph));
+  u32 expected[] = {scene, threshold, blur_h, blur_v, tonemap, ui};
+  EXPECT(graph.order_count == ARR_LEN(expected));
+  EXPECT(memcmp(graph.order, expected, sizeof (expected)) == 0);
+  EXPECT(graph.passes[debug_view].culled && graph.resources[debug].first == TARGET_NONE);
+
+  // Bright is done by the time bloom is written, the blur in between isn't
+  EXPECT(graph.resources[bright].physical == graph.resources[bloom].physical);
+  EXPECT(graph.resources[blur].physical != graph.resources[bloom].physical);
+  EXPECT(graph.resources[backbuffer].physical == TARGET_NONE);
+  EXPECT(graph.physical_count == 4);
+  EXPECT(graph.transient_bytes - graph.physical_bytes == target_desc_bytes(&half));
+
+  // Only what's read later or leaves the frame is stored
+  EXPECT(graph_keep(&graph, scene, color) && !graph_keep(&graph, scene, motion));
+  EXPECT(graph_keep(&graph, tonemap, backbuffer) && graph_keep(&graph, ui, backbuffer));
+
+  TargetRecorder recorder = target_recorder_create(8);
+  TargetBackend backend = target_recorder_backend(&recorder);
+  TargetPool pool = target_pool_create(8, 2);
+
+  log.resource = bloom;
+  EXPECT(graph_execute(&graph, &pool, &backend));
+  EXPECT(log.count == graph.order_count && memcmp(log.passes, expected, sizeof (expected)) == 0);
+  EXPECT(recorder.creates == 4 && log.slots[3] != TARGET_NONE);
+  EXPECT(graph_target(&graph, bright) == graph_target(&graph, bloom));
+  EXPECT(graph_target(&graph, backbuffer) == TARGET_NONE);
+
+  // The next frame's graph gets the same targets back
+  target_pool_next_frame(&pool, &backend);
+  EXPECT(graph_compile(&graph) && graph_execute(&graph, &pool, &backend));
+  EXPECT(recorder.creates == 4 && pool.reused == 4);
+
+  // A pool too small runs nothing and holds on to nothing
+  TargetPool small = target_pool_create(2, 2);
+  log.count = 0;
+  EXPECT(!graph_execute(&graph, &small, &backend) && log.count == 0);
+  EXPECT(!small.slots[0].in_use && !small.slots[1].in_use);
+  target_pool_destroy(&small, &backend);
+
+  // Passes feeding each other can't be ordered
+  graph_reset(&graph);
+  u32 a = graph_create_target(&graph, "a", &half);
+  u32 b = graph_create_target(&graph, "b", &half);
+  graph_export(&graph, a);
+  u32 pa = graph_add_pass(&graph, "pa", NULL, NULL);
+  graph_read(&graph, pa, b);
+  graph_write(&graph, pa, a);
+  u32 pb = graph_add_pass(&graph, "pb", NULL, NULL);
+  graph_read(&graph, pb, a);
+  graph_write(&graph, pb, b);
+  EXPECT(!graph_compile(&graph));
+
+  // One target written twice: each read sees the write declared before it,
+  // and the second write waits for the first read
+  graph_reset(&graph);
+  u32 tmp = graph_create_target(&graph, "tmp", &half);
+  u32 out1 = graph_import_target(&graph, "out1", &half);
+  u32 out2 = graph_import_target(&graph, "out2", &half);
+  u32 write_tmp1 = graph_add_pass(&graph, "write_tmp1", NULL, NULL);
+  graph_write(&graph, write_tmp1, tmp);
+  u32 read_tmp1 = graph_add_pass(&graph, "read_tmp1", NULL, NULL);
+  graph_read(&graph, read_tmp1, tmp);
+  graph_write(&graph, read_tmp1, out1);
+  u32 write_tmp2 = graph_add_pass(&graph, "write_tmp2", NULL, NULL);
+  graph_write(&graph, write_tmp2, tmp);
+  u32 read_tmp2 = graph_add_pass(&graph, "read_tmp2", NULL, NULL);
+  graph_read(&graph, read_tmp2, tmp);
+  graph_write(&graph, read_tmp2, out2);
+  EXPECT(graph_compile(&graph));
+  u32 versions[] = {write_tmp1, read_tmp1, write_tmp2, read_tmp2};
+  EXPECT(graph.order_count == ARR_LEN(versions));
+  EXPECT(memcmp(graph.order, versions, sizeof (versions)) == 0);
+  EXPECT(graph_keep(&graph, write_tmp1, tmp) && graph_keep(&graph, write_tmp2, tmp));
+
+  target_pool_destroy(&pool, &backend);
+  EXPECT(recorder.live_bytes == 0);
+  target_recorder_destroy(&recorder);
+}
+
+static
+void test_post(void)
+{
+  // Half size down to the last level with both sides at least 8, at most 8
+  EXPECT(post_bloom_levels(800, 450) == 5);
+  EXPECT(post_bloom_levels(1920, 1080) == 7);
+  EXPECT(post_bloom_levels(3840, 2160) == 8);
+  EXPECT(post_bloom_levels(15, 4096) == 0);
+
+  PostPassCost passes[2 * POST_MAX_BLOOM_LEVELS];
+  u32 count = post_estimate(800, 450, 5, passes);
+  EXPECT(count == 10);
+  EXPECT(passes[0].width == 400 && passes[0].height == 225);
+  EXPECT(passes[0].read_bytes == 800 * 450 * 8 && passes[0].write_bytes == 400 * 225 * 8);
+  EXPECT(strcmp(passes[4].name, "downsample") == 0 && passes[4].width == 25);
+
+  // Upsamples run from the smallest level and read back what they add onto
+  EXPECT(strcmp(passes[5].name, "upsample") == 0 && passes[5].level == 3);
+  EXPECT(passes[5].read_bytes == (25 * 14 + 50 * 28) * 8 && passes[5].write_bytes == 50 * 28 * 8);
+  EXPECT(passes[8].level == 0 && passes[8].width == 400);
+  EXPECT(strcmp(passes[9].name, "tonemap") == 0);
+  EXPECT(passes[9].read_bytes == (800 * 450 + 400 * 225) * 8);
+  EXPECT(passes[9].write_bytes == 800 * 450 * 4);
+
+  EXPECT(post_estimate(800, 450, 0, passes) == 1 && passes[0].read_bytes == 800 * 450 * 8);
+
+  // The curves the tonemap shader applies
+  EXPECT(post_tonemap_aces(0.0f) == 0.0f);
+  EXPECT(fabsf(post_tonemap_aces(1.0f) - 0.8038f) < 1e-3f);
+  EXPECT(post_tonemap_aces(100.0f) == 1.0f);
+
+  bool monotonic = TRUE;
+  for (f32 x = 0.0f, prev = 0.0f; x < 16.0f; x += 0.01f)
+  {
+    f32 y = post_tonemap_aces(x);
+    if (y < prev) monotonic = FALSE;
+    prev = y;
+  }
+
+  EXPECT(monotonic);
+
+  EXPECT(post_linear_to_srgb(0.0f) == 0.0f);
+  EXPECT(fabsf(post_linear_to_srgb(1.0f) - 1.0f) < 1e-5f);
+  EXPECT(fabsf(post_linear_to_srgb(0.5f) - 0.7354f) < 1e-3f);
+  EXPECT(fabsf(post_linear_to_srgb(0.0031307f) - post_linear_to_srgb(0.0031309f)) < 1e-4f);
+}
+
 i32 main(void)
 {
   Mat3x3F sprite = scale_3x3f(1.0f, 1.0f);
   Mat3x3F camera = translate_3x3f(100.f, 100.0f);
   Mat3x3F projection = orthographic_3x3f(0.0f, 800.0f, 0.0f, 450.0f);
 
+  test_skyline();
+  test_atlas_find();
+  test_shelf_atlas();
+  test_block_compression();
+  test_mips();
+  test_image_container();
+  test_trig();
+  test_quat();
+  test_affine();
+  test_camera();
+  test_culling();
+  test_spatial_grid();
+  test_bvh();
+  test_bvh_degenerate();
+  test_vertex_half();
+  test_vertex_normalized();
+  test_vertex_pack();
+  test_mesh_obj();
+  test_mesh_optimize();
+  test_mesh_lod();
+  test_mesh_container();
+  test_draw_list();
+  test_heap();
+  #ifdef DEBUG
+  test_dbg();
+  #endif
+  test_font();
+  test_font_ttf();
+  test_target_pool();
+  test_graph();
+  test_post();
+
+  test_failures += test_math_properties();
+
+  if (test_failures)
+  {
+    printf("%i checks failed!\n", test_failures);
+    return 1;
+  }
+
+  printf("All tests passed!\n");
+
   return 0;
 }
@@ -0,0 +1,1081 @@
+// Property tests for base_math. Every function in base_math.h runs on random
+// inputs and is compared against the same math done in double precision, or,
+// where there is nothing simpler to compare with, against an identity it has
+// to satisfy (inverses, round trips, batch versus scalar).
+//
+// Built header-only with the SSE Vec4F kernels. `make test` builds it a second
+// time with TEST_MATH_LINKED, standalone and linked against base_math.c, and
+// with BASE_MATH_SCALAR_VEC4, so the scalar kernels run the same suite.
+#ifndef TEST_MATH_LINKED
+#define BASE_MATH_HEADER_ONLY
+#endif
+
+#include <math.h>
+#include <stdio.h>
+
+#include "../src/base_common.h"
+#include "../src/base_math.h"
+
+#include "test_math.h"
+
+#define RUNS 1000
+
+// Errors are measured relative to `scale`, the size of the inputs that went
+// into a result, so sums that cancel aren't held to an impossible standard.
+#define TOL 1e-6
+#define TOL_TRIG 2e-6
+#define TOL_SOLVE 1e-4
+
+#define REF_PI 3.14159265358979323846
+
+#define PROPERTY(exp) \
+  if (!(exp)) \
+  { \
+    if (property_failures < 32) \
+    { \
+      printf("[Property Failed]: %s:%i (run %u): %s\n", __FILE__, __LINE__, run, #exp); \
+    } \
+    property_failures++; \
+  }
+
+static i32 property_failures;
+static u32 property_rng = 0x2545F491;
+
+static
+u32 prop_next(void)
+{
+  property_rng ^= property_rng << 13;
+  property_rng ^= property_rng >> 17;
+  property_rng ^= property_rng << 5;
+  return property_rng;
+}
+
+static
+f32 prop_f32(f32 lo, f32 hi)
+{
+  return lo + (hi - lo) * ((f32) prop_next() / 4294967295.0f);
+}
+
+// Components in [-1, 1] times a magnitude between 1e-3 and 1e3
+static
+void prop_vec(f32 *v, u32 n)
+{
+  f32 magnitude = powf(10.0f, prop_f32(-3.0f, 3.0f));
+  for (u32 i = 0; i < n; i++) v[i] = prop_f32(-1.0f, 1.0f) * magnitude;
+}
+
+static
+void prop_mat(f32 *m, u32 n)
+{
+  for (u32 i = 0; i < n; i++) m[i] = prop_f32(-4.0f, 4.0f);
+}
+
+static
+Vec3F prop_axis(void)
+{
+  Vec3F v;
+  do
+  {
+    v = v3f(prop_f32(-1, 1), prop_f32(-1, 1), prop_f32(-1, 1));
+  } while (dot_3f(v, v) < 0.01f);
+
+  return normalize_3f(v);
+}
+
+static
+QuatF prop_qf(void)
+{
+  return axis_angle_qf(prop_axis(), prop_f32(-180.0f, 180.0f));
+}
+
+// @Reference ===============================================================================
+
+static
+void widen(const f32 *src, f64 *dst, u32 n)
+{
+  for (u32 i = 0; i < n; i++) dst[i] = src[i];
+}
+
+static
+f64 ref_norm(const f64 *v, u32 n)
+{
+  f64 sum = 0.0;
+  for (u32 i = 0; i < n; i++) sum += v[i] * v[i];
+  return sqrt(sum);
+}
+
+static
+f64 ref_dot(const f64 *a, const f64 *b, u32 n)
+{
+  f64 sum = 0.0;
+  for (u32 i = 0; i < n; i++) sum += a[i] * b[i];
+  return sum;
+}
+
+// n x n, row-major
+static
+void ref_mul(const f64 *a, const f64 *b, f64 *out, u32 n)
+{
+  for (u32 r = 0; r < n; r++)
+  {
+    for (u32 c = 0; c < n; c++)
+    {
+      f64 sum = 0.0;
+      for (u32 k = 0; k < n; k++) sum += a[r * n + k] * b[k * n + c];
+      out[r * n + c] = sum;
+    }
+  }
+}
+
+static
+void ref_transform(const f64 *m, const f64 *v, f64 *out, u32 n)
+{
+  for (u32 r = 0; r < n; r++) out[r] = ref_dot(&m[r * n], v, n);
+}
+
+// Gauss-Jordan with partial pivoting
+static
+void ref_inverse(const f64 *m, f64 *out, u32 n)
+{
+  f64 a[4][8];
+  for (u32 r = 0; r < n; r++)
+  {
+    for (u32 c = 0; c < n; c++)
+    {
+      a[r][c] = m[r * n + c];
+      a[r][c + n] = r == c;
+    }
+  }
+
+  for (u32 c = 0; c < n; c++)
+  {
+    u32 pivot = c;
+    for (u32 r = c + 1; r < n; r++)
+    {
+      if (fabs(a[r][c]) > fabs(a[pivot][c])) pivot = r;
+    }
+
+    for (u32 k = 0; k < 2 * n; k++)
+    {
+      f64 tmp = a[c][k];
+      a[c][k] = a[pivot][k];
+      a[pivot][k] = tmp;
+    }
+
+    f64 inv = 1.0 / a[c][c];
+    for (u32 k = 0; k < 2 * n; k++) a[c][k] *= inv;
+
+    for (u32 r = 0; r < n; r++)
+    {
+      if (r == c) continue;
+      f64 f = a[r][c];
+      for (u32 k = 0; k < 2 * n; k++) a[r][k] -= f * a[c][k];
+    }
+  }
+
+  for (u32 r = 0; r < n; r++)
+  {
+    for (u32 c = 0; c < n; c++) out[r * n + c] = a[r][c + n];
+  }
+}
+
+// Rotation matrix of a unit quaternion, row-major 3x3
+static
+void ref_quat_mat(const f64 *q, f64 *m)
+{
+  f64 x = q[0], y = q[1], z = q[2], w = q[3];
+  f64 rows[9] =
+  {
+    1 - 2 * (y * y + z * z), 2 * (x * y - w * z), 2 * (x * z + w * y),
+    2 * (x * y + w * z), 1 - 2 * (x * x + z * z), 2 * (y * z - w * x),
+    2 * (x * z - w * y), 2 * (y * z + w * x), 1 - 2 * (x * x + y * y),
+  };
+
+  for (u32 i = 0; i < 9; i++) m[i] = rows[i];
+}
+
+// Rodrigues, angle in degrees, row-major 3x3
+static
+void ref_axis_angle_mat(Vec3F axis, f64 degrees, f64 *m)
+{
+  f64 a = degrees * REF_PI / 180.0;
+  f64 s = sin(a), c = cos(a), t = 1.0 - c;
+  f64 x = axis.x, y = axis.y, z = axis.z;
+  f64 rows[9] =
+  {
+    c + x * x * t, x * y * t - z * s, x * z * t + y * s,
+    y * x * t + z * s, c + y * y * t, y * z * t - x * s,
+    z * x * t - y * s, z * y * t + x * s, c + z * z * t,
+  };
+
+  for (u32 i = 0; i < 9; i++) m[i] = rows[i];
+}
+
+static
+bool near_all(const f32 *got, const f64 *want, u32 n, f64 scale, f64 tol)
+{
+  for (u32 i = 0; i < n; i++)
+  {
+    // Written so NaN fails
+    if (!(fabs(got[i] - want[i]) <= tol * scale)) return FALSE;
+  }
+
+  return TRUE;
+}
+
+static
+bool near_one(f32 got, f64 want, f64 scale, f64 tol)
+{
+  return fabs(got - want) <= tol * scale;
+}
+
+static
+bool equal_all(const f32 *got, const f32 *want, u32 n)
+{
+  for (u32 i = 0; i < n; i++)
+  {
+    if (got[i] != want[i]) return FALSE;
+  }
+
+  return TRUE;
+}
+
+// @Vectors =================================================================================
+
+static
+void test_vec2_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Vec2F a, b;
+    prop_vec(a.elements, 2);
+    prop_vec(b.elements, 2);
+    f32 k = prop_f32(-8.0f, 8.0f);
+    f32 t = prop_f32(0.0f, 1.0f);
+
+    // Divisors kept away from zero
+    Vec2F d = {copysignf(0.5f, b.x) + b.x, copysignf(0.5f, b.y) + b.y};
+
+    f64 da[2], db[2], dd[2], want[2];
+    widen(a.elements, da, 2);
+    widen(b.elements, db, 2);
+    widen(d.elements, dd, 2);
+    f64 sa = ref_norm(da, 2);
+    f64 sb = ref_norm(db, 2);
+    f64 sab = sa + sb;
+
+    PROPERTY(equal_all(v2f(a.x, a.y).elements, a.elements, 2));
+
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] + db[i];
+    PROPERTY(near_all(add_2f(a, b).elements, want, 2, sab, TOL));
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] - db[i];
+    PROPERTY(near_all(sub_2f(a, b).elements, want, 2, sab, TOL));
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] * db[i];
+    PROPERTY(near_all(mul_2f(a, b).elements, want, 2, sa * sb, TOL));
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] / dd[i];
+    PROPERTY(near_all(div_2f(a, d).elements, want, 2, sa / fmin(fabs(dd[0]), fabs(dd[1])), TOL));
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] * k;
+    PROPERTY(near_all(scale_2f(a, k).elements, want, 2, sa * fabs(k), TOL));
+
+    PROPERTY(near_one(dot_2f(a, b), ref_dot(da, db, 2), sa * sb, TOL));
+    PROPERTY(near_one(cross_2f(a, b), da[0] * db[1] - da[1] * db[0], sa * sb, TOL));
+
+    PROPERTY(near_one(magnitude_2f(a), sa, sa, TOL));
+    PROPERTY(near_one(magnitude_squared_2f(a), sa * sa, sa * sa, TOL));
+    for (u32 i = 0; i < 2; i++) want[i] = db[i] - da[i];
+    PROPERTY(near_one(distance_2f(a, b), ref_norm(want, 2), sab, TOL));
+    PROPERTY(near_one(distance_squared_2f(a, b), ref_dot(want, want, 2), sab * sab, TOL));
+
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] / sa;
+    PROPERTY(near_all(normalize_2f(a).elements, want, 2, 1.0, TOL));
+    PROPERTY(near_all(normalize_fast_2f(a).elements, want, 2, 1.0, TOL));
+    PROPERTY(near_all(normalize_safe_2f(a).elements, want, 2, 1.0, TOL));
+
+    for (u32 i = 0; i < 2; i++) want[i] = da[i] + (db[i] - da[i]) * t;
+    PROPERTY(near_all(lerp_2f(a, b, t).elements, want, 2, sab, TOL));
+  }
+
+  u32 run = 0;
+  PROPERTY(equal_all(normalize_safe_2f(V2F_ZERO).elements, V2F_ZERO.elements, 2));
+  PROPERTY(equal_all(normalize_safe_2f(v2f(1e-20f, 0.0f)).elements, V2F_ZERO.elements, 2));
+  PROPERTY(normalize_safe_2f(v2f(0.0f, -1e-10f)).y == -1.0f);
+  PROPERTY(lerp_2f(v2f(1.0f, 2.0f), v2f(3.0f, 6.0f), 0.0f).y == 2.0f);
+  PROPERTY(lerp_2f(v2f(1.0f, 2.0f), v2f(3.0f, 6.0f), 1.0f).y == 6.0f);
+}
+
+static
+void test_vec3_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Vec3F a, b;
+    prop_vec(a.elements, 3);
+    prop_vec(b.elements, 3);
+    f32 k = prop_f32(-8.0f, 8.0f);
+    f32 t = prop_f32(0.0f, 1.0f);
+    Vec3F d = {copysignf(0.5f, b.x) + b.x, copysignf(0.5f, b.y) + b.y, copysignf(0.5f, b.z) + b.z};
+
+    Mat3x3F m;
+    prop_mat(&m.elements[0][0], 9);
+
+    f64 da[3], db[3], dd[3], dm[9], want[3];
+    widen(a.elements, da, 3);
+    widen(b.elements, db, 3);
+    widen(d.elements, dd, 3);
+    widen(&m.elements[0][0], dm, 9);
+    f64 sa = ref_norm(da, 3);
+    f64 sb = ref_norm(db, 3);
+    f64 sab = sa + sb;
+    f64 min_d = fmin(fmin(fabs(dd[0]), fabs(dd[1])), fabs(dd[2]));
+
+    PROPERTY(equal_all(v3f(a.x, a.y, a.z).elements, a.elements, 3));
+
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] + db[i];
+    PROPERTY(near_all(add_3f(a, b).elements, want, 3, sab, TOL));
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] - db[i];
+    PROPERTY(near_all(sub_3f(a, b).elements, want, 3, sab, TOL));
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] * db[i];
+    PROPERTY(near_all(mul_3f(a, b).elements, want, 3, sa * sb, TOL));
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] / dd[i];
+    PROPERTY(near_all(div_3f(a, d).elements, want, 3, sa / min_d, TOL));
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] * k;
+    PROPERTY(near_all(scale_3f(a, k).elements, want, 3, sa * fabs(k), TOL));
+
+    PROPERTY(near_one(dot_3f(a, b), ref_dot(da, db, 3), sa * sb, TOL));
+    want[0] = da[1] * db[2] - da[2] * db[1];
+    want[1] = da[2] * db[0] - da[0] * db[2];
+    want[2] = da[0] * db[1] - da[1] * db[0];
+    PROPERTY(near_all(cross_3f(a, b).elements, want, 3, sa * sb, TOL));
+
+    ref_transform(dm, da, want, 3);
+    PROPERTY(near_all(transform_3f(a, m).elements, want, 3, 12.0 * sa, TOL));
+
+    PROPERTY(near_one(magnitude_3f(a), sa, sa, TOL));
+    PROPERTY(near_one(magnitude_squared_3f(a), sa * sa, sa * sa, TOL));
+    for (u32 i = 0; i < 3; i++) want[i] = db[i] - da[i];
+    PROPERTY(near_one(distance_3f(a, b), ref_norm(want, 3), sab, TOL));
+    PROPERTY(near_one(distance_squared_3f(a, b), ref_dot(want, want, 3), sab * sab, TOL));
+
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] / sa;
+    PROPERTY(near_all(normalize_3f(a).elements, want, 3, 1.0, TOL));
+    PROPERTY(near_all(normalize_fast_3f(a).elements, want, 3, 1.0, TOL));
+    PROPERTY(near_all(normalize_safe_3f(a).elements, want, 3, 1.0, TOL));
+
+    for (u32 i = 0; i < 3; i++) want[i] = da[i] + (db[i] - da[i]) * t;
+    PROPERTY(near_all(lerp_3f(a, b, t).elements, want, 3, sab, TOL));
+  }
+
+  u32 run = 0;
+  PROPERTY(equal_all(normalize_safe_3f(V3F_ZERO).elements, V3F_ZERO.elements, 3));
+  PROPERTY(equal_all(normalize_safe_3f(v3f(0.0f, 1e-20f, 0.0f)).elements, V3F_ZERO.elements, 3));
+  PROPERTY(normalize_safe_3f(v3f(0.0f, 0.0f, 1e-10f)).z == 1.0f);
+}
+
+static
+void test_vec4_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Vec4F a, b;
+    prop_vec(a.elements, 4);
+    prop_vec(b.elements, 4);
+    f32 k = prop_f32(-8.0f, 8.0f);
+    f32 t = prop_f32(0.0f, 1.0f);
+    Vec4F d;
+    for (u32 i = 0; i < 4; i++) d.elements[i] = copysignf(0.5f, b.elements[i]) + b.elements[i];
+
+    Mat4x4F m;
+    prop_mat(&m.elements[0][0], 16);
+
+    f64 da[4], db[4], dd[4], dm[16], want[4];
+    widen(a.elements, da, 4);
+    widen(b.elements, db, 4);
+    widen(d.elements, dd, 4);
+    widen(&m.elements[0][0], dm, 16);
+    f64 sa = ref_norm(da, 4);
+    f64 sb = ref_norm(db, 4);
+    f64 sab = sa + sb;
+    f64 min_d = fmin(fmin(fabs(dd[0]), fabs(dd[1])), fmin(fabs(dd[2]), fabs(dd[3])));
+
+    PROPERTY(equal_all(v4f(a.x, a.y, a.z, a.w).elements, a.elements, 4));
+
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] + db[i];
+    PROPERTY(near_all(add_4f(a, b).elements, want, 4, sab, TOL));
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] - db[i];
+    PROPERTY(near_all(sub_4f(a, b).elements, want, 4, sab, TOL));
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] * db[i];
+    PROPERTY(near_all(mul_4f(a, b).elements, want, 4, sa * sb, TOL));
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] / dd[i];
+    PROPERTY(near_all(div_4f(a, d).elements, want, 4, sa / min_d, TOL));
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] * k;
+    PROPERTY(near_all(scale_4f(a, k).elements, want, 4, sa * fabs(k), TOL));
+
+    PROPERTY(near_one(dot_4f(a, b), ref_dot(da, db, 4), sa * sb, TOL));
+    ref_transform(dm, da, want, 4);
+    PROPERTY(near_all(transform_4f(a, m).elements, want, 4, 16.0 * sa, TOL));
+
+    // magnitude_4f used to add z twice and drop w
+    PROPERTY(near_one(magnitude_4f(a), sa, sa, TOL));
+    PROPERTY(near_one(magnitude_squared_4f(a), sa * sa, sa * sa, TOL));
+    for (u32 i = 0; i < 4; i++) want[i] = db[i] - da[i];
+    PROPERTY(near_one(distance_4f(a, b), ref_norm(want, 4), sab, TOL));
+    PROPERTY(near_one(distance_squared_4f(a, b), ref_dot(want, want, 4), sab * sab, TOL));
+
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] / sa;
+    PROPERTY(near_all(normalize_4f(a).elements, want, 4, 1.0, TOL));
+    PROPERTY(near_all(normalize_fast_4f(a).elements, want, 4, 1.0, TOL));
+    PROPERTY(near_all(normalize_safe_4f(a).elements, want, 4, 1.0, TOL));
+
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] + (db[i] - da[i]) * t;
+    PROPERTY(near_all(lerp_4f(a, b, t).elements, want, 4, sab, TOL));
+  }
+
+  u32 run = 0;
+  PROPERTY(magnitude_4f(v4f(0.0f, 0.0f, 0.0f, 2.0f)) == 2.0f);
+  PROPERTY(equal_all(normalize_safe_4f(V4F_ZERO).elements, V4F_ZERO.elements, 4));
+  PROPERTY(equal_all(normalize_safe_4f(v4f(0, 0, 1e-20f, 0)).elements, V4F_ZERO.elements, 4));
+  PROPERTY(normalize_safe_4f(v4f(0.0f, 0.0f, 0.0f, 1e-10f)).w == 1.0f);
+}
+
+// @Matrices ================================================================================
+
+static
+void test_mat3_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Mat3x3F a, b;
+    prop_mat(&a.elements[0][0], 9);
+    prop_mat(&b.elements[0][0], 9);
+    Vec3F r0 = {a.elements[0][0], a.elements[0][1], a.elements[0][2]};
+    Vec3F r1 = {a.elements[1][0], a.elements[1][1], a.elements[1][2]};
+    Vec3F r2 = {a.elements[2][0], a.elements[2][1], a.elements[2][2]};
+    f32 k = prop_f32(-4.0f, 4.0f);
+    f32 x = prop_f32(-100.0f, 100.0f);
+    f32 y = prop_f32(-100.0f, 100.0f);
+    f32 angle = prop_f32(-720.0f, 720.0f);
+
+    f64 da[9], db[9], want[9];
+    widen(&a.elements[0][0], da, 9);
+    widen(&b.elements[0][0], db, 9);
+
+    Mat3x3F ident = m3x3f(k);
+    for (u32 i = 0; i < 9; i++) want[i] = i % 4 == 0 ? k : 0.0;
+    PROPERTY(near_all(&ident.elements[0][0], want, 9, 1.0, 0.0));
+
+    Mat3x3F rows = rows_3x3f(r0, r1, r2);
+    PROPERTY(equal_all(&rows.elements[0][0], &a.elements[0][0], 9));
+    Mat3x3F cols = transpose_3x3f(cols_3x3f(r0, r1, r2));
+    PROPERTY(equal_all(&cols.elements[0][0], &a.elements[0][0], 9));
+
+    for (u32 r = 0; r < 3; r++)
+    {
+      for (u32 c = 0; c < 3; c++) want[c * 3 + r] = da[r * 3 + c];
+    }
+    PROPERTY(near_all(&transpose_3x3f(a).elements[0][0], want, 9, 1.0, 0.0));
+
+    ref_mul(da, db, want, 3);
+    PROPERTY(near_all(&mul_3x3f(a, b).elements[0][0], want, 9, 48.0, TOL));
+
+    f64 tr[9] = {1, 0, x, 0, 1, y, 0, 0, 1};
+    PROPERTY(near_all(&translate_3x3f(x, y).elements[0][0], tr, 9, 100.0, 0.0));
+
+    f64 s = sin(angle * REF_PI / 180.0), c = cos(angle * REF_PI / 180.0);
+    f64 rot[9] = {c, -s, 0, s, c, 0, 0, 0, 1};
+    PROPERTY(near_all(&rotate_3x3f(angle).elements[0][0], rot, 9, 1.0, TOL_TRIG));
+
+    f64 sc[9] = {x, 0, 0, 0, y, 0, 0, 0, 1};
+    PROPERTY(near_all(&scale_3x3f(x, y).elements[0][0], sc, 9, 100.0, 0.0));
+    f64 sh[9] = {1, x, 0, y, 1, 0, 0, 0, 1};
+    PROPERTY(near_all(&shear_3x3f(x, y).elements[0][0], sh, 9, 100.0, 0.0));
+
+    // The corners of the box map to the corners of NDC
+    f32 left = prop_f32(-100, 0), right = left + prop_f32(10, 100);
+    f32 bot = prop_f32(-100, 0), top = bot + prop_f32(10, 100);
+    Mat3x3F ortho = orthographic_3x3f(left, right, bot, top);
+    Vec3F lo = transform_3f(v3f(left, bot, 1.0f), ortho);
+    Vec3F hi = transform_3f(v3f(right, top, 1.0f), ortho);
+    f64 lo_want[3] = {-1, -1, 1};
+    f64 hi_want[3] = {1, 1, 1};
+    PROPERTY(near_all(lo.elements, lo_want, 3, 1.0, 1e-5));
+    PROPERTY(near_all(hi.elements, hi_want, 3, 1.0, 1e-5));
+  }
+}
+
+static
+Affine2F prop_a2f(void)
+{
+  return a2f(v2f(prop_f32(-100, 100), prop_f32(-100, 100)),
+             prop_f32(-180, 180),
+             v2f(prop_f32(0.25f, 4.0f), prop_f32(0.25f, 4.0f)));
+}
+
+// Affine2F widened to a full 3x3
+static
+void widen_a2f(Affine2F m, f64 *out)
+{
+  widen(&m.elements[0][0], out, 6);
+  out[6] = 0.0;
+  out[7] = 0.0;
+  out[8] = 1.0;
+}
+
+static
+void test_affine_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Vec2F pos = v2f(prop_f32(-100, 100), prop_f32(-100, 100));
+    Vec2F scale = v2f(prop_f32(-4, 4), prop_f32(-4, 4));
+    f32 angle = prop_f32(-720, 720);
+    f64 s = sin(angle * REF_PI / 180.0), c = cos(angle * REF_PI / 180.0);
+
+    f64 want[9] = {c * scale.x, -s * scale.y, pos.x, s * scale.x, c * scale.y, pos.y};
+    PROPERTY(near_all(&a2f(pos, angle, scale).elements[0][0], want, 6, 100.0, TOL_TRIG));
+
+    Affine2F a = prop_a2f();
+    Affine2F b = prop_a2f();
+    f64 da[9], db[9], m[9];
+    widen_a2f(a, da);
+    widen_a2f(b, db);
+
+    ref_mul(da, db, m, 3);
+    PROPERTY(near_all(&mul_a2f(a, b).elements[0][0], m, 6, 2000.0, TOL));
+
+    ref_inverse(da, m, 3);
+    PROPERTY(near_all(&invert_a2f(a).elements[0][0], m, 6, 1000.0, TOL));
+
+    Vec2F p = v2f(prop_f32(-100, 100), prop_f32(-100, 100));
+    f64 dp[3] = {p.x, p.y, 1.0}, tp[3];
+    ref_transform(da, dp, tp, 3);
+    PROPERTY(near_all(transform_a2f(p, a).elements, tp, 2, 1000.0, TOL));
+
+    f64 tr[6] = {1, 0, pos.x, 0, 1, pos.y};
+    PROPERTY(near_all(&translate_a2f(pos.x, pos.y).elements[0][0], tr, 6, 1.0, 0.0));
+
+    f32 left = prop_f32(-100, 0), right = left + prop_f32(10, 100);
+    f32 bot = prop_f32(-100, 0), top = bot + prop_f32(10, 100);
+    Affine2F ortho = orthographic_a2f(left, right, bot, top);
+    Mat3x3F ortho3 = orthographic_3x3f(left, right, bot, top);
+    PROPERTY(equal_all(&ortho.elements[0][0], &ortho3.elements[0][0], 6));
+
+    Mat3x3F full = m3x3f_from_a2f(a);
+    f64 want_full[9];
+    widen_a2f(a, want_full);
+    PROPERTY(near_all(&full.elements[0][0], want_full, 9, 1.0, 0.0));
+  }
+}
+
+static
+void test_mat4_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Mat4x4F a, b;
+    prop_mat(&a.elements[0][0], 16);
+    prop_mat(&b.elements[0][0], 16);
+    f32 k = prop_f32(-4.0f, 4.0f);
+    f32 x = prop_f32(-100, 100), y = prop_f32(-100, 100), z = prop_f32(-100, 100);
+
+    f64 da[16], db[16], want[16];
+    widen(&a.elements[0][0], da, 16);
+    widen(&b.elements[0][0], db, 16);
+
+    for (u32 i = 0; i < 16; i++) want[i] = i % 5 == 0 ? k : 0.0;
+    PROPERTY(near_all(&m4x4f(k).elements[0][0], want, 16, 1.0, 0.0));
+
+    Vec4F r[4];
+    for (u32 i = 0; i < 4; i++)
+    {
+      r[i] = v4f(a.elements[i][0], a.elements[i][1], a.elements[i][2], a.elements[i][3]);
+    }
+    PROPERTY(equal_all(&rows_4x4f(r[0], r[1], r[2], r[3]).elements[0][0], &a.elements[0][0], 16));
+    Mat4x4F cols = transpose_4x4f(cols_4x4f(r[0], r[1], r[2], r[3]));
+    PROPERTY(equal_all(&cols.elements[0][0], &a.elements[0][0], 16));
+
+    for (u32 i = 0; i < 4; i++)
+    {
+      for (u32 j = 0; j < 4; j++) want[j * 4 + i] = da[i * 4 + j];
+    }
+    PROPERTY(near_all(&transpose_4x4f(a).elements[0][0], want, 16, 1.0, 0.0));
+
+    // mul_4x4f(a, b) applies a first: b * a
+    ref_mul(db, da, want, 4);
+    PROPERTY(near_all(&mul_4x4f(a, b).elements[0][0], want, 16, 64.0, TOL));
+
+    // Diagonally dominant, so well conditioned
+    Mat4x4F g = a;
+    for (u32 i = 0; i < 4; i++) g.elements[i][i] += copysignf(16.0f, g.elements[i][i]);
+    f64 dg[16];
+    widen(&g.elements[0][0], dg, 16);
+    ref_inverse(dg, want, 4);
+    PROPERTY(near_all(&inverse_4x4f(g).elements[0][0], want, 16, 1.0, TOL_SOLVE));
+
+    Vec3F axis = prop_axis();
+    f32 angle = prop_f32(-360, 360);
+    Mat4x4F affine = mul_4x4f(mul_4x4f(scale_4x4f(prop_f32(0.5f, 2), prop_f32(0.5f, 2), prop_f32(0.5f, 2)),
+                                       rotate_4x4f(angle, axis)),
+                              translate_4x4f(x, y, z));
+    f64 daff[16];
+    widen(&affine.elements[0][0], daff, 16);
+    ref_inverse(daff, want, 4);
+    PROPERTY(near_all(&inverse_affine_4x4f(affine).elements[0][0], want, 16, 200.0, TOL_SOLVE));
+
+    f64 tr[16] = {1, 0, 0, x, 0, 1, 0, y, 0, 0, 1, z, 0, 0, 0, 1};
+    PROPERTY(near_all(&translate_4x4f(x, y, z).elements[0][0], tr, 16, 1.0, 0.0));
+    f64 sc[16] = {x, 0, 0, 0, 0, y, 0, 0, 0, 0, z, 0, 0, 0, 0, 1};
+    PROPERTY(near_all(&scale_4x4f(x, y, z).elements[0][0], sc, 16, 1.0, 0.0));
+    f64 sh[16] = {1, x, 0, 0, 0, 1, y, 0, z, 0, 1, 0, 0, 0, 0, 1};
+    PROPERTY(near_all(&shear_4x4f(x, y, z).elements[0][0], sh, 16, 1.0, 0.0));
+
+    f64 rot[9];
+    ref_axis_angle_mat(axis, angle, rot);
+    Mat4x4F rm = rotate_4x4f(angle, axis);
+    for (u32 i = 0; i < 3; i++)
+    {
+      PROPERTY(near_all(rm.elements[i], &rot[i * 3], 3, 1.0, TOL_TRIG));
+    }
+
+    f32 left = prop_f32(-100, 0), right = left + prop_f32(10, 100);
+    f32 bot = prop_f32(-100, 0), top = bot + prop_f32(10, 100);
+    Mat4x4F ortho = orthographic_4x4f(left, right, bot, top);
+    f64 lo_want[4] = {-1, -1, 0, 1};
+    f64 hi_want[4] = {1, 1, 0, 1};
+    PROPERTY(near_all(transform_4f(v4f(left, bot, 0, 1), ortho).elements, lo_want, 4, 1.0, 1e-5));
+    PROPERTY(near_all(transform_4f(v4f(right, top, 0, 1), ortho).elements, hi_want, 4, 1.0, 1e-5));
+
+    // Points on the near and far planes at the edge of the view land on the
+    // edges of clip space
+    f32 fov = prop_f32(20, 120), aspect = prop_f32(0.5f, 2.5f);
+    f32 near = prop_f32(0.05f, 1.0f), far = near + prop_f32(10.0f, 1000.0f);
+    f64 half = tan(fov * REF_PI / 360.0);
+    Mat4x4F persp = perspective_4x4f(fov, aspect, near, far);
+    for (u32 i = 0; i < 2; i++)
+    {
+      f64 d = i ? far : near;
+      Vec4F clip = transform_4f(v4f((f32) (d * half * aspect), (f32) (d * half), (f32) -d, 1), persp);
+      f64 ndc[3] = {1.0, 1.0, i ? 1.0 : -1.0};
+      f32 got[3] = {clip.x / clip.w, clip.y / clip.w, clip.z / clip.w};
+      PROPERTY(near_all(got, ndc, 3, 1.0, i ? 1e-3 : 1e-5));
+      PROPERTY(near_one(clip.w, d, d, TOL));
+    }
+
+    Mat4x4F rev = perspective_reversed_4x4f(fov, aspect, near);
+    Vec4F clip = transform_4f(v4f(0, 0, -near, 1), rev);
+    PROPERTY(near_one(clip.z / clip.w, 1.0, 1.0, TOL));
+    clip = transform_4f(v4f((f32) (near * half * aspect), 0, -near * 1e6f, 1), rev);
+    PROPERTY(clip.z / clip.w > 0.0f && clip.z / clip.w < 1e-5f);
+
+    // look_at puts the eye at the origin and the target down -z, with an
+    // orthonormal basis
+    Vec3F eye = v3f(x, y, z);
+    Vec3F center = add_3f(eye, scale_3f(prop_axis(), prop_f32(1, 50)));
+    Vec3F up = v3f(0, 1, 0);
+    if (fabsf(dot_3f(normalize_3f(sub_3f(center, eye)), up)) > 0.99f) up = v3f(1, 0, 0);
+    Mat4x4F view = look_at_4x4f(eye, center, up);
+    f64 origin[4] = {0, 0, 0, 1};
+    PROPERTY(near_all(transform_4f(v4f(x, y, z, 1), view).elements, origin, 4, 200.0, TOL));
+    Vec4F target = transform_4f(v4f(center.x, center.y, center.z, 1), view);
+    f64 dist = distance_3f(eye, center);
+    f64 forward[4] = {0, 0, -dist, 1};
+    PROPERTY(near_all(target.elements, forward, 4, 200.0, TOL));
+    f64 upper[9], ident[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1}, gram[9];
+    for (u32 i = 0; i < 3; i++)
+    {
+      for (u32 j = 0; j < 3; j++) upper[i * 3 + j] = view.elements[i][j];
+    }
+    for (u32 i = 0; i < 3; i++)
+    {
+      for (u32 j = 0; j < 3; j++) gram[i * 3 + j] = ref_dot(&upper[i * 3], &upper[j * 3], 3);
+    }
+    f32 gram_f[9];
+    for (u32 i = 0; i < 9; i++) gram_f[i] = (f32) gram[i];
+    PROPERTY(near_all(gram_f, ident, 9, 1.0, 1e-5));
+
+    // unproject inverts projection
+    Mat4x4F view_proj = mul_4x4f(view, persp);
+    Vec2F viewport = v2f(1280, 720);
+    Vec2F screen = v2f(prop_f32(0, 1280), prop_f32(0, 720));
+    f32 depth = prop_f32(-1, 0.9f);
+    Vec3F world = unproject_4x4f(screen, depth, viewport, inverse_4x4f(view_proj));
+    Vec4F back = transform_4f(v4f(world.x, world.y, world.z, 1), view_proj);
+    f64 screen_want[3] = {screen.x, screen.y, depth};
+    f32 screen_got[3] =
+    {
+      (back.x / back.w + 1.0f) * 0.5f * viewport.x,
+      (1.0f - back.y / back.w) * 0.5f * viewport.y,
+      back.z / back.w,
+    };
+    PROPERTY(near_all(screen_got, screen_want, 2, 1280.0, 1e-3));
+    PROPERTY(near_one(screen_got[2], depth, 1.0, 1e-2));
+  }
+}
+
+// @Quaternions =============================================================================
+
+static
+void test_quat_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    Vec3F axis = prop_axis();
+    f32 angle = prop_f32(-360, 360);
+    QuatF a = prop_qf();
+    QuatF b = prop_qf();
+    f32 t = prop_f32(0, 1);
+
+    f64 da[4], db[4], want[16];
+    widen(a.elements, da, 4);
+    widen(b.elements, db, 4);
+
+    PROPERTY(equal_all(qf(a.x, a.y, a.z, a.w).elements, a.elements, 4));
+
+    f64 half = angle * REF_PI / 360.0;
+    f64 aa[4] = {axis.x * sin(half), axis.y * sin(half), axis.z * sin(half), cos(half)};
+    PROPERTY(near_all(axis_angle_qf(axis, angle).elements, aa, 4, 1.0, TOL_TRIG));
+
+    want[0] = da[3] * db[0] + da[0] * db[3] + da[1] * db[2] - da[2] * db[1];
+    want[1] = da[3] * db[1] - da[0] * db[2] + da[1] * db[3] + da[2] * db[0];
+    want[2] = da[3] * db[2] + da[0] * db[1] - da[1] * db[0] + da[2] * db[3];
+    want[3] = da[3] * db[3] - da[0] * db[0] - da[1] * db[1] - da[2] * db[2];
+    PROPERTY(near_all(mul_qf(a, b).elements, want, 4, 1.0, TOL));
+
+    PROPERTY(near_one(dot_qf(a, b), ref_dot(da, db, 4), 1.0, TOL));
+
+    f64 conj[4] = {-da[0], -da[1], -da[2], da[3]};
+    PROPERTY(near_all(conjugate_qf(a).elements, conj, 4, 1.0, 0.0));
+
+    QuatF raw = qf(prop_f32(-5, 5), prop_f32(-5, 5), prop_f32(-5, 5), prop_f32(-5, 5));
+    f64 draw[4];
+    widen(raw.elements, draw, 4);
+    f64 len = ref_norm(draw, 4);
+    for (u32 i = 0; i < 4; i++) want[i] = draw[i] / len;
+    PROPERTY(near_all(normalize_qf(raw).elements, want, 4, 1.0, TOL));
+
+    Vec3F v = v3f(prop_f32(-10, 10), prop_f32(-10, 10), prop_f32(-10, 10));
+    f64 dv[3], rot[9], rv[3];
+    widen(v.elements, dv, 3);
+    ref_quat_mat(da, rot);
+    ref_transform(rot, dv, rv, 3);
+    PROPERTY(near_all(rotate_qf(a, v).elements, rv, 3, 20.0, TOL));
+
+    // Both interpolations take the short way round
+    f64 sign = ref_dot(da, db, 4) < 0.0 ? -1.0 : 1.0;
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] * (1.0 - t) + db[i] * sign * t;
+    len = ref_norm(want, 4);
+    for (u32 i = 0; i < 4; i++) want[i] /= len;
+    PROPERTY(near_all(nlerp_qf(a, b, t).elements, want, 4, 1.0, TOL));
+
+    f64 cos_theta = fabs(ref_dot(da, db, 4));
+    if (cos_theta < 0.999)
+    {
+      f64 theta = acos(cos_theta);
+      f64 wa = sin(theta * (1.0 - t)) / sin(theta);
+      f64 wb = sin(theta * t) / sin(theta) * sign;
+      for (u32 i = 0; i < 4; i++) want[i] = da[i] * wa + db[i] * wb;
+      PROPERTY(near_all(slerp_qf(a, b, t).elements, want, 4, 1.0, 1e-4));
+    }
+
+    Mat4x4F m = m4x4f_from_qf(a);
+    for (u32 i = 0; i < 3; i++)
+    {
+      PROPERTY(near_all(m.elements[i], &rot[i * 3], 3, 1.0, TOL));
+    }
+
+    // q and -q are the same rotation
+    QuatF back = qf_from_4x4f(m);
+    f64 flip = dot_qf(back, a) < 0.0f ? -1.0 : 1.0;
+    for (u32 i = 0; i < 4; i++) want[i] = da[i] * flip;
+    PROPERTY(near_all(back.elements, want, 4, 1.0, 1e-5));
+
+    Vec3F tr = v3f(prop_f32(-100, 100), prop_f32(-100, 100), prop_f32(-100, 100));
+    Vec3F sc = v3f(prop_f32(-4, 4), prop_f32(-4, 4), prop_f32(-4, 4));
+    f64 trs[16] = {0};
+    for (u32 r = 0; r < 3; r++)
+    {
+      for (u32 c = 0; c < 3; c++) trs[r * 4 + c] = rot[r * 3 + c] * sc.elements[c];
+      trs[r * 4 + 3] = tr.elements[r];
+    }
+    trs[15] = 1.0;
+    Mat4x4F got = trs_4x4f(tr, a, sc);
+    PROPERTY(near_all(&got.elements[0][0], trs, 16, 100.0, TOL));
+  }
+
+  // The batch path must match the scalar one, including the tail
+  Vec3F t[7], s[7];
+  QuatF r[7];
+  Mat4x4F batch[7];
+  for (u32 i = 0; i < 7; i++)
+  {
+    t[i] = v3f(prop_f32(-10, 10), prop_f32(-10, 10), prop_f32(-10, 10));
+    s[i] = v3f(prop_f32(0.1f, 3), prop_f32(0.1f, 3), prop_f32(0.1f, 3));
+    r[i] = prop_qf();
+  }
+  trs_batch_4x4f(t, r, s, batch, 7);
+  for (u32 run = 0; run < 7; run++)
+  {
+    Mat4x4F one = trs_4x4f(t[run], r[run], s[run]);
+    f64 want[16];
+    widen(&one.elements[0][0], want, 16);
+    PROPERTY(near_all(&batch[run].elements[0][0], want, 16, 10.0, TOL));
+  }
+}
+
+// @Trig ====================================================================================
+
+static
+void test_trig_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    f32 x[8], s[8], c[8];
+    for (u32 i = 0; i < 8; i++) x[i] = prop_f32(-1000, 1000);
+
+    for (u32 p = 0; p < 2; p++)
+    {
+      TrigPrecision precision = p ? TRIG_FAST : TRIG_PRECISE;
+      f64 tol = p ? 2e-3 : 2e-6;
+
+      sincos_f32(x[0], precision, &s[0], &c[0]);
+      PROPERTY(near_one(s[0], sin(x[0]), 1.0, tol) && near_one(c[0], cos(x[0]), 1.0, tol));
+
+      sincos_4f32(x, precision, s, c);
+      for (u32 i = 0; i < 4; i++)
+      {
+        PROPERTY(near_one(s[i], sin(x[i]), 1.0, tol) && near_one(c[i], cos(x[i]), 1.0, tol));
+      }
+
+      sincos_8f32(x, precision, s, c);
+      for (u32 i = 0; i < 8; i++)
+      {
+        PROPERTY(near_one(s[i], sin(x[i]), 1.0, tol) && near_one(c[i], cos(x[i]), 1.0, tol));
+      }
+    }
+  }
+}
+
+// @Bounds ==================================================================================
+
+static
+AABB3F prop_aabb3f(void)
+{
+  Vec3F c = v3f(prop_f32(-50, 50), prop_f32(-50, 50), prop_f32(-50, 50));
+  Vec3F e = v3f(prop_f32(0, 20), prop_f32(0, 20), prop_f32(0, 20));
+  return (AABB3F) {sub_3f(c, e), add_3f(c, e)};
+}
+
+static
+void test_bounds_properties(void)
+{
+  for (u32 run = 0; run < RUNS; run++)
+  {
+    AABB3F a = prop_aabb3f();
+    AABB3F b = prop_aabb3f();
+    AABB2F a2 = {{a.min.x, a.min.y}, {a.max.x, a.max.y}};
+    AABB2F b2 = {{b.min.x, b.min.y}, {b.max.x, b.max.y}};
+
+    bool overlap_x = a.min.x <= b.max.x && b.min.x <= a.max.x;
+    bool overlap_y = a.min.y <= b.max.y && b.min.y <= a.max.y;
+    bool overlap_z = a.min.z <= b.max.z && b.min.z <= a.max.z;
+    PROPERTY(overlap_aabb2f(a2, b2) == (overlap_x && overlap_y));
+    PROPERTY(overlap_aabb3f(a, b) == (overlap_x && overlap_y && overlap_z));
+
+    AABB3F u = union_aabb3f(a, b);
+    for (u32 i = 0; i < 3; i++)
+    {
+      PROPERTY(u.min.elements[i] == fminf(a.min.elements[i], b.min.elements[i]));
+      PROPERTY(u.max.elements[i] == fmaxf(a.max.elements[i], b.max.elements[i]));
+    }
+    PROPERTY(contains_aabb3f(u, a) && contains_aabb3f(u, b));
+    PROPERTY(contains_aabb3f(a, b) == (contains_aabb3f(u, b) && u.min.x == a.min.x &&
+                                       u.min.y == a.min.y && u.min.z == a.min.z &&
+                                       u.max.x == a.max.x && u.max.y == a.max.y &&
+                                       u.max.z == a.max.z));
+
+    // Skip circles within rounding of the box edge
+    CircleF circle = {v2f(prop_f32(-80, 80), prop_f32(-80, 80)), prop_f32(0, 30)};
+    f64 dx = fmax(fmax(a2.min.x - (f64) circle.center.x, (f64) circle.center.x - a2.max.x), 0.0);
+    f64 dy = fmax(fmax(a2.min.y - (f64) circle.center.y, (f64) circle.center.y - a2.max.y), 0.0);
+    f64 gap = sqrt(dx * dx + dy * dy) - circle.radius;
+    if (fabs(gap) > 1e-3) PROPERTY(overlap_circle_aabb2f(circle, a2) == (gap <= 0.0));
+
+    // Transformed boxes are the tight bounds of the transformed corners
+    Affine2F xf = prop_a2f();
+    f64 xf_d[9];
+    widen_a2f(xf, xf_d);
+    f64 lo2[2] = {INFINITY, INFINITY}, hi2[2] = {-INFINITY, -INFINITY};
+    for (u32 k = 0; k < 4; k++)
+    {
+      f64 p[3] = {k & 1 ? a2.max.x : a2.min.x, k & 2 ? a2.max.y : a2.min.y, 1.0}, q[3];
+      ref_transform(xf_d, p, q, 3);
+      for (u32 i = 0; i < 2; i++)
+      {
+        lo2[i] = fmin(lo2[i], q[i]);
+        hi2[i] = fmax(hi2[i], q[i]);
+      }
+    }
+    AABB2F box2 = transform_aabb2f(a2, xf);
+    PROPERTY(near_all(box2.min.elements, lo2, 2, 1000.0, TOL) &&
+             near_all(box2.max.elements, hi2, 2, 1000.0, TOL));
+
+    Mat4x4F m = trs_4x4f(v3f(prop_f32(-50, 50), prop_f32(-50, 50), prop_f32(-50, 50)),
+                         prop_qf(), v3f(prop_f32(-3, 3), prop_f32(-3, 3), prop_f32(-3, 3)));
+    f64 md[16];
+    widen(&m.elements[0][0], md, 16);
+    f64 lo3[3] = {INFINITY, INFINITY, INFINITY}, hi3[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (u32 k = 0; k < 8; k++)
+    {
+      f64 p[4] =
+      {
+        k & 1 ? a.max.x : a.min.x, k & 2 ? a.max.y : a.min.y, k & 4 ? a.max.z : a.min.z, 1.0
+      };
+      f64 q[4];
+      ref_transform(md, p, q, 4);
+      for (u32 i = 0; i < 3; i++)
+      {
+        lo3[i] = fmin(lo3[i], q[i]);
+        hi3[i] = fmax(hi3[i], q[i]);
+      }
+    }
+    AABB3F box3 = transform_aabb3f(a, m);
+    PROPERTY(near_all(box3.min.elements, lo3, 3, 1000.0, TOL) &&
+             near_all(box3.max.elements, hi3, 3, 1000.0, TOL));
+  }
+}
+
+// @Culling =================================================================================
+
+static
+void test_culling_properties(void)
+{
+  Vec3F eye = v3f(3.0f, 4.0f, 30.0f);
+  Mat4x4F view = look_at_4x4f(eye, v3f(-2.0f, 1.0f, 0.0f), v3f(0.0f, 1.0f, 0.0f));
+  Mat4x4F view_proj = mul_4x4f(view, perspective_4x4f(65.0f, 1.5f, 0.5f, 150.0f));
+  FrustumF frustum = frustum_from_4x4f(view_proj);
+
+  // Planes are normalized and agree with clip space: a point is inside every
+  // plane exactly when -w <= x, y, z <= w
+  f64 vp[16];
+  widen(&view_proj.elements[0][0], vp, 16);
+  for (u32 run = 0; run < 6; run++)
+  {
+    const Vec4F *p = &frustum.planes[run];
+    f64 want[4];
+    for (u32 c = 0; c < 4; c++) want[c] = vp[12 + c] + (run % 2 ? -1.0 : 1.0) * vp[(run / 2) * 4 + c];
+    f64 len = ref_norm(want, 3);
+    for (u32 c = 0; c < 4; c++) want[c] /= len;
+    PROPERTY(near_all(p->elements, want, 4, fmax(1.0, fabs(want[3])), 1e-5));
+  }
+
+  const u32 count = 203;
+  SphereF spheres[203];
+  AABB3F boxes[203];
+  CircleF circles[203];
+  AABB2F rects[203];
+  u32 visible[203];
+  AABB2F view_2d = {v2f(-30, -20), v2f(25, 40)};
+
+  for (u32 run = 0; run < count; run++)
+  {
+    Vec3F c = v3f(prop_f32(-100, 100), prop_f32(-100, 100), prop_f32(-150, 40));
+    f32 r = prop_f32(0, 10);
+    spheres[run] = (SphereF) {c, r};
+    boxes[run] = (AABB3F) {sub_3f(c, v3f(r, r * 0.5f, r)), add_3f(c, v3f(r, r * 0.5f, r))};
+    circles[run] = (CircleF) {v2f(c.x, c.y), r};
+    rects[run] = (AABB2F) {v2f(c.x - r, c.y - r), v2f(c.x + r, c.y + r * 0.5f)};
+
+    // Reference plane distances in double, skipping spheres that graze a plane
+    f64 min_d = INFINITY;
+    for (u32 i = 0; i < 6; i++)
+    {
+      const Vec4F *p = &frustum.planes[i];
+      f64 d = (f64) p->x * c.x + (f64) p->y * c.y + (f64) p->z * c.z + p->w + r;
+      min_d = fmin(min_d, d);
+    }
+    if (fabs(min_d) > 1e-3) PROPERTY(sphere_in_frustum(&frustum, spheres[run]) == (min_d >= 0.0));
+
+    min_d = INFINITY;
+    for (u32 i = 0; i < 6; i++)
+    {
+      // The box corner furthest along the plane normal
+      const Vec4F *p = &frustum.planes[i];
+      f64 d = p->w;
+      for (u32 k = 0; k < 3; k++)
+      {
+        d += p->elements[k] * (f64) (p->elements[k] >= 0 ? boxes[run].max.elements[k]
+                                                          : boxes[run].min.elements[k]);
+      }
+      min_d = fmin(min_d, d);
+    }
+    if (fabs(min_d) > 1e-3) PROPERTY(aabb_in_frustum(&frustum, boxes[run]) == (min_d >= 0.0));
+  }
+
+  // Batch kernels list exactly the indices the scalar tests accept, in order
+  u32 run = 0;
+  u32 n = cull_spheres(&frustum, spheres, count, visible);
+  u32 m = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (sphere_in_frustum(&frustum, spheres[i])) PROPERTY(m < n && visible[m++] == i);
+  }
+  PROPERTY(m == n);
+
+  n = cull_aabbs(&frustum, boxes, count, visible);
+  m = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (aabb_in_frustum(&frustum, boxes[i])) PROPERTY(m < n && visible[m++] == i);
+  }
+  PROPERTY(m == n);
+
+  n = cull_circles_2d(view_2d, circles, count, visible);
+  m = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (overlap_circle_aabb2f(circles[i], view_2d)) PROPERTY(m < n && visible[m++] == i);
+  }
+  PROPERTY(m == n);
+
+  n = cull_aabbs_2d(view_2d, rects, count, visible);
+  m = 0;
+  for (u32 i = 0; i < count; i++)
+  {
+    if (overlap_aabb2f(rects[i], view_2d)) PROPERTY(m < n && visible[m++] == i);
+  }
+  PROPERTY(m == n);
+}
+
+i32 test_math_properties(void)
+{
+  property_failures = 0;
+
+  test_vec2_properties();
+  test_vec3_properties();
+  test_vec4_properties();
+  test_mat3_properties();
+  test_affine_properties();
+  test_mat4_properties();
+  test_quat_properties();
+  test_trig_properties();
+  test_bounds_properties();
+  test_culling_properties();
+
+  return property_failures;
+}
+
+#ifdef TEST_MATH_LINKED
+i32 main(void)
+{
+  i32 failures = test_math_properties();
+
+  if (failures)
+  {
+    printf("%i properties failed!\n", failures);
+    return 1;
+  }
+
+  printf("All properties passed!\n");
+
+  return 0;
+}
+#endif
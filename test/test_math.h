@@ -0,0 +1,6 @@
+#pragma once
+
+#include "../src/base_common.h"
+
+// Returns the number of failed properties
+i32 test_math_properties(void);
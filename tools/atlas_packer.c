@@ -0,0 +1,368 @@
+// Packs a list of PNGs into atlas pages and emits a header with the sprite table.
+//
+//   AtlasPacker -o res/sprites -h src/sprites.h [-s 1024] [-p 2] [-e 1] a.png b.png ...
+//
+// Writes res/sprites_0.png, res/sprites_1.png, ... and src/sprites.h. Sprites are
+// named after their file without the extension, made into a C identifier.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "stb/stb_image.h"
+
+#include "../src/base_common.h"
+#include "../src/atlas.h"
+
+typedef struct Image Image;
+struct Image
+{
+  const i8 *path;
+  i8 name[128];
+  i32 width;
+  i32 height;
+  u8 *data;
+  i32 page;
+  AtlasRect rect;
+  u32 hash;
+};
+
+typedef struct Page Page;
+struct Page
+{
+  Skyline skyline;
+  u8 *pixels;
+  i64 used_area;
+};
+
+static i32 compare_height(const void *a, const void *b);
+static i32 compare_hash(const void *a, const void *b);
+static void blit_extruded(Page *page, i32 size, Image *image, i32 extrude);
+static bool write_png(const i8 *path, u8 *pixels, i32 width, i32 height);
+static void c_identifier(i8 *out, u64 size, const i8 *in, const i8 *digit_prefix);
+
+i32 main(i32 argc, i8 **argv)
+{
+  const i8 *out_prefix = NULL;
+  const i8 *header_path = NULL;
+  i32 page_size = 1024;
+  i32 padding = 2;
+  i32 extrude = 1;
+
+  Image *images = malloc(sizeof (Image) * argc);
+  i32 image_count = 0;
+
+  for (i32 i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) out_prefix = argv[++i];
+    else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc) header_path = argv[++i];
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) page_size = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) padding = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) extrude = atoi(argv[++i]);
+    else images[image_count++] = (Image) {.path = argv[i]};
+  }
+
+  if (out_prefix == NULL || header_path == NULL || image_count == 0)
+  {
+    printf("usage: %s -o <out_prefix> -h <header> [-s size] [-p pad] [-e extrude] <png>...\n",
+           argv[0]);
+    return 1;
+  }
+
+  for (i32 i = 0; i < image_count; i++)
+  {
+    Image *image = &images[i];
+    i32 channels;
+    image->data = stbi_load(image->path, &image->width, &image->height, &channels, 4);
+    if (image->data == NULL)
+    {
+      printf("[AtlasPacker Error]: Failed to load %s\n", image->path);
+      return 1;
+    }
+
+    const i8 *base = strrchr(image->path, '/');
+    base = base ? base + 1 : image->path;
+    i8 stem[128];
+    snprintf(stem, sizeof (stem), "%s", base);
+    i8 *ext = strrchr(stem, '.');
+    if (ext) *ext = '\0';
+    c_identifier(image->name, sizeof (image->name), stem, "sprite_");
+    image->hash = atlas_hash(image->name);
+  }
+
+  // Equal names hash equal, so sorted by hash every collision is next to its twin
+  qsort(images, image_count, sizeof (Image), compare_hash);
+  for (i32 i = 1; i < image_count; i++)
+  {
+    if (images[i].hash == images[i - 1].hash)
+    {
+      printf("[AtlasPacker Error]: %s and %s both map to sprite %s\n", images[i - 1].path,
+             images[i].path, images[i].name);
+      return 1;
+    }
+  }
+
+  // Tallest first gives the skyline the flattest profile
+  qsort(images, image_count, sizeof (Image), compare_height);
+
+  i32 page_cap = image_count;
+  Page *pages = calloc(page_cap, sizeof (Page));
+  i32 page_count = 0;
+
+  for (i32 i = 0; i < image_count; i++)
+  {
+    Image *image = &images[i];
+    i32 w = image->width + extrude * 2 + padding;
+    i32 h = image->height + extrude * 2 + padding;
+
+    if (w > page_size || h > page_size)
+    {
+      printf("[AtlasPacker Error]: %s does not fit in a %i page\n", image->path, page_size);
+      return 1;
+    }
+
+    AtlasRect rect;
+    i32 p = 0;
+    for (; p < page_count; p++)
+    {
+      if (skyline_insert(&pages[p].skyline, w, h, &rect)) break;
+    }
+
+    if (p == page_count)
+    {
+      pages[p].skyline = skyline_create(page_size, page_size);
+      pages[p].pixels = calloc((u64) page_size * page_size, 4);
+      page_count++;
+      skyline_insert(&pages[p].skyline, w, h, &rect);
+    }
+
+    image->page = p;
+    image->rect = (AtlasRect) {rect.x + extrude, rect.y + extrude, image->width, image->height};
+    pages[p].used_area += (i64) image->width * image->height;
+    blit_extruded(&pages[p], page_size, image, extrude);
+  }
+
+  i8 path[512];
+  for (i32 p = 0; p < page_count; p++)
+  {
+    snprintf(path, sizeof (path), "%s_%i.png", out_prefix, p);
+    if (!write_png(path, pages[p].pixels, page_size, page_size))
+    {
+      printf("[AtlasPacker Error]: Failed to write %s\n", path);
+      return 1;
+    }
+
+    printf("%s: %.1f%% occupied\n", path,
+           skyline_occupancy(&pages[p].skyline, pages[p].used_area) * 100.0f);
+  }
+
+  qsort(images, image_count, sizeof (Image), compare_hash);
+
+  const i8 *base = strrchr(out_prefix, '/');
+  i8 var[128];
+  c_identifier(var, sizeof (var), base ? base + 1 : out_prefix, "atlas_");
+
+  FILE *header = fopen(header_path, "w");
+  if (header == NULL)
+  {
+    printf("[AtlasPacker Error]: Failed to write %s\n", header_path);
+    return 1;
+  }
+
+  fprintf(header, "// Generated by AtlasPacker. Do not edit.\n\n");
+  fprintf(header, "#pragma once\n\n#include \"atlas.h\"\n\n");
+  fprintf(header, "#define %s_PAGE_COUNT %i\n", var, page_count);
+  fprintf(header, "#define %s_SPRITE_COUNT %i\n\n", var, image_count);
+
+  fprintf(header, "static const i8 *%s_pages[%i] =\n{\n", var, page_count);
+  for (i32 p = 0; p < page_count; p++)
+  {
+    fprintf(header, "  \"%s_%i.png\",\n", out_prefix, p);
+  }
+  fprintf(header, "};\n\n");
+
+  fprintf(header, "static const AtlasSprite %s_sprites[%i] =\n{\n", var, image_count);
+  for (i32 i = 0; i < image_count; i++)
+  {
+    Image *image = &images[i];
+    AtlasRect r = image->rect;
+    fprintf(header, "  {0x%08xu, %i, %i, %i, %i, %i, {%ff, %ff, %ff, %ff}, \"%s\"},\n",
+            image->hash, image->page, r.x, r.y, r.w, r.h,
+            (f32) r.x / page_size,
+            (f32) r.y / page_size,
+            (f32) (r.x + r.w) / page_size,
+            (f32) (r.y + r.h) / page_size,
+            image->name);
+  }
+  fprintf(header, "};\n");
+  fclose(header);
+
+  printf("Packed %i sprites into %i pages!\n", image_count, page_count);
+
+  return 0;
+}
+
+static
+i32 compare_height(const void *a, const void *b)
+{
+  const Image *ia = a;
+  const Image *ib = b;
+  if (ia->height != ib->height) return ib->height - ia->height;
+  return ib->width - ia->width;
+}
+
+static
+i32 compare_hash(const void *a, const void *b)
+{
+  u32 ha = ((const Image *) a)->hash;
+  u32 hb = ((const Image *) b)->hash;
+  return (ha > hb) - (ha < hb);
+}
+
+// Names end up in the header as identifiers and string literals, so anything
+// outside [A-Za-z0-9_] becomes '_' and a leading digit gets `digit_prefix`
+static
+void c_identifier(i8 *out, u64 size, const i8 *in, const i8 *digit_prefix)
+{
+  snprintf(out, size, "%s%s", in[0] >= '0' && in[0] <= '9' ? digit_prefix : "", in);
+  for (i8 *c = out; *c; c++)
+  {
+    bool valid = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                 (*c >= '0' && *c <= '9') || *c == '_';
+    if (!valid) *c = '_';
+  }
+}
+
+// Copies the image into the page and repeats its edge pixels outward so bilinear
+// filtering at the sprite border never samples a neighbour.
+static
+void blit_extruded(Page *page, i32 size, Image *image, i32 extrude)
+{
+  AtlasRect r = image->rect;
+
+  for (i32 y = -extrude; y < r.h + extrude; y++)
+  {
+    i32 sy = y < 0 ? 0 : (y >= r.h ? r.h - 1 : y);
+    for (i32 x = -extrude; x < r.w + extrude; x++)
+    {
+      i32 sx = x < 0 ? 0 : (x >= r.w ? r.w - 1 : x);
+      u8 *src = &image->data[((u64) sy * r.w + sx) * 4];
+      u8 *dst = &page->pixels[((u64) (r.y + y) * size + (r.x + x)) * 4];
+      memcpy(dst, src, 4);
+    }
+  }
+}
+
+// @PNG =====================================================================================
+
+static u32 crc_table[256];
+
+static
+u32 crc32_update(u32 crc, const u8 *data, u64 len)
+{
+  if (crc_table[1] == 0)
+  {
+    for (u32 n = 0; n < 256; n++)
+    {
+      u32 c = n;
+      for (u32 k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      crc_table[n] = c;
+    }
+  }
+
+  for (u64 i = 0; i < len; i++) crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+  return crc;
+}
+
+static
+void put_u32_be(u8 *dst, u32 v)
+{
+  dst[0] = v >> 24;
+  dst[1] = v >> 16;
+  dst[2] = v >> 8;
+  dst[3] = v;
+}
+
+static
+void write_chunk(FILE *file, const i8 *type, const u8 *data, u32 len)
+{
+  u8 header[8];
+  put_u32_be(header, len);
+  memcpy(header + 4, type, 4);
+  fwrite(header, 1, 8, file);
+  if (len) fwrite(data, 1, len, file);
+
+  u32 crc = crc32_update(0xFFFFFFFFu, (const u8 *) type, 4);
+  crc = crc32_update(crc, data, len) ^ 0xFFFFFFFFu;
+  u8 footer[4];
+  put_u32_be(footer, crc);
+  fwrite(footer, 1, 4, file);
+}
+
+// Writes an RGBA8 PNG using stored (uncompressed) deflate blocks.
+static
+bool write_png(const i8 *path, u8 *pixels, i32 width, i32 height)
+{
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) return FALSE;
+
+  static const u8 signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+  fwrite(signature, 1, 8, file);
+
+  u8 ihdr[13];
+  put_u32_be(ihdr, width);
+  put_u32_be(ihdr + 4, height);
+  ihdr[8] = 8;  // bit depth
+  ihdr[9] = 6;  // RGBA
+  ihdr[10] = 0;
+  ihdr[11] = 0;
+  ihdr[12] = 0;
+  write_chunk(file, "IHDR", ihdr, 13);
+
+  u64 row = (u64) width * 4 + 1;
+  u64 raw_len = row * height;
+  u64 block_count = (raw_len + 65534) / 65535;
+  u64 idat_len = 2 + raw_len + block_count * 5 + 4;
+  u8 *idat = malloc(idat_len);
+  u8 *out = idat;
+
+  *out++ = 0x78;
+  *out++ = 0x01;
+
+  u32 a = 1;
+  u32 b = 0;
+  u64 remaining = raw_len;
+  u64 pos = 0;
+
+  while (remaining > 0)
+  {
+    u16 len = remaining > 65535 ? 65535 : (u16) remaining;
+    remaining -= len;
+    *out++ = remaining == 0;
+    *out++ = len & 0xFF;
+    *out++ = len >> 8;
+    *out++ = ~len & 0xFF;
+    *out++ = (~len >> 8) & 0xFF;
+
+    for (u16 i = 0; i < len; i++, pos++)
+    {
+      u64 x = pos % row;
+      u8 byte = x == 0 ? 0 : pixels[(pos / row) * (row - 1) + x - 1];
+      *out++ = byte;
+      a = (a + byte) % 65521;
+      b = (b + a) % 65521;
+    }
+  }
+
+  put_u32_be(out, (b << 16) | a);
+  write_chunk(file, "IDAT", idat, (u32) idat_len);
+  write_chunk(file, "IEND", NULL, 0);
+
+  free(idat);
+  fclose(file);
+
+  return TRUE;
+}
@@ -0,0 +1,106 @@
+// Encodes a PNG into a TEXC container, optionally with a full mip chain.
+//
+//   TexCompress [-f bc1|bc3|bc7|rgba8] [-m] in.png out.tex
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#include "stb/stb_image.h"
+
+#include "../src/base_common.h"
+#include "../src/image.h"
+
+static f64 psnr_rgba8(const u8 *a, const u8 *b, u64 count);
+
+i32 main(i32 argc, i8 **argv)
+{
+  ImageFormat format = IMAGE_FORMAT_BC7;
+  bool mips = FALSE;
+  const i8 *in_path = NULL;
+  const i8 *out_path = NULL;
+
+  for (i32 i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-m") == 0) mips = TRUE;
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+    {
+      i++;
+      if (strcmp(argv[i], "bc1") == 0) format = IMAGE_FORMAT_BC1;
+      else if (strcmp(argv[i], "bc3") == 0) format = IMAGE_FORMAT_BC3;
+      else if (strcmp(argv[i], "bc7") == 0) format = IMAGE_FORMAT_BC7;
+      else if (strcmp(argv[i], "rgba8") == 0) format = IMAGE_FORMAT_RGBA8;
+    }
+    else if (in_path == NULL) in_path = argv[i];
+    else out_path = argv[i];
+  }
+
+  if (in_path == NULL || out_path == NULL)
+  {
+    printf("usage: %s [-f bc1|bc3|bc7|rgba8] [-m] <in.png> <out.tex>\n", argv[0]);
+    return 1;
+  }
+
+  i32 width, height, channels;
+  u8 *rgba = stbi_load(in_path, &width, &height, &channels, 4);
+  if (rgba == NULL)
+  {
+    printf("[TexCompress Error]: Failed to load %s\n", in_path);
+    return 1;
+  }
+
+  clock_t start = clock();
+  Image image = img_compress(format, rgba, width, height, mips);
+  f64 encode_ms = (f64) (clock() - start) / CLOCKS_PER_SEC * 1000.0;
+
+  u64 raw_bytes = 0;
+  u64 packed_bytes = 0;
+  for (u32 i = 0; i < image.level_count; i++)
+  {
+    raw_bytes += (u64) image.levels[i].width * image.levels[i].height * 4;
+    packed_bytes += image.levels[i].size;
+  }
+
+  u8 *decoded = malloc((u64) width * height * 4);
+  img_decode(format, image.levels[0].data, width, height, decoded);
+
+  if (!img_save(out_path, &image))
+  {
+    printf("[TexCompress Error]: Failed to write %s\n", out_path);
+    return 1;
+  }
+
+  printf("%s: %ix%i, %u levels\n", out_path, width, height, image.level_count);
+  printf("  RGBA8 %llu KiB -> %llu KiB (%.1fx), %.1f dB PSNR, %.1f ms\n",
+         (unsigned long long) raw_bytes / 1024,
+         (unsigned long long) packed_bytes / 1024,
+         (f64) raw_bytes / packed_bytes,
+         psnr_rgba8(rgba, decoded, (u64) width * height * 4),
+         encode_ms);
+
+  img_free(&image);
+  free(decoded);
+  stbi_image_free(rgba);
+
+  return 0;
+}
+
+static
+f64 psnr_rgba8(const u8 *a, const u8 *b, u64 count)
+{
+  f64 mse = 0.0;
+  for (u64 i = 0; i < count; i++)
+  {
+    f64 d = (f64) a[i] - b[i];
+    mse += d * d;
+  }
+
+  mse /= count;
+  if (mse == 0.0) return 99.0;
+
+  return 10.0 * log10(255.0 * 255.0 / mse);
+}